@@ -1,16 +1,32 @@
 #include <iostream>
+#include <fstream>
 #include <functional>
 #include <string>
 #include <cstring>  // for std::strcmp
+#include <cstdlib>  // for std::strtoul
 #include "etcoverage.h"
 #include "conductor/interface.h"
 #include "pass/aflcoverage.h"
+#include "pass/aflforkserver.h"
 #include "pass/ldsorefs.h"
 #include "pass/ifuncplts.h"
 #include "log/registry.h"
 #include "log/temp.h"
 
-static void parse(const std::string& filename, const std::string& output, bool quiet) {
+struct CoverageOptions {
+    AFLCoveragePass::Mode mode;
+    bool pruned;
+    std::string idTable;
+    std::string forkServer;     // empty for none
+    unsigned long iterations;
+
+    CoverageOptions() : mode(AFLCoveragePass::MODE_HASH), pruned(false),
+        iterations(1) {}
+};
+
+static void parse(const std::string& filename, const std::string& output,
+    bool quiet, const CoverageOptions &options) {
+
     std::cout << "Instrumenting file [" << filename << "]\n";
 
     // Set logging levels according to quiet and EGALITO_DEBUG env var.
@@ -37,9 +53,23 @@ static void parse(const std::string& filename, const std::string& output, bool q
         // Apply transformations.
         auto program = egalito.getProgram();
         std::cout << "Adding coverage calls...\n";
-        AFLCoveragePass aflCoverage;
+        AFLCoveragePass aflCoverage(options.mode, options.pruned);
         program->accept(&aflCoverage);
 
+        if(!options.idTable.empty()) {
+            std::cout << "Writing block IDs to [" << options.idTable << "]...\n";
+            std::ofstream idFile(options.idTable.c_str());
+            aflCoverage.writeIDTable(idFile);
+        }
+
+        if(!options.forkServer.empty()) {
+            std::cout << "Adding fork server at [" << options.forkServer
+                << "]...\n";
+            AFLForkServerPass forkServer(options.forkServer,
+                options.iterations);
+            program->accept(&forkServer);
+        }
+
         // Generate output, mirrorgen or uniongen. If only one argument is
         // given to generate(), automatically guess based on whether multiple
         // Modules are present.
@@ -59,6 +89,12 @@ static void printUsage(const char *program) {
         "Options:\n"
         "    -v     Verbose mode, print logging messages\n"
         "    -q     Quiet mode (default), suppress logging messages\n"
+        "    --pruned        Only instrument blocks needed to recover coverage\n"
+        "    --counters      Inline 8-bit counter per block instead of edge hash\n"
+        "    --ids=FILE      Write the block ID table to FILE\n"
+        "    --fork-server[=FUNC]  Start an AFL fork server on entry to FUNC\n"
+        "                    (default main)\n"
+        "    --persistent=N  Run FUNC N times per fork (implies --fork-server)\n"
         "Note: the EGALITO_DEBUG variable is also honoured.\n";
 }
 
@@ -74,6 +110,7 @@ int main(int argc, char *argv[]) {
     }
 
     bool quiet = true;
+    CoverageOptions options;
 
     struct {
         const char *str;
@@ -82,11 +119,28 @@ int main(int argc, char *argv[]) {
         // should we show debugging log messages?
         {"-v", [&quiet] () { quiet = false; }},
         {"-q", [&quiet] () { quiet = true; }},
+
+        {"--pruned", [&options] () { options.pruned = true; }},
+        {"--counters", [&options] () {
+            options.mode = AFLCoveragePass::MODE_COUNTERS; }},
     };
 
     for(int a = 1; a < argc; a ++) {
         const char *arg = argv[a];
-        if(arg[0] == '-') {
+        if(std::strncmp(arg, "--ids=", 6) == 0) {
+            options.idTable = arg + 6;
+        }
+        else if(std::strcmp(arg, "--fork-server") == 0) {
+            options.forkServer = "main";
+        }
+        else if(std::strncmp(arg, "--fork-server=", 14) == 0) {
+            options.forkServer = arg + 14;
+        }
+        else if(std::strncmp(arg, "--persistent=", 13) == 0) {
+            options.iterations = std::strtoul(arg + 13, nullptr, 0);
+            if(options.forkServer.empty()) options.forkServer = "main";
+        }
+        else if(arg[0] == '-') {
             bool found = false;
             for(auto action : actions) {
                 if(std::strcmp(arg, action.str) == 0) {
@@ -100,7 +154,7 @@ int main(int argc, char *argv[]) {
             }
         }
         else if(argv[a] && argv[a + 1]) {
-            parse(argv[a], argv[a + 1], quiet);
+            parse(argv[a], argv[a + 1], quiet, options);
             break;
         }
         else {
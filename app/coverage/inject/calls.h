@@ -7,6 +7,13 @@ void exit(int status);
 void *shmat(int shmid, const void *shmaddr, int shmflg);
 int shmdt(const void *shmaddr);
 ssize_t write(int fd, const void *buf, size_t count);
+ssize_t read(int fd, void *buf, size_t count);
+int close(int fd);
+pid_t fork(void);
+struct rusage;
+pid_t wait4(pid_t pid, int *status, int options, struct rusage *rusage);
+int kill(pid_t pid, int sig);
+pid_t getpid(void);
 void *__mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
 
 #define stdout 1
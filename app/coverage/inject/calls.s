@@ -2,11 +2,23 @@
 .global shmdt
 .global exit
 .global write
+.global read
+.global close
+.global fork
+.global wait4
+.global kill
+.global getpid
 .global __mmap
 .hidden shmat
 .hidden shmdt
 .hidden exit
 .hidden write
+.hidden read
+.hidden close
+.hidden fork
+.hidden wait4
+.hidden kill
+.hidden getpid
 .hidden __mmap
 
 .section .text
@@ -43,6 +55,61 @@ write:
     pop     %rcx
     retq
 
+read:
+    push    %rcx
+    push    %r11
+    mov     $0, %rax    # read
+    syscall             # other args in %rdi, %rsi, %rdx
+    pop     %r11
+    pop     %rcx
+    retq
+
+close:
+    push    %rcx
+    push    %r11
+    mov     $3, %rax    # close
+    syscall             # other arg in %rdi
+    pop     %r11
+    pop     %rcx
+    retq
+
+fork:
+    push    %rcx
+    push    %r11
+    mov     $57, %rax   # fork
+    syscall
+    pop     %r11
+    pop     %rcx
+    retq
+
+wait4:
+    push    %rcx
+    push    %r11
+    mov     %rcx, %r10
+    mov     $61, %rax   # wait4
+    syscall             # other args in %rdi, %rsi, %rdx, %r10
+    pop     %r11
+    pop     %rcx
+    retq
+
+kill:
+    push    %rcx
+    push    %r11
+    mov     $62, %rax   # kill
+    syscall             # other args in %rdi, %rsi
+    pop     %r11
+    pop     %rcx
+    retq
+
+getpid:
+    push    %rcx
+    push    %r11
+    mov     $39, %rax   # getpid
+    syscall
+    pop     %r11
+    pop     %rcx
+    retq
+
 __mmap:
     push    %rcx
     push    %r11
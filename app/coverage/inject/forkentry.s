@@ -0,0 +1,105 @@
+# Entry into the AFL fork server. AFLForkServerPass puts
+#     push    $iterations
+#     call    egalito_forkserver_entry
+# at the start of the fork server function, so on entry the stack holds
+# the address of the function body, the iteration count, and the
+# function's own return address.
+#
+# The argument registers are saved in this layout, which egalito_call_body
+# reloads them from:
+#     0   rdi, rsi, rdx, rcx, r8, r9
+#     48  rax (vector register count for varargs)
+#     64  xmm0-xmm7
+
+.global egalito_forkserver_entry
+.global egalito_call_body
+.hidden egalito_call_body
+.type egalito_forkserver_entry, @function
+.type egalito_call_body, @function
+
+.section .text
+
+egalito_forkserver_entry:
+    cmpb    $0, egalito_forkserver_started(%rip)
+    jne     1f                  # recursive call, or the server is running
+    push    %rbp
+    mov     %rsp, %rbp
+    sub     $192, %rsp          # keeps the stack 16-byte aligned
+    mov     %rdi, 0(%rsp)
+    mov     %rsi, 8(%rsp)
+    mov     %rdx, 16(%rsp)
+    mov     %rcx, 24(%rsp)
+    mov     %r8, 32(%rsp)
+    mov     %r9, 40(%rsp)
+    mov     %rax, 48(%rsp)
+    movaps  %xmm0, 64(%rsp)
+    movaps  %xmm1, 80(%rsp)
+    movaps  %xmm2, 96(%rsp)
+    movaps  %xmm3, 112(%rsp)
+    movaps  %xmm4, 128(%rsp)
+    movaps  %xmm5, 144(%rsp)
+    movaps  %xmm6, 160(%rsp)
+    movaps  %xmm7, 176(%rsp)
+    mov     8(%rbp), %rdi       # the function body, just past our call
+    mov     16(%rbp), %rsi      # iteration count
+    mov     %rsp, %rdx          # saved arguments
+    call    egalito_forkserver
+    mov     %rax, %r11
+    movaps  64(%rsp), %xmm0
+    movaps  80(%rsp), %xmm1
+    movaps  96(%rsp), %xmm2
+    movaps  112(%rsp), %xmm3
+    movaps  128(%rsp), %xmm4
+    movaps  144(%rsp), %xmm5
+    movaps  160(%rsp), %xmm6
+    movaps  176(%rsp), %xmm7
+    mov     0(%rsp), %rdi
+    mov     8(%rsp), %rsi
+    mov     16(%rsp), %rdx
+    mov     24(%rsp), %rcx
+    mov     32(%rsp), %r8
+    mov     40(%rsp), %r9
+    mov     48(%rsp), %rax
+    leave
+    test    %r11d, %r11d        # egalito_forkserver returns an int
+    jnz     2f
+1:  retq    $8                  # run the body once, as if nothing happened
+2:  mov     egalito_persistent_result(%rip), %rax
+    mov     egalito_persistent_result+8(%rip), %rdx
+    movaps  egalito_persistent_result+16(%rip), %xmm0
+    movaps  egalito_persistent_result+32(%rip), %xmm1
+    add     $16, %rsp           # the loop already ran the body, return
+    retq                        # straight to the function's caller
+.size egalito_forkserver_entry, .-egalito_forkserver_entry
+
+# void egalito_call_body(void *body, long *arguments)
+# Keeps every register the body may return a value in (rax, rdx, xmm0,
+# xmm1) in egalito_persistent_result.
+egalito_call_body:
+    push    %rbp
+    mov     %rsp, %rbp
+    mov     %rdi, %r11
+    mov     %rsi, %r10
+    movups  64(%r10), %xmm0
+    movups  80(%r10), %xmm1
+    movups  96(%r10), %xmm2
+    movups  112(%r10), %xmm3
+    movups  128(%r10), %xmm4
+    movups  144(%r10), %xmm5
+    movups  160(%r10), %xmm6
+    movups  176(%r10), %xmm7
+    mov     (%r10), %rdi
+    mov     8(%r10), %rsi
+    mov     16(%r10), %rdx
+    mov     24(%r10), %rcx
+    mov     32(%r10), %r8
+    mov     40(%r10), %r9
+    mov     48(%r10), %rax
+    call    *%r11
+    mov     %rax, egalito_persistent_result(%rip)
+    mov     %rdx, egalito_persistent_result+8(%rip)
+    movaps  %xmm0, egalito_persistent_result+16(%rip)
+    movaps  %xmm1, egalito_persistent_result+32(%rip)
+    pop     %rbp
+    retq
+.size egalito_call_body, .-egalito_call_body
@@ -0,0 +1,87 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include "calls.h"
+
+#define EGALITO_MAP_BASE 0x50000000
+#define EGALITO_PREV_LOCATION (EGALITO_MAP_BASE - 0x1000)
+
+/* AFL's fork server protocol: the fuzzer writes 4 bytes to FORKSRV_FD
+    for each run, we answer on FORKSRV_FD + 1 with the child's pid and
+    then its wait status.
+*/
+#define FORKSRV_FD 198
+
+// afl-fuzz looks for this string to enable persistent mode
+const char egalito_persistent_signature[] = "##SIG_AFL_PERSISTENT##";
+
+// shared with egalito_forkserver_entry in forkentry.s
+#define HIDDEN __attribute__((visibility("hidden")))
+HIDDEN char egalito_forkserver_started = 0;
+// what the last run of the body returned in rax, rdx, xmm0 and xmm1
+HIDDEN long egalito_persistent_result[6] __attribute__((aligned(16)));
+
+HIDDEN void egalito_call_body(void *body, long *arguments);
+
+/* Returns 1 in each child. Returns 0 if no fuzzer is listening, in which
+    case the program just runs once.
+*/
+static int run_forkserver(int persistent) {
+    int message = 0;
+    if(write(FORKSRV_FD + 1, &message, 4) != 4) return 0;
+
+    pid_t child = -1;
+    int stopped = 0;
+    for(;;) {
+        int killed;
+        if(read(FORKSRV_FD, &killed, 4) != 4) exit(1);
+
+        int status;
+        if(stopped && killed) {
+            // the fuzzer timed out the stopped child, reap it
+            stopped = 0;
+            if(wait4(child, &status, 0, 0) < 0) exit(1);
+        }
+
+        if(stopped) {
+            kill(child, SIGCONT);
+            stopped = 0;
+        }
+        else {
+            child = fork();
+            if(child < 0) exit(1);
+            if(child == 0) {
+                close(FORKSRV_FD);
+                close(FORKSRV_FD + 1);
+                return 1;
+            }
+        }
+
+        if(write(FORKSRV_FD + 1, &child, 4) != 4) exit(1);
+        if(wait4(child, &status, persistent ? WUNTRACED : 0, 0) < 0) exit(1);
+        if(WIFSTOPPED(status)) stopped = 1;
+        if(write(FORKSRV_FD + 1, &status, 4) != 4) exit(1);
+    }
+}
+
+/* Called by egalito_forkserver_entry the first time the fork server
+    function is entered. With more than one iteration, each child runs the
+    function body that many times, stopping itself in between so the
+    fuzzer can collect the map, and returns 1 to skip the normal run.
+*/
+HIDDEN int egalito_forkserver(void *body, unsigned long iterations, long *arguments) {
+    egalito_forkserver_started = 1;
+
+    int persistent = (iterations > 1);
+    if(!run_forkserver(persistent)) return 0;
+    if(!persistent) return 0;
+
+    // the body may read (but must not modify) the saved arguments
+    volatile unsigned long *previous
+        = (volatile unsigned long *)EGALITO_PREV_LOCATION;
+    for(unsigned long i = 0; i < iterations; i++) {
+        if(i > 0) kill(getpid(), SIGSTOP);
+        *previous = 0;
+        egalito_call_body(body, arguments);
+    }
+    return 1;
+}
@@ -3,6 +3,9 @@
 #include "calls.h"
 
 #define EGALITO_MAP_BASE 0x50000000
+#ifndef SHM_REMAP
+#define SHM_REMAP 040000
+#endif
 //#define NULL (void *)0
 
 int strncmp(const char *one, const char *two, size_t n) {
@@ -46,7 +49,10 @@ void map_shmem(char *env) {
             write_string(stdout, "\n");
             int id = strtol(env + 12 + 1, NULL, 10);
             //printf("shmid=[%d]\n", id);
-            void *shm = shmat(id, (void *)EGALITO_MAP_BASE, SHM_RND);
+            // replaces any counter sections (etcoverage --counters)
+            // that were loaded inside the map
+            void *shm = shmat(id, (void *)EGALITO_MAP_BASE,
+                SHM_RND | SHM_REMAP);
             if (shm == (void *)-1) {
                 exit(-1);
             }
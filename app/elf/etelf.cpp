@@ -49,7 +49,9 @@ static void printUsage(const char *program) {
         "    -u     Perform union elf generation (merged output)\n"
         "    -v     Verbose mode, print logging messages\n"
         "    -q     Quiet mode (default), suppress logging messages\n"
-        "Note: the EGALITO_DEBUG variable is also honoured.\n";
+        "Note: the EGALITO_DEBUG variable is also honoured.\n"
+        "Set EGALITO_RELR=1 (or auto) to pack relative relocations into\n"
+        "DT_RELR in mirror output; this needs glibc 2.36 to run.\n";
 }
 
 int main(int argc, char *argv[]) {
@@ -55,6 +55,7 @@
 #include "pass/makecache.h"
 #include "pass/nonreturn.h"
 #include "pass/noppass.h"
+#include "pass/peephole.h"
 #include "pass/permutedata.h"
 #include "pass/populateplt.h"
 #include "pass/positiondump.h"
@@ -116,6 +117,8 @@ void PassCommands::makePassMap(EgalitoInterface *egalito) {
         [] (Chunk *chunk) { return new EndbrAddPass(); });
     passMap["endbrenforce"] = PassContext(true, {},
         [] (Chunk *chunk) { return new EndbrEnforcePass(); });
+    passMap["peephole"] = PassContext(true, {},
+        [] (Chunk *chunk) { return new PeepholePass(); });
     passMap["stackxor"] = PassContext({TYPE_Program},
         [] (Chunk *chunk) { return new StackXOR(0x28); });
     passMap["shadowstackconst"] = PassContext(true, {},
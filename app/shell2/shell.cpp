@@ -4,6 +4,7 @@
 #include "readline.h"
 #include "chunks.h"
 #include "passes.h"
+#include "util/profiler.h"
 #include "log/registry.h"
 
 #define DEBUG_GROUP shell
@@ -390,6 +391,7 @@ bool Shell2App::parseIndexArg(const std::string &arg,
 
 int main(int argc, char *argv[]) {
     SettingsParser().parseEnvVar("EGALITO_DEBUG");
+    EgalitoProfiler::getInstance()->parseEnvVar("EGALITO_PROFILE");
 
     std::cout << "Welcome to the egalito shell2 version "
         << _STRINGIZE2(GIT_VERSION) << ". Type \"help\" for usage.\n";
@@ -1,160 +1,247 @@
-#include <iomanip>
+#include <utility>
 #include "dominance.h"
-#include "walker.h"
 
 #include "log/log.h"
 
-Dominance::Dominance(ControlFlowGraph *cfg)
-    : cfg(cfg), idoms(cfg->getCount(), -1), idMap(cfg->getCount(), -1) {
-
-    SccOrder scc(cfg);
-    scc.gen(0);
-    LOG(10, "SCC");
-    for(auto sub : scc.get()) {
-        for(auto n : sub) {
-            LOG0(10, " " << std::setw(3) << n);
-        }
-        LOG(10, "");
-    }
+DominatorTree::DominatorTree(GraphBase *graph, int direction)
+    : haveFrontiers(false) {
 
-    ReversePostorder rpo(cfg);
-    rpo.gen(0);
-    auto order = rpo.get()[0];
-    for(size_t i = 0; i < order.size(); i++) {
-        idMap[order[i]] = i;
-    }
+    buildEdges(graph, direction);
+    computeIDoms();
+    numberTree();
+    IF_LOG(10) dump();
+}
 
-    LOG(10, "RPO");
-    for(auto n : order) {
-        LOG0(10, " " << std::setw(3) << n);
+void DominatorTree::buildEdges(GraphBase *graph, int direction) {
+    const id_t count = graph->getCount();
+    const bool virtualRoot = (direction < 0);
+    const size_t total = count + (virtualRoot ? 1 : 0);
+
+    succ.resize(total);
+    pred.resize(total);
+    for(id_t id = 0; id < count; id++) {
+        for(auto link : graph->get(id)->getLinks(direction)) {
+            auto target = link->getTargetID();
+            succ[id].push_back(target);
+            pred[target].push_back(id);
+        }
     }
-    LOG(10, "");
-
-    bool changed = true;
-    while(changed) {
-        changed = false;
-        for(auto id : order) {
-            LOG(10, "id = " << id);
-            if(id == 0) {
-                idoms[0] = 0;
-                continue;
-            }
-            auto node = cfg->get(id);
-            bool first = true;
-            ControlFlow::id_t idom = -1;
-            for(auto link : node->backwardLinks()) {
-                auto pred = link->getTargetID();
-                if(idoms[pred] != -1) {
-                    if(first) {
-                        idom = pred;
-                        first = false;
-                    }
-                    else {
-                        idom = intersect(pred, idom);
-                    }
-                }
-            }
 
-            if(idoms[id] != idom) {
-                idoms[id] = idom;
-                changed = true;
-                IF_LOG(10) dump();
+    if(virtualRoot) {
+        root = count;
+        for(id_t id = 0; id < count; id++) {
+            bool isExit = true;
+            for(auto link : graph->get(id)->getLinks(-direction)) {
+                (void)link;
+                isExit = false;
+                break;
+            }
+            if(isExit) {
+                succ[root].push_back(id);
+                pred[id].push_back(root);
             }
         }
     }
-
-    IF_LOG(10) dump();
+    else {
+        root = 0;
+    }
 }
 
-ControlFlow::id_t Dominance::intersect(ControlFlow::id_t i1,
-    ControlFlow::id_t i2) {
-
-    auto finger1 = i1;
-    auto finger2 = i2;
-
-    LOG(10, "intersect " << i1 << " " << i2);
+void DominatorTree::computeIDoms() {
+    const size_t total = succ.size();
+    idoms.assign(total, -1);
+    if(total == 0) return;
+
+    // number nodes in DFS preorder; all arrays below are indexed by dfnum
+    std::vector<int> dfnum(total, -1);
+    std::vector<id_t> vertex;
+    std::vector<int> parent;
+    vertex.reserve(total);
+    parent.reserve(total);
+
+    std::vector<std::pair<id_t, size_t>> stack;
+    dfnum[root] = 0;
+    vertex.push_back(root);
+    parent.push_back(-1);
+    stack.emplace_back(root, 0);
+    while(!stack.empty()) {
+        auto v = stack.back().first;
+        auto &next = stack.back().second;
+        if(next < succ[v].size()) {
+            auto w = succ[v][next++];
+            if(dfnum[w] == -1) {
+                dfnum[w] = vertex.size();
+                vertex.push_back(w);
+                parent.push_back(dfnum[v]);
+                stack.emplace_back(w, 0);
+            }
+        }
+        else {
+            stack.pop_back();
+        }
+    }
 
-    while(finger1 != finger2) {
-        if(idoms[finger1] == -1) return finger2;
-        if(idoms[finger2] == -1) return finger1;
+    const int n = vertex.size();
+    std::vector<int> semi(n), label(n), ancestor(n, -1), idom(n);
+    for(int i = 0; i < n; i++) {
+        semi[i] = i;
+        label[i] = i;
+    }
 
-        while(idoms[finger1] != -1 && idMap[finger1] > idMap[finger2]) {
-            finger1 = idoms[finger1];
+    // path-compressing eval over the forest of already processed nodes
+    std::vector<int> path;
+    auto eval = [&](int v) {
+        if(ancestor[v] == -1) return v;
+        path.clear();
+        for(int x = v; ancestor[ancestor[x]] != -1; x = ancestor[x]) {
+            path.push_back(x);
+        }
+        for(auto it = path.rbegin(); it != path.rend(); ++it) {
+            int x = *it;
+            int a = ancestor[x];
+            if(semi[label[a]] < semi[label[x]]) label[x] = label[a];
+            ancestor[x] = ancestor[a];
         }
-        while(idoms[finger2] != -1 && idMap[finger2] > idMap[finger1]) {
-            finger2 = idoms[finger2];
+        return label[v];
+    };
+
+    // semidominators, in reverse preorder
+    for(int i = n - 1; i > 0; i--) {
+        for(auto p : pred[vertex[i]]) {
+            int v = dfnum[p];
+            if(v == -1) continue;   // predecessor is unreachable
+            int u = eval(v);
+            if(semi[u] < semi[i]) semi[i] = semi[u];
         }
+        ancestor[i] = parent[i];
     }
-    return finger1;
-}
 
-std::vector<ControlFlow::id_t> Dominance::getDominators(ControlFlow::id_t id) {
-    std::vector<ControlFlow::id_t> doms;
+    // immediate dominator is the NCA of parent and semidominator
+    idom[0] = 0;
+    for(int i = 1; i < n; i++) {
+        idom[i] = parent[i];
+        while(idom[i] > semi[i]) idom[i] = idom[idom[i]];
+    }
 
-    while(id != 0) {
-        doms.push_back(id);
-        id = idoms[id];
+    for(int i = 0; i < n; i++) {
+        idoms[vertex[i]] = vertex[idom[i]];
     }
-    doms.push_back(0);
-    return doms;
 }
 
-std::vector<ControlFlow::id_t> Dominance::getPostDominators(
-    ControlFlow::id_t id) {
+void DominatorTree::numberTree() {
+    const size_t total = idoms.size();
+    preNum.assign(total, -1);
+    postNum.assign(total, -1);
+    if(total == 0) return;
 
-    Preorder po(cfg);
-    po.gen(0);
-    auto order = po.get()[0];
-    for(size_t i = 0; i < order.size(); i++) {
-        idMap[order[i]] = i;
+    std::vector<std::vector<id_t>> children(total);
+    for(id_t id = 0; id < static_cast<id_t>(total); id++) {
+        if(id != root && idoms[id] != -1) children[idoms[id]].push_back(id);
     }
 
-    std::vector<ControlFlowNode *> exitNodes;
-    for(auto nid : order) {
-        auto node = cfg->get(nid);
-        bool isExit = true;
-        for(auto link : node->forwardLinks()) {
-            (void)link;
-            isExit = false;
-            break;
+    int preCount = 0, postCount = 0;
+    std::vector<std::pair<id_t, size_t>> stack;
+    preNum[root] = preCount++;
+    stack.emplace_back(root, 0);
+    while(!stack.empty()) {
+        auto v = stack.back().first;
+        auto &next = stack.back().second;
+        if(next < children[v].size()) {
+            auto w = children[v][next++];
+            preNum[w] = preCount++;
+            stack.emplace_back(w, 0);
         }
-        if(isExit) {
-            exitNodes.push_back(node);
+        else {
+            postNum[v] = postCount++;
+            stack.pop_back();
         }
     }
-    if(exitNodes.empty()) { // due to not knowing non-returing call yet
-        return {};
+}
+
+const std::vector<DominatorTree::id_t> &DominatorTree::getFrontier(id_t id) {
+    if(!haveFrontiers) computeFrontiers();
+    return frontiers[id];
+}
+
+void DominatorTree::computeFrontiers() {
+    frontiers.assign(idoms.size(), std::vector<id_t>());
+    for(id_t b = 0; b < static_cast<id_t>(idoms.size()); b++) {
+        if(!isReachable(b)) continue;
+
+        // walk up from each predecessor until reaching idom(b); the root
+        // has no strict dominator, so a back edge to it reaches the root
+        for(auto p : pred[b]) {
+            if(!isReachable(p)) continue;
+            for(auto runner = p; ; runner = idoms[runner]) {
+                if(runner == idoms[b] && b != root) break;
+                auto &df = frontiers[runner];
+                if(df.empty() || df.back() != b) df.push_back(b);
+                if(runner == root) break;
+            }
+        }
     }
+    haveFrontiers = true;
+}
 
-    auto cap = [](std::vector<ControlFlow::id_t> v1,
-        std::vector<ControlFlow::id_t> v2) {
+void DominatorTree::dump() const {
+    LOG(1, "idoms (root " << root << ")");
+    for(auto i : idoms) {
+        LOG0(1, " " << i);
+    }
+    LOG(1, "");
+}
 
-        std::vector<ControlFlow::id_t> v;
-        std::set_intersection(v1.begin(), v1.end(), v2.begin(), v2.end(),
-            std::back_inserter(v));
+Dominance::Dominance(ControlFlowGraph *cfg)
+    : cfg(cfg), dom(cfg, 1), postDom(nullptr) {
 
-        return v;
-    };
+}
 
-    auto pdom = getDominators(exitNodes[0]->getID());
-    //pdom.erase(std::remove(pdom.begin(), pdom.end(), 0), pdom.end());
+Dominance::~Dominance() {
+    delete postDom;
+}
 
-    for(size_t i = 1; i <exitNodes.size(); i++) {
-        auto pdom2 = getDominators(exitNodes[i]->getID());
-        std::sort(pdom2.begin(), pdom2.end());
-        pdom = cap(pdom, pdom2);
-        if(pdom.empty()) break;
-    }
+DominatorTree *Dominance::getPostDom() {
+    if(!postDom) postDom = new DominatorTree(cfg, -1);
+    return postDom;
+}
 
-    return pdom;
+std::vector<ControlFlow::id_t> Dominance::getDominators(ControlFlow::id_t id) {
+    std::vector<ControlFlow::id_t> doms;
+    if(!dom.isReachable(id)) return doms;
+
+    while(id != dom.getRoot()) {
+        doms.push_back(id);
+        id = dom.getIDom(id);
+    }
+    doms.push_back(id);
+    return doms;
 }
 
+std::vector<ControlFlow::id_t> Dominance::getPostDominators(
+    ControlFlow::id_t id) {
+
+    // empty if no exit is reachable, e.g. non-returning calls not known yet
+    std::vector<ControlFlow::id_t> pdoms;
+    auto tree = getPostDom();
+    if(!tree->isReachable(id)) return pdoms;
 
-void Dominance::dump() {
-    LOG(1, "idoms");
-    for(auto i : idoms) {
-        LOG0(1, " " << i);
+    // stop before the virtual exit node
+    while(id != tree->getRoot()) {
+        pdoms.push_back(id);
+        id = tree->getIDom(id);
     }
-    LOG(1, "");
+    return pdoms;
 }
 
+ControlFlow::id_t Dominance::getImmediateDominator(
+    ControlFlow::id_t id) const {
+
+    if(id == dom.getRoot()) return -1;
+    return dom.getIDom(id);
+}
+
+ControlFlow::id_t Dominance::getImmediatePostDominator(ControlFlow::id_t id) {
+    auto tree = getPostDom();
+    auto ipdom = tree->getIDom(id);
+    return (ipdom == tree->getRoot()) ? -1 : ipdom;
+}
@@ -2,26 +2,79 @@
 #define EGALITO_ANALYSIS_DOMINANCE_H
 
 #include <vector>
-#include <set>
 #include "controlflow.h"
 
+/** Dominator tree over a graph, computed with the semi-NCA algorithm
+    (Lengauer-Tarjan semidominators followed by a nearest common ancestor
+    walk). The tree is numbered with DFS intervals so that dominates() is
+    O(1). Dominance frontiers are only computed when first requested.
+
+    With direction > 0 the tree is rooted at node 0; with direction < 0 it
+    is rooted at a virtual exit node (id == graph->getCount()) which has an
+    edge to every node without forward links, giving post-dominators.
+*/
+class DominatorTree {
+public:
+    using id_t = ControlFlow::id_t;
+private:
+    id_t root;
+    std::vector<std::vector<id_t>> succ;    // edges in walk direction
+    std::vector<std::vector<id_t>> pred;
+    std::vector<id_t> idoms;                // -1 if unreachable from root
+    std::vector<int> preNum;                // DFS interval on the tree
+    std::vector<int> postNum;
+    std::vector<std::vector<id_t>> frontiers;
+    bool haveFrontiers;
+public:
+    DominatorTree(GraphBase *graph, int direction = 1);
+
+    id_t getRoot() const { return root; }
+    bool isReachable(id_t id) const { return idoms[id] != -1; }
+    id_t getIDom(id_t id) const { return idoms[id]; }
+    bool dominates(id_t a, id_t b) const
+        { return isReachable(a) && isReachable(b)
+            && preNum[a] <= preNum[b] && postNum[b] <= postNum[a]; }
+    const std::vector<id_t> &getFrontier(id_t id);
+
+    void dump() const;
+private:
+    void buildEdges(GraphBase *graph, int direction);
+    void computeIDoms();
+    void numberTree();
+    void computeFrontiers();
+};
+
 class Dominance {
 public:
     using id_t = ControlFlow::id_t;
 
 private:
     ControlFlowGraph *cfg;
-    std::vector<id_t> idoms;    // immediate dominator
-    std::vector<id_t> idMap;    // id_t => order ID
+    DominatorTree dom;
+    DominatorTree *postDom;     // built on first use
 
 public:
     Dominance(ControlFlowGraph *cfg);
+    ~Dominance();
+
+    /** Returns id and all of its dominators, ending with the entry. */
     std::vector<id_t> getDominators(id_t id);
+    /** Returns id and all of its post-dominators, nearest first. */
     std::vector<id_t> getPostDominators(id_t id);
 
-private:
-    id_t intersect(id_t i1, id_t i2);
+    id_t getImmediateDominator(id_t id) const;
+    id_t getImmediatePostDominator(id_t id);
 
-    void dump();
+    bool dominates(id_t a, id_t b) const { return dom.dominates(a, b); }
+    bool postDominates(id_t a, id_t b)
+        { return getPostDom()->dominates(a, b); }
+
+    const std::vector<id_t> &getDominanceFrontier(id_t id)
+        { return dom.getFrontier(id); }
+    const std::vector<id_t> &getPostDominanceFrontier(id_t id)
+        { return getPostDom()->getFrontier(id); }
+private:
+    DominatorTree *getPostDom();
 };
+
 #endif
@@ -1,9 +1,11 @@
+#include <cstring>  // for std::strlen
 #include "liveregister.h"
 #include "analysis/usedef.h"
 #include "analysis/walker.h"
 #include "analysis/controlflow.h"
 #include "analysis/savedregister.h"
 #include "chunk/concrete.h"
+#include "instr/concrete.h"
 #include "instr/register.h"
 #include "instr/isolated.h"
 
@@ -91,3 +93,337 @@ void LiveInfo::live(int reg) {
         regs[reg] = 1;
     }
 }
+
+InstructionLiveRegister::InstructionLiveRegister(Function *function) {
+    detect(function);
+}
+
+LiveInfo InstructionLiveRegister::getLiveBefore(
+    Instruction *instruction) const {
+
+    auto it = liveBefore.find(instruction);
+    return (it != liveBefore.end()) ? (*it).second : LiveInfo();
+}
+
+LiveInfo InstructionLiveRegister::getLiveOut(Block *block) const {
+    auto it = liveOut.find(block);
+    return (it != liveOut.end()) ? (*it).second : LiveInfo();
+}
+
+#ifdef ARCH_X86_64
+namespace {
+    typedef std::bitset<32> RegSet;
+
+    RegSet makeRegSet(std::initializer_list<int> list) {
+        RegSet set;
+        for(auto reg : list) set.set(reg);
+        return set;
+    }
+
+    // System V: rax carries the vector count for varargs, r10 the static
+    // chain. Callers and direct callees are assumed to follow the ABI.
+    const RegSet argumentRegs = makeRegSet({
+        X86Register::R0, X86Register::R1, X86Register::R2, X86Register::R6,
+        X86Register::R7, X86Register::R8, X86Register::R9, X86Register::R10});
+    const RegSet calleeSavedRegs = makeRegSet({
+        X86Register::R3, X86Register::BP, X86Register::R12, X86Register::R13,
+        X86Register::R14, X86Register::R15});
+    const RegSet callClobberedRegs = argumentRegs
+        | makeRegSet({X86Register::R11, X86Register::FLAGS});
+    const RegSet stackRegs = makeRegSet({X86Register::SP});
+
+    /** What one instruction does to the live set: live-before is
+        (live-after - def) | use, or just use when control leaves the
+        function.
+    */
+    struct LiveEffect {
+        RegSet use;
+        RegSet def;
+        bool exit;
+        LiveEffect() : exit(false) {}
+    };
+
+    // capstone does not always list the flags these read
+    bool readsFlagsByName(const std::string &mnemonic) {
+        for(auto prefix : {"set", "cmov", "adc", "sbb", "rcl", "rcr",
+            "pushf", "lahf"}) {
+
+            if(mnemonic.compare(0, std::strlen(prefix), prefix) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int getIndex(int reg) {
+        if(reg == X86_REG_EFLAGS) return X86Register::FLAGS;
+        return X86Register::convertToPhysical(reg);
+    }
+
+    void addUse(RegSet &set, int reg) {
+        int index = getIndex(reg);
+        if(index != X86Register::INVALID) set.set(index);
+    }
+
+    // writes to the full 64 bits, or to 32 bits which zero-extends
+    int getFullDefinition(int reg) {
+        int index = X86Register::convertToPhysical(reg);
+        if(index == X86Register::INVALID) return X86Register::INVALID;
+        if(X86Register::getWidth(index, reg) < 4) return X86Register::INVALID;
+        return index;
+    }
+
+    bool isInFunction(Chunk *target, Function *function) {
+        if(auto block = dynamic_cast<Block *>(target)) {
+            return block->getParent() == function;
+        }
+        if(auto instr = dynamic_cast<Instruction *>(target)) {
+            return instr->getParent()
+                && instr->getParent()->getParent() == function;
+        }
+        return false;
+    }
+
+    LiveEffect makeCallEffect(bool indirect) {
+        LiveEffect effect;
+        // callee-saved registers are read if the call unwinds to a landing pad
+        effect.use = argumentRegs | calleeSavedRegs | stackRegs;
+        // indirect calls may go to TLS descriptors, which preserve more
+        if(!indirect) effect.def = callClobberedRegs;
+        return effect;
+    }
+
+    LiveEffect makeUnknownEffect() {
+        LiveEffect effect;
+        effect.use.set();
+        effect.exit = true;
+        return effect;
+    }
+
+    // Callers of these rely on more than the ABI: TLS descriptors and the
+    // lazy binding resolver preserve every register, and thunks "return"
+    // into their real target with its arguments still in registers.
+    bool followsABI(Function *function) {
+        for(auto prefix : {"_dl_tlsdesc_", "_dl_runtime_resolve",
+            "_dl_runtime_profile", "__x86_indirect_thunk",
+            "__x86_return_thunk", "retpoline_"}) {
+
+            if(function->getName().compare(0, std::strlen(prefix), prefix)
+                == 0) {
+
+                return false;
+            }
+        }
+        return true;
+    }
+
+    LiveEffect getEffect(Instruction *instruction, Function *function) {
+        auto semantic = instruction->getSemantic();
+        if(dynamic_cast<ReturnInstruction *>(semantic)) {
+            LiveEffect effect;
+            effect.use = makeRegSet({X86Register::R0, X86Register::R2})
+                | calleeSavedRegs | stackRegs;
+            effect.exit = true;
+            return effect;
+        }
+        if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+            if(cfi->getMnemonic() == "callq" || cfi->getMnemonic() == "call") {
+                return makeCallEffect(false);
+            }
+
+            auto link = cfi->getLink();
+            if(!link || !link->getTarget()) return makeUnknownEffect();
+
+            LiveEffect effect;
+            if(cfi->getMnemonic() != "jmp") {
+                effect.use.set(X86Register::FLAGS);
+                if(cfi->getMnemonic() == "jrcxz"
+                    || cfi->getMnemonic() == "jecxz"
+                    || cfi->getMnemonic().compare(0, 4, "loop") == 0) {
+
+                    effect.use.set(X86Register::R1);
+                }
+            }
+            if(!isInFunction(&*link->getTarget(), function)) {
+                // tail call, the control flow graph has no edge for it
+                effect.use |= argumentRegs | calleeSavedRegs | stackRegs;
+                if(cfi->getMnemonic() == "jmp") effect.exit = true;
+            }
+            return effect;
+        }
+        if(auto dlcfi = dynamic_cast<DataLinkedControlFlowInstruction *>(
+            semantic)) {
+
+            if(dlcfi->isCall()) return makeCallEffect(false);
+            LiveEffect effect;
+            effect.use = argumentRegs | calleeSavedRegs | stackRegs;
+            effect.exit = true;
+            return effect;
+        }
+        if(auto indirect = dynamic_cast<IndirectControlFlowInstructionBase *>(
+            semantic)) {
+
+            LiveEffect effect;
+            auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic);
+            if(dynamic_cast<IndirectCallInstruction *>(semantic)
+                || (ij && ij->getMnemonic() == "callq")) {
+
+                effect = makeCallEffect(true);
+            }
+            else if(!ij || !ij->isForJumpTable()) {
+                // may be a computed goto within this function
+                return makeUnknownEffect();
+            }
+            addUse(effect.use, indirect->getRegister());
+            addUse(effect.use, indirect->getIndexRegister());
+            return effect;
+        }
+
+        auto assembly = semantic->getAssembly();
+        if(!assembly) return makeUnknownEffect();
+
+        LiveEffect effect;
+        auto asmOps = assembly->getAsmOperands();
+        auto operands = asmOps->getOperands();
+        size_t count = asmOps->getOpCount();
+
+        // only definitions we are sure of kill a register; AT&T operand
+        // order puts the destination last
+        int def = X86Register::INVALID;
+        switch(assembly->getId()) {
+        case X86_INS_MOV:
+        case X86_INS_MOVABS:
+        case X86_INS_MOVZX:
+        case X86_INS_MOVSX:
+        case X86_INS_MOVSXD:
+        case X86_INS_LEA:
+        case X86_INS_POP:
+            if(count > 0 && operands[count - 1].type == X86_OP_REG) {
+                def = getFullDefinition(operands[count - 1].reg);
+            }
+            break;
+        case X86_INS_XOR:
+        case X86_INS_SUB:
+            // zeroing idiom reads nothing
+            if(count == 2 && operands[0].type == X86_OP_REG
+                && operands[1].type == X86_OP_REG
+                && operands[0].reg == operands[1].reg) {
+
+                def = getFullDefinition(operands[1].reg);
+                if(def != X86Register::INVALID) count = 0;
+            }
+            break;
+        default:
+            break;
+        }
+        if(def != X86Register::INVALID) effect.def.set(def);
+
+        switch(assembly->getId()) {
+        case X86_INS_ADD:
+        case X86_INS_SUB:
+        case X86_INS_CMP:
+        case X86_INS_AND:
+        case X86_INS_OR:
+        case X86_INS_XOR:
+        case X86_INS_TEST:
+        case X86_INS_NEG:
+            effect.def.set(X86Register::FLAGS);
+            break;
+        default:
+            break;
+        }
+
+        for(size_t i = 0; i < count; i++) {
+            const auto &op = operands[i];
+            if(op.type == X86_OP_REG) {
+                if(i + 1 == count && def != X86Register::INVALID) continue;
+                addUse(effect.use, op.reg);
+            }
+            else if(op.type == X86_OP_MEM) {
+                addUse(effect.use, op.mem.base);
+                addUse(effect.use, op.mem.index);
+            }
+        }
+        for(size_t i = 0; i < assembly->getImplicitRegsReadCount(); i++) {
+            addUse(effect.use, assembly->getImplicitRegsRead()[i]);
+        }
+        if(readsFlagsByName(assembly->getMnemonic())) {
+            effect.use.set(X86Register::FLAGS);
+        }
+        if(assembly->getId() == X86_INS_SYSCALL) {
+            effect.use |= argumentRegs | stackRegs;
+        }
+        return effect;
+    }
+}
+#endif
+
+void InstructionLiveRegister::detect(Function *function) {
+#ifdef ARCH_X86_64
+    // everything stays live, so nothing is used as a scratch register
+    if(!followsABI(function)) return;
+
+    ControlFlowGraph cfg(function);
+    size_t count = cfg.getCount();
+
+    std::map<Instruction *, LiveEffect> effects;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            effects[instr] = getEffect(instr, function);
+        }
+    }
+
+    // a jump into the middle of a block uses everything live anywhere in it
+    std::vector<RegSet> liveIn(count), liveAnywhere(count);
+    auto getLiveOut = [&] (ControlFlowNode *node) {
+        RegSet live;
+        bool hasSuccessor = false;
+        for(auto link : node->forwardLinks()) {
+            auto cfLink = dynamic_cast<ControlFlowLink *>(&*link);
+            auto target = link->getTargetID();
+            live |= (cfLink && cfLink->getOffset() != 0)
+                ? liveAnywhere[target] : liveIn[target];
+            hasSuccessor = true;
+        }
+        if(!hasSuccessor) live.set();
+        return live;
+    };
+    auto transfer = [&] (Instruction *instr, const RegSet &live) {
+        const auto &effect = effects[instr];
+        return effect.exit ? effect.use : ((live & ~effect.def) | effect.use);
+    };
+
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t id = count; id-- > 0; ) {
+            auto node = cfg.get(id);
+            RegSet live = getLiveOut(node);
+            RegSet anywhere = live;
+            auto children = node->getBlock()->getChildren()->getIterable();
+            for(size_t i = children->getCount(); i-- > 0; ) {
+                live = transfer(children->get(i), live);
+                anywhere |= live;
+            }
+
+            if(live != liveIn[id] || anywhere != liveAnywhere[id]) {
+                liveIn[id] = live;
+                liveAnywhere[id] = anywhere;
+                changed = true;
+            }
+        }
+    }
+
+    for(size_t id = 0; id < count; id++) {
+        auto node = cfg.get(id);
+        RegSet live = getLiveOut(node);
+        liveOut[node->getBlock()] = LiveInfo(live);
+        auto children = node->getBlock()->getChildren()->getIterable();
+        for(size_t i = children->getCount(); i-- > 0; ) {
+            auto instr = children->get(i);
+            live = transfer(instr, live);
+            liveBefore[instr] = LiveInfo(live);
+        }
+    }
+#endif
+}
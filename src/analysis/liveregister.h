@@ -6,6 +6,8 @@
 #include "analysis/usedef.h"
 
 class Function;
+class Block;
+class Instruction;
 class UDState;
 
 class LiveInfo {
@@ -14,9 +16,10 @@ private:
 
 public:
     LiveInfo() : regs(0xFFFFFFFF) {}
+    explicit LiveInfo(const std::bitset<32> &regs) : regs(regs) {}
     void kill(int reg);
     void live(int reg);
-    bool get(int reg) { return regs[reg]; }
+    bool get(int reg) const { return regs[reg]; }
     const std::bitset<32>& get() const { return regs; }
 };
 
@@ -32,4 +35,30 @@ public:
     void detect(UDRegMemWorkingSet *working);
 };
 
+/** Registers that may be live just before each instruction of a function,
+    indexed like X86Register (X86Register::FLAGS for the flags). Inserted
+    code can clobber a dead register without saving it. Only x86-64 is
+    analyzed; anything the analysis does not understand keeps every
+    register live.
+
+    Returns and tail calls assume the caller only relies on what the ABI
+    preserves. Functions known not to follow it (TLS descriptors, the lazy
+    binding resolver, retpoline and return thunks) are not analyzed, so
+    every register stays live in them.
+*/
+class InstructionLiveRegister {
+private:
+    std::map<Instruction *, LiveInfo> liveBefore;
+    std::map<Block *, LiveInfo> liveOut;
+public:
+    InstructionLiveRegister(Function *function);
+
+    /** Every register is live before instructions added since. */
+    LiveInfo getLiveBefore(Instruction *instruction) const;
+    /** Registers that may be live when control leaves block. */
+    LiveInfo getLiveOut(Block *block) const;
+private:
+    void detect(Function *function);
+};
+
 #endif
@@ -493,16 +493,16 @@ TreeNode *SlicingUtilities::makeMemTree(SearchState *state,
     if(mem->index != X86_REG_INVALID) {
         tree = getParentRegTree(state, mem->index);
         if(mem->scale != 1) {
-            tree = TreeFactory::instance().make<TreeNodeMultiplication>(
+            tree = treeFactory->make<TreeNodeMultiplication>(
                 tree,
-                TreeFactory::instance().make<TreeNodeConstant>(mem->scale));
+                treeFactory->make<TreeNodeConstant>(mem->scale));
         }
     }
 
     TreeNode *baseTree = getParentRegTree(state, mem->base);
     if(mem->base != X86_REG_INVALID) {
         if(tree) {
-            tree = TreeFactory::instance().make<TreeNodeAddition>(baseTree, tree);
+            tree = treeFactory->make<TreeNodeAddition>(baseTree, tree);
         }
         else {
             tree = baseTree;
@@ -511,11 +511,11 @@ TreeNode *SlicingUtilities::makeMemTree(SearchState *state,
 
     if(mem->disp) {
         if(tree) {
-            tree = TreeFactory::instance().make<TreeNodeAddition>(
-                TreeFactory::instance().make<TreeNodeAddress>(mem->disp), tree);
+            tree = treeFactory->make<TreeNodeAddition>(
+                treeFactory->make<TreeNodeAddress>(mem->disp), tree);
         }
         else {
-            tree = TreeFactory::instance().make<TreeNodeAddress>(mem->disp);
+            tree = treeFactory->make<TreeNodeAddress>(mem->disp);
         }
     }
 
@@ -533,9 +533,9 @@ TreeNode *SlicingUtilities::makeMemTree(SearchState *state,
         tree = getParentRegTree(state, mem->index);
         if(sft_type != ARM64_SFT_INVALID) {
             if(sft_type  == ARM64_SFT_LSL) {
-                tree = TreeFactory::instance().make<TreeNodeLogicalShiftLeft>(
+                tree = treeFactory->make<TreeNodeLogicalShiftLeft>(
                     tree,
-                    TreeFactory::instance().make<TreeNodeConstant>(sft_value));
+                    treeFactory->make<TreeNodeConstant>(sft_value));
             }
         }
     }
@@ -543,22 +543,22 @@ TreeNode *SlicingUtilities::makeMemTree(SearchState *state,
     TreeNode *baseTree = getParentRegTree(state, mem->base);
     if(mem->base != ARM64_REG_INVALID) {    // should be there always
         if(tree) {
-            tree = TreeFactory::instance().make<TreeNodeAddition>(baseTree, tree);
+            tree = treeFactory->make<TreeNodeAddition>(baseTree, tree);
         }
         else {
             tree = baseTree;
         }
     }
     if(tree) {
-        tree = TreeFactory::instance().make<TreeNodeAddition>(
+        tree = treeFactory->make<TreeNodeAddition>(
             tree,
-            TreeFactory::instance().make<TreeNodeConstant>(mem->disp));
+            treeFactory->make<TreeNodeConstant>(mem->disp));
     }
     else {
-        tree = TreeFactory::instance().make<TreeNodeConstant>(mem->disp);
+        tree = treeFactory->make<TreeNodeConstant>(mem->disp);
     }
 
-    tree = TreeFactory::instance().make<TreeNodeDereference>(tree, width);
+    tree = treeFactory->make<TreeNodeDereference>(tree, width);
     state->getIState()->setMemTree(tree);
 
     return tree;
@@ -569,7 +569,7 @@ TreeNode *SlicingUtilities::getParentRegTree(SearchState *state, int reg) {
     if(reg == X86_REG_RIP) {
         // evaluate the instruction pointer in-place
         auto i = state->getInstruction();
-        return TreeFactory::instance().make<TreeNodeRegisterRIP>(
+        return treeFactory->make<TreeNodeRegisterRIP>(
             i->getAddress() + i->getSize());
     }
 #endif
@@ -577,7 +577,7 @@ TreeNode *SlicingUtilities::getParentRegTree(SearchState *state, int reg) {
     const auto &parents = state->getParents();
     if(parents.size() == 0) {
         // no parents, the register value must have originated here
-        auto tree = TreeFactory::instance().make<TreeNodeRegister>(reg);
+        auto tree = treeFactory->make<TreeNodeRegister>(reg);
         state->setRegTree(reg, tree);
         return tree;
     }
@@ -586,7 +586,7 @@ TreeNode *SlicingUtilities::getParentRegTree(SearchState *state, int reg) {
         auto tree = parents.front()->getRegTree(reg);
         if(!tree) {
             // This should only happen the first time a reg is used.
-            tree = TreeFactory::instance().make<TreeNodeRegister>(reg);
+            tree = treeFactory->make<TreeNodeRegister>(reg);
             state->setRegTree(reg, tree);
         }
         return tree;
@@ -617,10 +617,10 @@ TreeNode *SlicingUtilities::getParentRegTree(SearchState *state, int reg) {
 #endif
 
         // nope, we need to combine parents with a branching node
-        auto tree = TreeFactory::instance().make<TreeNodeMultipleParents>();
+        auto tree = treeFactory->make<TreeNodeMultipleParents>();
         for(auto p : parents) {
             auto t = p->getRegTree(reg);
-            if(!t) t = TreeFactory::instance().make<TreeNodeRegister>(reg);
+            if(!t) t = treeFactory->make<TreeNodeRegister>(reg);
 #ifdef OPTIMIZE_TREES
             tree->addParentIfNotPresent(t);
 #else
@@ -755,7 +755,7 @@ void SlicingSearch::buildRegTreePass() {
             dumper.visit(instruction);
         }
 
-        SlicingUtilities u;
+        SlicingUtilities u(&treeFactory);
         u.printRegs(state, true);
         u.printMems(state, true);
 
@@ -774,7 +774,7 @@ void SlicingSearch::debugPrintRegAccesses(Instruction *i) {
     auto assembly = i->getSemantic()->getAssembly();
     if(!assembly) return;
 
-    SlicingUtilities u;
+    SlicingUtilities u(&treeFactory);
 
     for(size_t r = 0; r < assembly->getImplicitRegsReadCount(); r ++) {
         LOG(11, "        implicit reg read "
@@ -828,7 +828,7 @@ void SlicingSearch::buildStateFor(SearchState *state) {
     state->removeReg(X86_REG_RIP);  // never care about this
 #endif
 
-    SlicingUtilities u;
+    SlicingUtilities u(&treeFactory);
     u.printRegs(state, true);
     u.printMems(state, true);
 }
@@ -859,7 +859,7 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
         return;
     }
 
-    SlicingUtilities u;
+    SlicingUtilities u(&treeFactory);
 
     SlicingInstructionState *iState;
     if(firstPass) {
@@ -882,7 +882,7 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                 auto source = iState->get1()->reg;
                 auto target = iState->get2()->reg;
 
-                auto tree = TreeFactory::instance().make<TreeNodeAddition>(
+                auto tree = treeFactory.make<TreeNodeAddition>(
                     u.getParentRegTree(state, source),
                     u.getParentRegTree(state, target));
                 state->setRegTree(target, tree);
@@ -985,8 +985,8 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                 state->addReg(reg);
             }
             else {
-                auto tree = TreeFactory::instance().make<TreeNodeComparison>(
-                    TreeFactory::instance().make<TreeNodeConstant>(imm),
+                auto tree = treeFactory.make<TreeNodeComparison>(
+                    treeFactory.make<TreeNodeConstant>(imm),
                     u.getParentRegTree(state, reg));
                 state->setRegTree(X86_REG_EFLAGS, tree);
             }
@@ -1020,7 +1020,7 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                 auto imm = iState->get2()->imm;
 
                 state->setRegTree(reg,
-                    TreeFactory::instance().make<TreeNodeAddress>(imm));
+                    treeFactory.make<TreeNodeAddress>(imm));
             }
         }
         else {
@@ -1038,7 +1038,7 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                 auto imm = iState->get2()->imm; //cs adds PC internally
 
                 state->setRegTree(reg,
-                    TreeFactory::instance().make<TreeNodeAddress>(imm));
+                    treeFactory.make<TreeNodeAddress>(imm));
             }
         }
         else {
@@ -1060,14 +1060,14 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                 TreeNode *tree = u.getParentRegTree(state, source2);
                 if(extreg->shift.type != ARM64_SFT_INVALID) {
                     if(extreg->shift.type == ARM64_SFT_LSL) {
-                        auto c = TreeFactory::instance().make<TreeNodeConstant>(
+                        auto c = treeFactory.make<TreeNodeConstant>(
                             extreg->shift.value);
-                        tree = TreeFactory::instance().make<
+                        tree = treeFactory.make<
                             TreeNodeLogicalShiftLeft>(tree, c);
                     }
                 }
 
-                tree = TreeFactory::instance().make<TreeNodeAddition>(
+                tree = treeFactory.make<TreeNodeAddition>(
                     u.getParentRegTree(state, source1),
                     tree);
                 state->setRegTree(target, tree);
@@ -1090,8 +1090,8 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                     }
                 }
 
-                tree = TreeFactory::instance().make<TreeNodeConstant>(extimm.imm);
-                tree = TreeFactory::instance().make<TreeNodeAddition>(
+                tree = treeFactory.make<TreeNodeConstant>(extimm.imm);
+                tree = treeFactory.make<TreeNodeAddition>(
                     u.getParentRegTree(state, source),
                     tree);
                 state->setRegTree(target, tree);
@@ -1112,18 +1112,18 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                 auto source = iState->get2()->reg;
                 auto extimm = iState->get3()->extimm;
 
-                TreeNode *tree = TreeFactory::instance().make<TreeNodeConstant>(
+                TreeNode *tree = treeFactory.make<TreeNodeConstant>(
                     extimm.imm);
                 if(extimm.shift.type != ARM64_SFT_INVALID) {
                     if(extimm.shift.type == ARM64_SFT_LSL) {
-                        auto c = TreeFactory::instance().make<TreeNodeConstant>(
+                        auto c = treeFactory.make<TreeNodeConstant>(
                             extimm.shift.value);
-                        tree = TreeFactory::instance().make<
+                        tree = treeFactory.make<
                             TreeNodeLogicalShiftLeft>(tree, c);
                     }
                 }
 
-                tree = TreeFactory::instance().make<TreeNodeSubtraction>(
+                tree = treeFactory.make<TreeNodeSubtraction>(
                     u.getParentRegTree(state, source),
                     tree);
                 state->setRegTree(target, tree);
@@ -1142,14 +1142,14 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
                 TreeNode *tree = u.getParentRegTree(state, source2);
                 if(extreg->shift.type != ARM64_SFT_INVALID) {
                     if(extreg->shift.type == ARM64_SFT_LSL) {
-                        auto c = TreeFactory::instance().make<TreeNodeConstant>(
+                        auto c = treeFactory.make<TreeNodeConstant>(
                             extreg->shift.value);
-                        tree = TreeFactory::instance().make<
+                        tree = treeFactory.make<
                             TreeNodeLogicalShiftLeft>(tree, c);
                     }
                 }
 
-                tree = TreeFactory::instance().make<TreeNodeSubtraction>(
+                tree = treeFactory.make<TreeNodeSubtraction>(
                     u.getParentRegTree(state, source1),
                     tree);
                 state->setRegTree(target, tree);
@@ -1292,9 +1292,9 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
             else {
                 auto reg = iState->get1()->reg;
                 auto imm = iState->get2()->imm;
-                auto tree = TreeFactory::instance().make<TreeNodeComparison>(
+                auto tree = treeFactory.make<TreeNodeComparison>(
                     u.getParentRegTree(state, reg),
-                    TreeFactory::instance().make<TreeNodeConstant>(imm));
+                    treeFactory.make<TreeNodeConstant>(imm));
                 state->setRegTree(ARM64_REG_NZCV, tree);
             }
         }
@@ -1305,7 +1305,7 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
             else {
                 auto reg1 = iState->get1()->reg;
                 auto reg2 = iState->get2()->reg;
-                auto tree = TreeFactory::instance().make<TreeNodeComparison>(
+                auto tree = treeFactory.make<TreeNodeComparison>(
                     u.getParentRegTree(state, reg1),
                     u.getParentRegTree(state, reg2));
                 state->setRegTree(ARM64_REG_NZCV, tree);
@@ -1330,7 +1330,7 @@ void SlicingSearch::detectInstruction(SearchState *state, bool firstPass) {
 }
 
 void SlicingSearch::detectJumpRegTrees(SearchState *state, bool firstPass) {
-    SlicingUtilities u;
+    SlicingUtilities u(&treeFactory);
     auto semantic = state->getInstruction()->getSemantic();
     LOG(11, "@ " << std::hex << state->getInstruction()->getAddress());
     if(auto v = dynamic_cast<ControlFlowInstruction *>(semantic)) {
@@ -1367,7 +1367,6 @@ SlicingSearch::~SlicingSearch() {
     for(auto state : stateList) {
         delete state;
     }
-    TreeFactory::instance().clean();
 }
 
 bool SlicingSearch::shouldContinue(SearchState *currentState) {
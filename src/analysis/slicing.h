@@ -6,11 +6,11 @@
 #include <set>
 #include "controlflow.h"
 #include "flow.h"
+#include "slicingtree.h"
 #include "instr/register.h"
 #include "chunk/chunklist.h"
 
 class Instruction;
-class TreeNode;
 class Memory;
 class SlicingInstructionState;
 
@@ -120,7 +120,12 @@ public:
 
 
 class SlicingUtilities {
+private:
+    TreeFactory *treeFactory;
 public:
+    SlicingUtilities(TreeFactory *treeFactory = nullptr)
+        : treeFactory(treeFactory) {}
+
     const char *printReg(int reg);
     void printRegs(SearchState *state, bool withNewline = true);
     void printMems(SearchState *state, bool withNewline = true);
@@ -174,6 +179,7 @@ private:
     std::vector<SearchState *> stateList;  // history of states
     std::vector<SearchState *> conditions;  // conditional jumps
     SlicingHalt *halt;
+    TreeFactory treeFactory;    // owns all trees built by this search
 
 public:
     SlicingSearch(ControlFlowGraph *cfg, SlicingHalt *halt = nullptr)
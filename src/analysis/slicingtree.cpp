@@ -44,6 +44,7 @@ void TreeNodeUnary::print(const TreePrinter &p) const {
 }
 
 bool TreeNodeUnary::equal(TreeNode *tree) {
+    if(tree == this) return true;
     auto t = dynamic_cast<TreeNodeUnary *>(tree);
     return t && !strcmp(name, t->getName()) &&
         getChild()->equal(t->getChild());
@@ -69,6 +70,7 @@ void TreeNodeBinary::print(const TreePrinter &p) const {
 }
 
 bool TreeNodeBinary::equal(TreeNode *tree) {
+    if(tree == this) return true;
     auto t = dynamic_cast<TreeNodeBinary *>(tree);
     return t && !strcmp(op, t->getOperator()) && (
         (getLeft()->equal(t->getLeft()) &&
@@ -126,6 +128,7 @@ void TreeNodeMultipleParents::addParentIfNotPresent(TreeNode *parent) {
 }
 
 bool TreeNodeMultipleParents::equal(TreeNode *tree) {
+    if(tree == this) return true;
     auto t = dynamic_cast<TreeNodeMultipleParents *>(tree);
     if(t) {
         auto p1 = t->getParents();
@@ -144,44 +147,18 @@ bool TreeNodeMultipleParents::equal(TreeNode *tree) {
     return false;
 }
 
-TreeFactory& TreeFactory::instance() {
-    static TreeFactory factory;
-    return factory;
-}
-
-TreeNodeRegister *TreeFactory::makeTreeNodeRegister(int reg) {
-    auto i = regTrees.find(reg);
-    if(i != regTrees.end()) {
-        return i->second;
-    }
-
-    TreeNodeRegister *n = new TreeNodeRegister(reg);
-    regTrees.emplace(reg, n);
-    return n;
-}
-
-TreeNodePhysicalRegister *TreeFactory::makeTreeNodePhysicalRegister(
-    Register reg, int width) {
-
-    auto i = regPhysicalTrees.find(reg);
-    if(i != regPhysicalTrees.end()) {
-        return i->second;
+size_t TreeNodeKeyHash::operator () (const TreeNodeKey &key) const {
+    size_t h = key.type->hash_code();
+    for(auto a : key.arg) {
+        h ^= std::hash<uint64_t>()(a) + 0x9e3779b97f4a7c15ull
+            + (h << 6) + (h >> 2);
     }
-
-    TreeNodePhysicalRegister *n = new TreeNodePhysicalRegister(reg, width);
-    regPhysicalTrees.emplace(reg, n);
-    return n;
+    return h;
 }
 
 void TreeFactory::clean() {
-    for(auto t : trees) { delete t; }
+    for(auto t : trees) { t->~TreeNode(); }
     trees.clear();
-}
-
-void TreeFactory::cleanAll() {
-    clean();
-    for(auto t : regTrees) { delete t.second; }
-    regTrees.clear();
-    for(auto t : regPhysicalTrees) { delete t.second; }
-    regPhysicalTrees.clear();
+    table.clear();
+    arena.clear();
 }
@@ -3,8 +3,12 @@
 
 #include <iosfwd>
 #include <vector>
-#include <map>
+#include <new>
+#include <unordered_map>
+#include <typeinfo>
+#include <cstdint>
 #include "instr/register.h"
+#include "util/arena.h"
 #include "types.h"
 
 class TreePrinter {
@@ -34,7 +38,6 @@ private:
 public:
     TreeNodeConstant(long value) : value(value) {}
     long int getValue() const { return value; }
-    void setValue(long int value) { this->value = value; }
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
         auto t = dynamic_cast<TreeNodeConstant *>(tree);
@@ -48,7 +51,6 @@ private:
 public:
     TreeNodeAddress(address_t address) : address(address) {}
     address_t getValue() const { return address; }
-    void setValue(address_t address) { this->address = address; }
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
         auto t = dynamic_cast<TreeNodeAddress *>(tree);
@@ -236,6 +238,7 @@ public:
 
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
+        if(tree == this) return true;
         auto t = dynamic_cast<TreeNodeComparison *>(tree);
         return t && (
             (getLeft()->equal(t->getLeft()) &&
@@ -259,44 +262,80 @@ public:
     virtual bool equal(TreeNode *tree);
 };
 
+/** Identity of a tree node for hash-consing: its dynamic type plus up to
+    three constructor arguments (child pointers or scalar values).
+*/
+struct TreeNodeKey {
+    const std::type_info *type;
+    uint64_t arg[3];
+
+    bool operator == (const TreeNodeKey &other) const
+        { return *type == *other.type && arg[0] == other.arg[0]
+            && arg[1] == other.arg[1] && arg[2] == other.arg[2]; }
+};
+
+struct TreeNodeKeyHash {
+    size_t operator () (const TreeNodeKey &key) const;
+};
+
+/** Creates tree nodes. Nodes are hash-consed, so making the same expression
+    twice returns the same node and equal subtrees can be compared by
+    pointer; nodes must therefore never be modified after creation (except
+    for TreeNodeMultipleParents, which is never shared). All nodes live in an
+    arena owned by the factory and are freed together by clean() or when the
+    factory (usually held by a use-def working set or slicing search) dies.
+*/
 class TreeFactory {
 private:
+    Arena arena;
     std::vector<TreeNode *> trees;
-    std::map<int, TreeNodeRegister *> regTrees;
-    std::map<Register, TreeNodePhysicalRegister *> regPhysicalTrees;
+    std::unordered_map<TreeNodeKey, TreeNode *, TreeNodeKeyHash> table;
 
 public:
-    static TreeFactory& instance();
+    TreeFactory() {}
+    ~TreeFactory() { clean(); }
 
     template <typename TreeNodeType, typename... Args>
     TreeNodeType *make(Args... args) {
-        TreeNodeType *n = new TreeNodeType(args...);
-        trees.push_back(n);
+        static_assert(sizeof...(Args) <= 3, "too many args for TreeNodeKey");
+        TreeNodeKey key = {&typeid(TreeNodeType), {keyWord(args)...}};
+        auto it = table.find(key);
+        if(it != table.end()) {
+            return static_cast<TreeNodeType *>((*it).second);
+        }
+
+        auto n = makeUnshared<TreeNodeType>(args...);
+        table.emplace(key, n);
         return n;
     }
 
     void clean();
-    void cleanAll();
+    size_t getNodeCount() const { return trees.size(); }
 
 private:
-    TreeFactory() {}
-    ~TreeFactory() {}
-    TreeFactory& operator=(const TreeFactory&);
-    TreeFactory(const TreeFactory&);
+    TreeFactory &operator = (const TreeFactory &);
+    TreeFactory(const TreeFactory &);
 
-    TreeNodeRegister *makeTreeNodeRegister(int reg);
-    TreeNodePhysicalRegister *makeTreeNodePhysicalRegister(
-        Register reg, int width);
-};
+    template <typename TreeNodeType, typename... Args>
+    TreeNodeType *makeUnshared(Args... args) {
+        void *memory = arena.allocate(sizeof(TreeNodeType),
+            alignof(TreeNodeType));
+        TreeNodeType *n = new (memory) TreeNodeType(args...);
+        trees.push_back(n);
+        return n;
+    }
 
-template <>
-inline TreeNodeRegister *TreeFactory::make(int reg) {
-    return makeTreeNodeRegister(reg);
+    template <typename T>
+    static uint64_t keyWord(T *pointer)
+        { return reinterpret_cast<uintptr_t>(pointer); }
+    template <typename T>
+    static uint64_t keyWord(T value) { return static_cast<uint64_t>(value); }
 };
 
 template <>
-inline TreeNodePhysicalRegister *TreeFactory::make(Register reg, int width) {
-    return makeTreeNodePhysicalRegister(reg, width);
+inline TreeNodeMultipleParents *TreeFactory::make() {
+    // parents are added after creation, so this can never be shared
+    return makeUnshared<TreeNodeMultipleParents>();
 };
 
 #endif
@@ -0,0 +1,109 @@
+#include <map>
+#include <utility>
+#include "superblock.h"
+#include "dominance.h"
+
+#include "log/log.h"
+
+SuperblockAnalysis::SuperblockAnalysis(ControlFlowGraph *cfg,
+    Dominance *dominance, bool merge) {
+
+    size_t count = cfg->getCount();
+    heads.assign(count, -1);
+    findCycles(cfg);
+
+    for(size_t id = 0; id < count; id++) {
+        // walk up the dominator tree while nodes belong with their idom
+        std::vector<id_t> chain;
+        id_t node = id;
+        while(heads[node] == -1) {
+            chain.push_back(node);
+            id_t idom = dominance->getImmediateDominator(node);
+            if(!merge || idom == -1 || cycleHead[node]
+                || cycles[node] != cycles[idom]
+                || dominance->getImmediatePostDominator(idom) != node) {
+
+                heads[node] = node;
+                break;
+            }
+            node = idom;
+        }
+        for(auto n : chain) heads[n] = heads[node];
+    }
+
+    LOG(10, "superblocks in " << count << " nodes:");
+    for(size_t id = 0; id < count; id++) {
+        if(!isHead(id)) LOG(10, "    " << id << " is in " << heads[id]);
+    }
+}
+
+void SuperblockAnalysis::findCycles(ControlFlowGraph *cfg) {
+    size_t count = cfg->getCount();
+    cycleHead.assign(count, false);
+    cycles.assign(count, std::vector<id_t>());
+    if(count == 0) return;
+
+    std::vector<std::vector<id_t>> successors(count);
+    for(size_t id = 0; id < count; id++) {
+        for(auto link : cfg->get(id)->forwardLinks()) {
+            successors[id].push_back(link->getTargetID());
+        }
+    }
+
+    // an edge back to a node still on the depth-first stack closes a cycle
+    std::map<id_t, std::vector<id_t>> closing;
+    std::vector<int> state(count, 0);   // 0 new, 1 on stack, 2 done
+    std::vector<std::pair<id_t, size_t>> stack;
+    stack.emplace_back(0, 0);
+    state[0] = 1;
+    while(!stack.empty()) {
+        id_t node = stack.back().first;
+        size_t index = stack.back().second++;
+        if(index >= successors[node].size()) {
+            state[node] = 2;
+            stack.pop_back();
+            continue;
+        }
+
+        id_t target = successors[node][index];
+        if(state[target] == 1) {
+            closing[target].push_back(node);
+        }
+        else if(state[target] == 0) {
+            state[target] = 1;
+            stack.emplace_back(target, 0);
+        }
+    }
+
+    // a cycle holds every node that reaches a closing edge without
+    // passing its head; heads are visited in order, so lists stay sorted
+    for(auto &kv : closing) {
+        id_t head = kv.first;
+        cycleHead[head] = true;
+
+        std::vector<bool> inCycle(count, false);
+        inCycle[head] = true;
+        std::vector<id_t> work;
+        for(auto source : kv.second) {
+            if(!inCycle[source]) {
+                inCycle[source] = true;
+                work.push_back(source);
+            }
+        }
+        while(!work.empty()) {
+            auto node = cfg->get(work.back());
+            work.pop_back();
+            for(auto link : node->backwardLinks()) {
+                id_t pred = link->getTargetID();
+                if(!inCycle[pred]) {
+                    inCycle[pred] = true;
+                    work.push_back(pred);
+                }
+            }
+        }
+
+        for(size_t id = 0; id < count; id++) {
+            if(inCycle[id]) cycles[id].push_back(head);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef EGALITO_ANALYSIS_SUPERBLOCK_H
+#define EGALITO_ANALYSIS_SUPERBLOCK_H
+
+#include <vector>
+#include "controlflow.h"
+
+class Dominance;
+
+/** Partitions the nodes of a control flow graph into superblocks, sets of
+    blocks that are all executed whenever one of them is (Agrawal,
+    "Dominators, super blocks, and program coverage"). A node joins the
+    superblock of its immediate dominator when it is also that
+    dominator's immediate post-dominator. Each superblock is headed by the
+    node that dominates the others; nodes unreachable from the entry or
+    from the exit are superblocks by themselves.
+
+    Nodes never merge across a cycle boundary, so that a probe at each head
+    still counts every iteration and every edge can be told apart: the
+    head of a cycle (a loop header, or the entry of an irreducible cycle)
+    heads its own superblock, and a node only joins its immediate
+    dominator if both are in the same cycles.
+
+    Post-dominance only sees exits that the graph models, so callers
+    should pass merge = false for functions with other ways out (e.g.
+    conditional tail calls).
+*/
+class SuperblockAnalysis {
+public:
+    using id_t = ControlFlow::id_t;
+private:
+    std::vector<id_t> heads;
+    std::vector<bool> cycleHead;
+    std::vector<std::vector<id_t>> cycles;  // heads of enclosing cycles
+public:
+    SuperblockAnalysis(ControlFlowGraph *cfg, Dominance *dominance,
+        bool merge = true);
+
+    id_t getHead(id_t id) const { return heads[id]; }
+    bool isHead(id_t id) const { return heads[id] == id; }
+    size_t getCount() const { return heads.size(); }
+private:
+    void findCycles(ControlFlowGraph *cfg);
+};
+
+#endif
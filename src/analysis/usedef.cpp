@@ -605,7 +605,7 @@ void UseDef::useReg(UDState *state, int reg) {
     if(working->getRegSet(reg).empty()
         && working->shouldTrackPartialUDChains()) {
 
-        defReg(state, reg, new TreeNodeRegister(reg));
+        defReg(state, reg, factory().make<TreeNodeRegister>(reg));
     }
     else {
         for(auto o : working->getRegSet(reg)) {
@@ -655,23 +655,23 @@ TreeNode *UseDef::shiftExtend(TreeNode *tree, arm64_shifter type,
 
     switch(type) {
     case ARM64_SFT_LSL:
-        tree = TreeFactory::instance().make<TreeNodeLogicalShiftLeft>(tree,
-            TreeFactory::instance().make<TreeNodeConstant>(value));
+        tree = factory().make<TreeNodeLogicalShiftLeft>(tree,
+            factory().make<TreeNodeConstant>(value));
         break;
     case ARM64_SFT_MSL:
         throw "msl";
         break;
     case ARM64_SFT_LSR:
-        tree = TreeFactory::instance().make<TreeNodeLogicalShiftRight>(tree,
-            TreeFactory::instance().make<TreeNodeConstant>(value));
+        tree = factory().make<TreeNodeLogicalShiftRight>(tree,
+            factory().make<TreeNodeConstant>(value));
         break;
     case ARM64_SFT_ASR:
-        tree = TreeFactory::instance().make<TreeNodeArithmeticShiftRight>(tree,
-            TreeFactory::instance().make<TreeNodeConstant>(value));
+        tree = factory().make<TreeNodeArithmeticShiftRight>(tree,
+            factory().make<TreeNodeConstant>(value));
         break;
     case ARM64_SFT_ROR:
-        tree = TreeFactory::instance().make<TreeNodeRotateRight>(tree,
-            TreeFactory::instance().make<TreeNodeConstant>(value));
+        tree = factory().make<TreeNodeRotateRight>(tree,
+            factory().make<TreeNodeConstant>(value));
         break;
     case ARM64_SFT_INVALID:
     default:
@@ -707,25 +707,25 @@ void UseDef::fillRegToReg(UDState *state, AssemblyPtr assembly) {
     auto id = assembly->getId();
     if(id == X86_INS_ADD) {
         useReg(state, reg1);
-        auto reg0Tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto reg0Tree = factory().make<TreeNodePhysicalRegister>(
             reg0, width0);
-        auto reg1Tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto reg1Tree = factory().make<TreeNodePhysicalRegister>(
             reg1, width1);
-        tree = TreeFactory::instance().make<TreeNodeAddition>(
+        tree = factory().make<TreeNodeAddition>(
             reg1Tree, reg0Tree);
     } else if(id == X86_INS_SUB) {
         useReg(state, reg1);
-        auto reg0Tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto reg0Tree = factory().make<TreeNodePhysicalRegister>(
             reg0, width0);
-        auto reg1Tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto reg1Tree = factory().make<TreeNodePhysicalRegister>(
             reg1, width1);
-        tree = TreeFactory::instance().make<TreeNodeSubtraction>(
+        tree = factory().make<TreeNodeSubtraction>(
             reg1Tree, reg0Tree);
     } else if(id == X86_INS_MOV
         || id == X86_INS_MOVSXD
         || id == X86_INS_MOVZX) {
 
-        tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        tree = factory().make<TreeNodePhysicalRegister>(
             reg0, width0);
     }
     defReg(state, reg1, tree);
@@ -737,7 +737,7 @@ void UseDef::fillRegToReg(UDState *state, AssemblyPtr assembly) {
     size_t width1 = AARCH64GPRegister::getWidth(reg1, op1);
 
     useReg(state, reg1);
-    auto tree = TreeFactory::instance().make<
+    auto tree = factory().make<
         TreeNodePhysicalRegister>(reg1, width1);
 
     defReg(state, reg0, tree);
@@ -750,21 +750,21 @@ void UseDef::fillRegToReg(UDState *state, AssemblyPtr assembly) {
     TreeNode *tree = nullptr;
     switch(assembly->getId()) {
     case rv_op_mv:
-        tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(rs, 8);
+        tree = factory().make<TreeNodePhysicalRegister>(rs, 8);
         break;
     case rv_op_neg:
-        tree = TreeFactory::instance().make<TreeNodeSubtraction>(
-            TreeFactory::instance().make<TreeNodeConstant>(0),
-            TreeFactory::instance().make<TreeNodePhysicalRegister>(rs, 8));
+        tree = factory().make<TreeNodeSubtraction>(
+            factory().make<TreeNodeConstant>(0),
+            factory().make<TreeNodePhysicalRegister>(rs, 8));
         break;
     case rv_op_negw:
-        tree = TreeFactory::instance().make<TreeNodeSubtraction>(
-            TreeFactory::instance().make<TreeNodeConstant>(0),
-            TreeFactory::instance().make<TreeNodePhysicalRegister>(rs, 4));
+        tree = factory().make<TreeNodeSubtraction>(
+            factory().make<TreeNodeConstant>(0),
+            factory().make<TreeNodePhysicalRegister>(rs, 4));
         break;
     case rv_op_not:
-        tree = TreeFactory::instance().make<TreeNodeNot>(
-            TreeFactory::instance().make<TreeNodePhysicalRegister>(rs, 8));
+        tree = factory().make<TreeNodeNot>(
+            factory().make<TreeNodePhysicalRegister>(rs, 8));
         break;
     case rv_op_seqz:
         // XXX: conditional move, either 0 or 1
@@ -772,8 +772,8 @@ void UseDef::fillRegToReg(UDState *state, AssemblyPtr assembly) {
         break;
     case rv_op_sext_w:
         // XXX: sign extension
-        tree = TreeFactory::instance().make<TreeNodeSignExtendWord>(
-            TreeFactory::instance().make<TreeNodePhysicalRegister>(rs, 4));
+        tree = factory().make<TreeNodeSignExtendWord>(
+            factory().make<TreeNodePhysicalRegister>(rs, 4));
         break;
     case rv_op_sgtz:
         // XXX: conditional move, either 0 or 1
@@ -809,13 +809,13 @@ void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
     auto id = assembly->getId();
     if(id == X86_INS_ADD) {
         useMem(state, memTree, reg1);
-        tree = TreeFactory::instance().make<TreeNodeDereference>(
+        tree = factory().make<TreeNodeDereference>(
             memTree, width);
 
         useReg(state, reg1);
-        auto reg1Tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto reg1Tree = factory().make<TreeNodePhysicalRegister>(
             reg1, width1);
-        tree = TreeFactory::instance().make<TreeNodeAddition>(
+        tree = factory().make<TreeNodeAddition>(
             reg1Tree, tree);
     }
     else if(id == X86_INS_LEA) {
@@ -827,11 +827,11 @@ void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
 
         if(memTree) {
             useMem(state, memTree, reg1);
-            tree = TreeFactory::instance().make<TreeNodeDereference>(
+            tree = factory().make<TreeNodeDereference>(
                 memTree, width);
         }
         else {
-            tree = TreeFactory::instance().make<TreeNodeConstant>(0);
+            tree = factory().make<TreeNodeConstant>(0);
         }
     }
     defReg(state, reg1, tree);
@@ -847,25 +847,25 @@ void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
     useReg(state, base);
 
     auto baseTree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(base, widthB);
+        = factory().make<TreeNodePhysicalRegister>(base, widthB);
     TreeNode *memTree = nullptr;
     if(mem.index != INVALID_REGISTER) {
         auto regI = AARCH64GPRegister::convertToPhysical(mem.index);
         size_t widthI = AARCH64GPRegister::getWidth(regI, mem.index);
         useReg(state, regI);
 
-        TreeNode *indexTree = TreeFactory::instance().make<
+        TreeNode *indexTree = factory().make<
             TreeNodePhysicalRegister>(regI, widthI);
         auto shift = assembly->getAsmOperands()->getOperands()[1].shift;
         indexTree = shiftExtend(indexTree, shift.type, shift.value);
-        memTree = TreeFactory::instance().make<TreeNodeAddition>(
+        memTree = factory().make<TreeNodeAddition>(
             baseTree,
             indexTree);
     }
     else {
-        memTree = TreeFactory::instance().make<TreeNodeAddition>(
+        memTree = factory().make<TreeNodeAddition>(
             baseTree,
-            TreeFactory::instance().make<TreeNodeConstant>(mem.disp));
+            factory().make<TreeNodeConstant>(mem.disp));
 
         if(assembly->isPreIndex()) {
             defReg(state, base, memTree);
@@ -874,7 +874,7 @@ void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
     useMem(state, memTree, reg0);
 
     auto derefTree
-        = TreeFactory::instance().make<TreeNodeDereference>(memTree, width);
+        = factory().make<TreeNodeDereference>(memTree, width);
     defReg(state, reg0, derefTree);
 #elif defined(ARCH_RISCV)
     auto rd = assembly->getAsmOperands()->getOperands()[0].value.reg;
@@ -883,11 +883,11 @@ void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
     useReg(state, mem.basereg);
 
     auto rs1tree =
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(mem.basereg, 8);
+        factory().make<TreeNodePhysicalRegister>(mem.basereg, 8);
 
-    auto memTree = TreeFactory::instance().make<TreeNodeAddition>(
+    auto memTree = factory().make<TreeNodeAddition>(
         rs1tree,
-        TreeFactory::instance().make<TreeNodeConstant>(mem.disp));
+        factory().make<TreeNodeConstant>(mem.disp));
 
     // int width = 0;
     switch(assembly->getId()) {
@@ -912,7 +912,7 @@ void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
 
     useMem(state, memTree, width);
     defReg(state, rd,
-        TreeFactory::instance().make<TreeNodeDereference>(memTree, width));
+        factory().make<TreeNodeDereference>(memTree, width));
 #endif
 }
 
@@ -924,18 +924,18 @@ void UseDef::fillImmToReg(UDState *state, AssemblyPtr assembly) {
     int reg1;
     size_t width1;
     std::tie(reg1, width1) = getPhysicalRegister(op1);
-    auto tree1 = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+    auto tree1 = factory().make<TreeNodePhysicalRegister>(
         reg1, width1);
-    auto tree0 = TreeFactory::instance().make<TreeNodeConstant>(op0);
+    auto tree0 = factory().make<TreeNodeConstant>(op0);
     if(assembly->getId() == X86_INS_ADD) {
         auto destTree
-            = TreeFactory::instance().make<TreeNodeAddition>(tree1, tree0);
+            = factory().make<TreeNodeAddition>(tree1, tree0);
         useReg(state, reg1);
         defReg(state, reg1, destTree);
     }
     else if(assembly->getId() == X86_INS_SUB) {
         auto destTree
-            = TreeFactory::instance().make<TreeNodeSubtraction>(tree1, tree0);
+            = factory().make<TreeNodeSubtraction>(tree1, tree0);
         useReg(state, reg1);
         defReg(state, reg1, destTree);
     }
@@ -946,7 +946,7 @@ void UseDef::fillImmToReg(UDState *state, AssemblyPtr assembly) {
         defReg(state, reg1, tree0);
     }
     else if(assembly->getId() == X86_INS_AND) {
-        auto destTree = TreeFactory::instance().make<TreeNodeAnd>(tree1, tree0);
+        auto destTree = factory().make<TreeNodeAnd>(tree1, tree0);
         useReg(state, reg1);
         defReg(state, reg1, destTree);
     }
@@ -963,10 +963,10 @@ void UseDef::fillImmToReg(UDState *state, AssemblyPtr assembly) {
         || assembly->getId() == ARM64_INS_ADRP
         || assembly->getId() == ARM64_INS_LDR) {
 
-        tree1 = TreeFactory::instance().make<TreeNodeAddress>(op1);
+        tree1 = factory().make<TreeNodeAddress>(op1);
     }
     else {
-        tree1 = TreeFactory::instance().make<TreeNodeConstant>(op1);
+        tree1 = factory().make<TreeNodeConstant>(op1);
     }
     defReg(state, reg0, tree1);
 #elif defined(ARCH_RISCV)
@@ -976,11 +976,11 @@ void UseDef::fillImmToReg(UDState *state, AssemblyPtr assembly) {
     TreeNode *tree = nullptr;
     switch(assembly->getId()) {
     case rv_op_lui:
-        tree = TreeFactory::instance().make<TreeNodeConstant>(
+        tree = factory().make<TreeNodeConstant>(
             (int64_t)(imm << 12));
       break;
     case rv_op_c_lui:
-        tree = TreeFactory::instance().make<TreeNodeConstant>(
+        tree = factory().make<TreeNodeConstant>(
             (int64_t)(imm << 12));
         break;
     case rv_op_auipc:
@@ -988,7 +988,7 @@ void UseDef::fillImmToReg(UDState *state, AssemblyPtr assembly) {
         // but our riscv disas doesn't, so we need to add it manually
         // the disas does, however, pre-shift the imm by 12.
         uint64_t ip = state->getInstruction()->getAddress();
-        tree = TreeFactory::instance().make<TreeNodeAddress>(
+        tree = factory().make<TreeNodeAddress>(
                 ip + (int64_t)(imm));
         break;
     }
@@ -1011,9 +1011,9 @@ void UseDef::fillRegRegToReg(UDState *state, AssemblyPtr assembly) {
     useReg(state, reg2);
 
     TreeNode *reg1tree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(reg1, width1);
+        = factory().make<TreeNodePhysicalRegister>(reg1, width1);
     TreeNode *reg2tree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(reg2, width2);
+        = factory().make<TreeNodePhysicalRegister>(reg2, width2);
 
     auto shift = assembly->getAsmOperands()->getOperands()[2].shift;
     reg2tree = shiftExtend(reg2tree, shift.type, shift.value);
@@ -1021,15 +1021,15 @@ void UseDef::fillRegRegToReg(UDState *state, AssemblyPtr assembly) {
     TreeNode *tree = nullptr;
     switch(assembly->getId()) {
     case ARM64_INS_ADD:
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeAddition>(reg1tree, reg2tree);
         break;
     case ARM64_INS_AND:
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeAnd>(reg1tree, reg2tree);
         break;
     case ARM64_INS_SUB:
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeSubtraction>(reg1tree, reg2tree);
         break;
     default:
@@ -1048,9 +1048,9 @@ void UseDef::fillRegRegToReg(UDState *state, AssemblyPtr assembly) {
 
     TreeNode *reg1tree = nullptr, *reg2tree = nullptr;
     auto helper = [&](size_t width) {
-        reg1tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(rs1,
+        reg1tree = factory().make<TreeNodePhysicalRegister>(rs1,
             width);
-        reg2tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(rs2,
+        reg2tree = factory().make<TreeNodePhysicalRegister>(rs2,
             width);
     };
 
@@ -1058,32 +1058,32 @@ void UseDef::fillRegRegToReg(UDState *state, AssemblyPtr assembly) {
     switch(assembly->getId()) {
     case rv_op_add:
         helper(8);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeAddition>(reg1tree, reg2tree);
         break;
     case rv_op_and:
         helper(8);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeAnd>(reg1tree, reg2tree);
         break;
     case rv_op_or:
         helper(8);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeOr>(reg1tree, reg2tree);
         break;
     case rv_op_sub:
         helper(8);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeSubtraction>(reg1tree, reg2tree);
         break;
     case rv_op_subw:
         helper(4);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeSubtraction>(reg1tree, reg2tree);
         break;
     case rv_op_xor:
         helper(8);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeXor>(reg1tree, reg2tree);
         break;
     default:
@@ -1108,25 +1108,25 @@ void UseDef::fillMemImmToReg(UDState *state, AssemblyPtr assembly) {
     useReg(state, base);
 
     auto baseTree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(base, widthB);
+        = factory().make<TreeNodePhysicalRegister>(base, widthB);
 
     assert(mem.index == INVALID_REGISTER);
     assert(mem.disp == 0);
 
     size_t width = (assembly->getBytes()[3] & 0b01000000) ? 8 : 4;
-    auto memTree = TreeFactory::instance().make<TreeNodeAddition>(
+    auto memTree = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(0));
+        factory().make<TreeNodeConstant>(0));
     useMem(state, memTree, reg0);
 
     auto derefTree
-        = TreeFactory::instance().make<TreeNodeDereference>(memTree, width);
+        = factory().make<TreeNodeDereference>(memTree, width);
     defReg(state, reg0, derefTree);
 
     auto imm = assembly->getAsmOperands()->getOperands()[2].imm;
-    auto wbTree = TreeFactory::instance().make<TreeNodeAddition>(
+    auto wbTree = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(imm));
+        factory().make<TreeNodeConstant>(imm));
     defReg(state, base, wbTree);
 #endif
 }
@@ -1143,11 +1143,11 @@ void UseDef::fillRegToMem(UDState *state, AssemblyPtr assembly, size_t width) {
         int rsp;
         size_t widthRsp;
         std::tie(rsp, widthRsp) = getPhysicalRegister(X86_REG_RSP);
-        auto rspTree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto rspTree = factory().make<TreeNodePhysicalRegister>(
             rsp, widthRsp);
         useReg(state, rsp);
-        auto memTree = TreeFactory::instance().make<TreeNodeSubtraction>(
-            rspTree, TreeFactory::instance().make<TreeNodeConstant>(8));
+        auto memTree = factory().make<TreeNodeSubtraction>(
+            rspTree, factory().make<TreeNodeConstant>(8));
         defReg(state, rsp, memTree);
         defMem(state, memTree, reg0);
     }
@@ -1155,7 +1155,7 @@ void UseDef::fillRegToMem(UDState *state, AssemblyPtr assembly, size_t width) {
         auto memTree = makeMemTree(state,
             assembly->getAsmOperands()->getOperands()[1].mem);
         if(!memTree) {
-            memTree = TreeFactory::instance().make<TreeNodeConstant>(0);
+            memTree = factory().make<TreeNodeConstant>(0);
         }
         defMem(state, memTree, reg0);
     }
@@ -1173,25 +1173,25 @@ void UseDef::fillRegToMem(UDState *state, AssemblyPtr assembly, size_t width) {
     useReg(state, base);
 
     auto baseTree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(base, widthB);
+        = factory().make<TreeNodePhysicalRegister>(base, widthB);
     TreeNode *memTree = nullptr;
     if(mem.index != INVALID_REGISTER) {
         auto regI = AARCH64GPRegister::convertToPhysical(mem.index);
         size_t widthI = AARCH64GPRegister::getWidth(regI, mem.index);
         useReg(state, regI);
 
-        TreeNode *indexTree = TreeFactory::instance().make<
+        TreeNode *indexTree = factory().make<
             TreeNodePhysicalRegister>(regI, widthI);
         auto shift = assembly->getAsmOperands()->getOperands()[1].shift;
         indexTree = shiftExtend(indexTree, shift.type, shift.value);
-        memTree = TreeFactory::instance().make<TreeNodeAddition>(
+        memTree = factory().make<TreeNodeAddition>(
             baseTree,
             indexTree);
     }
     else {
-        memTree = TreeFactory::instance().make<TreeNodeAddition>(
+        memTree = factory().make<TreeNodeAddition>(
             baseTree,
-            TreeFactory::instance().make<TreeNodeConstant>(mem.disp));
+            factory().make<TreeNodeConstant>(mem.disp));
 
         if(assembly->isPreIndex()) {
             defReg(state, base, memTree);
@@ -1207,13 +1207,13 @@ void UseDef::fillRegToMem(UDState *state, AssemblyPtr assembly, size_t width) {
     useReg(state, mem.basereg);
 
     auto rs1tree =
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(mem.basereg, 8);
+        factory().make<TreeNodePhysicalRegister>(mem.basereg, 8);
 
     TreeNode *memTree = rs1tree;
     if(mem.disp != 0) {
-        memTree = TreeFactory::instance().make<TreeNodeAddition>(
+        memTree = factory().make<TreeNodeAddition>(
             rs1tree,
-            TreeFactory::instance().make<TreeNodeConstant>(mem.disp));
+            factory().make<TreeNodeConstant>(mem.disp));
     }
 
     // int width = 0;
@@ -1251,27 +1251,27 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
     useReg(state, reg1);
 
     auto regTree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(reg1, width1);
+        = factory().make<TreeNodePhysicalRegister>(reg1, width1);
 
     long int imm = assembly->getAsmOperands()->getOperands()[2].imm;
     auto shift = assembly->getAsmOperands()->getOperands()[2].shift;
     TreeNode *immTree
-        = TreeFactory::instance().make<TreeNodeConstant>(imm);
+        = factory().make<TreeNodeConstant>(imm);
 
     immTree = shiftExtend(immTree, shift.type, shift.value);
 
     TreeNode *tree = nullptr;
     switch(assembly->getId()) {
     case ARM64_INS_ADD:
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeAddition>(regTree, immTree);
         break;
     case ARM64_INS_AND:
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeAnd>(regTree, immTree);
         break;
     case ARM64_INS_SUB:
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeSubtraction>(regTree, immTree);
         break;
     default:
@@ -1289,9 +1289,9 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
 
     TreeNode *reg1tree = nullptr, *immtree = nullptr;
     auto helper = [&](size_t width) {
-        reg1tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(rs1,
+        reg1tree = factory().make<TreeNodePhysicalRegister>(rs1,
             width);
-        immtree = TreeFactory::instance().make<TreeNodeConstant>(imm);
+        immtree = factory().make<TreeNodeConstant>(imm);
     };
 
     TreeNode *tree = nullptr;
@@ -1299,7 +1299,7 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
     case rv_op_addi:
         helper(8);
         if(rs1 != rv_ireg_zero) {
-            tree = TreeFactory::instance().make<TreeNodeAddition>(
+            tree = factory().make<TreeNodeAddition>(
                 reg1tree, immtree);
         }
         else {
@@ -1309,10 +1309,10 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
         break;
     case rv_op_addiw:
         helper(4);
-        tree = TreeFactory::instance().make<TreeNodeAddition>(
+        tree = factory().make<TreeNodeAddition>(
             reg1tree, immtree);
         if(rs1 != rv_ireg_zero) {
-            tree = TreeFactory::instance().make<TreeNodeAddition>(
+            tree = factory().make<TreeNodeAddition>(
                 reg1tree, immtree);
         }
         else {
@@ -1322,32 +1322,32 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
         break;
     case rv_op_andi:
         helper(8);
-        tree = TreeFactory::instance().make<TreeNodeAnd>(
+        tree = factory().make<TreeNodeAnd>(
             reg1tree, immtree);
         break;
     case rv_op_ori:
         helper(8);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeOr>(reg1tree, immtree);
         break;
     case rv_op_slli:
         helper(8);
-        tree = TreeFactory::instance().make<TreeNodeLogicalShiftLeft>(
+        tree = factory().make<TreeNodeLogicalShiftLeft>(
             reg1tree, immtree);
         break;
     case rv_op_srai:
         helper(8);
-        tree = TreeFactory::instance().make<TreeNodeArithmeticShiftRight>(
+        tree = factory().make<TreeNodeArithmeticShiftRight>(
             reg1tree, immtree);
         break;
     case rv_op_srli:
         helper(8);
-        tree = TreeFactory::instance().make<TreeNodeLogicalShiftRight>(
+        tree = factory().make<TreeNodeLogicalShiftRight>(
             reg1tree, immtree);
         break;
     case rv_op_xori:
         helper(8);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeXor>(reg1tree, immtree);
         break;
     default:
@@ -1375,29 +1375,29 @@ void UseDef::fillMemToRegReg(UDState *state, AssemblyPtr assembly) {
 
     assert(mem.index == INVALID_REGISTER);
     auto disp = mem.disp;
-    auto dispTree = TreeFactory::instance().make<TreeNodeConstant>(disp);
+    auto dispTree = factory().make<TreeNodeConstant>(disp);
 
-    auto memTree = TreeFactory::instance().make<TreeNodeAddition>(
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(base, widthB),
+    auto memTree = factory().make<TreeNodeAddition>(
+        factory().make<TreeNodePhysicalRegister>(base, widthB),
         dispTree);
     if(assembly->isPreIndex()) {
         defReg(state, base, memTree);
     }
 
     size_t width = (assembly->getBytes()[3] & 0b10000000) ? 8 : 4;
-    auto memTree0 = TreeFactory::instance().make<TreeNodeAddition>(
+    auto memTree0 = factory().make<TreeNodeAddition>(
         memTree,
-        TreeFactory::instance().make<TreeNodeConstant>(0));
-    auto memTree1 = TreeFactory::instance().make<TreeNodeAddition>(
+        factory().make<TreeNodeConstant>(0));
+    auto memTree1 = factory().make<TreeNodeAddition>(
         memTree,
-        TreeFactory::instance().make<TreeNodeConstant>(width));
+        factory().make<TreeNodeConstant>(width));
     useMem(state, memTree0, reg0);
     useMem(state, memTree1, reg1);
 
     auto derefTree0
-        = TreeFactory::instance().make<TreeNodeDereference>(memTree0, width);
+        = factory().make<TreeNodeDereference>(memTree0, width);
     auto derefTree1
-        = TreeFactory::instance().make<TreeNodeDereference>(memTree1, width);
+        = factory().make<TreeNodeDereference>(memTree1, width);
     defReg(state, reg0, derefTree0);
     defReg(state, reg1, derefTree1);
 #endif
@@ -1421,22 +1421,22 @@ void UseDef::fillRegRegToMem(UDState *state, AssemblyPtr assembly) {
     useReg(state, base);
     assert(mem.index == INVALID_REGISTER);
     auto disp = mem.disp;
-    auto dispTree = TreeFactory::instance().make<TreeNodeConstant>(disp);
+    auto dispTree = factory().make<TreeNodeConstant>(disp);
 
-    auto memTree = TreeFactory::instance().make<TreeNodeAddition>(
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(base, widthB),
+    auto memTree = factory().make<TreeNodeAddition>(
+        factory().make<TreeNodePhysicalRegister>(base, widthB),
         dispTree);
     if(assembly->isPreIndex()) {
         defReg(state, base, memTree);
     }
 
     size_t width = (assembly->getBytes()[3] & 0b10000000) ? 8 : 4;
-    auto memTree0 = TreeFactory::instance().make<TreeNodeAddition>(
+    auto memTree0 = factory().make<TreeNodeAddition>(
         memTree,
-        TreeFactory::instance().make<TreeNodeConstant>(0));
-    auto memTree1 = TreeFactory::instance().make<TreeNodeAddition>(
+        factory().make<TreeNodeConstant>(0));
+    auto memTree1 = factory().make<TreeNodeAddition>(
         memTree,
-        TreeFactory::instance().make<TreeNodeConstant>(width));
+        factory().make<TreeNodeConstant>(width));
 
     defMem(state, memTree0, reg0);
     defMem(state, memTree1, reg1);
@@ -1460,25 +1460,25 @@ void UseDef::fillRegRegImmToMem(UDState *state, AssemblyPtr assembly) {
     useReg(state, base);
 
     auto baseTree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(base, widthB);
+        = factory().make<TreeNodePhysicalRegister>(base, widthB);
 
     assert(mem.index == INVALID_REGISTER);
     assert(mem.disp == 0);
 
     size_t width = (assembly->getBytes()[3] & 0b10000000) ? 8 : 4;
-    auto memTree0 = TreeFactory::instance().make<TreeNodeAddition>(
+    auto memTree0 = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(0));
-    auto memTree1 = TreeFactory::instance().make<TreeNodeAddition>(
+        factory().make<TreeNodeConstant>(0));
+    auto memTree1 = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(width));
+        factory().make<TreeNodeConstant>(width));
     defMem(state, memTree0, reg0);
     defMem(state, memTree1, reg1);
 
     auto imm = assembly->getAsmOperands()->getOperands()[3].imm;
-    auto wbTree = TreeFactory::instance().make<TreeNodeAddition>(
+    auto wbTree = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(imm));
+        factory().make<TreeNodeConstant>(imm));
     defReg(state, base, wbTree);
 #endif
 }
@@ -1498,32 +1498,32 @@ void UseDef::fillMemImmToRegReg(UDState *state, AssemblyPtr assembly) {
     useReg(state, base);
 
     auto baseTree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(base, widthB);
+        = factory().make<TreeNodePhysicalRegister>(base, widthB);
 
     assert(mem.index == INVALID_REGISTER);
     assert(mem.disp == 0);
 
     size_t width = (assembly->getBytes()[3] & 0b10000000) ? 8 : 4;
-    auto memTree0 = TreeFactory::instance().make<TreeNodeAddition>(
+    auto memTree0 = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(0));
-    auto memTree1 = TreeFactory::instance().make<TreeNodeAddition>(
+        factory().make<TreeNodeConstant>(0));
+    auto memTree1 = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(width));
+        factory().make<TreeNodeConstant>(width));
     useMem(state, memTree0, reg0);
     useMem(state, memTree1, reg1);
 
     auto derefTree0
-        = TreeFactory::instance().make<TreeNodeDereference>(memTree0, width);
+        = factory().make<TreeNodeDereference>(memTree0, width);
     auto derefTree1
-        = TreeFactory::instance().make<TreeNodeDereference>(memTree1, width);
+        = factory().make<TreeNodeDereference>(memTree1, width);
     defReg(state, reg0, derefTree0);
     defReg(state, reg1, derefTree1);
 
     auto imm = assembly->getAsmOperands()->getOperands()[3].imm;
-    auto wbTree = TreeFactory::instance().make<TreeNodeAddition>(
+    auto wbTree = factory().make<TreeNodeAddition>(
         baseTree,
-        TreeFactory::instance().make<TreeNodeConstant>(imm));
+        factory().make<TreeNodeConstant>(imm));
     defReg(state, base, wbTree);
 #endif
 }
@@ -1547,18 +1547,18 @@ void UseDef::fillRegRegRegToReg(UDState *state, AssemblyPtr assembly) {
     useReg(state, reg3);
 
     TreeNode *reg1tree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(reg1, width1);
+        = factory().make<TreeNodePhysicalRegister>(reg1, width1);
     TreeNode *reg2tree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(reg2, width2);
+        = factory().make<TreeNodePhysicalRegister>(reg2, width2);
     TreeNode *reg3tree
-        = TreeFactory::instance().make<TreeNodePhysicalRegister>(reg3, width3);
+        = factory().make<TreeNodePhysicalRegister>(reg3, width3);
 
     TreeNode *tree = nullptr;
     switch(assembly->getId()) {
     case ARM64_INS_MADD: {
-        auto subtree = TreeFactory::instance().make<
+        auto subtree = factory().make<
             TreeNodeMultiplication>(reg1tree, reg2tree);
-        tree = TreeFactory::instance().make<
+        tree = factory().make<
             TreeNodeAddition>(subtree, reg3tree);
         break;
     }
@@ -1592,22 +1592,22 @@ TreeNode *UseDef::makeMemTree(UDState *state, const x86_op_mem& mem) {
         && mem.base == INVALID_REGISTER)) {
 
         // use TreeNodeConstant because it can be mem.disp < 0
-        memTree = TreeFactory::instance().make<TreeNodeConstant>(mem.disp);
+        memTree = factory().make<TreeNodeConstant>(mem.disp);
     }
     if(mem.index != INVALID_REGISTER) {
         int regI;
         size_t widthI;
         std::tie(regI, widthI) = getPhysicalRegister(mem.index);
         useReg(state, regI);
-        TreeNode *indexTree = TreeFactory::instance().make<
+        TreeNode *indexTree = factory().make<
             TreeNodePhysicalRegister>(regI, widthI);
         //if(mem.scale != 1) {
-            indexTree = TreeFactory::instance().make<TreeNodeMultiplication>(
+            indexTree = factory().make<TreeNodeMultiplication>(
                 indexTree,
-                TreeFactory::instance().make<TreeNodeConstant>(mem.scale));
+                factory().make<TreeNodeConstant>(mem.scale));
         //}
         if(memTree) {
-            memTree = TreeFactory::instance().make<TreeNodeAddition>(
+            memTree = factory().make<TreeNodeAddition>(
                 indexTree, memTree);
         }
         else {
@@ -1619,7 +1619,7 @@ TreeNode *UseDef::makeMemTree(UDState *state, const x86_op_mem& mem) {
         TreeNode *baseTree = nullptr;
         if(mem.base == X86_REG_RIP) {
             auto instr = state->getInstruction();
-            baseTree = TreeFactory::instance().make<TreeNodeRegisterRIP>(
+            baseTree = factory().make<TreeNodeRegisterRIP>(
                 instr->getAddress() + instr->getSize());
         }
         else {
@@ -1627,11 +1627,11 @@ TreeNode *UseDef::makeMemTree(UDState *state, const x86_op_mem& mem) {
             size_t widthB;
             std::tie(regB, widthB) = getPhysicalRegister(mem.base);
             useReg(state, regB);
-            baseTree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+            baseTree = factory().make<TreeNodePhysicalRegister>(
                 regB, widthB);
         }
         if(memTree) {
-            memTree = TreeFactory::instance().make<TreeNodeAddition>(
+            memTree = factory().make<TreeNodeAddition>(
                 baseTree, memTree);
         }
         else {
@@ -1692,11 +1692,11 @@ void UseDef::fillBt(UDState *state, AssemblyPtr assembly) {
         std::tie(reg1, width1) = getPhysicalRegister(
             assembly->getAsmOperands()->getOperands()[1].reg);
         useReg(state, reg1);
-        auto tree0 = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto tree0 = factory().make<TreeNodePhysicalRegister>(
             reg0, width0);
-        auto tree1 = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto tree1 = factory().make<TreeNodePhysicalRegister>(
             reg1, width1);
-        auto tree = TreeFactory::instance().make<TreeNodeAnd>(tree0, tree1);
+        auto tree = factory().make<TreeNodeAnd>(tree0, tree1);
         defReg(state, X86Register::FLAGS, tree);
     }
     else if(mode == AssemblyOperands::MODE_MEM_REG) {
@@ -1734,11 +1734,11 @@ void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
             assembly->getAsmOperands()->getOperands()[1].reg);
         useReg(state, reg1);
 
-        auto tree0 = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto tree0 = factory().make<TreeNodePhysicalRegister>(
             reg0, width0);
-        auto tree1 = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto tree1 = factory().make<TreeNodePhysicalRegister>(
             reg1, width1);
-        auto tree = TreeFactory::instance().make<TreeNodeComparison>(
+        auto tree = factory().make<TreeNodeComparison>(
             tree1, tree0);
         defReg(state, X86Register::FLAGS, tree);
     }
@@ -1748,21 +1748,21 @@ void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
         std::tie(reg1, width1) = getPhysicalRegister(
             assembly->getAsmOperands()->getOperands()[1].reg);
         useReg(state, reg1);
-        auto tree0 = TreeFactory::instance().make<TreeNodeConstant>(imm);
-        auto tree1 = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto tree0 = factory().make<TreeNodeConstant>(imm);
+        auto tree1 = factory().make<TreeNodePhysicalRegister>(
             reg1, width1);
-        auto tree = TreeFactory::instance().make<TreeNodeComparison>(
+        auto tree = factory().make<TreeNodeComparison>(
             tree1, tree0);
         defReg(state, X86Register::FLAGS, tree);
     }
     else if(mode == AssemblyOperands::MODE_IMM_MEM) {
         auto imm = assembly->getAsmOperands()->getOperands()[0].imm;
-        auto tree0 = TreeFactory::instance().make<TreeNodeConstant>(imm);
+        auto tree0 = factory().make<TreeNodeConstant>(imm);
         auto memTree = makeMemTree(
             state, assembly->getAsmOperands()->getOperands()[1].mem);
-        auto tree1 = TreeFactory::instance().make<TreeNodeDereference>(
+        auto tree1 = factory().make<TreeNodeDereference>(
             memTree, 8);    // !!!
-        auto tree = TreeFactory::instance().make<TreeNodeComparison>(
+        auto tree = factory().make<TreeNodeComparison>(
             tree1, tree0);
         defReg(state, X86Register::FLAGS, tree);
     }
@@ -1780,10 +1780,10 @@ void UseDef::fillInc(UDState *state, AssemblyPtr assembly) {
             assembly->getAsmOperands()->getOperands()[0].reg);
         if(reg0 < 0) return;
         useReg(state, reg0);
-        auto reg0Tree = TreeFactory::instance().make<TreeNodePhysicalRegister>(
+        auto reg0Tree = factory().make<TreeNodePhysicalRegister>(
             reg0, width0);
-        auto oneTree = TreeFactory::instance().make<TreeNodeConstant>(1);
-        auto tree = TreeFactory::instance().make<TreeNodeAddition>(
+        auto oneTree = factory().make<TreeNodeConstant>(1);
+        auto tree = factory().make<TreeNodeAddition>(
             reg0Tree, oneTree);
         defReg(state, reg0, tree);
     }
@@ -1950,7 +1950,7 @@ void UseDef::fillXor(UDState *state, AssemblyPtr assembly) {
             std::tie(reg0, std::ignore) = getPhysicalRegister(op0);
 
             defReg(state, reg0,
-                TreeFactory::instance().make<TreeNodeConstant>(0));
+                factory().make<TreeNodeConstant>(0));
         }
     }
     LOG(10, "NYI (fully): " << assembly->getMnemonic());
@@ -2038,9 +2038,9 @@ void UseDef::fillCbz(UDState *state, AssemblyPtr assembly) {
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
     useReg(state, reg0);
 
-    auto tree = TreeFactory::instance().make<TreeNodeComparison>(
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0),
-        TreeFactory::instance().make<TreeNodeConstant>(0));
+    auto tree = factory().make<TreeNodeComparison>(
+        factory().make<TreeNodePhysicalRegister>(reg0, width0),
+        factory().make<TreeNodeConstant>(0));
     defReg(state, AARCH64GPRegister::ONETIME_NZCV, tree);
 }
 void UseDef::fillCbnz(UDState *state, AssemblyPtr assembly) {
@@ -2049,9 +2049,9 @@ void UseDef::fillCbnz(UDState *state, AssemblyPtr assembly) {
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
     useReg(state, reg0);
 
-    auto tree = TreeFactory::instance().make<TreeNodeComparison>(
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0),
-        TreeFactory::instance().make<TreeNodeConstant>(0));
+    auto tree = factory().make<TreeNodeComparison>(
+        factory().make<TreeNodePhysicalRegister>(reg0, width0),
+        factory().make<TreeNodeConstant>(0));
     defReg(state, AARCH64GPRegister::ONETIME_NZCV, tree);
 }
 void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
@@ -2061,9 +2061,9 @@ void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
     useReg(state, reg0);
 
     auto imm = assembly->getAsmOperands()->getOperands()[1].imm;
-    auto tree = TreeFactory::instance().make<TreeNodeComparison>(
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0),
-        TreeFactory::instance().make<TreeNodeConstant>(imm));
+    auto tree = factory().make<TreeNodeComparison>(
+        factory().make<TreeNodePhysicalRegister>(reg0, width0),
+        factory().make<TreeNodeConstant>(imm));
     defReg(state, AARCH64GPRegister::NZCV, tree);
 }
 void UseDef::fillCsel(UDState *state, AssemblyPtr assembly) {
@@ -2072,7 +2072,7 @@ void UseDef::fillCsel(UDState *state, AssemblyPtr assembly) {
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
     defReg(state,
         reg0,
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
+        factory().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI: " << assembly->getMnemonic());
 }
 void UseDef::fillCset(UDState *state, AssemblyPtr assembly) {
@@ -2081,7 +2081,7 @@ void UseDef::fillCset(UDState *state, AssemblyPtr assembly) {
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
     defReg(state,
         reg0,
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
+        factory().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI: " << assembly->getMnemonic());
 }
 void UseDef::fillEor(UDState *state, AssemblyPtr assembly) {
@@ -2090,7 +2090,7 @@ void UseDef::fillEor(UDState *state, AssemblyPtr assembly) {
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
     defReg(state,
         reg0,
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
+        factory().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI (fully): " << assembly->getMnemonic());
 }
 void UseDef::fillFmov(UDState *state, AssemblyPtr assembly) {
@@ -2222,7 +2222,7 @@ void UseDef::fillOrr(UDState *state, AssemblyPtr assembly) {
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
     defReg(state,
         reg0,
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
+        factory().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI (fully): " << assembly->getMnemonic());
 }
 void UseDef::fillMov(UDState *state, AssemblyPtr assembly) {
@@ -2243,7 +2243,7 @@ void UseDef::fillMrs(UDState *state, AssemblyPtr assembly) {
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
     defReg(state,
         reg0,
-        TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
+        factory().make<TreeNodePhysicalRegister>(reg0, width0));
 }
 void UseDef::fillRet(UDState *state, AssemblyPtr assembly) {
     for(int i = 0; i < 8; i++) {
@@ -2365,7 +2365,7 @@ void UseDef::fillJal(UDState *state, AssemblyPtr assembly) {
 void UseDef::fillJalr(UDState *state, AssemblyPtr assembly) {
     useReg(state, assembly->getAsmOperands()->getOperands()[1].value.reg);
     defReg(state, assembly->getAsmOperands()->getOperands()[0].value.reg,
-        TreeFactory::instance().make<TreeNodeAddress>(
+        factory().make<TreeNodeAddress>(
         state->getInstruction()->getAddress() + state->getInstruction()->getSize()
         ));
 }
@@ -265,6 +265,8 @@ private:
     RefList *regSet;
     MemOriginList *memSet;
 
+    TreeFactory treeFactory;    // owns the trees of every state
+
 public:
     UDWorkingSet(ControlFlowGraph *cfg, bool trackPartial = false)
         : nodeExposedRegSetList(cfg->getCount()),
@@ -295,6 +297,8 @@ public:
 
     void dumpSet() const;
 
+    TreeFactory &getTreeFactory() { return treeFactory; }
+
     virtual UDState *getState(Instruction *instruction)
         { return nullptr; }
 };
@@ -340,6 +344,8 @@ public:
     void cancelUseDefReg(UDState *state, int reg);
 
 private:
+    TreeFactory &factory() const { return working->getTreeFactory(); }
+
     void analyzeGraph(const std::vector<int>& order);
     void fillState(UDState *state);
     bool callIfEnabled(UDState *state, Instruction *instruction);
@@ -14,7 +14,7 @@ FunctionAliasMap::FunctionAliasMap(Module *module) {
                 if(aliasSym->getType() != Symbol::TYPE_FUNC
                     && aliasSym->getType() != Symbol::TYPE_IFUNC) continue;
                 auto alias = aliasSym->getName();
-                aliasMap[alias] = func;
+                add(alias, func);
                 LOG(5, "alias [" << alias << "] to [" << func->getName() << "]");
 
                 maybeSpecialAlias(alias, func);
@@ -27,7 +27,7 @@ FunctionAliasMap::FunctionAliasMap(Module *module) {
                 if(aliasSym->getType() != Symbol::TYPE_FUNC
                     && aliasSym->getType() != Symbol::TYPE_IFUNC) continue;
                 auto alias = aliasSym->getName();
-                aliasMap[alias] = func;
+                add(alias, func);
                 LOG(5, "alias [" << alias << "] to [" << func->getName() << "]");
 
                 maybeSpecialAlias(alias, func);
@@ -44,14 +44,15 @@ void FunctionAliasMap::maybeSpecialAlias(const char *alias, Function *func) {
         auto specialVersion = std::strstr(alias, ext[i]);
         if(specialVersion) {
             std::string splice(alias, specialVersion - alias);
-            aliasMap[splice] = func;
+            add(splice, func);
             LOG(5, "SPECIAL alias [" << splice << "] to [" << alias << "]");
             break;
         }
     }
 }
 
-Function *FunctionAliasMap::find(const std::string &alias) {
-    auto it = aliasMap.find(alias);
+Function *FunctionAliasMap::find(StringTable::ID id) {
+    if(id == StringTable::NONE) return nullptr;
+    auto it = aliasMap.find(id);
     return (it != aliasMap.end() ? (*it).second : nullptr);
 }
@@ -2,7 +2,8 @@
 #define EGALITO_CHUNK_ALIAS_MAP_H
 
 #include <string>
-#include <map>
+#include <unordered_map>
+#include "util/stringtable.h"
 
 class Function;
 class Module;
@@ -13,12 +14,20 @@ class Module;
 */
 class FunctionAliasMap {
 private:
-    std::map<std::string, Function *> aliasMap;
+    std::unordered_map<StringTable::ID, Function *> aliasMap;
 public:
     FunctionAliasMap(Module *module);
 
-    Function *find(const std::string &alias);
+    Function *find(const std::string &alias)
+        { return find(StringTable::getInstance().lookup(alias)); }
+    Function *find(const char *alias)
+        { return find(StringTable::getInstance().lookup(alias)); }
 private:
+    Function *find(StringTable::ID id);
+    void add(const char *alias, Function *func)
+        { aliasMap[StringTable::getInstance().intern(alias)] = func; }
+    void add(const std::string &alias, Function *func)
+        { aliasMap[StringTable::getInstance().intern(alias)] = func; }
     void maybeSpecialAlias(const char *alias, Function *func);
 };
 
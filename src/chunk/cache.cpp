@@ -4,6 +4,7 @@
 #include "chunk/link.h"
 #include "chunk/concrete.h"
 #include "instr/semantic.h"
+#include "instr/concrete.h"
 #include "instr/writer.h"
 #include "log/log.h"
 #include "log/temp.h"
@@ -14,38 +15,134 @@ void ChunkCache::make(Chunk *chunk) {
     //TemporaryLogLevel tll2("disasm", 10);
 
     LOG(10, "fixups for ChunkCache::make " << chunk->getName());
-#ifdef ARCH_X86_64
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
     this->address = chunk->getAddress();
     InstrWriterCppString writer(data);
     for(auto b : chunk->getChildren()->genericIterable()) {
         auto block = dynamic_cast<Block *>(b);
         for(auto i : CIter::children(block)) {
             auto semantic = i->getSemantic();
+            uint32_t offset = i->getAddress() - address;
             semantic->accept(&writer);
-            if(auto link = semantic->getLink()) {
-                if(dynamic_cast<DataOffsetLink *>(link)) {
-                    auto v = dynamic_cast<LinkedInstruction *>(semantic);
-                    assert(v);
-
-                    fixups.push_back(i->getAddress() + v->getDispOffset()
-                        - chunk->getAddress());
-                    IF_LOG(10) {
-                        ChunkDumper d;
-                        i->accept(&d);
-                    }
-                }
+
+            auto link = semantic->getLink();
+            if(!link) continue;
+
+            Fixup field = {};
+#ifdef ARCH_X86_64
+            if(auto v = dynamic_cast<LinkedInstructionBase *>(semantic)) {
+                field.offset = offset + v->getDispOffset();
+                field.width = v->getDispSize();
+            }
+            else if(auto v
+                = dynamic_cast<ControlFlowInstructionBase *>(semantic)) {
+
+                field.offset = offset + v->getDispOffset();
+                field.width = v->getDisplacementSize();
+            }
+            if(field.width == 0) continue;
+            field.encoding = link->isRIPRelative()
+                ? ENCODING_RELATIVE : ENCODING_ABSOLUTE;
+            field.pcOffset = offset + semantic->getSize();
+#else
+            field.offset = offset;
+            field.width = 4;
+            field.pcOffset = offset;
+            if(auto v = dynamic_cast<LinkedInstruction *>(semantic)) {
+                uint32_t bits;
+                std::memcpy(&bits, data.data() + offset, 4);
+                field.encoding = v->isPCRelative()
+                    ? ENCODING_RELATIVE : ENCODING_AARCH64;
+                field.makeImm = v->getModeInfo()->makeImm;
+                field.fixedBits = bits & v->getModeInfo()->fixedMask;
+            }
+            else if(dynamic_cast<LinkedLiteralInstruction *>(semantic)) {
+                field.encoding = ENCODING_ABSOLUTE;
+            }
+            else continue;
+#endif
+            addFixup(chunk, link, field);
+            IF_LOG(10) {
+                ChunkDumper d;
+                i->accept(&d);
             }
         }
     }
 #endif
+    LOG(10, "    " << getFixupCount() << " fixups");
 }
 
-void ChunkCache::copyAndFix(char *output) {
+void ChunkCache::addFixup(Chunk *chunk, Link *link, const Fixup &field) {
+    Fixup fixup = field;
+    bool relative = (fixup.encoding == ENCODING_RELATIVE);
+#ifdef ARCH_AARCH64
+    // immediates are always re-encoded; relative only matters for
+    // deciding whether an internal target needs a fixup
+    if(relative) fixup.encoding = ENCODING_AARCH64;
+#endif
+
+    address_t target = link->getTargetAddress();
+    if(target - chunk->getAddress() < chunk->getSize()) {
+        // moves along with the chunk: PC-relative fields never change
+        if(relative) return;
+        fixup.targetKind = TARGET_INTERNAL;
+        fixup.value = target - chunk->getAddress();
+        fixups.push_back(fixup);
+        return;
+    }
+
+    Chunk *targetChunk = link->getTarget();
+    bool moving = !dynamic_cast<GSTableLink *>(link)
+        && (dynamic_cast<DistanceLink *>(link)
+            || dynamic_cast<Function *>(targetChunk)
+            || dynamic_cast<Block *>(targetChunk)
+            || dynamic_cast<Instruction *>(targetChunk)
+            || dynamic_cast<PLTTrampoline *>(targetChunk));
+    if(moving) {
+        fixup.targetKind = TARGET_LINK;
+        fixup.link = link;
+        fixups.push_back(fixup);
+    }
+    else if(fixup.encoding == ENCODING_RELATIVE && fixup.width == 4) {
+        rel32Offsets.push_back(fixup.offset);
+        rel32Values.push_back(target - fixup.pcOffset);
+    }
+    else {
+        fixup.targetKind = TARGET_FIXED;
+        fixup.value = target;
+        fixups.push_back(fixup);
+    }
+}
+
+void ChunkCache::copyAndFix(char *output, address_t address) {
     std::memcpy(output, data.c_str(), data.size());
-    for(auto offset : fixups) {
-        uint32_t *point = reinterpret_cast<uint32_t *>(output + offset);
-        int32_t delta = address - reinterpret_cast<address_t>(output);
-        *point = *reinterpret_cast<const uint32_t *>(data.c_str() + offset)
-            + delta;
+
+    // the common case, with no branches
+    for(size_t k = 0; k < rel32Offsets.size(); k++) {
+        int32_t disp = rel32Values[k] - address;
+        std::memcpy(output + rel32Offsets[k], &disp, sizeof(disp));
+    }
+
+    for(const auto &fixup : fixups) {
+        address_t target = fixup.value;
+        if(fixup.targetKind == TARGET_INTERNAL) {
+            target += address;
+        }
+        else if(fixup.targetKind == TARGET_LINK) {
+            target = fixup.link->getTargetAddress();
+        }
+
+        address_t pc = address + fixup.pcOffset;
+        if(fixup.encoding == ENCODING_AARCH64) {
+            uint32_t word = fixup.fixedBits
+                | fixup.makeImm(target, pc, fixup.fixedBits);
+            std::memcpy(output + fixup.offset, &word, sizeof(word));
+        }
+        else {
+            // fields are little-endian, like the host
+            unsigned long value = (fixup.encoding == ENCODING_RELATIVE)
+                ? target - pc : target;
+            std::memcpy(output + fixup.offset, &value, fixup.width);
+        }
     }
 }
@@ -7,17 +7,58 @@
 #include "instr/instr.h"
 
 class Chunk;
+class Link;
 
+/** Encoded bytes of a chunk plus a list of every field that depends on
+    where the chunk or its link targets are. Re-emitting at a new address
+    is a memcpy followed by patching those fields; PC-relative links whose
+    target is inside the chunk need no patching at all.
+*/
 class ChunkCache {
+public:
+    enum TargetKind {
+        TARGET_FIXED,       // data, GS offsets: value is the target address
+        TARGET_INTERNAL,    // value is the target's offset in the chunk
+        TARGET_LINK,        // code that may move: ask the link every time
+    };
+    enum Encoding {
+        ENCODING_RELATIVE,  // little-endian, target - (address + pcOffset)
+        ENCODING_ABSOLUTE,  // little-endian, target
+        ENCODING_AARCH64,   // immediate field of an AArch64 instruction
+    };
+    typedef uint32_t (*MakeImmediate)(address_t, address_t, uint32_t);
+
+    struct Fixup {
+        uint32_t offset;        // of the field in the chunk
+        uint8_t width;          // of the field in bytes
+        uint8_t encoding;
+        uint8_t targetKind;
+        int32_t pcOffset;       // of the PC base from the chunk start
+        address_t value;
+        Link *link;
+        MakeImmediate makeImm;  // AArch64 only
+        uint32_t fixedBits;     // AArch64 only
+    };
 private:
     address_t address;
     std::string data;
-    std::vector<address_t> fixups;
+    // fixed-target rel32 fields: data at offset = value - output address
+    std::vector<uint32_t> rel32Offsets;
+    std::vector<int64_t> rel32Values;
+    std::vector<Fixup> fixups;  // everything else
 public:
     ChunkCache(Chunk *chunk) { make(chunk); }
-    void copyAndFix(char *output);
+    void copyAndFix(char *output)
+        { copyAndFix(output, reinterpret_cast<address_t>(output)); }
+    /** Copy to output, fixing displacements as if output were at address. */
+    void copyAndFix(char *output, address_t address);
+
+    size_t getSize() const { return data.size(); }
+    size_t getFixupCount() const
+        { return rel32Offsets.size() + fixups.size(); }
 private:
     void make(Chunk *chunk);
+    void addFixup(Chunk *chunk, Link *link, const Fixup &field);
 };
 
 #endif
@@ -3,10 +3,12 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <algorithm>
 #include "chunk.h"
 #include "util/iter.h"
+#include "util/stringtable.h"
 #include "types.h"
 
 // forward declarations
@@ -232,23 +234,36 @@ std::vector<ChildType *> SpatialChunkList<ChildType>
     return std::move(found);
 }
 
+/** Looks up children by name. Names are interned, so looking up a name
+    that no chunk has ever had fails without touching the map.
+*/
 template <typename ChildType>
 class NamedChunkList {
 private:
-    typedef std::map<std::string, ChildType *> NameMapType;
+    typedef std::unordered_map<StringTable::ID, ChildType *> NameMapType;
     NameMapType nameMap;
 public:
     void add(ChildType *child)
-        { nameMap[child->getName()] = child; }
-    void remove(ChildType *child)
-        { nameMap.erase(child->getName()); }
+        { nameMap[StringTable::getInstance().intern(child->getName())] = child; }
+    void remove(ChildType *child);
 
-    ChildType *find(const std::string &name);
+    ChildType *find(const std::string &name)
+        { return find(StringTable::getInstance().lookup(name)); }
+    ChildType *find(const char *name)
+        { return find(StringTable::getInstance().lookup(name)); }
+    ChildType *find(StringTable::ID id);
 };
 
 template <typename ChunkType>
-ChunkType *NamedChunkList<ChunkType>::find(const std::string &name) {
-    auto it = nameMap.find(name);
+void NamedChunkList<ChunkType>::remove(ChunkType *child) {
+    auto id = StringTable::getInstance().lookup(child->getName());
+    if(id != StringTable::NONE) nameMap.erase(id);
+}
+
+template <typename ChunkType>
+ChunkType *NamedChunkList<ChunkType>::find(StringTable::ID id) {
+    if(id == StringTable::NONE) return nullptr;
+    auto it = nameMap.find(id);
     return (it != nameMap.end() ? (*it).second : nullptr);
 }
 
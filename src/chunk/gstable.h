@@ -2,6 +2,7 @@
 #define EGALITO_CHUNK_GS_TABLE_H
 
 #include <map>
+#include <vector>
 #include "chunk.h"
 #include "chunklist.h"
 #include "types.h"
@@ -13,6 +14,7 @@ private:
     Chunk *target;
     IndexType index;
     Chunk *otherTarget;
+    std::vector<IndexType> callees;     // JIT entries target calls directly
 public:
     GSTableEntry(Chunk *target, uint32_t index)
         : target(target), index(index), otherTarget(nullptr) {}
@@ -22,6 +24,8 @@ public:
     IndexType getOffset() const;
     void setOtherTarget(Chunk *other) { otherTarget = other; }
     Chunk *getOtherTarget() const { return otherTarget; }
+    void addCallee(IndexType callee) { callees.push_back(callee); }
+    const std::vector<IndexType> &getCallees() const { return callees; }
 
     virtual void accept(ChunkVisitor *visitor);
 };
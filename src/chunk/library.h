@@ -55,7 +55,8 @@ public:
     const char *getResolvedPathCStr() const { return resolvedPath.c_str(); }
     void setResolvedPath(const std::string &path) { resolvedPath = path; }
 
-    const std::set<Library *> getDependencies() { return dependencies; }
+    const std::set<Library *> &getDependencies() const
+        { return dependencies; }
     void addDependency(Library *library) { dependencies.insert(library); }
 
     virtual void serialize(ChunkSerializerOperations &op,
@@ -99,7 +99,7 @@ void PLTTrampoline::writeTo(char *target) {
     for(auto block : CIter::children(this)) {
         LOG(11, "    write plt block at address 0x" << std::hex << block->getAddress());
         for(auto instr : CIter::children(block)) {
-            char *output = reinterpret_cast<char *>(instr->getAddress());
+            char *output = target + (instr->getAddress() - getAddress());
             LOG(11, "    write plt instruction at address 0x" << std::hex << instr->getAddress());
             InstrWriterCString writer(output);
             instr->getSemantic()->accept(&writer);
@@ -297,7 +297,7 @@ PLTList *PLTList::parse(RelocList *relocList, ElfMap *elf, Module *module) {
                 auto trampoline = new PLTTrampoline(
                     pltList, pltAddress, externalSymbol, value);
 
-                static DisasmHandle handle(true);
+                thread_local DisasmHandle handle(true);
                 auto jmp1 = new Instruction();
                 auto jmp1sem = new DataLinkedControlFlowInstruction(X86_INS_JMP, jmp1,
                     "\xff\x25", "jmpq", 4);
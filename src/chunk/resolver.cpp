@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <cassert>
 #include "resolver.h"
 #include "chunk/concrete.h"
 #include "chunk/aliasmap.h"
+#include "chunk/symbolindex.h"
 #include "conductor/conductor.h"
 #include "conductor/bridge.h"
 #include "disasm/disassemble.h"
@@ -405,14 +407,25 @@ Link *PerfectLinkResolver::resolveExternallyHelper(const char *name,
         return link;
     }
 
-    auto dependencies = module->getLibrary()->getDependencies();
-    for(auto m : CIter::modules(conductor->getProgram())) {
+    // only modules that define the name can resolve it
+    std::vector<Module *> candidates;
+    conductor->getSymbolIndex()->findModules(name, version, candidates);
+
+    // name@version and name@@version, built once for all candidates
+    VersionedNames versioned;
+    if(version && !candidates.empty()) {
+        versioned.single = std::string(name) + "@" + version->getName();
+        versioned.dual = std::string(name) + "@@" + version->getName();
+    }
+
+    const auto &dependencies = module->getLibrary()->getDependencies();
+    for(auto m : candidates) {
         if(dependencies.find(m->getLibrary()) == dependencies.end()) {
             continue;
         }
-        
+
         if(m != module) {
-            if(auto link = resolveNameAsLinkHelper(name, version,
+            if(auto link = resolveNameAsLinkHelper(name, versioned,
                 m, weak, relative, afterMapping)) {
 
                 return link;
@@ -428,16 +441,20 @@ Link *PerfectLinkResolver::resolveExternallyHelper(const char *name,
     }
 
     // weak definition
-    if(auto link = resolveNameAsLinkHelper(name, version,
-        module, weak, relative, afterMapping)) {
+    if(std::find(candidates.begin(), candidates.end(), module)
+        != candidates.end()) {
 
-        LOG(10, "    link to weak definition in " << module->getName());
-        return link;
+        if(auto link = resolveNameAsLinkHelper(name, versioned,
+            module, weak, relative, afterMapping)) {
+
+            LOG(10, "    link to weak definition in " << module->getName());
+            return link;
+        }
     }
 
     // weak reference
-    for(auto m : CIter::modules(conductor->getProgram())) {
-        if(auto link = resolveNameAsLinkHelper(name, version,
+    for(auto m : candidates) {
+        if(auto link = resolveNameAsLinkHelper(name, versioned,
             m, weak, relative, afterMapping)) {
 
             LOG(10, "    link (weak) to definition in " << m->getName());
@@ -451,10 +468,10 @@ Link *PerfectLinkResolver::resolveExternallyHelper(const char *name,
 }
 
 Link *PerfectLinkResolver::resolveNameAsLinkHelper(const char *name,
-    const SymbolVersion *version,
+    const VersionedNames &versioned,
     Module *module, bool weak, bool relative, bool afterMapping) {
 
-    LOG(1, "        resolveNameAsLinkHelper (" << name << ") inside "
+    LOG(10, "        resolveNameAsLinkHelper (" << name << ") inside "
         << module->getName());
 
     if(auto link = resolveNameAsLinkHelper2(
@@ -464,21 +481,15 @@ Link *PerfectLinkResolver::resolveNameAsLinkHelper(const char *name,
     }
     // if there is a default versioned symbol, we need to make a link to
     // it, but this may not occur for gcc compiled binaries & libraries
-    if(!version) return nullptr;
+    if(versioned.single.empty()) return nullptr;
 
-    std::string versionedName1(name);
-    versionedName1.append("@");
-    versionedName1.append(version->getName());
     if(auto link = resolveNameAsLinkHelper2(
-        versionedName1.c_str(), module, weak, relative, afterMapping)) {
+        versioned.single.c_str(), module, weak, relative, afterMapping)) {
 
         return link;
     }
-    std::string versionedName2(name);
-    versionedName2.append("@@");
-    versionedName2.append(version->getName());
     if(auto link = resolveNameAsLinkHelper2(
-        versionedName2.c_str(), module, weak, relative, afterMapping)) {
+        versioned.dual.c_str(), module, weak, relative, afterMapping)) {
 
         return link;
     }
@@ -543,7 +554,7 @@ Link *PerfectLinkResolver::resolveNameAsLinkHelper2(const char *name,
         }
         auto t = LinkFactory::makeDataLink(module, address, true);
 
-        LOG(1, "    address 0x" << std::hex << address << " -> " << t);
+        LOG(10, "    address 0x" << std::hex << address << " -> " << t);
 //        return LinkFactory::makeDataLink(module, address, true);
           return t;
     }
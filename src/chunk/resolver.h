@@ -1,6 +1,7 @@
 #ifndef EGALITO_CHUNK_RESOLVER_H
 #define EGALITO_CHUNK_RESOLVER_H
 
+#include <string>
 #include "link.h"
 
 class Reloc;
@@ -40,7 +41,12 @@ private:
     Link *resolveExternallyHelper(const char *name, const SymbolVersion *version,
         Conductor *conductor, Module *module, bool weak, bool relative,
         bool afterMapping);
-    Link *resolveNameAsLinkHelper(const char *name, const SymbolVersion *version,
+    struct VersionedNames {
+        std::string single;     // name@version, empty if unversioned
+        std::string dual;       // name@@version
+    };
+    Link *resolveNameAsLinkHelper(const char *name,
+        const VersionedNames &versioned,
         Module *module, bool weak, bool relative, bool afterMapping);
     Link *resolveNameAsLinkHelper2(const char *name, Module *module,
         bool weak, bool relative, bool afterMapping);
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstring>
+#include "symbolindex.h"
+#include "concrete.h"
+#include "elf/elfspace.h"
+#include "elf/symbol.h"
+
+#include "log/log.h"
+
+static const uint32_t NO_ENTRY = ~0u;
+
+SymbolIndex::SymbolIndex(Program *program) {
+    for(auto module : CIter::modules(program)) {
+        uint32_t index = moduleList.size();
+        moduleList.push_back(module);
+
+        auto space = module->getElfSpace();
+        auto list = space ? space->getDynamicSymbolList() : nullptr;
+        if(!list) continue;
+
+        for(auto symbol : *list) {
+            auto name = symbol->getName();
+            if(name && *name) add(name, index);
+        }
+    }
+    build();
+
+    LOG(1, "symbol index: " << entryList.size() << " names in "
+        << moduleList.size() << " modules");
+}
+
+uint32_t SymbolIndex::hash(const char *str, uint32_t h) {
+    for(auto p = reinterpret_cast<const unsigned char *>(str); *p; p++) {
+        h = h * 33 + *p;
+    }
+    return h;
+}
+
+void SymbolIndex::add(const char *name, uint32_t moduleIndex) {
+    entryList.push_back(Entry{name, hash(name), moduleIndex, NO_ENTRY});
+}
+
+void SymbolIndex::build() {
+    size_t count = 1;
+    while(count < entryList.size()) count <<= 1;
+    bucketList.assign(count, NO_ENTRY);
+
+    // link in reverse so each chain keeps program order
+    for(size_t i = entryList.size(); i-- > 0; ) {
+        auto &bucket = bucketList[entryList[i].hash & (count - 1)];
+        entryList[i].next = bucket;
+        bucket = i;
+    }
+}
+
+void SymbolIndex::findModules(const char *name, const SymbolVersion *version,
+    std::vector<Module *> &out) const {
+
+    std::vector<uint32_t> found;
+    uint32_t h = hash(name);
+    find(h, name, "", "", found);
+
+    // name@version and name@@version, hashed without concatenating
+    if(version) {
+        auto versionName = version->getName();
+        uint32_t h1 = hash("@", h);
+        find(hash(versionName, h1), name, "@", versionName, found);
+        find(hash(versionName, hash("@", h1)), name, "@@", versionName,
+            found);
+    }
+
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    for(auto index : found) {
+        out.push_back(moduleList[index]);
+    }
+}
+
+void SymbolIndex::find(uint32_t h, const char *name, const char *separator,
+    const char *version, std::vector<uint32_t> &found) const {
+
+    if(bucketList.empty()) return;
+
+    size_t nameLength = std::strlen(name);
+    size_t separatorLength = std::strlen(separator);
+    auto i = bucketList[h & (bucketList.size() - 1)];
+    for( ; i != NO_ENTRY; i = entryList[i].next) {
+        const auto &entry = entryList[i];
+        if(entry.hash != h) continue;
+
+        // compare against name + separator + version piecewise
+        const char *s = entry.name;
+        if(std::strncmp(s, name, nameLength) != 0) continue;
+        s += nameLength;
+        if(std::strncmp(s, separator, separatorLength) != 0) continue;
+        s += separatorLength;
+        if(std::strcmp(s, version) != 0) continue;
+
+        found.push_back(entry.moduleIndex);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef EGALITO_CHUNK_SYMBOL_INDEX_H
+#define EGALITO_CHUNK_SYMBOL_INDEX_H
+
+#include <vector>
+#include <cstdint>
+
+class Program;
+class Module;
+class SymbolVersion;
+
+/** Program-wide index of the names in every module's dynamic symbol list,
+    so that external references can be resolved without probing each
+    module in turn.
+
+    Names are hashed with the GNU ELF hash (h * 33 + c). Since that hash can
+    be continued over more characters, a lookup of name@version or
+    name@@version hashes the pieces in place instead of building the
+    combined string.
+*/
+class SymbolIndex {
+private:
+    struct Entry {
+        const char *name;
+        uint32_t hash;
+        uint32_t moduleIndex;
+        uint32_t next;      // next entry in the same bucket
+    };
+    std::vector<Module *> moduleList;   // in program order
+    std::vector<Entry> entryList;
+    std::vector<uint32_t> bucketList;   // head of each chain
+public:
+    SymbolIndex(Program *program);
+
+    size_t getModuleCount() const { return moduleList.size(); }
+    size_t getEntryCount() const { return entryList.size(); }
+
+    /** Appends every module whose dynamic symbol list contains name,
+        name@version or name@@version, in program order.
+    */
+    void findModules(const char *name, const SymbolVersion *version,
+        std::vector<Module *> &out) const;
+
+    static uint32_t hash(const char *str, uint32_t h = 5381);
+private:
+    void add(const char *name, uint32_t moduleIndex);
+    void build();
+    void find(uint32_t h, const char *name, const char *separator,
+        const char *version, std::vector<uint32_t> &found) const;
+};
+
+#endif
@@ -1,3 +1,6 @@
+#include <cerrno>
+#include <unistd.h>
+#include <sys/syscall.h>
 #include "tls.h"
 
 #ifdef ARCH_X86_64
@@ -92,3 +95,102 @@ void EgalitoTLS::setJITResetCounter(size_t JIT_resetCounter) {
     SET_TO_TLS(JIT_resetCounter);
 }
 
+
+JITEpochGroup *EgalitoTLS::getEpochGroup() {
+    JITEpochGroup *epochGroup = nullptr;
+    GET_FROM_TLS(epochGroup);
+    return epochGroup;
+}
+
+void EgalitoTLS::setEpochGroup(JITEpochGroup *epochGroup) {
+    SET_TO_TLS(epochGroup);
+}
+
+JITThreadStatistics *EgalitoTLS::getJITStatistics() {
+    JITThreadStatistics *JIT_stats = nullptr;
+    GET_FROM_TLS(JIT_stats);
+    return JIT_stats;
+}
+
+void EgalitoTLS::setJITStatistics(JITThreadStatistics *JIT_stats) {
+    SET_TO_TLS(JIT_stats);
+}
+
+JITShuffler *EgalitoTLS::getJITShuffler() {
+    JITShuffler *JIT_shuffler = nullptr;
+    GET_FROM_TLS(JIT_shuffler);
+    return JIT_shuffler;
+}
+
+void EgalitoTLS::setJITShuffler(JITShuffler *JIT_shuffler) {
+    SET_TO_TLS(JIT_shuffler);
+}
+
+size_t EgalitoTLS::getJITResetCursor() {
+    size_t JIT_resetCursor = 0;
+    GET_FROM_TLS(JIT_resetCursor);
+    return JIT_resetCursor;
+}
+
+void EgalitoTLS::setJITResetCursor(size_t JIT_resetCursor) {
+    SET_TO_TLS(JIT_resetCursor);
+}
+
+JITEpochGroup::JITEpochGroup(GSTable *gsTable, ShufflingSandbox *sandbox,
+    void *JIT_addressTable, size_t capacity, long firstTid)
+    : gsTable(gsTable), sandbox(sandbox), JIT_addressTable(JIT_addressTable),
+    members(1), capacity(capacity), slot(new long[capacity]()), arrived(0),
+    generation(0), resetRequested(0), lock(0), barrierLock(0) {
+
+    slot[0] = firstTid;
+}
+
+size_t JITEpochGroup::claimSlot() {
+    acquireBarrier();
+    pruneExited();
+    size_t index = 0;
+    while(index < capacity && slot[index] != SLOT_FREE) index++;
+    if(index < capacity) {
+        slot[index] = SLOT_STARTING;
+        members++;
+    }
+    releaseBarrier();
+    return index;
+}
+
+void JITEpochGroup::releaseSlot(size_t index) {
+    acquireBarrier();
+    slot[index] = SLOT_FREE;
+    members--;
+    releaseBarrier();
+}
+
+void JITEpochGroup::enter(size_t index) {
+    acquireBarrier();
+    slot[index] = currentThread();
+    releaseBarrier();
+}
+
+void JITEpochGroup::leave(size_t index) {
+    acquireBarrier();
+    slot[index] = -slot[index];
+    releaseBarrier();
+}
+
+size_t JITEpochGroup::pruneExited() {
+    auto pid = getpid();
+    for(size_t i = 0; i < capacity; i++) {
+        if(slot[i] >= SLOT_STARTING) continue;
+
+        long tid = -slot[i];
+        if(syscall(SYS_tgkill, pid, tid, 0) < 0 && errno == ESRCH) {
+            slot[i] = SLOT_FREE;
+            members--;
+        }
+    }
+    return members;
+}
+
+long JITEpochGroup::currentThread() {
+    return syscall(SYS_gettid);
+}
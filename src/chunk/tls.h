@@ -24,10 +24,82 @@
 // operation for libegalito (e.g. __tls_get_addr)
 
 class GSTable;
+struct JITThreadStatistics;
+struct JITShuffler;
+
+/** Threads in one epoch group share a GS table, sandbox and JIT address
+    table. Generation is serialized by lock; finished entries are published
+    with release stores, so GS lookups by other members never block.
+
+    Each member owns a slot holding its kernel thread ID. A member whose
+    start routine has returned keeps its slot until the kernel reports the
+    thread gone, since it still runs libc's thread exit code from the
+    epoch. Resets use a barrier: see egalito_jit_gs_reset().
+*/
+struct JITEpochGroup {
+    enum {
+        SLOT_FREE = 0,
+        SLOT_STARTING = -1      // created, not yet running
+        // > 0: tid of a live member; < -1: -tid of an exiting member
+    };
+
+    GSTable *gsTable;
+    ShufflingSandbox *sandbox;
+    void *JIT_addressTable;
+    size_t members;         // slots in use
+    size_t capacity;
+    long *slot;
+    size_t arrived;         // members waiting at the reset barrier
+    size_t generation;      // completed group resets
+    int resetRequested;
+    int lock;
+    int barrierLock;        // guards slot, members and arrived
+
+    /** The first member takes slot 0 with the given tid (or
+        SLOT_STARTING if it has not started yet).
+    */
+    JITEpochGroup(GSTable *gsTable, ShufflingSandbox *sandbox,
+        void *JIT_addressTable, size_t capacity, long firstTid);
+
+    // no pthread calls here: they may land on a JIT entry not generated yet
+    void acquire() { acquire(&lock); }
+    void release() { release(&lock); }
+    void acquireBarrier() { acquire(&barrierLock); }
+    void releaseBarrier() { release(&barrierLock); }
+
+    /** Reserves a slot for a thread about to be created, or returns
+        capacity if the group is full. Takes the barrier lock.
+    */
+    size_t claimSlot();
+    /** Gives back a slot claimed for a thread that was never created. */
+    void releaseSlot(size_t index);
+    /** Called by a member thread when it starts and after it returns. */
+    void enter(size_t index);
+    void leave(size_t index);
+    /** Frees the slots of members the kernel has finished with. Call with
+        the barrier lock held. Returns the number of members left.
+    */
+    size_t pruneExited();
+
+    static long currentThread();
+private:
+    static void acquire(int *lock) {
+        while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+            while(__atomic_load_n(lock, __ATOMIC_RELAXED));
+        }
+    }
+    static void release(int *lock) {
+        __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+    }
+};
 
 // the list grows upward
 class EgalitoTLS {
 private:
+    size_t JIT_resetCursor;     // next entry an incremental reset retires
+    JITShuffler *JIT_shuffler;  // this thread's background shuffler, if any
+    JITThreadStatistics *JIT_stats; // null unless EGALITO_JIT_STATS is set
+    JITEpochGroup *epochGroup;  // null unless the code epoch is shared
     size_t JIT_resetThreshold;
     size_t JIT_resetCounter;
     volatile size_t *barrier;
@@ -40,8 +112,9 @@ private:
     size_t JIT_temporary;   // hard coded in assembly (-0x8)
 public:
     EgalitoTLS(volatile size_t *barrier, GSTable *gsTable,
-        ShufflingSandbox *sandbox, void *JIT_addressTable, size_t JIT_resetThreshold=1)
-        :  JIT_resetThreshold(JIT_resetThreshold), JIT_resetCounter(0),
+        ShufflingSandbox *sandbox, void *JIT_addressTable, size_t JIT_resetThreshold=1,
+        JITEpochGroup *epochGroup=nullptr, JITThreadStatistics *JIT_stats=nullptr)
+        : JIT_resetCursor(0), JIT_shuffler(nullptr), JIT_stats(JIT_stats), epochGroup(epochGroup), JIT_resetThreshold(JIT_resetThreshold), JIT_resetCounter(0),
         barrier(barrier), child(nullptr), gsTable(gsTable), sandbox(sandbox),
         JIT_addressTable(JIT_addressTable), JIT_jitting(0) {}
 
@@ -59,6 +132,14 @@ public:
     static void setJITResetThreshold(size_t threshold);
     static size_t getJITResetCounter();
     static void setJITResetCounter(size_t counter);
+    static JITEpochGroup *getEpochGroup();
+    static void setEpochGroup(JITEpochGroup *epochGroup);
+    static JITThreadStatistics *getJITStatistics();
+    static void setJITStatistics(JITThreadStatistics *JIT_stats);
+    static JITShuffler *getJITShuffler();
+    static void setJITShuffler(JITShuffler *JIT_shuffler);
+    static size_t getJITResetCursor();
+    static void setJITResetCursor(size_t JIT_resetCursor);
 };
 
 #endif
@@ -10,6 +10,7 @@ class ConductorSetup;
 class Conductor;
 class Chunk;
 class IFuncList;
+struct JITStatisticsHeader;
 #endif
 
 EGALITO_BRIDGE_ENTRY(address_t, egalito_entry)
@@ -21,6 +22,11 @@ EGALITO_BRIDGE_ENTRY(Conductor *, egalito_conductor)
 EGALITO_BRIDGE_ENTRY(Chunk *, egalito_gsCallback)
 EGALITO_BRIDGE_ENTRY(IFuncList *, egalito_ifuncList)
 EGALITO_BRIDGE_ENTRY(bool, egalito_init_done)
+EGALITO_BRIDGE_ENTRY(bool, egalito_jit_async_reset)
+EGALITO_BRIDGE_ENTRY(size_t, egalito_jit_fanout)
+EGALITO_BRIDGE_ENTRY(size_t, egalito_jit_epoch_group_size)
+EGALITO_BRIDGE_ENTRY(size_t, egalito_jit_reset_functions)
+EGALITO_BRIDGE_ENTRY(JITStatisticsHeader *, egalito_jit_stats)
 EGALITO_BRIDGE_ENTRY(address_t, egalito_hook_function_entry_hook)
 EGALITO_BRIDGE_ENTRY(address_t, egalito_hook_function_exit_hook)
 EGALITO_BRIDGE_ENTRY(address_t, egalito_hook_instruction_hook)
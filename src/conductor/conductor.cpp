@@ -4,6 +4,7 @@
 #include "parseoverride.h"
 #include "passes.h"
 #include "chunk/ifunc.h"
+#include "chunk/symbolindex.h"
 #include "chunk/tls.h"
 #include "elf/elfmap.h"
 #include "elf/elfdynamic.h"
@@ -27,6 +28,8 @@
 #include "pass/findinitfuncs.h"
 #include "disasm/objectoriented.h"
 #include "transform/data.h"
+#include "util/parallel.h"
+#include "util/profiler.h"
 
 #include "parseoverride.h"
 
@@ -35,14 +38,19 @@
 
 IFuncList *egalito_ifuncList __attribute__((weak));
 
-Conductor::Conductor() : mainThreadPointer(0), ifuncList(nullptr) {
+Conductor::Conductor() : mainThreadPointer(0), ifuncList(nullptr),
+    parseThreads(1), symbolIndex(nullptr) {
+
     program = new Program();
     program->setLibraryList(new LibraryList());
 
     ParseOverride::getInstance()->parseFromEnvironmentVar();
+
+    parseThreads = getThreadsFromEnvironment("EGALITO_PARALLEL_PARSE");
 }
 
 Conductor::~Conductor() {
+    delete symbolIndex;
     delete program;
 }
 
@@ -94,6 +102,12 @@ void Conductor::parseEgalitoElfSpaceOnly(ElfMap *elf, Module *module,
 }
 
 void Conductor::parseLibraries() {
+    // overrides are looked up through the single current module name
+    if(parseThreads > 1 && !ParseOverride::getInstance()->hasOverrides()) {
+        parseLibrariesInParallel();
+        return;
+    }
+
     auto iterable = getLibraryList()->getChildren()->getIterable();
 
     // we use an index here because the list can change as we iterate
@@ -108,6 +122,41 @@ void Conductor::parseLibraries() {
     }
 }
 
+void Conductor::parseLibrariesInParallel() {
+    // Finding dependencies only needs each dynamic section, so do it
+    // serially to keep the library order identical to parseLibraries().
+    std::vector<ElfSpace *> spaceList;
+    auto iterable = getLibraryList()->getChildren()->getIterable();
+    for(size_t i = 0; i < iterable->getCount(); i ++) {
+        auto library = iterable->get(i);
+        if(library->getModule()) {
+            continue;  // already parsed
+        }
+
+        ElfMap *elf = new ElfMap(library->getResolvedPathCStr());
+        ElfDynamic(getLibraryList()).parse(elf, library);
+        spaceList.push_back(new ElfSpace(elf, library->getName(),
+            library->getResolvedPath()));
+    }
+
+    // Modules do not refer to each other until resolvePLTLinks() and
+    // resolveData(), so symbols, disassembly and the default passes can run
+    // on each one concurrently.
+    LOG(1, "\n=== PARSING " << spaceList.size() << " LIBRARIES with "
+        << parseThreads << " threads ===");
+    parallelFor(spaceList.size(), parseThreads, [this, &spaceList] (size_t i) {
+        auto space = spaceList[i];
+        space->findSymbolsAndRelocs();
+        ConductorPasses(this).newElfPasses(space);
+    });
+
+    for(auto space : spaceList) {
+        auto module = space->getModule();
+        program->add(module);
+        module->setParent(program);
+    }
+}
+
 Module *Conductor::parseAddOnLibrary(ElfMap *elf) {
     auto library = new Library("(addon)", Library::ROLE_SUPPORT);
     auto module = parse(elf, library);
@@ -374,10 +423,21 @@ void Conductor::acceptInAllModules(ChunkVisitor *visitor, bool inEgalito) {
     for(auto module : CIter::modules(program)) {
         if(!inEgalito && module == program->getEgalito()) continue;
 
+        ProfileScope profile(module->getName(),
+            EgalitoProfiler::LEVEL_MODULE);
         module->accept(visitor);
     }
 }
 
+SymbolIndex *Conductor::getSymbolIndex() {
+    auto moduleCount = program->getChildren()->genericGetSize();
+    if(!symbolIndex || symbolIndex->getModuleCount() != moduleCount) {
+        delete symbolIndex;
+        symbolIndex = new SymbolIndex(program);
+    }
+    return symbolIndex;
+}
+
 ElfSpace *Conductor::getMainSpace() const {
     return getProgram()->getFirst()->getElfSpace();
 }
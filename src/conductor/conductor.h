@@ -12,6 +12,7 @@ class ElfMap;
 class Module;
 class ChunkVisitor;
 class IFuncList;
+class SymbolIndex;
 struct EgalitoTLS;
 
 class Conductor {
@@ -20,6 +21,8 @@ private:
     address_t mainThreadPointer;
     size_t TLSOffsetFromTCB;
     IFuncList *ifuncList;
+    size_t parseThreads;
+    SymbolIndex *symbolIndex;
 
     std::set<Module *> resolveFinished;
 public:
@@ -33,6 +36,12 @@ public:
     void parseEgalitoElfSpaceOnly(ElfMap *elf, Module *module,
         const std::string &fullPath);
     void parseLibraries();
+    /** Number of threads parseLibraries() may use; 1 means serial. Also set
+        by EGALITO_PARALLEL_PARSE (N = N threads, 0 or auto = one per
+        hardware thread).
+    */
+    void setParseThreads(size_t threads) { parseThreads = threads; }
+    size_t getParseThreads() const { return parseThreads; }
     Module *parseAddOnLibrary(ElfMap *elf);
     Module *parseExtraLibrary(ElfMap *elf, const std::string &name = "");
     void parseEgalitoArchive(const char *archive);
@@ -56,12 +65,17 @@ public:
 
     address_t getMainThreadPointer() const { return mainThreadPointer; }
     IFuncList *getIFuncList() const { return ifuncList; }
+    /** Index of dynamic symbols across all modules, rebuilt on first use
+        after modules have been added.
+    */
+    SymbolIndex *getSymbolIndex();
 
     void loadTLSDataFor(address_t tcb);
 
     void check();
 private:
     Module *parse(ElfMap *elf, Library *library);
+    void parseLibrariesInParallel();
     void allocateTLSArea(address_t base);
     void loadTLSData();
     void backupTLSData();
@@ -1,11 +1,18 @@
+#include <cstdlib>  // for getenv
 #include "interface.h"
 
 #include "pass/fixenviron.h"
 #include "pass/collapseplt.h"
+#include "pass/peephole.h"
 #include "pass/promotejumps.h"
+#include "pass/relaxjumps.h"
+#include "pass/alignloops.h"
 #include "pass/ldsorefs.h"
 #include "pass/externalsymbollinks.h"
 #include "pass/ifuncplts.h"
+#include "transform/alignment.h"
+#include "util/feature.h"
+#include "util/profiler.h"
 #include "log/registry.h"
 #include "log/log.h"
 
@@ -15,6 +22,9 @@ EgalitoInterface::EgalitoInterface(bool verboseLogging, bool useLoggingEnvVar) {
     if(!parseLoggingEnvVar()) {
         LOG(1, "Failed to parse EGALITO_DEBUG environment variable");
     }
+    if(!EgalitoProfiler::getInstance()->parseEnvVar("EGALITO_PROFILE")) {
+        LOG(1, "Failed to parse EGALITO_PROFILE environment variable");
+    }
 }
 
 bool EgalitoInterface::parseLoggingEnvVar(const char *envVar) {
@@ -57,8 +67,27 @@ void EgalitoInterface::prepareForGeneration(bool isUnion) {
     CollapsePLTPass collapsePLT(setup.getConductor());
     getProgram()->accept(&collapsePLT);
 
+    if(isFeatureEnabled("EGALITO_USE_PEEPHOLE")) {
+        PeepholePass peephole;
+        getProgram()->accept(&peephole);
+        LOG(1, "peephole removed " << peephole.getRemovedCount()
+            << " instructions, " << peephole.getBytesSaved() << " bytes, ~"
+            << peephole.getCyclesSaved() << " cycles (estimated)");
+    }
+
     PromoteJumpsPass promoteJumps;
     getProgram()->accept(&promoteJumps);
+
+    if(isFeatureEnabled("EGALITO_RELAX_JUMPS")) {
+        RelaxJumpsPass relaxJumps;
+        getProgram()->accept(&relaxJumps);
+    }
+
+    auto alignment = setup.getAlignmentPolicy();
+    if(alignment->hasLoopAlignment()) {
+        AlignLoopsPass alignLoops(alignment);
+        getProgram()->accept(&alignLoops);
+    }
 }
 
 void EgalitoInterface::generate(const std::string &outputName) {
@@ -141,6 +141,8 @@ public:
             currentModule, std::experimental::nullopt, address);
     }
 
+    bool hasOverrides() const { return !blockOverrides.empty(); }
+
     // override lookups
     BlockBoundaryOverride *getBlockBoundaryOverride(
         const OverrideContext &where);
@@ -32,6 +32,8 @@
 #include "log/temp.h"
 
 void ConductorPasses::newElfPasses(ElfSpace *space) {
+    ProfileScope profile(space->getName(), EgalitoProfiler::LEVEL_MODULE);
+
     ElfMap *elf = space->getElfMap();
     RelocList *relocList = space->getRelocList();
 
@@ -7,6 +7,7 @@
 #include "conductor.h"
 #include "passes.h"
 #include "transform/generator.h"
+#include "transform/alignment.h"
 #include "load/segmap.h"
 #include "load/emulator.h"
 #include "chunk/dump.h"
@@ -250,17 +251,16 @@ Sandbox *ConductorSetup::makeLoaderSandbox() {
 }
 
 ShufflingSandbox *ConductorSetup::makeShufflingSandbox() {
-    auto backing = MemoryBacking(sandboxBase, 1 * 0x1000 * 0x1000);
+    auto backing = DualMappedBacking(sandboxBase, 1 * 0x1000 * 0x1000);
     sandboxBase += 2 * 0x1000 * 0x1000;
-    auto sandbox1 = new SandboxImpl<MemoryBacking,
-        WatermarkAllocator<MemoryBacking>>(backing);
+    auto sandbox1 = new SandboxImpl<DualMappedBacking,
+        FreeListAllocator<DualMappedBacking>>(backing);
 
-    auto backing2 = MemoryBacking(sandboxBase, 1 * 0x1000 * 0x1000);
+    auto backing2 = DualMappedBacking(sandboxBase, 1 * 0x1000 * 0x1000);
     sandboxBase += 2 * 0x1000 * 0x1000;
-    auto sandbox2 = new SandboxImpl<MemoryBacking,
-        WatermarkAllocator<MemoryBacking>>(backing2);
-    return new DualSandbox<SandboxImpl<MemoryBacking,
-        WatermarkAllocator<MemoryBacking>>>(sandbox1, sandbox2);
+    auto sandbox2 = new SandboxImpl<DualMappedBacking,
+        FreeListAllocator<DualMappedBacking>>(backing2);
+    return new ShufflingSandbox(sandbox1, sandbox2);
 }
 
 Sandbox *ConductorSetup::makeFileSandbox(const char *outputFile) {
@@ -371,7 +371,9 @@ void ConductorSetup::moveCode(Sandbox *sandbox, bool useDisps) {
 }
 
 void ConductorSetup::moveCodeAssignAddresses(Sandbox *sandbox, bool useDisps) {
-    Generator(sandbox, useDisps).assignAddresses(conductor->getProgram());
+    Generator generator(sandbox, useDisps);
+    generator.setAlignmentPolicy(getAlignmentPolicy());
+    generator.assignAddresses(conductor->getProgram());
 }
 
 void ConductorSetup::copyCodeToNewAddresses(Sandbox *sandbox, bool useDisps) {
@@ -382,6 +384,13 @@ void ConductorSetup::moveCodeMakeExecutable(Sandbox *sandbox) {
     sandbox->finalize();
 }
 
+AlignmentPolicy *ConductorSetup::getAlignmentPolicy() {
+    if(!alignmentPolicy) {
+        alignmentPolicy = AlignmentPolicy::makeFromEnvironment();
+    }
+    return alignmentPolicy;
+}
+
 void ConductorSetup::dumpElfSpace(ElfSpace *space) {
     ChunkDumper dumper;
     space->getModule()->accept(&dumper);
@@ -11,6 +11,7 @@
 class Conductor;
 class Sandbox;
 class Symbol;
+class AlignmentPolicy;
 
 /** Main setup class for Egalito.
 
@@ -28,9 +29,10 @@ private:
     ElfMap *egalito;
     Conductor *conductor;
     address_t sandboxBase;
+    AlignmentPolicy *alignmentPolicy;
 public:
     ConductorSetup() : elf(nullptr), egalito(nullptr), conductor(nullptr),
-        sandboxBase(SANDBOX_BASE_ADDRESS) {}
+        sandboxBase(SANDBOX_BASE_ADDRESS), alignmentPolicy(nullptr) {}
     Module *parseElfFiles(const char *executable, bool withSharedLibs = true,
         bool injectEgalito = false);
     Module *injectElfFiles(const char *executable, bool withSharedLibs = true,
@@ -60,6 +62,7 @@ public:
     ElfMap *getElfMap() const { return elf; }
     ElfMap *getEgalitoElfMap() const { return egalito; }
     Conductor *getConductor() const { return conductor; }
+    AlignmentPolicy *getAlignmentPolicy();
 public:
     void dumpElfSpace(ElfSpace *space);
     void dumpFunction(const char *function, ElfSpace *space = nullptr);
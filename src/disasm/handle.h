@@ -3,16 +3,29 @@
 
 #include <capstone/capstone.h>
 
+/** Capstone handles are not thread-safe, so each thread opens its own
+    pair (plain and detailed) the first time it needs one, and closes them
+    when it exits. A DisasmHandle may be shared between threads; raw()
+    always returns the caller's.
+*/
 class DisasmHandle {
 private:
-    static bool initialized[2];
-    static csh handle[2];
+    struct ThreadHandles {
+        bool initialized[2];
+        csh handle[2];
+
+        ThreadHandles() : initialized{false, false} {}
+        ~ThreadHandles();
+    };
+    static thread_local ThreadHandles handles;
     int which;
 public:
     DisasmHandle(bool detailed = false);
     ~DisasmHandle();
 
-    csh &raw() { return handle[which]; }
+    csh &raw();
+private:
+    static void open(int which);
 };
 
 #endif
@@ -7,6 +7,7 @@
 #include <fcntl.h>
 
 #include "elfmap.h"
+#include "relr.h"
 #include "log/log.h"
 
 ElfMap::ElfMap() : map(nullptr), length(0), fd(-1) {
@@ -250,6 +251,7 @@ bool ElfMap::isDynamic() const {
 }
 
 bool ElfMap::hasRelocations() const {
-    return !findSectionsByType(SHT_RELA).empty();
+    return !findSectionsByType(SHT_RELA).empty()
+        || !findSectionsByType(SHT_RELR).empty();
     //return findSection(".rela.text") != nullptr;
 }
@@ -1,6 +1,7 @@
 #include <cstdio>
 #include <cstring>
 #include "reloc.h"
+#include "relr.h"
 #include "symbol.h"
 
 #undef DEBUG_GROUP
@@ -9,6 +10,16 @@
 
 #define RELA_PREFIX ".rela"
 
+#if defined(ARCH_X86_64)
+    #define R_RELATIVE R_X86_64_RELATIVE
+#elif defined(ARCH_AARCH64)
+    #define R_RELATIVE R_AARCH64_RELATIVE
+#elif defined(ARCH_RISCV)
+    #define R_RELATIVE R_RISCV_RELATIVE
+#else
+    #define R_RELATIVE R_ARM_RELATIVE
+#endif
+
 std::string Reloc::getSymbolName() const {
     return symbol ? symbol->getName() : "???";
 }
@@ -114,9 +125,59 @@ RelocList *RelocList::buildRelocList(ElfMap *elf, SymbolList *symbolList,
         }
     }
 
+    // DT_RELR: relative relocations with their addends stored in place
+    for(void *p : elf->findSectionsByType(SHT_RELR)) {
+        ElfXX_Shdr *s = static_cast<ElfXX_Shdr *>(p);
+        const char *name = elf->getSHStrtab() + s->sh_name;
+        LOG(1, "relr section [" << name << ']');
+
+        auto words = reinterpret_cast<RelrTable::WordType *>(
+            elf->getCharmap() + s->sh_offset);
+        auto addresses = RelrTable::decode(words, s->sh_size / sizeof(*words));
+        for(auto address : addresses) {
+            auto target = findInPlaceWord(elf, address);
+            if(!target) {
+                CLOG0(1, "relr address %lx is not in the file\n", address);
+                continue;
+            }
+
+            Reloc *reloc = new Reloc(address, R_RELATIVE, 0, nullptr,
+                static_cast<Reloc::rel_addend_t>(*target));
+
+            CLOG0(2, "    relr reloc at address 0x%08lx, addend 0x%lx\n",
+                reloc->getAddress(), *target);
+
+            if(!list->add(reloc)) {
+                CLOG0(1, "ignoring duplicate relocation for %lx\n",
+                      reloc->getAddress());
+            }
+            else {
+                list->makeOrGetSection(name, s)->add(reloc);
+            }
+        }
+    }
+
     return list;
 }
 
+const RelrTable::WordType *RelocList::findInPlaceWord(ElfMap *elf,
+    address_t address) {
+
+    for(auto section : elf->getSectionList()) {
+        auto header = section->getHeader();
+        if(!(header->sh_flags & SHF_ALLOC)) continue;
+        if(header->sh_type == SHT_NOBITS) continue;
+        if(address < header->sh_addr) continue;
+        if(address + sizeof(RelrTable::WordType)
+            > header->sh_addr + header->sh_size) continue;
+
+        return reinterpret_cast<const RelrTable::WordType *>(
+            elf->getCharmap() + header->sh_offset
+                + (address - header->sh_addr));
+    }
+    return nullptr;
+}
+
 RelocSection *RelocList::makeOrGetSection(const std::string &name,
     ElfXX_Shdr *s) {
 
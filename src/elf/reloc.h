@@ -9,6 +9,7 @@
 #include "types.h"
 #include "elf/elfmap.h"
 #include "elf/elfxx.h"
+#include "elf/relr.h"
 #include "elf/riscv-elf.h"
 
 class Symbol;
@@ -84,6 +85,8 @@ public:
         SymbolList *dynamicSymbolList = nullptr);
 private:
     RelocSection *makeOrGetSection(const std::string &name, ElfXX_Shdr *s);
+    static const RelrTable::WordType *findInPlaceWord(ElfMap *elf,
+        address_t address);
 };
 
 #endif
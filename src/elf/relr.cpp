@@ -0,0 +1,53 @@
+#include "relr.h"
+
+std::vector<RelrTable::WordType> RelrTable::encode(
+    const std::vector<address_t> &addresses) {
+
+    const address_t wordSize = sizeof(WordType);
+    std::vector<WordType> words;
+
+    size_t i = 0;
+    while(i < addresses.size()) {
+        words.push_back(addresses[i]);
+        address_t base = addresses[i] + wordSize;
+        i ++;
+
+        // follow with bitmaps for as long as they cover something
+        for(;;) {
+            WordType bitmap = 0;
+            while(i < addresses.size()
+                && addresses[i] - base < BITMAP_WORDS * wordSize) {
+
+                bitmap |= WordType(1) << ((addresses[i] - base) / wordSize);
+                i ++;
+            }
+            if(!bitmap) break;
+            words.push_back((bitmap << 1) | 1);
+            base += BITMAP_WORDS * wordSize;
+        }
+    }
+    return words;
+}
+
+std::vector<address_t> RelrTable::decode(const WordType *words,
+    size_t count) {
+
+    const address_t wordSize = sizeof(WordType);
+    std::vector<address_t> addresses;
+
+    address_t base = 0;
+    for(size_t i = 0; i < count; i ++) {
+        auto word = words[i];
+        if(!(word & 1)) {
+            addresses.push_back(word);
+            base = word + wordSize;
+        }
+        else {
+            for(address_t a = base; word >>= 1; a += wordSize) {
+                if(word & 1) addresses.push_back(a);
+            }
+            base += BITMAP_WORDS * wordSize;
+        }
+    }
+    return addresses;
+}
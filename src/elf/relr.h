@@ -0,0 +1,37 @@
+#ifndef EGALITO_ELF_RELR_H
+#define EGALITO_ELF_RELR_H
+
+#include <vector>
+#include <elf.h>
+#include "types.h"
+#include "elfxx.h"
+
+/* glibc added DT_RELR in 2.36, so define it for older headers. */
+#ifndef SHT_RELR
+#define SHT_RELR    19
+#endif
+#ifndef DT_RELR
+#define DT_RELRSZ   35
+#define DT_RELR     36
+#define DT_RELRENT  37
+#endif
+
+/** The SHT_RELR encoding of relative relocations. An even word is the
+    address of a word to relocate. An odd word is a bitmap of the next 63
+    words (31 for ELFCLASS32): bit i relocates the i'th word after that
+    address, and each further bitmap continues where the last one ended.
+    The addend is the word already in place.
+*/
+class RelrTable {
+public:
+    typedef ElfXX_Addr WordType;
+    enum { BITMAP_WORDS = 8 * sizeof(WordType) - 1 };
+public:
+    /** Addresses must be sorted, unique, and word-aligned. */
+    static std::vector<WordType> encode(
+        const std::vector<address_t> &addresses);
+    static std::vector<address_t> decode(const WordType *words,
+        size_t count);
+};
+
+#endif
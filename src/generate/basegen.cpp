@@ -1,6 +1,31 @@
+#include <cstdlib>  // for getenv
+#include <cstring>
+#include <gnu/libc-version.h>
 #include "basegen.h"
+#include "util/parallel.h"
+
+// DT_RELR is understood by ld.so from glibc 2.36 onwards
+static bool loaderSupportsRelr() {
+    const char *version = gnu_get_libc_version();
+    char *end = nullptr;
+    unsigned long major = std::strtoul(version, &end, 10);
+    unsigned long minor = 0;
+    if(*end == '.') minor = std::strtoul(end + 1, nullptr, 10);
+    return major > 2 || (major == 2 && minor >= 36);
+}
 
 ElfGeneratorImpl::ElfGeneratorImpl(Program *program, SandboxBacking *backing)
     : data(new ElfDataImpl(program, backing)) {
 
+    config.setThreads(getThreadsFromEnvironment("EGALITO_PARALLEL_GENERATE"));
+
+    // "auto" packs only if the loader on this machine supports it
+    if(const char *relr = getenv("EGALITO_RELR")) {
+        if(std::strcmp(relr, "auto") == 0) {
+            config.setRelrOutput(loaderSupportsRelr());
+        }
+        else {
+            config.setRelrOutput(std::strtoul(relr, nullptr, 0) != 0);
+        }
+    }
 }
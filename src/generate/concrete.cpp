@@ -5,17 +5,29 @@
 #include "modulegen.h"
 #include "sectionlist.h"
 #include "concretedeferred.h"
+#include "gnuhash.h"
 #include "transform/sandbox.h"
 #include "chunk/concrete.h"
 #include "operation/find2.h"
 #include "elf/elfspace.h"
 #include "elf/symbol.h"
+#include "elf/relr.h"
 #include "instr/concrete.h"
 #include "util/streamasstring.h"
 #include "pass/chunkpass.h"
 #include "log/log.h"
 #include "config.h"
 
+#if defined(ARCH_X86_64)
+    #define R_RELATIVE R_X86_64_RELATIVE
+#elif defined(ARCH_AARCH64)
+    #define R_RELATIVE R_AARCH64_RELATIVE
+#elif defined(ARCH_RISCV)
+    #define R_RELATIVE R_RISCV_RELATIVE
+#else
+    #define R_RELATIVE R_ARM_RELATIVE
+#endif
+
 void BasicElfCreator::execute() {
     auto header = new Section("=elfheader");
     getSectionList()->addSection(header);
@@ -73,12 +85,10 @@ void BasicElfCreator::execute() {
         getSectionList()->addSection(dynsymSection);
 
         // .gnu.hash
-        if(!getConfig()->isUnionOutput()) {
-            auto gnuhash = new GnuHashSectionContent();
-            auto gnuhashSection = new Section(".gnu.hash", SHT_GNU_HASH, SHF_ALLOC);
-            gnuhashSection->setContent(gnuhash);
-            getSectionList()->addSection(gnuhashSection);
-        }
+        auto gnuhash = new GnuHashSectionContent();
+        auto gnuhashSection = new Section(".gnu.hash", SHT_GNU_HASH, SHF_ALLOC);
+        gnuhashSection->setContent(gnuhash);
+        getSectionList()->addSection(gnuhashSection);
 
         // .rela.dyn
         auto relaDyn = new DataRelocSectionContent(
@@ -88,6 +98,16 @@ void BasicElfCreator::execute() {
         relaDynSection->setContent(relaDyn);
         getSectionList()->addSection(relaDynSection);
 
+        // .relr.dyn, filled from .rela.dyn by PackRelativeRelocs
+        if(getConfig()->isRelrOutput()
+            && getConfig()->isPositionIndependent()) {
+
+            auto relrDynSection = new Section(".relr.dyn",
+                SHT_RELR, SHF_ALLOC);
+            relrDynSection->setContent(new RelrSectionContent());
+            getSectionList()->addSection(relrDynSection);
+        }
+
         // .dynamic
         auto dynamicSection = new Section(".dynamic", SHT_DYNAMIC,
             SHF_ALLOC | SHF_WRITE);
@@ -200,6 +220,9 @@ void BasicElfStructure::makeSymtabSection() {
         dynsymSection->getHeader()->setSectionLink(
             new SectionRef(getSectionList(), ".dynstr"));
         dynsymSection->getHeader()->setShdrFlags(SHF_ALLOC);
+
+        getSection(".gnu.hash")->getHeader()->setSectionLink(
+            new SectionRef(getSectionList(), ".dynsym"));
     }
 }
 
@@ -400,12 +423,10 @@ void BasicElfStructure::makeDynamicSection() {
         return dynsymSection->getHeader()->getAddress();
     });
 
-    if(!getConfig()->isUnionOutput()) {
-        dynamic->addPair(DT_GNU_HASH, [this] () {
-            auto gnuhashSection = getSection(".gnu.hash");
-            return gnuhashSection->getHeader()->getAddress();
-        });
-    }
+    dynamic->addPair(DT_GNU_HASH, [this] () {
+        auto gnuhashSection = getSection(".gnu.hash");
+        return gnuhashSection->getHeader()->getAddress();
+    });
 
     dynamic->addPair(DT_RELA, [this] () {
         auto relaDyn = getSection(".rela.dyn");
@@ -417,6 +438,18 @@ void BasicElfStructure::makeDynamicSection() {
     });
     dynamic->addPair(DT_RELAENT, sizeof(ElfXX_Rela));
 
+    if(getSection(".relr.dyn")) {
+        dynamic->addPair(DT_RELR, [this] () {
+            auto relrDyn = getSection(".relr.dyn");
+            return relrDyn->getHeader()->getAddress();
+        });
+        dynamic->addPair(DT_RELRSZ, [this] () {
+            auto relrDyn = getSection(".relr.dyn");
+            return relrDyn->getContent()->getSize();
+        });
+        dynamic->addPair(DT_RELRENT, sizeof(RelrTable::WordType));
+    }
+
     dynamic->addPair(DT_INIT_ARRAY, [this] () {
         auto initArray = getSection(".init_array");
         return initArray->getHeader()->getAddress();
@@ -496,10 +529,11 @@ void AssignSectionsToSegments::execute() {
         dynSegment->addContains(getSection(".dynstr"));
         dynSegment->addContains(getSection(".symtab"));
         dynSegment->addContains(getSection(".dynsym"));
-        if(!getConfig()->isUnionOutput()) {
-            dynSegment->addContains(getSection(".gnu.hash"));
-        }
+        dynSegment->addContains(getSection(".gnu.hash"));
         dynSegment->addContains(getSection(".rela.dyn"));
+        if(auto relrDyn = getSection(".relr.dyn")) {
+            dynSegment->addContains(relrDyn);
+        }
         dynSegment->addContains(getSection(".dynamic"));
         phdrTable->add(dynSegment, 0x400000);
 
@@ -1017,119 +1051,159 @@ void CopyDynsym::execute() {
     }
 }
 
-// hash function stolen from binutils/bfd/elf.c:221
-static unsigned long
-bfd_elf_gnu_hash (const char *namearg)
-{
-  const unsigned char *name = (const unsigned char *) namearg;
-  unsigned long h = 5381;
-  unsigned char ch;
-
-  while ((ch = *name++) != '\0')
-    h = (h << 5) + h + ch;
-  return h & 0xffffffff;
-}
-
 void MakeDynsymHash::execute() {
     auto gnuhash = getData()->getSection(".gnu.hash")->castAs<GnuHashSectionContent *>();
     auto dynsym = getData()->getSection(".dynsym")->castAs<SymbolTableContent *>();
-    dynsym->recalculateIndices();
-
-    auto dynstr = getData()->getSection(".dynstr")->castAs<DeferredStringList *>();
-    std::ostringstream dynstrStream;
-    dynstr->writeTo(dynstrStream);
-    auto dynstrData = dynstrStream.str();
-
-    bucketList.resize(1011);
-    //bucketList.resize(10007);
-
-    bool hashing = false;
-    size_t firstHashedSymbol = 0;
-    for(auto sym : *dynsym) {
-        auto elfSym = sym->getElfPtr();
-        LOG(1, "elfSym address " << elfSym->st_value);
-        // Skip the undefined symbols (first, address == 0), don't hash them.
-        // These will be looked up in another library, not in our own .dynsym.
-        if(elfSym->st_value) hashing = true;
-        if(!hashing) {
-            firstHashedSymbol ++;
-            continue;
+
+    // Only defined globals are looked up in our own .dynsym; the null,
+    // local, and undefined symbols stay first, in their current order.
+    typedef std::pair<SymbolInTable, SymbolTableContent::DeferredType *>
+        EntryType;
+    std::vector<EntryType> unhashed, hashed;
+    for(const auto &pair : dynsym->getValueMap()) {
+        if(pair.first.getType() == SymbolInTable::TYPE_GLOBAL) {
+            hashed.push_back(pair);
         }
+        else {
+            unhashed.push_back(pair);
+        }
+    }
 
-        auto name = dynstrData.c_str() + elfSym->st_name;
-        auto hash = bfd_elf_gnu_hash(name);
+    GnuHashTable table(unhashed.size());
+    for(const auto &entry : hashed) {
+        table.add(entry.first.getName());
+    }
+    table.build();
+    table.writeTo(gnuhash);
 
-        LOG(1, "elfSym name [" << name << "] hash 0x" << std::hex << hash);
-        bucketList[hash % bucketList.size()].push_back(name);
+    LOG(1, "GNU hash table: " << hashed.size() << " symbols in "
+        << table.getBucketList().size() << " buckets, "
+        << table.getBloomList().size() << " bloom words");
+
+    // rebuild .dynsym in its final order; the table index keeps the map
+    // of keys sorted the same way as the list
+    dynsym->clearAll();
+    for(const auto &entry : unhashed) {
+        dynsym->add(entry.first, entry.second);
+    }
+    size_t index = unhashed.size();
+    for(auto i : table.getOrder()) {
+        auto key = hashed[i].first;
+        key.setTableIndex(index ++);
+        dynsym->add(key, hashed[i].second);
+    }
+}
+
+void PackRelativeRelocs::execute() {
+    auto relrSection = getData()->getSection(".relr.dyn");
+    if(!relrSection) return;
+    auto relr = relrSection->castAs<RelrSectionContent *>();
+    auto relaDyn = getData()->getSection(".rela.dyn")
+        ->castAs<DataRelocSectionContent *>();
+
+    const size_t wordSize = sizeof(RelrTable::WordType);
+    std::map<address_t, size_t> relativeCount;
+    for(auto value : *relaDyn) {
+        auto rela = value->getElfPtr();
+        if(ELFXX_R_TYPE(rela->r_info) == R_RELATIVE) {
+            relativeCount[rela->r_offset] ++;
+        }
     }
 
-    size_t index = 0;
-    for(const auto &bucket : bucketList) {
-        for(const auto &name : bucket) {
-            indexMap[name] = index++;
+    // the addend goes in place, so the word must be in a data section
+    // that is not overlapped by another (as TLS images are)
+    std::vector<address_t> addresses;
+    std::vector<std::pair<address_t, DataRelocSectionContent::DeferredType *>>
+        kept;
+    for(auto value : *relaDyn) {
+        auto rela = value->getElfPtr();
+        address_t address = rela->r_offset;
+        size_t offset = 0;
+        DeferredString *content = nullptr;
+        if(ELFXX_R_TYPE(rela->r_info) == R_RELATIVE
+            && relativeCount[address] == 1
+            && address % wordSize == 0) {
+
+            content = findDataContaining(address, wordSize, offset);
         }
+        if(!content) {
+            kept.emplace_back(relaDyn->getKey(value), value);
+            continue;
+        }
+
+        auto addend = static_cast<RelrTable::WordType>(rela->r_addend);
+        content->overwrite(offset, std::string(
+            reinterpret_cast<const char *>(&addend), sizeof(addend)));
+        addresses.push_back(address);
+        delete value;
     }
 
-    typedef uint64_t BloomType;  // Assumes ELFCLASS64
-    const uint32_t bloomShift = 5;
-    std::vector<BloomType> bloomList; //= {-1ul, -1ul};
-    for(size_t i = 0; i < 0x100; i ++) bloomList.push_back(-1ul);
+    relaDyn->clearAll();
+    for(const auto &pair : kept) {
+        relaDyn->add(pair.first, pair.second);
+    }
 
-    gnuhash->add(static_cast<uint32_t>(bucketList.size()));     // nbuckets
-    gnuhash->add(static_cast<uint32_t>(firstHashedSymbol));     // symoffset
-    gnuhash->add(static_cast<uint32_t>(bloomList.size()));      // bloom_size
-    gnuhash->add(static_cast<uint32_t>(bloomShift));            // bloom_shift
+    if(addresses.empty()) {
+        // section indices are already fixed, so .relr.dyn stays (empty),
+        // but the loader should not be told about it
+        removeRelrTags();
+        LOG(1, "no relative relocations to pack, " << kept.size()
+            << " left in .rela.dyn");
+        return;
+    }
 
-    // bloom_list
-    for(auto bloom : bloomList) {
-        gnuhash->add(bloom);
+    std::sort(addresses.begin(), addresses.end());
+    auto words = RelrTable::encode(addresses);
+    for(auto word : words) {
+        relr->add(word);
     }
+    LOG(1, "packed " << addresses.size() << " relative relocations into "
+        << words.size() << " RELR words, " << kept.size()
+        << " left in .rela.dyn");
+}
 
-    // bucket_list
-    size_t symIndex = firstHashedSymbol;
-    for(const auto &bucket : bucketList) {
-        if(bucket.size()) {
-            gnuhash->add(static_cast<uint32_t>(symIndex));
-            symIndex += bucket.size();
+void PackRelativeRelocs::removeRelrTags() {
+    auto dynamic = getData()->getSection(".dynamic")
+        ->castAs<DynamicSectionContent *>();
+
+    std::vector<DynamicSectionContent::DeferredType *> kept;
+    for(auto pair : *dynamic) {
+        auto key = pair->getElfPtr()->getKey();
+        if(key == DT_RELR || key == DT_RELRSZ || key == DT_RELRENT) {
+            delete pair;
         }
         else {
-            // 0's observed in real binaries
-            gnuhash->add(static_cast<uint32_t>(0));
+            kept.push_back(pair);
         }
     }
 
-    // chain
-    for(const auto &bucket : bucketList) {
-        for(const auto &name : bucket) {
-            auto hash = bfd_elf_gnu_hash(name.c_str());
-            //uint32_t value = (hash % bucketList.size()) & ~1;
-            uint32_t value = hash & ~1;
-            if(name == bucket.back()) value += 1;
-            gnuhash->add(value);
-        }
-    }
-    
-    // .dymsym sorting
-    auto oldValueMap = dynsym->getValueMap();  // deep copy
-    dynsym->clearAll();
-    for(const auto &pair : oldValueMap) {
-        auto key = pair.first;
-        auto val = pair.second;
-        auto it = indexMap.find(key.getName());
-        if(it != indexMap.end()) {
-            LOG(1, "Found symbol index for name [" << (*it).first << "] at index "
-                << (*it).second);
-            key.setTableIndex((*it).second);
-        }
-        dynsym->insertSorted(key, val);
+    dynamic->clearAll();
+    for(auto pair : kept) {
+        dynamic->add(pair);
     }
+}
 
-    dynsym->recalculateIndices();
+DeferredString *PackRelativeRelocs::findDataContaining(address_t address,
+    size_t size, size_t &offset) {
 
-    //auto newValueMap = dynsym->getValueMap();  // deep copy
-    //for(const auto &val : *dynsym) {
-    //    LOG(1, "new order for symbol with name [" << val->getName() << "]");
-    //}
+    DeferredString *found = nullptr;
+    for(auto section : *getData()->getSectionList()) {
+        if(!section->hasHeader()) continue;
+        auto header = section->getHeader();
+        if(header->getShdrType() != SHT_PROGBITS) continue;
+        if(!(header->getShdrFlags() & SHF_ALLOC)) continue;
+        auto content = section->castAs<DeferredString *>();
+        if(!content) continue;
+
+        address_t start = header->getAddress();
+        if(address < start || address + size > start + content->getSize()) {
+            continue;
+        }
+        if(found) return nullptr;  // ambiguous
+        found = content;
+        offset = address - start;
+    }
+    return found;
 }
 
 void MakeGlobalSymbols::execute() {
@@ -1189,6 +1263,18 @@ void MakeGlobalSymbols::execute() {
     }
 }
 
+void PrepareModuleData::execute() {
+    moduleGen->prepareDataSections();
+}
+
+void MakeModuleSections::execute() {
+    moduleGen->makeDataSections();
+    moduleGen->makeTextAccumulative();
+    if(makeTLS) {
+        moduleGen->makeTLS();
+    }
+}
+
 void ElfFileWriter::execute() {
     updateOffsets();
     serialize();
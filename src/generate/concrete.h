@@ -109,19 +109,61 @@ public:
     virtual void execute();
 };
 
+/** Fills .gnu.hash, moving the defined symbols to the end of .dynsym in
+    bucket order. Must run after all .dynsym entries have been added.
+*/
 class MakeDynsymHash : public NormalElfOperation {
-private:
-    std::vector<std::vector<std::string>> bucketList;
-    std::map<std::string, size_t> indexMap;
 public:
     virtual void execute();
 };
 
+class DeferredString;
+
+/** Moves relative relocations from .rela.dyn to .relr.dyn, writing each
+    addend into the data it relocates. Relocations that cannot be packed
+    stay in .rela.dyn; if none can be packed, the DT_RELR tags are dropped.
+    Must run after all data sections are made.
+*/
+class PackRelativeRelocs : public NormalElfOperation {
+public:
+    virtual void execute();
+private:
+    void removeRelrTags();
+    DeferredString *findDataContaining(address_t address, size_t size,
+        size_t &offset);
+};
+
 class MakeGlobalSymbols : public NormalElfOperation {
 public:
     virtual void execute();
 };
 
+class ModuleGen;
+/** Runs ModuleGen::prepareDataSections(), which only reads its module and
+    may run in parallel with other modules.
+*/
+class PrepareModuleData : public NormalElfOperation {
+private:
+    ModuleGen *moduleGen;
+public:
+    PrepareModuleData(ModuleGen *moduleGen) : moduleGen(moduleGen) {}
+    virtual void execute();
+};
+
+/** Adds one module's data sections, text symbols and (optionally) TLS to
+    the output. These append to shared sections, so modules must be added
+    one at a time and in order.
+*/
+class MakeModuleSections : public NormalElfOperation {
+private:
+    ModuleGen *moduleGen;
+    bool makeTLS;
+public:
+    MakeModuleSections(ModuleGen *moduleGen, bool makeTLS)
+        : moduleGen(moduleGen), makeTLS(makeTLS) {}
+    virtual void execute();
+};
+
 class ElfFileWriter : public ConcreteElfOperation {
 private:
     std::string filename;
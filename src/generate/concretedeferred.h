@@ -37,6 +37,7 @@ public:
         : type(type), sym(sym), tableIndex(0) {}
     bool operator < (const SymbolInTable &other) const;
     bool operator == (const SymbolInTable &other) const;
+    type_t getType() const { return type; }
     Symbol *get() const { return sym; }
     std::string getName() const;
     void setTableIndex(size_t index) { tableIndex = index; }
@@ -268,6 +269,11 @@ public:
     using DeferredIntegerList::DeferredIntegerList;
 };
 
+class RelrSectionContent : public DeferredIntegerList {
+public:
+    using DeferredIntegerList::DeferredIntegerList;
+};
+
 class TBSSContent : public DeferredString {
 private:
     size_t memSize;
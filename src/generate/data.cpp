@@ -1,4 +1,7 @@
+#include <mutex>
+#include <algorithm>
 #include "data.h"
+#include "util/parallel.h"
 #include "log/log.h"
 
 ElfDataImpl::ElfDataImpl(Program *program, SandboxBacking *backing)
@@ -26,16 +29,51 @@ bool ElfOperationTrace::ran(const std::string &name) {
 void ElfPipeline::add(UnnamedElfOperation *op) {
     op->setData(getData());
     op->setConfig(getConfig());
+
+    // everything since the last add(), which covers the rest
+    std::vector<size_t> after;
+    size_t first = (barrierCount ? barrierCount - 1 : 0);
+    for(size_t i = first; i < pipeline.size(); i ++) after.push_back(i);
+
     pipeline.push_back(op);
+    afterList.push_back(after);
+    barrierCount = pipeline.size();
+}
+
+void ElfPipeline::addParallel(UnnamedElfOperation *op,
+    const std::vector<ElfOperation *> &after) {
+
+    op->setData(getData());
+    op->setConfig(getConfig());
+
+    std::vector<size_t> indices;
+    if(barrierCount) indices.push_back(barrierCount - 1);
+    for(auto dep : after) {
+        auto it = std::find(pipeline.begin(), pipeline.end(), dep);
+        if(it == pipeline.end()) {
+            throw "ElfPipeline: dependency is not in this pipeline";
+        }
+        indices.push_back(it - pipeline.begin());
+    }
+
+    pipeline.push_back(op);
+    afterList.push_back(indices);
 }
 
 void ElfPipeline::execute() {
     getData()->getOperationTrace()->add("[PIPELINE BEGIN]");
     checkDependencies();
-    for(auto op : pipeline) {
-        getData()->getOperationTrace()->add(op->getName());
+    std::mutex traceMutex;
+    parallelGraph(pipeline.size(), afterList, getConfig()->getThreads(),
+        [this, &traceMutex] (size_t i) {
+
+        auto op = pipeline[i];
+        {
+            std::lock_guard<std::mutex> lock(traceMutex);
+            getData()->getOperationTrace()->add(op->getName());
+        }
         op->execute();
-    }
+    });
     getData()->getOperationTrace()->add("[PIPELINE END]");
 }
 
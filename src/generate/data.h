@@ -50,19 +50,30 @@ private:
     bool positionIndependent;
     bool unionOutput;
     bool freestandingKernel;
+    bool relrOutput;
+    size_t threads;
 public:
     ElfConfig() : dynamicallyLinked(false), positionIndependent(false),
-        unionOutput(false), freestandingKernel(false) {}
+        unionOutput(false), freestandingKernel(false), relrOutput(false),
+        threads(1) {}
 
     void setDynamicallyLinked(bool enable) { dynamicallyLinked = enable; }
     void setPositionIndependent(bool enable) { positionIndependent = enable; }
     void setUnionOutput(bool enable) { unionOutput = enable; }
     void setFreestandingKernel(bool enable) { freestandingKernel = enable; }
+    void setRelrOutput(bool enable) { relrOutput = enable; }
+    void setThreads(size_t threads) { this->threads = threads; }
 
     bool isDynamicallyLinked() const { return dynamicallyLinked; }
     bool isPositionIndependent() const { return positionIndependent; }
     bool isUnionOutput() const { return unionOutput; }
     bool isFreestandingKernel() const { return freestandingKernel; }
+    /** Pack relative relocations into DT_RELR (position-independent
+        output only). Needs glibc 2.36 or later at run time.
+    */
+    bool isRelrOutput() const { return relrOutput; }
+    /** Threads used to run independent pipeline operations. */
+    size_t getThreads() const { return threads; }
 };
 
 class ElfOperationTrace {
@@ -116,16 +127,27 @@ typedef ElfOperationStorageDecorator<ElfOperation>
 typedef ElfOperationNameDecorator<UnnamedElfOperation>
     NormalElfOperation;
 
+/** Operations added with add() run after everything added before them.
+    Those added with addParallel() only wait for the previous add() and
+    the operations they name, so with ElfConfig::getThreads() > 1 they may
+    run alongside each other. Either way the output must be the same, so a
+    parallel operation may not touch anything that an operation it could
+    run alongside writes (sections, string tables, positions).
+*/
 class ElfPipeline : public NormalElfOperation {
 private:
     std::set<std::string> dependencyList;
     std::vector<ElfOperation *> pipeline;
+    std::vector<std::vector<size_t>> afterList;
+    size_t barrierCount;    // operations up to the last add()
 public:
-    ElfPipeline(ElfData *data, ElfConfig *config)
+    ElfPipeline(ElfData *data, ElfConfig *config) : barrierCount(0)
         { setData(data); setConfig(config); }
 
     void addDependency(const std::string &dep) { dependencyList.insert(dep); }
     void add(UnnamedElfOperation *op);
+    void addParallel(UnnamedElfOperation *op,
+        const std::vector<ElfOperation *> &after = {});
 
     virtual void execute();
 private:
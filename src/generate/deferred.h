@@ -8,6 +8,7 @@
 #include <functional>
 #include <algorithm>
 #include <sstream>
+#include <utility>
 #include "types.h"
 
 /** Base class for any output value which may need further computation.
@@ -199,9 +200,14 @@ private:
     std::string value;
 public:
     DeferredString(const std::string &value) : value(value) {}
+    DeferredString(std::string &&value) : value(std::move(value)) {}
     DeferredString(const char *value, size_t length)
         : value(value, length) {}
     virtual size_t getSize() const { return value.length(); }
+
+    /** Overwrites bytes in place; the size does not change. */
+    void overwrite(size_t offset, const std::string &data)
+        { value.replace(offset, data.length(), data); }
 protected:
     virtual const char *getPtr() const { return value.c_str(); }
 };
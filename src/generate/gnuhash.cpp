@@ -0,0 +1,107 @@
+#include <algorithm>
+#include "gnuhash.h"
+#include "integerdeferred.h"
+
+void GnuHashTable::add(const std::string &name) {
+    nameList.push_back(name);
+    hashList.push_back(hash(name.c_str()));
+}
+
+void GnuHashTable::build() {
+    const size_t count = nameList.size();
+    const uint32_t bucketCount = chooseBucketCount(count);
+
+    // bloom filter sizing from bfd/elflink.c: 4 to 8 bits per symbol,
+    // and never less than one word
+    uint32_t log2 = 0;
+    while((count >> log2) > 1) log2 ++;
+    uint32_t maskBitsLog2 = log2 + 1;
+    if(maskBitsLog2 < 3) maskBitsLog2 = 6;
+    else if((size_t(1) << (maskBitsLog2 - 2)) & count) maskBitsLog2 += 3;
+    else maskBitsLog2 += 2;
+    if(maskBitsLog2 < 6) maskBitsLog2 = 6;
+
+    const uint32_t wordBitsLog2 = 6;
+    bloomShift = maskBitsLog2;
+    bloomList.assign(size_t(1) << (maskBitsLog2 - wordBitsLog2), 0);
+    for(auto h : hashList) {
+        auto &word = bloomList[(h >> wordBitsLog2) & (bloomList.size() - 1)];
+        word |= uint64_t(1) << (h & 63);
+        word |= uint64_t(1) << ((h >> bloomShift) & 63);
+    }
+
+    // each bucket's chain must be contiguous; keep the original order
+    // within a bucket so the output is deterministic
+    order.resize(count);
+    for(size_t i = 0; i < count; i ++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [this, bucketCount] (size_t a, size_t b) {
+            return hashList[a] % bucketCount < hashList[b] % bucketCount;
+        });
+
+    bucketList.assign(bucketCount, 0);
+    chainList.resize(count);
+    for(size_t i = 0; i < count; i ++) {
+        auto h = hashList[order[i]];
+        auto &bucket = bucketList[h % bucketCount];
+        if(!bucket) bucket = static_cast<uint32_t>(symbolOffset + i);
+
+        bool last = (i + 1 == count
+            || hashList[order[i + 1]] % bucketCount != h % bucketCount);
+        chainList[i] = (h & ~1u) | (last ? 1 : 0);
+    }
+}
+
+void GnuHashTable::writeTo(DeferredIntegerList *list) const {
+    list->add(static_cast<uint32_t>(bucketList.size()));
+    list->add(static_cast<uint32_t>(symbolOffset));
+    list->add(static_cast<uint32_t>(bloomList.size()));
+    list->add(bloomShift);
+    for(auto word : bloomList) list->add(word);
+    for(auto bucket : bucketList) list->add(bucket);
+    for(auto chain : chainList) list->add(chain);
+}
+
+size_t GnuHashTable::find(const std::string &name) const {
+    auto h = hash(name.c_str());
+
+    auto word = bloomList[(h >> 6) & (bloomList.size() - 1)];
+    if(!((word >> (h & 63)) & (word >> ((h >> bloomShift) & 63)) & 1)) {
+        return 0;
+    }
+
+    size_t index = bucketList[h % bucketList.size()];
+    if(!index) return 0;
+    for(;; index ++) {
+        auto chain = chainList[index - symbolOffset];
+        if((chain | 1) == (h | 1)
+            && nameList[order[index - symbolOffset]] == name) {
+
+            return index;
+        }
+        if(chain & 1) break;
+    }
+    return 0;
+}
+
+uint32_t GnuHashTable::hash(const char *name) {
+    // dl_new_hash() in glibc, bfd_elf_gnu_hash() in binutils
+    uint32_t h = 5381;
+    for(auto p = reinterpret_cast<const unsigned char *>(name); *p; p ++) {
+        h = (h << 5) + h + *p;
+    }
+    return h;
+}
+
+uint32_t GnuHashTable::chooseBucketCount(size_t count) {
+    // the same primes as GNU ld; aim for about one symbol per bucket
+    static const uint32_t primes[] = {
+        1, 3, 17, 37, 67, 97, 131, 197, 263, 521, 1031, 2053, 4099, 8209,
+        16411, 32771, 65537, 131101, 262147
+    };
+    const size_t n = sizeof(primes) / sizeof(*primes);
+
+    uint32_t best = primes[0];
+    for(size_t i = 0; i < n && primes[i] <= count; i ++) best = primes[i];
+    return best;
+}
@@ -0,0 +1,52 @@
+#ifndef EGALITO_GENERATE_GNU_HASH_H
+#define EGALITO_GENERATE_GNU_HASH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class DeferredIntegerList;
+
+/** Lays out a DT_GNU_HASH table the way GNU ld does. The bucket count
+    grows with the number of symbols, the bloom filter sets two bits per
+    symbol, and symbols are ordered by bucket so that every chain is a
+    contiguous run of .dynsym. Bloom words are 64 bits (ELFCLASS64).
+
+    The hashed symbols occupy .dynsym from symbolOffset onwards, which must
+    be at least 1: a bucket value of 0 means the bucket is empty.
+*/
+class GnuHashTable {
+private:
+    size_t symbolOffset;
+    std::vector<std::string> nameList;
+    std::vector<uint32_t> hashList;
+    std::vector<size_t> order;
+    uint32_t bloomShift;
+    std::vector<uint64_t> bloomList;
+    std::vector<uint32_t> bucketList;
+    std::vector<uint32_t> chainList;
+public:
+    GnuHashTable(size_t symbolOffset)
+        : symbolOffset(symbolOffset), bloomShift(0) {}
+
+    void add(const std::string &name);
+    void build();
+
+    /** The i'th hashed symbol in .dynsym is the order[i]'th one added. */
+    const std::vector<size_t> &getOrder() const { return order; }
+    uint32_t getBloomShift() const { return bloomShift; }
+    const std::vector<uint64_t> &getBloomList() const { return bloomList; }
+    const std::vector<uint32_t> &getBucketList() const { return bucketList; }
+    const std::vector<uint32_t> &getChainList() const { return chainList; }
+
+    void writeTo(DeferredIntegerList *list) const;
+
+    /** Looks name up as ld.so would. Returns its .dynsym index, or 0. */
+    size_t find(const std::string &name) const;
+
+    static uint32_t hash(const char *name);
+private:
+    static uint32_t chooseBucketCount(size_t count);
+};
+
+#endif
@@ -1,3 +1,4 @@
+#include <list>
 #include "mirrorgen.h"
 #include "modulegen.h"
 #include "data.h"
@@ -25,28 +26,36 @@ void MirrorGen::afterAddressAssign() {
     pipeline.addDependency("BasicElfStructure");
     pipeline.add(new MakeInitArray(/*stage=*/ 1));  // AssignSectionsToSegments
     pipeline.add(new UpdatePLTLinks());
-    pipeline.add(new CopyDynsym());
-    pipeline.add(new MakeGlobalSymbols());
+    // .dynsym/.dynstr and .symtab/.strtab respectively
+    pipeline.addParallel(new CopyDynsym());
+    pipeline.addParallel(new MakeGlobalSymbols());
     pipeline.execute();
 }
 
 void MirrorGen::generateContent(const std::string &filename) {
+    // the operations below only borrow these, and must not outlive them
+    std::list<ModuleGen> moduleGens;
     ElfPipeline pipeline(getData(), getConfig());
     pipeline.addDependency("AssignSectionsToSegments");
 
+    // copy every module's data at once, but add the sections in order
+    ElfOperation *previous = nullptr;
     for(auto module : CIter::children(getData()->getProgram())) {
         ModuleGen::Config config;
         config.setUniqueSectionNames(false);
         config.setRelocsForAbsoluteRefs(true);
         config.setCodeBacking(dynamic_cast<MemoryBufferBacking *>
             (getData()->getBacking()));
-        auto moduleGen = ModuleGen(config, module, getData()->getSectionList());
-        moduleGen.makeDataSections();
-        moduleGen.makeTextAccumulative();
-        if(true || module->getLibrary()->getRole() == Library::ROLE_LIBC) {
-            moduleGen.makeTLS();
-        }
+        moduleGens.emplace_back(config, module, getData()->getSectionList());
+        auto moduleGen = &moduleGens.back();
+        auto prepare = new PrepareModuleData(moduleGen);
+        pipeline.addParallel(prepare);
+        auto make = new MakeModuleSections(moduleGen, /*makeTLS=*/ true);
+        if(previous) pipeline.addParallel(make, {prepare, previous});
+        else pipeline.addParallel(make, {prepare});
+        previous = make;
     }
+    pipeline.add(new PackRelativeRelocs());  // after all data relocs added
     pipeline.add(new MakeDynsymHash());  // after all .dynsym entries added
     pipeline.add(new TextSectionCreator());
     pipeline.add(new GenerateSectionTable());
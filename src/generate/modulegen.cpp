@@ -12,10 +12,82 @@
 #include "config.h"
 
 ModuleGen::ModuleGen(Config config, Module *module, SectionList *sectionList)
-    : config(config), module(module), sectionList(sectionList) {
+    : config(config), module(module), sectionList(sectionList),
+    haveJumpTableVars(false) {
 
 }
 
+void ModuleGen::prepareDataSections() {
+    // the same sections, taken from the same regions, as makeDataSections()
+    auto regionList = module->getDataRegionList();
+    auto tls = regionList->getTLS();
+    for(auto region : CIter::children(regionList)) {
+        if(region == tls) continue;
+
+        std::vector<DataSection *> sectionList;
+        for(auto section : CIter::children(region)) {
+            sectionList.push_back(section);
+        }
+        if(tls && region->getRange().overlaps(tls->getRange())) {
+            for(auto section : CIter::children(tls)) {
+                sectionList.push_back(section);
+            }
+        }
+
+        for(auto section : sectionList) {
+            if(section->getType() != DataSection::TYPE_DATA
+                && section->getType() != DataSection::TYPE_BSS) continue;
+
+            prepareSection(region, section, preparedMap[section]);
+        }
+    }
+}
+
+void ModuleGen::prepareSection(DataRegion *region, DataSection *section,
+    PreparedSection &prepared) {
+
+    if(!haveJumpTableVars) {
+        for(auto jt : CIter::children(module->getJumpTableList())) {
+            for(auto entry : CIter::children(jt)) {
+                jumpTableVars.insert(entry->getDataVariable());
+            }
+        }
+        haveJumpTableVars = true;
+    }
+
+    prepared.ready = true;
+    prepared.region = region;
+    prepared.content = region->getDataBytes()
+        .substr(section->getOriginalOffset(), section->getSize());
+    prepared.ldRelocVars.clear();
+    prepared.generalRelocVars.clear();
+
+    for(auto var : CIter::children(section)) {
+        auto link = var->getDest();
+        if(!link) continue;
+        if(jumpTableVars.find(var) != jumpTableVars.end()) continue;
+
+        if(dynamic_cast<LDSOLoaderLink *>(var->getDest())) {
+            prepared.ldRelocVars.push_back(var);
+        }
+        else if(dynamic_cast<TLSDataOffsetLink *>(var->getDest())) {
+            // handled elsewhere
+        }
+        else if(config.getRelocsForAbsoluteRefs()) {
+            prepared.generalRelocVars.push_back(var);
+        }
+    }
+}
+
+std::string ModuleGen::takeContent(DataRegion *region, DataSection *section) {
+    auto &prepared = preparedMap[section];
+    if(!prepared.ready || prepared.region != region) {
+        prepareSection(region, section, prepared);
+    }
+    prepared.ready = false;  // keep the relocation lists for later
+    return std::move(prepared.content);
+}
+
 void ModuleGen::makeDataSections() {
     // Before all LOAD segments, we need to put padding.
     makePaddingSection(0);
@@ -79,8 +151,8 @@ void ModuleGen::makeDataSections() {
                 // by default, make everything writable
                 auto dataSection = new Section(section->getName(),
                     SHT_PROGBITS, flags);
-                auto content = new DeferredString(region->getDataBytes()
-                    .substr(section->getOriginalOffset(), section->getSize()));
+                auto content = new DeferredString(
+                    takeContent(region, section));
                 dataSection->setContent(content);
                 dataSection->getHeader()->setAddress(section->getAddress());
                 sectionList->addSection(dataSection);
@@ -109,8 +181,8 @@ void ModuleGen::makeDataSections() {
                     LOG(1, "   Initializing bss with 0");
                 }
                 else {
-                    auto content = new DeferredString(region->getDataBytes()
-                        .substr(section->getOriginalOffset(), section->getSize()));
+                    auto content = new DeferredString(
+                        takeContent(region, section));
                     bssSection->setContent(content);
                     LOG(1, "   Initializing bss with " << section->getSize() << " data bytes");
                 }
@@ -209,28 +281,10 @@ void ModuleGen::makeDataSections() {
 }
 
 void ModuleGen::maybeMakeDataRelocs(DataSection *section, Section *sec) {
-    std::set<DataVariable *> jumpTableVars; //jump table entries
-    for(auto jt : CIter::children(module->getJumpTableList())) {
-        for(auto entry : CIter::children(jt)) {
-            jumpTableVars.insert(entry->getDataVariable());
-        }
-    }
-    std::vector<DataVariable *> ldRelocVars, generalRelocVars;
-    for(auto var : CIter::children(section)) {
-        auto link = var->getDest();
-        if(!link) continue;
-        if(jumpTableVars.find(var) != jumpTableVars.end()) continue;
-
-        if(dynamic_cast<LDSOLoaderLink *>(var->getDest())) {
-            ldRelocVars.push_back(var);
-        }
-        else if(dynamic_cast<TLSDataOffsetLink *>(var->getDest())) {
-            // handled elsewhere
-        }
-        else if(config.getRelocsForAbsoluteRefs()) {
-            generalRelocVars.push_back(var);
-        }
-    }
+    // filled in by makeDataSections() if not already prepared
+    const auto &prepared = preparedMap[section];
+    const auto &ldRelocVars = prepared.ldRelocVars;
+    const auto &generalRelocVars = prepared.generalRelocVars;
     LOG(1, "maybeMakeDataRelocs with "
         << ldRelocVars.size() << ", " << generalRelocVars.size());
     if(ldRelocVars.empty() && generalRelocVars.empty()) return;
@@ -1,7 +1,10 @@
 #ifndef EGALITO_GENERATE_MODULEGEN_H
 #define EGALITO_GENERATE_MODULEGEN_H
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 #include "types.h"
 #include "section.h"
 #include "sectionlist.h"
@@ -9,7 +12,9 @@
 class Module;
 class Function;
 class MemoryBufferBacking;
+class DataRegion;
 class DataSection;
+class DataVariable;
 class TLSDataRegion;
 
 class ModuleGen {
@@ -48,13 +53,33 @@ public:
         MemoryBufferBacking *getCodeBacking() const { return backing; }
         bool isKernel() const { return this->isFreestandingKernel; }
     };
+private:
+    /** What makeDataSections() needs from one DataSection, found without
+        touching the output. */
+    struct PreparedSection {
+        bool ready;
+        DataRegion *region;
+        std::string content;
+        std::vector<DataVariable *> ldRelocVars;
+        std::vector<DataVariable *> generalRelocVars;
+
+        PreparedSection() : ready(false), region(nullptr) {}
+    };
 private:
     Config config;
     Module *module;
     SectionList *sectionList;
+    std::set<DataVariable *> jumpTableVars;
+    bool haveJumpTableVars;
+    std::map<DataSection *, PreparedSection> preparedMap;
 public:
     ModuleGen(Config config, Module *module, SectionList *sectionList);
 
+    /** Copies the data section contents and finds the variables that need
+        relocations ahead of makeDataSections(). Only reads the module, so
+        it can run for several modules at once.
+    */
+    void prepareDataSections();
     void makeDataSections();
 
     void makeText();
@@ -72,6 +97,9 @@ public:
     void makePaddingSection(size_t desiredAlignment);
     Section *makeIntraPaddingSection(size_t desiredAlignment);
 private:
+    void prepareSection(DataRegion *region, DataSection *section,
+        PreparedSection &prepared);
+    std::string takeContent(DataRegion *region, DataSection *section);
     size_t shdrIndexOf(Section *section);
     size_t shdrIndexOf(const std::string &name);
     static bool blacklistedSymbol(const std::string &name);
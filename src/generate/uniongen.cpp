@@ -1,3 +1,4 @@
+#include <list>
 #include "uniongen.h"
 #include "modulegen.h"
 #include "data.h"
@@ -29,21 +30,29 @@ void UnionGen::afterAddressAssign() {
 }
 
 void UnionGen::generateContent(const std::string &filename) {
+    // the operations below only borrow these, and must not outlive them
+    std::list<ModuleGen> moduleGens;
     ElfPipeline pipeline(getData(), getConfig());
     pipeline.addDependency("AssignSectionsToSegments");
 
+    // copy every module's data at once, but add the sections in order
+    ElfOperation *previous = nullptr;
     for(auto module : CIter::children(getData()->getProgram())) {
         ModuleGen::Config config;
         config.setUniqueSectionNames(true);
         config.setCodeBacking(dynamic_cast<MemoryBufferBacking *>
             (getData()->getBacking()));
-        auto moduleGen = ModuleGen(config, module, getData()->getSectionList());
-        moduleGen.makeDataSections();
-        moduleGen.makeTextAccumulative();
-        if(module->getLibrary()->getRole() == Library::ROLE_LIBC) {
-            moduleGen.makeTLS();
-        }
+        moduleGens.emplace_back(config, module, getData()->getSectionList());
+        auto moduleGen = &moduleGens.back();
+        auto prepare = new PrepareModuleData(moduleGen);
+        pipeline.addParallel(prepare);
+        auto make = new MakeModuleSections(moduleGen,
+            module->getLibrary()->getRole() == Library::ROLE_LIBC);
+        if(previous) pipeline.addParallel(make, {prepare, previous});
+        else pipeline.addParallel(make, {prepare});
+        previous = make;
     }
+    pipeline.add(new MakeDynsymHash());  // after all .dynsym entries added
     pipeline.add(new TextSectionCreator());
     pipeline.add(new GenerateSectionTable());
     pipeline.add(new ElfFileWriter(filename));
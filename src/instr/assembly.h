@@ -49,6 +49,8 @@ public:
           operands(insn.detail->x86.operands,
                    insn.detail->x86.operands + insn.detail->x86.op_count)
         { overrideCapstone(insn); }
+    AssemblyOperands(const std::vector<cs_x86_op> &operands)
+        : op_count(operands.size()), operands(operands) {}
     const cs_x86_op *getOperands() const { return operands.data(); }
 private:
     void overrideCapstone(const cs_insn &insn);
@@ -64,6 +66,10 @@ public:
           operands(insn.detail->arm64.operands,
                    insn.detail->arm64.operands + insn.detail->arm64.op_count)
         { overrideCapstone(insn); }
+    AssemblyOperands(const std::vector<cs_arm64_op> &operands,
+        bool writeback = false)
+        : op_count(operands.size()), writeback(writeback),
+          operands(operands) {}
     bool getWriteback() const { return writeback; }
     const cs_arm64_op *getOperands() const { return operands.data(); }
 private:
@@ -136,6 +142,16 @@ public:
           regs_write(insn.detail->regs_write,
                      insn.detail->regs_write + insn.detail->regs_write_count)
         { overrideCapstone(insn); }
+    /** For instructions encoded without a disassembler; see builder.h. */
+    Assembly(unsigned int id, const std::vector<uint8_t> &bytes,
+        const std::string &mnemonic, const std::string &operandString,
+        const AssemblyOperands &operands,
+        const std::vector<uint8_t> &regsRead,
+        const std::vector<uint8_t> &regsWrite)
+        : id(id), bytes(bytes), mnemonic(mnemonic),
+          operandString(operandString), operands(operands),
+          regs_read_count(regsRead.size()), regs_read(regsRead),
+          regs_write_count(regsWrite.size()), regs_write(regsWrite) {}
 #ifdef ARCH_RISCV
     Assembly(const rv_instr &instr);
 #endif
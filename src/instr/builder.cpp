@@ -0,0 +1,689 @@
+#include <cstring>  // for std::memset
+#include <sstream>
+#include "builder.h"
+#include "concrete.h"
+#include "instr.h"
+#include "register.h"
+
+#ifdef ARCH_X86_64
+X86Memory X86Memory::ripRelative(Link *link) {
+    X86Memory memory(X86_REG_RIP);
+    memory.link = link;
+    return memory;
+}
+
+X86Memory X86Memory::absolute(int32_t address, x86_reg segment) {
+    X86Memory memory(X86_REG_INVALID, address);
+    memory.segment = segment;
+    return memory;
+}
+
+namespace {
+
+int getNumber(x86_reg reg) {
+    int number = X86Register::convertToPhysical(reg);
+    if(number < X86Register::R0 || number > X86Register::R15) {
+        throw "X86Builder: only general-purpose registers can be encoded";
+    }
+    return number;
+}
+
+const char *const x86RegisterNames[] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+
+/** Accumulates the bytes and operands of one instruction. */
+class X86Encoding {
+private:
+    std::vector<uint8_t> bytes;
+    std::vector<cs_x86_op> operands;
+    std::ostringstream opStr;
+    Link *link;
+    int linkIndex;
+    size_t dispOffset;
+public:
+    X86Encoding() : link(nullptr), linkIndex(-1), dispOffset(0) {}
+
+    /** Emits [segment] [REX] opcode ModRM [SIB] [disp] for a memory rm. */
+    void encode(std::initializer_list<uint8_t> opcode, int regField,
+        const X86Memory &rm, bool rexW = true);
+    /** Same, with a register rm (mod 11). */
+    void encode(std::initializer_list<uint8_t> opcode, int regField,
+        x86_reg rm, bool rexW = true);
+    void append(std::initializer_list<uint8_t> data)
+        { bytes.insert(bytes.end(), data); }
+    void appendImm(int32_t imm, size_t size);
+
+    void addOperand(x86_reg reg);
+    void addOperand(const X86Memory &memory, uint8_t size = 8);
+    void addImmOperand(int64_t imm);
+
+    Instruction *build(unsigned int id, const char *mnemonic,
+        std::vector<uint8_t> regsRead = {},
+        std::vector<uint8_t> regsWrite = {},
+        InstructionSemantic *semantic = nullptr);
+private:
+    static const char *getName(x86_reg reg);
+    void emitREX(bool w, int reg, int index, int base);
+    void printNumber(int64_t value);
+};
+
+const char *X86Encoding::getName(x86_reg reg) {
+    switch(reg) {
+    case X86_REG_RIP:   return "rip";
+    case X86_REG_FS:    return "fs";
+    case X86_REG_GS:    return "gs";
+    default:            return x86RegisterNames[getNumber(reg)];
+    }
+}
+
+void X86Encoding::emitREX(bool w, int reg, int index, int base) {
+    uint8_t rex = 0x40;
+    if(w) rex |= 0x8;
+    if(reg >= 8) rex |= 0x4;
+    if(index >= 8) rex |= 0x2;
+    if(base >= 8) rex |= 0x1;
+    if(rex != 0x40) bytes.push_back(rex);
+}
+
+void X86Encoding::encode(std::initializer_list<uint8_t> opcode,
+    int regField, x86_reg rm, bool rexW) {
+
+    int number = getNumber(rm);
+    emitREX(rexW, regField, 0, number);
+    append(opcode);
+    bytes.push_back(0xc0 | (regField & 7) << 3 | (number & 7));
+}
+
+void X86Encoding::encode(std::initializer_list<uint8_t> opcode,
+    int regField, const X86Memory &rm, bool rexW) {
+
+    switch(rm.getSegment()) {
+    case X86_REG_INVALID:   break;
+    case X86_REG_FS:        bytes.push_back(0x64); break;
+    case X86_REG_GS:        bytes.push_back(0x65); break;
+    default:
+        throw "X86Builder: unsupported segment register";
+    }
+
+    int scaleBits = 0;
+    while((1 << scaleBits) < rm.getScale()) scaleBits++;
+    if((1 << scaleBits) != rm.getScale() || scaleBits > 3) {
+        throw "X86Builder: scale must be 1, 2, 4 or 8";
+    }
+
+    int index = 4;  // none
+    if(rm.getIndex() != X86_REG_INVALID) {
+        index = getNumber(rm.getIndex());
+        if(index == X86Register::SP) throw "X86Builder: %rsp can't be an index";
+    }
+
+    int32_t disp = rm.getDisplacement();
+    if(rm.getBase() == X86_REG_RIP) {
+        emitREX(rexW, regField, 0, 0);
+        append(opcode);
+        bytes.push_back(0x05 | (regField & 7) << 3);
+        link = rm.getLink();
+        dispOffset = bytes.size();
+        appendImm(disp, 4);
+    }
+    else if(rm.getBase() == X86_REG_INVALID) {
+        emitREX(rexW, regField, index, 0);
+        append(opcode);
+        bytes.push_back(0x04 | (regField & 7) << 3);
+        bytes.push_back(scaleBits << 6 | (index & 7) << 3 | 0x5);
+        appendImm(disp, 4);
+    }
+    else {
+        int base = getNumber(rm.getBase());
+        emitREX(rexW, regField, index, base);
+        append(opcode);
+
+        // %rbp and %r13 have no disp-less form
+        int mod = 2;
+        if(disp == 0 && (base & 7) != 5) mod = 0;
+        else if(disp >= -128 && disp < 128) mod = 1;
+
+        bool sib = (index != 4 || (base & 7) == 4);
+        bytes.push_back(mod << 6 | (regField & 7) << 3
+            | (sib ? 4 : (base & 7)));
+        if(sib) bytes.push_back(scaleBits << 6 | (index & 7) << 3 | (base & 7));
+        if(mod == 1) appendImm(disp, 1);
+        if(mod == 2) appendImm(disp, 4);
+    }
+}
+
+void X86Encoding::appendImm(int32_t imm, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        bytes.push_back(static_cast<uint32_t>(imm) >> (i * 8) & 0xff);
+    }
+}
+
+void X86Encoding::printNumber(int64_t value) {
+    // matches Capstone, which prints small values in decimal
+    if(value < 0) {
+        opStr << '-';
+        value = -value;
+    }
+    if(value > 9) opStr << "0x" << std::hex << value << std::dec;
+    else opStr << value;
+}
+
+void X86Encoding::addOperand(x86_reg reg) {
+    cs_x86_op op;
+    std::memset(&op, 0, sizeof op);
+    op.type = X86_OP_REG;
+    op.reg = reg;
+    op.size = 8;
+    operands.push_back(op);
+
+    if(!opStr.str().empty()) opStr << ", ";
+    opStr << '%' << getName(reg);
+}
+
+void X86Encoding::addOperand(const X86Memory &memory, uint8_t size) {
+    cs_x86_op op;
+    std::memset(&op, 0, sizeof op);
+    op.type = X86_OP_MEM;
+    op.mem.segment = memory.getSegment();
+    op.mem.base = memory.getBase();
+    op.mem.index = memory.getIndex();
+    op.mem.scale = memory.getScale();
+    op.mem.disp = memory.getDisplacement();
+    op.size = size;
+    if(memory.getLink()) linkIndex = operands.size();
+    operands.push_back(op);
+
+    if(!opStr.str().empty()) opStr << ", ";
+    if(memory.getSegment() != X86_REG_INVALID) {
+        opStr << '%' << getName(memory.getSegment()) << ':';
+    }
+    if(memory.getDisplacement() || memory.getBase() == X86_REG_INVALID) {
+        printNumber(memory.getDisplacement());
+    }
+    if(memory.getBase() != X86_REG_INVALID) {
+        opStr << "(%" << getName(memory.getBase());
+        if(memory.getIndex() != X86_REG_INVALID) {
+            opStr << ",%" << getName(memory.getIndex());
+            if(memory.getScale() != 1) opStr << ',' << memory.getScale();
+        }
+        opStr << ')';
+    }
+}
+
+void X86Encoding::addImmOperand(int64_t imm) {
+    cs_x86_op op;
+    std::memset(&op, 0, sizeof op);
+    op.type = X86_OP_IMM;
+    op.imm = imm;
+    op.size = 8;
+    operands.push_back(op);
+
+    if(!opStr.str().empty()) opStr << ", ";
+    opStr << '$';
+    printNumber(imm);
+}
+
+Instruction *X86Encoding::build(unsigned int id, const char *mnemonic,
+    std::vector<uint8_t> regsRead, std::vector<uint8_t> regsWrite,
+    InstructionSemantic *semantic) {
+
+    auto assembly = AssemblyPtr(new Assembly(id, bytes, mnemonic,
+        opStr.str(), AssemblyOperands(operands), regsRead, regsWrite));
+
+    auto instr = new Instruction();
+    if(link) {
+        auto linked = new LinkedInstruction(instr);
+        linked->setAssembly(assembly);
+        linked->setLink(link);
+        linked->setIndex(linkIndex, 4, dispOffset);
+        semantic = linked;
+    }
+    else {
+        if(!semantic) semantic = new IsolatedInstruction();
+        semantic->setAssembly(assembly);
+    }
+    instr->setSemantic(semantic);
+    return instr;
+}
+
+unsigned int getArithmeticId(X86Builder::ArithmeticOp op) {
+    switch(op) {
+    case X86Builder::OP_ADD:    return X86_INS_ADD;
+    case X86Builder::OP_OR:     return X86_INS_OR;
+    case X86Builder::OP_AND:    return X86_INS_AND;
+    case X86Builder::OP_SUB:    return X86_INS_SUB;
+    case X86Builder::OP_XOR:    return X86_INS_XOR;
+    case X86Builder::OP_CMP:    return X86_INS_CMP;
+    }
+    return X86_INS_INVALID;
+}
+
+const char *getArithmeticMnemonic(X86Builder::ArithmeticOp op) {
+    switch(op) {
+    case X86Builder::OP_ADD:    return "addq";
+    case X86Builder::OP_OR:     return "orq";
+    case X86Builder::OP_AND:    return "andq";
+    case X86Builder::OP_SUB:    return "subq";
+    case X86Builder::OP_XOR:    return "xorq";
+    case X86Builder::OP_CMP:    return "cmpq";
+    }
+    return "";
+}
+
+}  // anonymous namespace
+
+Instruction *X86Builder::mov(x86_reg source, x86_reg dest) {
+    X86Encoding e;
+    e.encode({0x89}, getNumber(source), dest);
+    e.addOperand(source);
+    e.addOperand(dest);
+    return e.build(X86_INS_MOV, "movq");
+}
+
+Instruction *X86Builder::mov(const X86Memory &source, x86_reg dest) {
+    X86Encoding e;
+    e.encode({0x8b}, getNumber(dest), source);
+    e.addOperand(source);
+    e.addOperand(dest);
+    return e.build(X86_INS_MOV, "movq");
+}
+
+Instruction *X86Builder::mov(x86_reg source, const X86Memory &dest) {
+    X86Encoding e;
+    e.encode({0x89}, getNumber(source), dest);
+    e.addOperand(source);
+    e.addOperand(dest);
+    return e.build(X86_INS_MOV, "movq");
+}
+
+Instruction *X86Builder::mov(int32_t imm, x86_reg dest) {
+    X86Encoding e;
+    e.encode({0xc7}, 0, dest);
+    e.appendImm(imm, 4);
+    e.addImmOperand(imm);
+    e.addOperand(dest);
+    return e.build(X86_INS_MOV, "movq");
+}
+
+Instruction *X86Builder::lea(const X86Memory &source, x86_reg dest) {
+    X86Encoding e;
+    e.encode({0x8d}, getNumber(dest), source);
+    e.addOperand(source);
+    e.addOperand(dest);
+    return e.build(X86_INS_LEA, "leaq");
+}
+
+Instruction *X86Builder::push(x86_reg reg) {
+    X86Encoding e;
+    if(reg == X86_REG_EFLAGS) {
+        e.append({0x9c});
+        return e.build(X86_INS_PUSHFQ, "pushfq",
+            {X86_REG_RSP, X86_REG_EFLAGS}, {X86_REG_RSP});
+    }
+
+    int number = getNumber(reg);
+    if(number >= 8) e.append({0x41});
+    e.append({static_cast<uint8_t>(0x50 + (number & 7))});
+    e.addOperand(reg);
+    return e.build(X86_INS_PUSH, "pushq", {X86_REG_RSP}, {X86_REG_RSP});
+}
+
+Instruction *X86Builder::pop(x86_reg reg) {
+    X86Encoding e;
+    if(reg == X86_REG_EFLAGS) {
+        e.append({0x9d});
+        return e.build(X86_INS_POPFQ, "popfq",
+            {X86_REG_RSP}, {X86_REG_RSP, X86_REG_EFLAGS});
+    }
+
+    int number = getNumber(reg);
+    if(number >= 8) e.append({0x41});
+    e.append({static_cast<uint8_t>(0x58 + (number & 7))});
+    e.addOperand(reg);
+    return e.build(X86_INS_POP, "popq", {X86_REG_RSP}, {X86_REG_RSP});
+}
+
+Instruction *X86Builder::push(int32_t imm) {
+    X86Encoding e;
+    if(imm >= -128 && imm < 128) {
+        e.append({0x6a});
+        e.appendImm(imm, 1);
+    }
+    else {
+        e.append({0x68});
+        e.appendImm(imm, 4);
+    }
+    e.addImmOperand(imm);
+    return e.build(X86_INS_PUSH, "pushq", {X86_REG_RSP}, {X86_REG_RSP});
+}
+
+Instruction *X86Builder::arithmetic(ArithmeticOp op, int32_t imm,
+    x86_reg dest) {
+
+    X86Encoding e;
+    if(imm >= -128 && imm < 128) {
+        e.encode({0x83}, op, dest);
+        e.appendImm(imm, 1);
+    }
+    else {
+        e.encode({0x81}, op, dest);
+        e.appendImm(imm, 4);
+    }
+    e.addImmOperand(imm);
+    e.addOperand(dest);
+    return e.build(getArithmeticId(op), getArithmeticMnemonic(op),
+        {}, {X86_REG_EFLAGS});
+}
+
+Instruction *X86Builder::arithmetic(ArithmeticOp op, int32_t imm,
+    const X86Memory &dest) {
+
+    X86Encoding e;
+    if(imm >= -128 && imm < 128) {
+        e.encode({0x83}, op, dest);
+        e.appendImm(imm, 1);
+    }
+    else {
+        e.encode({0x81}, op, dest);
+        e.appendImm(imm, 4);
+    }
+    e.addImmOperand(imm);
+    e.addOperand(dest);
+    return e.build(getArithmeticId(op), getArithmeticMnemonic(op),
+        {}, {X86_REG_EFLAGS});
+}
+
+Instruction *X86Builder::arithmetic(ArithmeticOp op, x86_reg source,
+    x86_reg dest) {
+
+    X86Encoding e;
+    e.encode({static_cast<uint8_t>(op << 3 | 0x1)}, getNumber(source), dest);
+    e.addOperand(source);
+    e.addOperand(dest);
+    return e.build(getArithmeticId(op), getArithmeticMnemonic(op),
+        {}, {X86_REG_EFLAGS});
+}
+
+Instruction *X86Builder::arithmetic(ArithmeticOp op, x86_reg source,
+    const X86Memory &dest) {
+
+    X86Encoding e;
+    e.encode({static_cast<uint8_t>(op << 3 | 0x1)}, getNumber(source), dest);
+    e.addOperand(source);
+    e.addOperand(dest);
+    return e.build(getArithmeticId(op), getArithmeticMnemonic(op),
+        {}, {X86_REG_EFLAGS});
+}
+
+Instruction *X86Builder::arithmetic(ArithmeticOp op,
+    const X86Memory &source, x86_reg dest) {
+
+    X86Encoding e;
+    e.encode({static_cast<uint8_t>(op << 3 | 0x3)}, getNumber(dest), source);
+    e.addOperand(source);
+    e.addOperand(dest);
+    return e.build(getArithmeticId(op), getArithmeticMnemonic(op),
+        {}, {X86_REG_EFLAGS});
+}
+
+Instruction *X86Builder::shr(uint8_t count, x86_reg dest) {
+    X86Encoding e;
+    if(count == 1) {
+        // Capstone shows the shift-by-one form without an immediate
+        e.encode({0xd1}, 5, dest);
+    }
+    else {
+        e.encode({0xc1}, 5, dest);
+        e.appendImm(count, 1);
+        e.addImmOperand(count);
+    }
+    e.addOperand(dest);
+    return e.build(X86_INS_SHR, "shrq", {}, {X86_REG_EFLAGS});
+}
+
+Instruction *X86Builder::incb(const X86Memory &dest) {
+    X86Encoding e;
+    e.encode({0xfe}, 0, dest, false);
+    e.addOperand(dest, 1);
+    return e.build(X86_INS_INC, "incb", {}, {X86_REG_EFLAGS});
+}
+
+Instruction *X86Builder::nop() {
+    X86Encoding e;
+    e.append({0x90});
+    return e.build(X86_INS_NOP, "nop");
+}
+
+Instruction *X86Builder::pause() {
+    X86Encoding e;
+    e.append({0xf3, 0x90});
+    return e.build(X86_INS_PAUSE, "pause");
+}
+
+Instruction *X86Builder::hlt() {
+    X86Encoding e;
+    e.append({0xf4});
+    return e.build(X86_INS_HLT, "hlt");
+}
+
+Instruction *X86Builder::ud2() {
+    X86Encoding e;
+    e.append({0x0f, 0x0b});
+    return e.build(X86_INS_UD2, "ud2");
+}
+
+Instruction *X86Builder::ret() {
+    X86Encoding e;
+    e.append({0xc3});
+    return e.build(X86_INS_RET, "retq", {X86_REG_RSP}, {X86_REG_RSP},
+        new ReturnInstruction());
+}
+#endif
+
+#ifdef ARCH_AARCH64
+namespace {
+
+/** One fixed-width instruction and its operands. */
+class AARCH64Encoding {
+private:
+    uint32_t bits;
+    std::vector<cs_arm64_op> operands;
+    std::ostringstream opStr;
+public:
+    AARCH64Encoding(uint32_t bits) : bits(bits) {}
+
+    /** Places the register number at bit position shift. */
+    void encode(arm64_reg reg, int shift);
+    void encodeImm(uint32_t imm, int shift) { bits |= imm << shift; }
+
+    void addOperand(arm64_reg reg);
+    void addImmOperand(int64_t imm);
+    void addMemOperand(arm64_reg base, int32_t disp);
+
+    Instruction *build(unsigned int id, const char *mnemonic);
+private:
+    static const char *getName(arm64_reg reg);
+    void printImm(int64_t imm);
+};
+
+void AARCH64Encoding::encode(arm64_reg reg, int shift) {
+    int number = AARCH64GPRegister::convertToPhysical(reg);
+    if(number < AARCH64GPRegister::R0 || number > AARCH64GPRegister::R31) {
+        throw "AARCH64Builder: only general-purpose registers can be encoded";
+    }
+    bits |= static_cast<uint32_t>(number) << shift;
+}
+
+const char *AARCH64Encoding::getName(arm64_reg reg) {
+    static const char *const names[] = {
+        "x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7",
+        "x8", "x9", "x10", "x11", "x12", "x13", "x14", "x15",
+        "x16", "x17", "x18", "x19", "x20", "x21", "x22", "x23",
+        "x24", "x25", "x26", "x27", "x28", "x29", "x30"
+    };
+    if(reg == ARM64_REG_SP) return "sp";
+    if(reg == ARM64_REG_XZR) return "xzr";
+    return names[AARCH64GPRegister::convertToPhysical(reg)];
+}
+
+void AARCH64Encoding::printImm(int64_t imm) {
+    opStr << '#';
+    if(imm < 0) {
+        opStr << '-';
+        imm = -imm;
+    }
+    if(imm > 9) opStr << "0x" << std::hex << imm << std::dec;
+    else opStr << imm;
+}
+
+void AARCH64Encoding::addOperand(arm64_reg reg) {
+    cs_arm64_op op;
+    std::memset(&op, 0, sizeof op);
+    op.type = ARM64_OP_REG;
+    op.reg = reg;
+    operands.push_back(op);
+
+    if(!opStr.str().empty()) opStr << ", ";
+    opStr << getName(reg);
+}
+
+void AARCH64Encoding::addImmOperand(int64_t imm) {
+    cs_arm64_op op;
+    std::memset(&op, 0, sizeof op);
+    op.type = ARM64_OP_IMM;
+    op.imm = imm;
+    operands.push_back(op);
+
+    if(!opStr.str().empty()) opStr << ", ";
+    printImm(imm);
+}
+
+void AARCH64Encoding::addMemOperand(arm64_reg base, int32_t disp) {
+    cs_arm64_op op;
+    std::memset(&op, 0, sizeof op);
+    op.type = ARM64_OP_MEM;
+    op.mem.base = base;
+    op.mem.index = ARM64_REG_INVALID;
+    op.mem.disp = disp;
+    operands.push_back(op);
+
+    if(!opStr.str().empty()) opStr << ", ";
+    opStr << '[' << getName(base);
+    if(disp) {
+        opStr << ", ";
+        printImm(disp);
+    }
+    opStr << ']';
+}
+
+Instruction *AARCH64Encoding::build(unsigned int id, const char *mnemonic) {
+    std::vector<uint8_t> bytes;
+    for(int i = 0; i < 4; i++) bytes.push_back(bits >> (i * 8) & 0xff);
+
+    auto semantic = new IsolatedInstruction();
+    semantic->setAssembly(AssemblyPtr(new Assembly(id, bytes, mnemonic,
+        opStr.str(), AssemblyOperands(operands), {}, {})));
+
+    auto instr = new Instruction();
+    instr->setSemantic(semantic);
+    return instr;
+}
+
+}  // anonymous namespace
+
+Instruction *AARCH64Builder::nop() {
+    return AARCH64Encoding(0xd503201f).build(ARM64_INS_NOP, "nop");
+}
+
+Instruction *AARCH64Builder::mov(arm64_reg dest, uint16_t imm) {
+    AARCH64Encoding e(0xd2800000);  // movz
+    e.encode(dest, 0);
+    e.encodeImm(imm, 5);
+    e.addOperand(dest);
+    e.addImmOperand(imm);
+    // see Assembly::overrideCapstone()
+    return e.build(ARM64_INS_MOV, "mov");
+}
+
+Instruction *AARCH64Builder::movn(arm64_reg dest, uint16_t imm) {
+    AARCH64Encoding e(0x92800000);
+    e.encode(dest, 0);
+    e.encodeImm(imm, 5);
+    e.addOperand(dest);
+    e.addImmOperand(imm);
+    return e.build(ARM64_INS_MOVN, "movn");
+}
+
+Instruction *AARCH64Builder::eor(arm64_reg dest, arm64_reg source1,
+    arm64_reg source2) {
+
+    AARCH64Encoding e(0xca000000);
+    e.encode(dest, 0);
+    e.encode(source1, 5);
+    e.encode(source2, 16);
+    e.addOperand(dest);
+    e.addOperand(source1);
+    e.addOperand(source2);
+    return e.build(ARM64_INS_EOR, "eor");
+}
+
+Instruction *AARCH64Builder::add(arm64_reg dest, arm64_reg source,
+    uint16_t imm) {
+
+    if(imm >= 0x1000) throw "AARCH64Builder: add immediate is 12 bits";
+    AARCH64Encoding e(0x91000000);
+    e.encode(dest, 0);
+    e.encode(source, 5);
+    e.encodeImm(imm, 10);
+    e.addOperand(dest);
+    e.addOperand(source);
+    e.addImmOperand(imm);
+    return e.build(ARM64_INS_ADD, "add");
+}
+
+Instruction *AARCH64Builder::sub(arm64_reg dest, arm64_reg source,
+    uint16_t imm) {
+
+    if(imm >= 0x1000) throw "AARCH64Builder: sub immediate is 12 bits";
+    AARCH64Encoding e(0xd1000000);
+    e.encode(dest, 0);
+    e.encode(source, 5);
+    e.encodeImm(imm, 10);
+    e.addOperand(dest);
+    e.addOperand(source);
+    e.addImmOperand(imm);
+    return e.build(ARM64_INS_SUB, "sub");
+}
+
+Instruction *AARCH64Builder::ldr(arm64_reg reg, arm64_reg base,
+    uint32_t offset) {
+
+    if(offset % 8 || offset / 8 >= 0x1000) {
+        throw "AARCH64Builder: bad ldr offset";
+    }
+    AARCH64Encoding e(0xf9400000);
+    e.encode(reg, 0);
+    e.encode(base, 5);
+    e.encodeImm(offset / 8, 10);
+    e.addOperand(reg);
+    e.addMemOperand(base, offset);
+    return e.build(ARM64_INS_LDR, "ldr");
+}
+
+Instruction *AARCH64Builder::str(arm64_reg reg, arm64_reg base,
+    uint32_t offset) {
+
+    if(offset % 8 || offset / 8 >= 0x1000) {
+        throw "AARCH64Builder: bad str offset";
+    }
+    AARCH64Encoding e(0xf9000000);
+    e.encode(reg, 0);
+    e.encode(base, 5);
+    e.encodeImm(offset / 8, 10);
+    e.addOperand(reg);
+    e.addMemOperand(base, offset);
+    return e.build(ARM64_INS_STR, "str");
+}
+#endif
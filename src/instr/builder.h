@@ -0,0 +1,122 @@
+#ifndef EGALITO_INSTR_BUILDER_H
+#define EGALITO_INSTR_BUILDER_H
+
+#include <string>
+#include <vector>
+#include "assembly.h"
+
+class Instruction;
+class Link;
+
+/*  Builders for the instructions that passes synthesize. Each call
+    encodes the bytes and fills in the same Assembly (id, operands,
+    implicit registers) that Capstone would, so inserting code does not
+    need a disassembler round-trip. The encodings are checked against
+    Capstone in test/unit/instr/_builder.cpp; the operand string is only
+    approximate and is meant for dumps.
+*/
+
+#ifdef ARCH_X86_64
+/** An x86-64 memory operand, %segment:disp(base, index, scale). */
+class X86Memory {
+private:
+    x86_reg segment;
+    x86_reg base;
+    x86_reg index;
+    int scale;
+    int32_t disp;
+    Link *link;
+public:
+    explicit X86Memory(x86_reg base, int32_t disp = 0)
+        : segment(X86_REG_INVALID), base(base), index(X86_REG_INVALID),
+        scale(1), disp(disp), link(nullptr) {}
+    X86Memory(x86_reg base, x86_reg index, int scale, int32_t disp = 0)
+        : segment(X86_REG_INVALID), base(base), index(index),
+        scale(scale), disp(disp), link(nullptr) {}
+
+    /** disp32(%rip), where the displacement is computed from link. */
+    static X86Memory ripRelative(Link *link);
+    /** An absolute disp32 with no base, usually with %fs or %gs. */
+    static X86Memory absolute(int32_t address,
+        x86_reg segment = X86_REG_INVALID);
+
+    X86Memory &setSegment(x86_reg segment)
+        { this->segment = segment; return *this; }
+
+    x86_reg getSegment() const { return segment; }
+    x86_reg getBase() const { return base; }
+    x86_reg getIndex() const { return index; }
+    int getScale() const { return scale; }
+    int32_t getDisplacement() const { return disp; }
+    Link *getLink() const { return link; }
+};
+
+/** Operands are in AT&T order (source first), as in the comments that
+    usually accompany synthesized code. Registers are 64-bit.
+*/
+class X86Builder {
+public:
+    // values are the /digit of the 0x81 and 0x83 opcodes
+    enum ArithmeticOp {
+        OP_ADD = 0,
+        OP_OR = 1,
+        OP_AND = 4,
+        OP_SUB = 5,
+        OP_XOR = 6,
+        OP_CMP = 7
+    };
+public:
+    static Instruction *mov(x86_reg source, x86_reg dest);
+    static Instruction *mov(const X86Memory &source, x86_reg dest);
+    static Instruction *mov(x86_reg source, const X86Memory &dest);
+    /** Sign-extended to 64 bits. */
+    static Instruction *mov(int32_t imm, x86_reg dest);
+    static Instruction *lea(const X86Memory &source, x86_reg dest);
+
+    /** X86_REG_EFLAGS gives pushfq and popfq. */
+    static Instruction *push(x86_reg reg);
+    static Instruction *pop(x86_reg reg);
+    /** Sign-extended to 64 bits. */
+    static Instruction *push(int32_t imm);
+
+    static Instruction *arithmetic(ArithmeticOp op, int32_t imm,
+        x86_reg dest);
+    static Instruction *arithmetic(ArithmeticOp op, int32_t imm,
+        const X86Memory &dest);
+    static Instruction *arithmetic(ArithmeticOp op, x86_reg source,
+        x86_reg dest);
+    static Instruction *arithmetic(ArithmeticOp op, x86_reg source,
+        const X86Memory &dest);
+    static Instruction *arithmetic(ArithmeticOp op, const X86Memory &source,
+        x86_reg dest);
+
+    static Instruction *shr(uint8_t count, x86_reg dest);
+    static Instruction *incb(const X86Memory &dest);
+
+    static Instruction *nop();
+    static Instruction *pause();
+    static Instruction *hlt();
+    static Instruction *ud2();
+    static Instruction *ret();
+};
+#endif
+
+#ifdef ARCH_AARCH64
+/** Registers are X registers (or sp/xzr where the encoding allows). */
+class AARCH64Builder {
+public:
+    static Instruction *nop();
+    /** movz with no shift, which Egalito calls mov. */
+    static Instruction *mov(arm64_reg dest, uint16_t imm);
+    static Instruction *movn(arm64_reg dest, uint16_t imm);
+    static Instruction *eor(arm64_reg dest, arm64_reg source1,
+        arm64_reg source2);
+    static Instruction *add(arm64_reg dest, arm64_reg source, uint16_t imm);
+    static Instruction *sub(arm64_reg dest, arm64_reg source, uint16_t imm);
+    /** 64-bit loads and stores with an unsigned, 8-byte aligned offset. */
+    static Instruction *ldr(arm64_reg reg, arm64_reg base, uint32_t offset);
+    static Instruction *str(arm64_reg reg, arm64_reg base, uint32_t offset);
+};
+#endif
+
+#endif
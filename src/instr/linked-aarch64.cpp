@@ -235,6 +235,23 @@ uint32_t LinkedInstruction::rebuild() {
     return fixedBytes | imm;
 }
 
+bool LinkedInstruction::isPCRelative() const {
+    switch(modeInfo - AARCH64_ImInfo) {
+    case AARCH64_IM_ADR:
+    case AARCH64_IM_LDRLIT:
+    case AARCH64_IM_BL:
+    case AARCH64_IM_B:
+    case AARCH64_IM_BCOND:
+    case AARCH64_IM_CBZ:
+    case AARCH64_IM_CBNZ:
+    case AARCH64_IM_TBZ:
+    case AARCH64_IM_TBNZ:
+        return true;
+    default:
+        return false;
+    }
+}
+
 // only works before move
 bool LinkedInstruction::check() {
     uint32_t original;
@@ -67,6 +67,8 @@ public:
     std::string getMnemonic() { return getAssembly()->getMnemonic(); }
 
     const AARCH64_modeInfo_t *getModeInfo() const { return modeInfo; }
+    /** True if the immediate only depends on target - source. */
+    bool isPCRelative() const;
     virtual int64_t getOriginalOffset() const;
 
     uint32_t rebuild();
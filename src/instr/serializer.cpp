@@ -251,7 +251,7 @@ InstructionSemantic *InstrSerializer::defaultDeserialize(Instruction *instructio
     std::string bytes = reader.readBytes<uint8_t>();
 #if 1
     try {
-        static DisasmHandle handle(true);
+        thread_local DisasmHandle handle(true);
         auto semantic = DisassembleInstruction(handle, true)
             .instructionSemantic(instruction, bytes, address);
         return semantic;
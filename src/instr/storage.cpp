@@ -34,18 +34,21 @@ AssemblyFactory AssemblyFactory::instance;
 AssemblyPtr AssemblyFactory::buildAssembly(InstructionStorage *storage,
     address_t address) {
 
-    static DisasmHandle handle(true);
+    thread_local DisasmHandle handle(true);
     auto assembly = DisassembleInstruction(handle, true)
         .allocateAssembly(storage->getData(), address);
     auto ptr = AssemblyPtr(assembly);
+    std::lock_guard<std::mutex> lock(mutex);
     assemblyList.push_back(ptr);
     return ptr;
 }
 
 void AssemblyFactory::registerAssembly(AssemblyPtr assembly) {
+    std::lock_guard<std::mutex> lock(mutex);
     assemblyList.push_back(assembly);
 }
 
 void AssemblyFactory::clearCache() {
+    std::lock_guard<std::mutex> lock(mutex);
     assemblyList.clear();
 }
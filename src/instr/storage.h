@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 #include "assembly.h"
 
 class InstructionStorage {
@@ -27,6 +28,7 @@ public:
     static AssemblyFactory *getInstance() { return &instance; }
 private:
     std::vector<AssemblyPtr> assemblyList;
+    std::mutex mutex;  // modules may be parsed on several threads
 public:
     AssemblyPtr buildAssembly(InstructionStorage *storage, address_t address);
     void registerAssembly(AssemblyPtr assembly);
@@ -20,7 +20,10 @@
 #include "pass/logcalls.h"
 #include "pass/loginstr.h"
 #include "pass/noppass.h"
+#include "pass/peephole.h"
 #include "pass/promotejumps.h"
+#include "pass/relaxjumps.h"
+#include "pass/alignloops.h"
 #include "pass/resolveplt.h"
 #include "pass/collapseplt.h"
 #include "pass/hijack.h"
@@ -36,9 +39,12 @@
 #include "pass/endbrenforce.h"
 #include "pass/syscallsandbox.h"
 #include "pass/clearplts.h"
+#include "runtime/jitstats.h"
 #include "runtime/managegs.h"
 #include "transform/sandbox.h"
+#include "transform/alignment.h"
 #include "util/feature.h"
+#include "util/profiler.h"
 #include "util/timing.h"
 #include "cminus/print.h"
 #include "log/registry.h"
@@ -160,12 +166,20 @@ void EgalitoLoader::run() {
             static_cast<int>(duration / 1000));
     }
 
+    if(shufflingSandbox) {
+        if(auto path = getenv("EGALITO_JIT_STATS")) {
+            JITStatistics::create(path, gsTable,
+                shufflingSandbox->getBacking()->getSize());
+        }
+    }
+
     // --- last point accesses to loader TLS work ('new' needs loader TLS)
     PrepareTLS::prepare(setup->getConductor());
 
     if(shufflingSandbox) {
         EgalitoTLS::setSandbox(shufflingSandbox);
         EgalitoTLS::setGSTable(gsTable);
+        EgalitoTLS::setJITStatistics(JITStatistics::claimThread());
     }
 
     // jump to the target program (never returns)
@@ -257,8 +271,27 @@ void EgalitoLoader::otherPasses() {
 
 #ifdef ARCH_X86_64
     if(!fromArchive) {
+        if(isFeatureEnabled("EGALITO_USE_PEEPHOLE")) {
+            PeepholePass peephole;
+            setup->getConductor()->acceptInAllModules(&peephole, true);
+            LOG(1, "peephole removed " << peephole.getRemovedCount()
+                << " instructions, " << peephole.getBytesSaved() << " bytes, ~"
+                << peephole.getCyclesSaved() << " cycles (estimated)");
+        }
+
         PromoteJumpsPass promoteJumps;
         setup->getConductor()->acceptInAllModules(&promoteJumps, true);
+
+        if(isFeatureEnabled("EGALITO_RELAX_JUMPS")) {
+            RelaxJumpsPass relaxJumps;
+            setup->getConductor()->acceptInAllModules(&relaxJumps, true);
+        }
+
+        auto alignment = setup->getAlignmentPolicy();
+        if(alignment->hasLoopAlignment()) {
+            AlignLoopsPass alignLoops(alignment);
+            setup->getConductor()->acceptInAllModules(&alignLoops, true);
+        }
     }
     if(0) {
         ClearPLTs clearPLTs;
@@ -300,6 +333,10 @@ int main(int argc, char *argv[]) {
         printUsage(argv[0]);
         return -2;
     }
+    if(!EgalitoProfiler::getInstance()->parseEnvVar("EGALITO_PROFILE")) {
+        printUsage(argv[0]);
+        return -2;
+    }
 
     if(isFeatureEnabled("EGALITO_MEASURE_LOADTIME")) {
         masterLoadTime = std::chrono::high_resolution_clock::now();
@@ -317,6 +354,7 @@ int main(int argc, char *argv[]) {
     if(loader.parse(program)) {
         loader.setupEnvironment(argc, argv);
         loader.generateCode();
+        EgalitoProfiler::getInstance()->finish();  // run() never exits
         loader.run();  // never returns
     }
 
@@ -22,4 +22,9 @@ void printUsage(const char *exepath) {
         "Debug options: EGALITO_DEBUG=/dev/null|(some/settings/file)|(setting)\n"
         "    where a setting may be e.g. load, load=2, !load\n"
         "    and a settings file contains one setting/filename per line\n");
+
+    std::fprintf(stderr, "\n"
+        "Profiling: EGALITO_PROFILE=(setting):(setting)...\n"
+        "    where a setting is pass, module or function (the deepest scope),\n"
+        "    trace=file.json, summary=file, or !summary\n");
 }
@@ -3,7 +3,9 @@
 #include <capstone/x86.h>
 #include "addinline.h"
 #include "analysis/frametype.h"
-#include "disasm/disassemble.h"
+#include "analysis/liveregister.h"
+#include "chunk/concrete.h"
+#include "instr/builder.h"
 #include "instr/register.h"
 #include "instr/semantic.h"
 #include "instr/linked-x86_64.h"
@@ -18,6 +20,70 @@ ChunkAddInline::ChunkAddInline(std::vector<Register> regList,
     modification = new ModificationImpl(regList, generator);
 }
 
+ChunkAddInline::ChunkAddInline(ScratchState *state,
+    std::vector<Register> scratchList, size_t count, bool clobbersFlags,
+    std::function<std::vector<Instruction *> (unsigned int,
+        const std::vector<Register> &)> generator) {
+
+    modification = new ScratchModification(state, scratchList, count,
+        clobbersFlags, generator);
+}
+
+ChunkAddInline::ScratchState::~ScratchState() {
+    delete liveness;
+}
+
+bool ChunkAddInline::ScratchState::isLive(Instruction *point, Register reg) {
+#ifdef ARCH_X86_64
+    auto function = dynamic_cast<Function *>(point->getParent()->getParent());
+    if(!function) return true;
+    if(function != this->function) {
+        // passes instrument one function at a time, only cache the last
+        delete liveness;
+        liveness = new InstructionLiveRegister(function);
+        this->function = function;
+    }
+
+    int index = (reg == X86_REG_EFLAGS)
+        ? X86Register::FLAGS : X86Register::convertToPhysical(reg);
+    if(index == X86Register::INVALID) return true;
+    return liveness->getLiveBefore(point).get(index);
+#else
+    return true;
+#endif
+}
+
+void ChunkAddInline::ScratchModification::setInsertionPoint(
+    Instruction *point) {
+
+    chosen.clear();
+    clobbered.clear();
+
+    RegList liveList;
+    for(auto reg : scratchList) {
+        if(chosen.size() == count) break;
+        if(state->isLive(point, reg)) liveList.push_back(reg);
+        else chosen.push_back(reg);
+    }
+    for(auto reg : liveList) {
+        if(chosen.size() == count) break;
+        chosen.push_back(reg);
+        clobbered.push_back(reg);
+    }
+    if(chosen.size() < count) throw "not enough scratch registers";
+
+    size_t wanted = count;
+#ifdef ARCH_X86_64
+    if(clobbersFlags) {
+        wanted++;
+        if(state->isLive(point, X86_REG_EFLAGS)) {
+            clobbered.insert(clobbered.begin(), X86_REG_EFLAGS);
+        }
+    }
+#endif
+    state->record(clobbered.size(), wanted - clobbered.size());
+}
+
 std::vector<Instruction *> ChunkAddInline::getFullCode(Instruction *point) {
     auto function = dynamic_cast<Function *>(point->getParent()->getParent());
     assert(function != nullptr);
@@ -25,10 +91,12 @@ std::vector<Instruction *> ChunkAddInline::getFullCode(Instruction *point) {
     bool redzone = !FrameType::hasStackFrame(function);
     SaveRestoreRegisters saveRestore(point, redzone);
 
+    modification->setInsertionPoint(point);
     auto regList = modification->getClobberedRegisters();
     unsigned int stackBytesAdded = 0;
     stackBytesAdded += regList.size() * 8;  // for pushes
-    if(redzone) stackBytesAdded += 0x80;
+    // the red zone is only skipped when something is pushed
+    if(redzone && regList.size() > 0) stackBytesAdded += 0x80;
 
     std::vector<Instruction *> instrList;
     extendList(instrList, saveRestore.getRegSaveCode(regList));
@@ -60,36 +128,17 @@ ChunkAddInline::InstrList ChunkAddInline::SaveRestoreRegisters::getRegSaveCode(
     const RegList &regList) {
 
     InstrList results;
+#ifdef ARCH_X86_64
     if(redzone && regList.size() > 0) {
         // lea -0x80(%rsp), %rsp
-        results.push_back(Disassemble::instruction({0x48, 0x8d, 0x64, 0x24, 0x80}));
+        results.push_back(X86Builder::lea(
+            X86Memory(X86_REG_RSP, -0x80), X86_REG_RSP));
     }
     for(auto reg : regList) {
-        std::vector<unsigned char> bytes;
-        switch(reg) {
-        case X86_REG_EFLAGS: bytes = {0x9c}; break;               // pushfd
-        case X86_REG_RAX:   bytes = {0x50}; break;                // push %rax
-        case X86_REG_RBX:   bytes = {0x53}; break;                // push %rbx
-        case X86_REG_RCX:   bytes = {0x51}; break;                // push %rcx
-        case X86_REG_RDX:   bytes = {0x52}; break;                // push %rdx
-        case X86_REG_RSI:   bytes = {0x56}; break;                // push %rsi
-        case X86_REG_RDI:   bytes = {0x57}; break;                // push %rdi
-        case X86_REG_RBP:   bytes = {0x55}; break;                // push %rbp
-        case X86_REG_RSP:   bytes = {0x54}; break;                // push %rsp
-        case X86_REG_R8:    bytes = {0x41, 0x50}; break;          // push %r8
-        case X86_REG_R9:    bytes = {0x41, 0x51}; break;          // push %r9
-        case X86_REG_R10:   bytes = {0x41, 0x52}; break;          // push %r10
-        case X86_REG_R11:   bytes = {0x41, 0x53}; break;          // push %r11
-        case X86_REG_R12:   bytes = {0x41, 0x54}; break;          // push %r12
-        case X86_REG_R13:   bytes = {0x41, 0x55}; break;          // push %r13
-        case X86_REG_R14:   bytes = {0x41, 0x56}; break;          // push %r14
-        case X86_REG_R15:   bytes = {0x41, 0x57}; break;          // push %r15
-        default:
-            LOG(1, "saving unsupported register in ChunkAddInline");
-            break;
-        }
-        results.push_back(Disassemble::instruction(bytes));
+        // pushfq for X86_REG_EFLAGS
+        results.push_back(X86Builder::push(static_cast<x86_reg>(reg)));
     }
+#endif
     return results;
 }
 
@@ -97,37 +146,16 @@ ChunkAddInline::InstrList ChunkAddInline::SaveRestoreRegisters::getRegRestoreCod
     const RegList &regList) {
 
     InstrList results;
+#ifdef ARCH_X86_64
     for(auto it = regList.rbegin(); it != regList.rend(); it++) {
-        auto reg = *it;
-        std::vector<unsigned char> bytes;
-        switch(reg) {
-        case X86_REG_EFLAGS: bytes = {0x9d}; break;               // popfd
-        case X86_REG_RAX:   bytes = {0x58}; break;                // pop %rax
-        case X86_REG_RBX:   bytes = {0x5b}; break;                // pop %rbx
-        case X86_REG_RCX:   bytes = {0x59}; break;                // pop %rcx
-        case X86_REG_RDX:   bytes = {0x5a}; break;                // pop %rdx
-        case X86_REG_RSI:   bytes = {0x5e}; break;                // pop %rsi
-        case X86_REG_RDI:   bytes = {0x5f}; break;                // pop %rdi
-        case X86_REG_RBP:   bytes = {0x5d}; break;                // pop %rbp
-        case X86_REG_RSP:   bytes = {0x5c}; break;                // pop %rsp
-        case X86_REG_R8:    bytes = {0x41, 0x58}; break;          // pop %r8
-        case X86_REG_R9:    bytes = {0x41, 0x59}; break;          // pop %r9
-        case X86_REG_R10:   bytes = {0x41, 0x5a}; break;          // pop %r10
-        case X86_REG_R11:   bytes = {0x41, 0x5b}; break;          // pop %r11
-        case X86_REG_R12:   bytes = {0x41, 0x5c}; break;          // pop %r12
-        case X86_REG_R13:   bytes = {0x41, 0x5d}; break;          // pop %r13
-        case X86_REG_R14:   bytes = {0x41, 0x5e}; break;          // pop %r14
-        case X86_REG_R15:   bytes = {0x41, 0x5f}; break;          // pop %r15
-        default:
-            LOG(1, "restoring unsupported register in ChunkAddInline");
-            break;
-        }
-        results.push_back(Disassemble::instruction(bytes));
+        // popfq for X86_REG_EFLAGS
+        results.push_back(X86Builder::pop(static_cast<x86_reg>(*it)));
     }
     if(redzone && regList.size() > 0) {
         // lea 0x80(%rsp), %rsp
-        results.push_back(Disassemble::instruction(
-            {0x48, 0x8d, 0xa4, 0x24, 0x80, 0x00, 0x00, 0x00}));
+        results.push_back(X86Builder::lea(
+            X86Memory(X86_REG_RSP, 0x80), X86_REG_RSP));
     }
+#endif
     return results;
 }
@@ -6,6 +6,9 @@
 #include "instr/instr.h"
 #include "instr/register.h"
 
+class Function;
+class InstructionLiveRegister;
+
 class ChunkAddInline {
 public:
     typedef std::vector<Instruction *> InstrList;
@@ -21,9 +24,35 @@ public:
         unsigned int getStackBytesAdded() const { return stackBytesAdded; }
     };*/
 
+    /** Shared by all the insertions of one pass: caches register liveness
+        for the function being modified, and counts how many register
+        saves were needed and how many were avoided.
+    */
+    class ScratchState {
+    private:
+        Function *function;
+        InstructionLiveRegister *liveness;
+        unsigned long savedCount;
+        unsigned long avoidedCount;
+    public:
+        ScratchState() : function(nullptr), liveness(nullptr),
+            savedCount(0), avoidedCount(0) {}
+        ~ScratchState();
+
+        bool isLive(Instruction *point, Register reg);
+        void record(size_t saved, size_t avoided)
+            { savedCount += saved; avoidedCount += avoided; }
+        unsigned long getSavedCount() const { return savedCount; }
+        unsigned long getAvoidedCount() const { return avoidedCount; }
+    private:
+        ScratchState(const ScratchState &);
+        ScratchState &operator = (const ScratchState &);
+    };
+
     class Modification {
     public:
         virtual ~Modification() {}
+        virtual void setInsertionPoint(Instruction *point) {}
         virtual InstrList getNewCode(unsigned int stackBytesAdded) = 0;
         virtual RegList getClobberedRegisters() = 0;
     };
@@ -39,6 +68,32 @@ public:
             { return makeCodeCallback(stackBytesAdded); }
         virtual RegList getClobberedRegisters() { return regList; }
     };
+
+    /** Chooses registers from a list of acceptable scratch registers,
+        preferring ones that are dead at the insertion point, and saves
+        only the chosen registers (and flags) that are live there.
+    */
+    class ScratchModification : public Modification {
+    private:
+        ScratchState *state;
+        RegList scratchList;
+        size_t count;
+        bool clobbersFlags;
+        RegList chosen;
+        RegList clobbered;
+        std::function<InstrList (unsigned int, const RegList &)>
+            makeCodeCallback;
+    public:
+        ScratchModification(ScratchState *state, RegList scratchList,
+            size_t count, bool clobbersFlags,
+            std::function<InstrList (unsigned int, const RegList &)> callback)
+            : state(state), scratchList(scratchList), count(count),
+            clobbersFlags(clobbersFlags), makeCodeCallback(callback) {}
+        virtual void setInsertionPoint(Instruction *point);
+        virtual InstrList getNewCode(unsigned int stackBytesAdded)
+            { return makeCodeCallback(stackBytesAdded, chosen); }
+        virtual RegList getClobberedRegisters() { return clobbered; }
+    };
 private:
     class SaveRestoreRegisters {
     private:
@@ -65,6 +120,11 @@ public:
     ChunkAddInline(Modification *modification);
     ChunkAddInline(std::vector<Register> regList,
         std::function<std::vector<Instruction *> (unsigned int)> generator);
+    // the generator receives count registers chosen from scratchList
+    ChunkAddInline(ScratchState *state, std::vector<Register> scratchList,
+        size_t count, bool clobbersFlags,
+        std::function<std::vector<Instruction *> (unsigned int,
+            const std::vector<Register> &)> generator);
     ~ChunkAddInline() { delete modification; }
 
     void insertBefore(Instruction *point, bool beforeJumpTo);
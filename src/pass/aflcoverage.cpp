@@ -1,7 +1,16 @@
 #include <vector>
 #include <cassert>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <algorithm>
+#include <elf.h>
 #include "aflcoverage.h"
-#include "disasm/disassemble.h"
+#include "analysis/controlflow.h"
+#include "analysis/dominance.h"
+#include "analysis/superblock.h"
+#include "chunk/concrete.h"
+#include "instr/builder.h"
 #include "instr/register.h"
 #include "instr/concrete.h"
 #include "operation/mutator.h"
@@ -10,6 +19,21 @@
 #include "pass/switchcontext.h"
 #include "types.h"
 
+#include "log/log.h"
+
+#define SHM_REGION 0x50000000
+#define SHM_REGION_SIZE 0x10000
+#define SHM_QUEUE_PTR (SHM_REGION - 0x1000)
+#define COUNTER_PAGE_SIZE 0x1000
+#define COUNTER_SECTION_NAME ".afl_counters"
+
+AFLCoveragePass::AFLCoveragePass(Mode mode, bool pruned)
+    : mode(mode), pruned(pruned), entryPoint(nullptr),
+    usedSlots(SHM_REGION_SIZE), usedSlotCount(0),
+    blockCount(0), instrumentedCount(0) {
+
+}
+
 void AFLCoveragePass::visit(Program *program) {
     auto allocateFunc = ChunkFind2(program).findFunction(
         "egalito_allocate_afl_shm");
@@ -42,7 +66,15 @@ void AFLCoveragePass::visit(Program *program) {
         entryPoint = f;
     }
 
+    if(mode == MODE_COUNTERS) allocateCounterSections(program);
+
     recurse(program);
+
+    LOG(1, "AFLCoveragePass: instrumented " << instrumentedCount << " of "
+        << blockCount << " blocks");
+    LOG(1, "AFLCoveragePass: saved " << scratchState.getSavedCount()
+        << " registers, avoided " << scratchState.getAvoidedCount()
+        << " spills");
 }
 
 void AFLCoveragePass::visit(Module *module) {
@@ -52,63 +84,305 @@ void AFLCoveragePass::visit(Module *module) {
 }
 
 void AFLCoveragePass::visit(Function *function) {
-    if(function->getName() == "obstack_free") return;  // jne tail rec, for const ss
-    if(function->getName() == "__GI__IO_file_xsputn") return;
-    if(function->getName() == "vfprintf") return;
+    if(!shouldInstrument(function)) return;
 
-    if(function->getName() == "_start" || function == entryPoint) return;
-    if(function->getName() == "__libc_csu_init") return;
+    auto module = static_cast<Module *>(function->getParent()->getParent());
+    auto blocks = selectBlocks(function);
+    blockCount += function->getChildren()->getIterable()->getCount();
+    instrumentedCount += blocks.size();
+
+    // IDs are named by the original offsets, take them before inserting
+    std::vector<address_t> offsets;
+    for(auto block : blocks) {
+        offsets.push_back(block->getAddress() - function->getAddress());
+    }
+
+    for(size_t i = 0; i < blocks.size(); i++) {
+        if(mode == MODE_COUNTERS) {
+            auto &counters = counterSections[module];
+            size_t index = counters.next++ % counters.size;
+            idTable.push_back(BlockEntry{counters.mapOffset + index,
+                module->getName(), function->getName(), offsets[i]});
+            addCounterCode(blocks[i], counters.section, index);
+        }
+        else {
+            auto id = makeBlockID(module, function, offsets[i]);
+            idTable.push_back(BlockEntry{id,
+                module->getName(), function->getName(), offsets[i]});
+            addCoverageCode(blocks[i], id);
+        }
+    }
+}
+
+void AFLCoveragePass::writeIDTable(std::ostream &stream) const {
+    for(const auto &entry : idTable) {
+        stream << "0x" << std::hex << std::setw(8) << std::setfill('0')
+            << entry.id << " " << entry.module << " " << entry.function
+            << "+0x" << entry.offset << std::dec << "\n";
+    }
+}
 
-    if(function->getName() == "__libc_start_main") return;
-    if(function->getName() == "mmap64") return;
-    if(function->getName() == "mmap") return;
-    if(function->getName() == "arch_prctl") return;
+bool AFLCoveragePass::shouldInstrument(Function *function) {
+    if(function->getName() == "obstack_free") return false;  // jne tail rec, for const ss
+    if(function->getName() == "__GI__IO_file_xsputn") return false;
+    if(function->getName() == "vfprintf") return false;
+
+    if(function->getName() == "_start" || function == entryPoint) return false;
+    if(function->getName() == "__libc_csu_init") return false;
+
+    if(function->getName() == "__libc_start_main") return false;
+    if(function->getName() == "mmap64") return false;
+    if(function->getName() == "mmap") return false;
+    if(function->getName() == "arch_prctl") return false;
 
     // const shadow stack needs these
-    if(function->getName() == "__longjmp") return;
-    if(function->getName() == "__longjmp_chk") return;
+    if(function->getName() == "__longjmp") return false;
+    if(function->getName() == "__longjmp_chk") return false;
 
     // mempcpy does jmp into middle of this:
-    //if(function->getName() == "__memcpy_avx_unaligned_erms") return;
-    if(function->getName().find("memcpy") != std::string::npos) return;
+    //if(function->getName() == "__memcpy_avx_unaligned_erms") return false;
+    if(function->getName().find("memcpy") != std::string::npos) return false;
 
     // memcpy does jmp into middle of this:
-    //if(function->getName() == "__memmove_sse2_unaligned_erms") return;
-    if(function->getName().find("memmove") != std::string::npos) return;
+    //if(function->getName() == "__memmove_sse2_unaligned_erms") return false;
+    if(function->getName().find("memmove") != std::string::npos) return false;
 
     // this has ja, conditional tail recursion
-    //if(function->getName() == "__memset_avx2_unaligned_erms") return;
-    if(function->getName().find("memset") != std::string::npos) return;
+    //if(function->getName() == "__memset_avx2_unaligned_erms") return false;
+    if(function->getName().find("memset") != std::string::npos) return false;
 
     // blacklist all mem* functions?
-    //if(function->getName().find("mem") != std::string::npos) return;
+    //if(function->getName().find("mem") != std::string::npos) return false;
 
     // this has jne, conditional tail recursion
     // __strncasecmp_l_avx
-    //if(function->getName() == "__strncasecmp_l_avx") return;
-    if(function->getName().find("str") != std::string::npos) return;
+    //if(function->getName() == "__strncasecmp_l_avx") return false;
+    if(function->getName().find("str") != std::string::npos) return false;
 
     // sphinx3, function does tail recursion to itself
-    if(function->getName() == "mdef_phone_id") return;
+    if(function->getName() == "mdef_phone_id") return false;
 
-    recurse(function);
+    return true;
 }
 
-void AFLCoveragePass::visit(Block *block) {
-    addCoverageCode(block);
+#ifdef ARCH_X86_64
+/* Whether control can leave the function from the end of this block, or
+    reach a place the control flow graph does not model.
+*/
+static bool leavesFunction(Function *function, Block *block) {
+    auto last = block->getChildren()->getIterable()->getLast();
+    auto semantic = last->getSemantic();
+    if(dynamic_cast<ReturnInstruction *>(semantic)) return true;
+    if(dynamic_cast<BreakInstruction *>(semantic)) return true;
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        if(cfi->getMnemonic() == "callq" || cfi->getMnemonic() == "call") {
+            return !cfi->returns();
+        }
+        auto link = cfi->getLink();
+        if(!link || !link->getTarget()) return true;
+        auto target = &*link->getTarget();
+        if(auto b = dynamic_cast<Block *>(target)) {
+            return b->getParent() != function;
+        }
+        if(auto i = dynamic_cast<Instruction *>(target)) {
+            return !i->getParent() || i->getParent()->getParent() != function;
+        }
+        return true;
+    }
+    if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+        return ij->getMnemonic() != "callq" && !ij->isForJumpTable();
+    }
+    if(auto dlcfi = dynamic_cast<DataLinkedControlFlowInstruction *>(
+        semantic)) {
+
+        return !dlcfi->isCall();
+    }
+    return false;
 }
+#endif
 
-#define GET_BYTE(x, shift) static_cast<unsigned char>(((x) >> (shift*8)) & 0xff)
-#define GET_BYTES(x) GET_BYTE((x),0), GET_BYTE((x),1), GET_BYTE((x),2), GET_BYTE((x),3)
+std::vector<Block *> AFLCoveragePass::selectBlocks(Function *function) {
+    std::vector<Block *> all;
+    for(auto block : CIter::children(function)) all.push_back(block);
+#ifdef ARCH_X86_64
+    if(!pruned) return all;
+
+    ControlFlowGraph cfg(function);
+    Dominance dominance(&cfg);
+    size_t count = cfg.getCount();
+
+    std::vector<bool> leaves(count);
+    bool hiddenExit = false;
+    for(size_t id = 0; id < count; id++) {
+        auto node = cfg.get(id);
+        leaves[id] = leavesFunction(function, node->getBlock());
+        auto links = node->forwardLinks();
+        if(leaves[id] && links.begin() != links.end()) {
+            // e.g. conditional tail call: post-dominance misses this exit
+            hiddenExit = true;
+        }
+        if(leaves[id]) {
+            auto ij = dynamic_cast<IndirectJumpInstruction *>(node->getBlock()
+                ->getChildren()->getIterable()->getLast()->getSemantic());
+            if(ij && ij->getMnemonic() != "callq") {
+                // targets we do not know, blocks may have hidden entries
+                return all;
+            }
+        }
+    }
 
-#define SHM_REGION 0x50000000
-#define SHM_REGION_SIZE 0x10000
-#define SHM_QUEUE_PTR (SHM_REGION - 0x1000)
+    // one probe per superblock, at its head
+    SuperblockAnalysis superblocks(&cfg, &dominance, !hiddenExit);
+    std::vector<bool> probe(count), required(count);
+    for(size_t id = 0; id < count; id++) {
+        probe[id] = superblocks.isHead(id);
+    }
 
-void AFLCoveragePass::addCoverageCode(Block *block) {
-    blockID = std::rand(); //% SHM_REGION_SIZE;
+    // A superblock S needs no probe if it cannot leave the function and
+    // every successor T is entered only from S: T's probe follows the
+    // probe before S directly, which identifies the path through S.
+    for(size_t s = 0; s < count; s++) {
+        if(!probe[s] || required[s]) continue;
+
+        std::vector<size_t> successors;
+        bool removable = true;
+        for(size_t id = 0; id < count && removable; id++) {
+            if(superblocks.getHead(id) != static_cast<int>(s)) continue;
+            if(leaves[id]) removable = false;
+            for(auto link : cfg.get(id)->forwardLinks()) {
+                auto t = link->getTargetID();
+                if(superblocks.getHead(t) == static_cast<int>(s)) continue;
+                auto cfLink = dynamic_cast<ControlFlowLink *>(&*link);
+                // the entry is also entered by callers
+                if(!cfLink || cfLink->getOffset() != 0 || !probe[t]
+                    || !superblocks.isHead(t) || t == 0) {
+
+                    removable = false;
+                    break;
+                }
+                for(auto back : cfg.get(t)->backwardLinks()) {
+                    if(superblocks.getHead(back->getTargetID())
+                        != static_cast<int>(s)) {
+
+                        removable = false;
+                    }
+                }
+                successors.push_back(t);
+            }
+        }
+        if(!removable || successors.empty()) continue;
+
+        probe[s] = false;
+        for(auto t : successors) required[t] = true;
+    }
+
+    std::vector<Block *> selected;
+    for(size_t id = 0; id < count; id++) {
+        if(probe[id]) selected.push_back(cfg.get(id)->getBlock());
+    }
+    return selected;
+#else
+    return all;
+#endif
+}
+
+void AFLCoveragePass::allocateCounterSections(Program *program) {
+    // each module gets whole pages of the map, in proportion to its blocks
+    std::vector<std::pair<Module *, size_t>> wanted;
+    size_t totalPages = 0;
+    for(auto module : CIter::modules(program)) {
+        if(module->getLibrary()->getRole() == Library::ROLE_EXTRA) continue;
+
+        size_t blocks = 0;
+        for(auto function : CIter::functions(module)) {
+            if(shouldInstrument(function)) {
+                blocks += function->getChildren()->getIterable()->getCount();
+            }
+        }
+        if(blocks == 0) continue;
+
+        size_t pages = (blocks + COUNTER_PAGE_SIZE - 1) / COUNTER_PAGE_SIZE;
+        wanted.push_back(std::make_pair(module, pages));
+        totalPages += pages;
+    }
+
+    const size_t mapPages = SHM_REGION_SIZE / COUNTER_PAGE_SIZE;
+    if(wanted.size() > mapPages) {
+        throw "AFLCoveragePass: too many modules for the coverage map";
+    }
+
+    size_t offset = 0;
+    for(size_t i = 0; i < wanted.size(); i++) {
+        auto module = wanted[i].first;
+        size_t pages = wanted[i].second;
+        if(totalPages > mapPages) {
+            // counters wrap around within smaller sections
+            pages = std::max<size_t>(1, pages * mapPages / totalPages);
+        }
+        size_t left = mapPages - offset / COUNTER_PAGE_SIZE;
+        pages = std::min(pages, left - (wanted.size() - i - 1));
+        size_t size = pages * COUNTER_PAGE_SIZE;
+
+        // the runtime maps the AFL shared memory over these sections
+        auto regionList = module->getDataRegionList();
+        auto region = new DataRegion(SHM_REGION + offset);
+        region->setPosition(new AbsolutePosition(SHM_REGION + offset));
+        regionList->getChildren()->add(region);
+        region->setParent(regionList);
+
+        auto section = new DataSection();
+        section->setName(COUNTER_SECTION_NAME);
+        section->setAlignment(COUNTER_PAGE_SIZE);
+        section->setPermissions(SHF_WRITE | SHF_ALLOC);
+        section->setPosition(new AbsoluteOffsetPosition(section, 0));
+        section->setType(DataSection::TYPE_DATA);
+        region->getChildren()->add(section);
+        section->setParent(region);
+
+        section->setSize(size);
+        region->setSize(size);
+        region->saveDataBytes(std::string(size, '\0'));
+
+        LOG(1, "AFLCoveragePass: " << module->getName() << " counters at 0x"
+            << std::hex << (SHM_REGION + offset) << std::dec
+            << ", " << size << " bytes");
+        counterSections[module] = CounterSection{section, offset, size, 0};
+        offset += size;
+    }
+}
+
+unsigned long AFLCoveragePass::makeBlockID(Module *module,
+    Function *function, address_t offset) {
 
-    ChunkAddInline ai({X86_REG_R10, X86_REG_EFLAGS}, [this] (unsigned int stackBytesAdded) {
+    // FNV-1a of the block's name, stable across runs
+    std::ostringstream name;
+    name << module->getName() << ":" << function->getName() << "+" << offset;
+    uint32_t hash = 2166136261u;
+    for(char c : name.str()) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+
+    // the low bits index the map, give each block its own while we can
+    const uint32_t mask = SHM_REGION_SIZE - 1;
+    uint32_t slot = hash & mask;
+    if(usedSlotCount < usedSlots.size()) {
+        while(usedSlots[slot]) slot = (slot + 1) & mask;
+        usedSlots[slot] = true;
+        usedSlotCount++;
+    }
+    return (hash & ~mask) | slot;
+}
+
+void AFLCoveragePass::addCoverageCode(Block *block, unsigned long blockID) {
+#ifdef ARCH_X86_64
+    // any caller-saved register will do, r10 is the traditional choice
+    ChunkAddInline ai(&scratchState, {X86_REG_R10, X86_REG_R11, X86_REG_RAX,
+        X86_REG_RCX, X86_REG_RDX, X86_REG_RSI, X86_REG_RDI, X86_REG_R8,
+        X86_REG_R9}, 1, true,
+        [blockID] (unsigned int stackBytesAdded, const std::vector<Register> &regs) {
+
+        auto reg = static_cast<x86_reg>(regs[0]);
 #if 1
 		//   0:   41 52                   push   %r10
 		//   2:   4c 8b 15 cc cc 0c 00    mov    0xccccc(%rip),%r10        # 0xcccd5
@@ -120,39 +394,27 @@ void AFLCoveragePass::addCoverageCode(Block *block) {
 		//  28:   41 5a                   pop    %r10
 
 
-        DisasmHandle handle(true);
-
 		//   2:   4c 8b 15 cc cc 0c 00    mov    0xccccc(%rip),%r10        # 0xcccd5
-        auto mov1Instr = new Instruction();
-        auto mov1Sem = new LinkedInstruction(mov1Instr);
-        mov1Sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x8b, 0x15, 0x00, 0x00, 0x00, 0x00}));
-        mov1Sem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
-        mov1Sem->setIndex(0);
-        mov1Instr->setSemantic(mov1Sem);
+        auto mov1Instr = X86Builder::mov(X86Memory::ripRelative(
+            new UnresolvedRelativeLink(SHM_QUEUE_PTR)), reg);
 
 		//  17:   49 d1 ea                shr    %r10
-        auto shrInstr = Disassemble::instruction({0x49, 0xd1, 0xea});
-
+        auto shrInstr = X86Builder::shr(1, reg);
 
 		//   c:   49 81 f2 11 11 11 11    xor    $0x11111111,%r10
-        auto xorInstr = Disassemble::instruction({0x49, 0x81, 0xf2, GET_BYTES(blockID)});
-
+        auto xorInstr = X86Builder::arithmetic(X86Builder::OP_XOR,
+            static_cast<int32_t>(blockID), reg);
 
         //  14:   4c 89 15 cc cc cc 00    mov    %r10,0xccccc(%rip)        # 0xddf8
-        auto mov2Instr = new Instruction();
-        auto mov2Sem = new LinkedInstruction(mov2Instr);
-        mov2Sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x89, 0x15, 0x00, 0x00, 0x00, 0x00}));
-        mov2Sem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
-        mov2Sem->setIndex(1);
-        mov2Instr->setSemantic(mov2Sem);
+        auto mov2Instr = X86Builder::mov(reg, X86Memory::ripRelative(
+            new UnresolvedRelativeLink(SHM_QUEUE_PTR)));
 
 		//  1a:   49 81 e2 ff ff 00 00    and    $0xffff,%r10
-        auto andInstr = Disassemble::instruction({0x49, 0x81, 0xe2, GET_BYTES(SHM_REGION_SIZE - 1)});
+        auto andInstr = X86Builder::arithmetic(X86Builder::OP_AND,
+            SHM_REGION_SIZE - 1, reg);
 
 		//  10:   41 fe 82 00 00 00 50    incb   0x50000000(%r10)
-        auto incInstr = Disassemble::instruction({0x41, 0xfe, 0x82, GET_BYTES(SHM_REGION)});
+        auto incInstr = X86Builder::incb(X86Memory(reg, SHM_REGION));
 
         return std::vector<Instruction *>{ mov1Instr, shrInstr, xorInstr, mov2Instr, andInstr, incInstr };
 #else  // 16-bit history version
@@ -164,43 +426,47 @@ void AFLCoveragePass::addCoverageCode(Block *block) {
 		//  1a:   4c 89 15 cc cc 0c 00    mov    %r10,0xccccc(%rip)        # 0xccced
 		//  21:   41 5a                   pop    %r10
 
-		blockID %= SHM_REGION_SIZE;
-
-        DisasmHandle handle(true);
-
 		//   2:   49 c7 c2 01 00 00 00    mov    $0x0001,%r10
-        auto mov1Instr = Disassemble::instruction({0x49, 0xc7, 0xc2, GET_BYTES(blockID)});
+        auto mov1Instr = X86Builder::mov(
+            static_cast<int32_t>(blockID % SHM_REGION_SIZE), reg);
 
 		//   9:   4c 33 15 cc cc 0c 00    xor    0xccccc(%rip),%r10        # 0xcccdc
-        auto xorInstr = new Instruction();
-        auto xorSem = new LinkedInstruction(xorInstr);
-        xorSem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x33, 0x15, 0x00, 0x00, 0x00, 0x00}));
-        xorSem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
-        xorSem->setIndex(0);
-        xorInstr->setSemantic(xorSem);
+        auto xorInstr = X86Builder::arithmetic(X86Builder::OP_XOR,
+            X86Memory::ripRelative(new UnresolvedRelativeLink(SHM_QUEUE_PTR)),
+            reg);
 
 		//  10:   41 fe 82 00 00 00 50    incb   0x50000000(%r10)
-        auto incInstr = Disassemble::instruction({0x41, 0xfe, 0x82, GET_BYTES(SHM_REGION)});
+        auto incInstr = X86Builder::incb(X86Memory(reg, SHM_REGION));
 
 		//  17:   49 d1 ea                shr    %r10
-        auto shrInstr = Disassemble::instruction({0x49, 0xd1, 0xea});
+        auto shrInstr = X86Builder::shr(1, reg);
 
         //  14:   4c 89 15 cc cc cc 00    mov    %r10,0xccccc(%rip)        # 0xddf8
-        auto mov2Instr = new Instruction();
-        auto mov2Sem = new LinkedInstruction(mov2Instr);
-        mov2Sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x89, 0x15, 0x00, 0x00, 0x00, 0x00}));
-        mov2Sem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
-        mov2Sem->setIndex(1);
-        mov2Instr->setSemantic(mov2Sem);
+        auto mov2Instr = X86Builder::mov(reg, X86Memory::ripRelative(
+            new UnresolvedRelativeLink(SHM_QUEUE_PTR)));
 
         return std::vector<Instruction *>{ mov1Instr, xorInstr, incInstr, shrInstr, mov2Instr };
 #endif
     });
 	auto instr1 = block->getChildren()->getIterable()->get(0);
     ai.insertBefore(instr1, true);
+#endif
 }
 
-#undef GET_BYTE
-#undef GET_BYTES
+void AFLCoveragePass::addCounterCode(Block *block, DataSection *section,
+    size_t index) {
+#ifdef ARCH_X86_64
+    ChunkAddInline ai(&scratchState, {}, 0, true,
+        [section, index] (unsigned int stackBytesAdded,
+            const std::vector<Register> &regs) {
+
+        //   0:   fe 05 00 00 00 00       incb   counter(%rip)
+        auto incInstr = X86Builder::incb(X86Memory::ripRelative(
+            new DataOffsetLink(section, index, Link::SCOPE_INTERNAL_DATA)));
+
+        return std::vector<Instruction *>{ incInstr };
+    });
+	auto instr1 = block->getChildren()->getIterable()->get(0);
+    ai.insertBefore(instr1, true);
+#endif
+}
@@ -1,20 +1,73 @@
 #ifndef EGALITO_PASS_AFL_COVERAGE_H
 #define EGALITO_PASS_AFL_COVERAGE_H
 
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
 #include "chunkpass.h"
+#include "operation/addinline.h"
 
+class DataSection;
+
+/** Adds AFL coverage instrumentation to every module but the injected
+    runtime. MODE_HASH folds each block's ID into a running hash and bumps
+    the map byte it selects, recording edges; MODE_COUNTERS gives each
+    block its own 8-bit counter in a per-module section placed inside the
+    map, recording block coverage with a single incb.
+
+    When pruned, only the blocks needed to reconstruct coverage are
+    instrumented: one block per superblock, and none for a superblock
+    whose every successor is entered only from it (the successor's probe
+    already implies the edge). Block IDs are derived from the function
+    name and block offset, so they are the same on every run.
+*/
 class AFLCoveragePass : public ChunkPass {
+public:
+    enum Mode {
+        MODE_HASH,
+        MODE_COUNTERS
+    };
 private:
+    struct BlockEntry {
+        unsigned long id;
+        std::string module;
+        std::string function;
+        address_t offset;
+    };
+    struct CounterSection {
+        DataSection *section;
+        size_t mapOffset;
+        size_t size;
+        size_t next;
+    };
+private:
+    Mode mode;
+    bool pruned;
     Function *entryPoint;
-    unsigned long blockID;
+    ChunkAddInline::ScratchState scratchState;
+    std::vector<bool> usedSlots;
+    size_t usedSlotCount;
+    std::vector<BlockEntry> idTable;
+    std::map<Module *, CounterSection> counterSections;
+    unsigned long blockCount;
+    unsigned long instrumentedCount;
 public:
-    AFLCoveragePass() : blockID(1) {}
+    AFLCoveragePass(Mode mode = MODE_HASH, bool pruned = false);
     virtual void visit(Program *program);
     virtual void visit(Module *module);
     virtual void visit(Function *function);
-    virtual void visit(Block *block);
+
+    /** One line per instrumented block: ID, module, function, offset. */
+    void writeIDTable(std::ostream &stream) const;
 private:
-    void addCoverageCode(Block *block);
+    bool shouldInstrument(Function *function);
+    std::vector<Block *> selectBlocks(Function *function);
+    void allocateCounterSections(Program *program);
+    unsigned long makeBlockID(Module *module, Function *function,
+        address_t offset);
+    void addCoverageCode(Block *block, unsigned long blockID);
+    void addCounterCode(Block *block, DataSection *section, size_t index);
 };
 
 
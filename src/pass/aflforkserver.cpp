@@ -0,0 +1,170 @@
+#include "aflforkserver.h"
+#include "chunk/concrete.h"
+#include "instr/builder.h"
+#include "instr/concrete.h"
+#include "operation/find2.h"
+#include "operation/mutator.h"
+
+#include "log/log.h"
+
+#ifdef ARCH_X86_64
+namespace {
+
+// changes %rsp by a constant: push, pop, or add/sub of an immediate
+bool getStackChange(const AssemblyPtr &assembly, long &change) {
+    switch(assembly->getId()) {
+    case X86_INS_PUSH:  change = 8;  return true;
+    case X86_INS_POP:   change = -8; return true;
+    case X86_INS_ADD:
+    case X86_INS_SUB:
+        break;
+    default:
+        return false;
+    }
+
+    auto ops = assembly->getAsmOperands();
+    if(ops->getOpCount() != 2) return false;
+    const auto &source = ops->getOperands()[0];
+    const auto &dest = ops->getOperands()[1];
+    if(source.type != X86_OP_IMM || dest.type != X86_OP_REG
+        || dest.reg != X86_REG_RSP) {
+
+        return false;
+    }
+    change = (assembly->getId() == X86_INS_SUB) ? source.imm : -source.imm;
+    return true;
+}
+
+bool writesStackPointer(const AssemblyPtr &assembly) {
+    auto ops = assembly->getAsmOperands();
+    size_t count = ops->getOpCount();
+    if(count > 0 && ops->getOperands()[count - 1].type == X86_OP_REG
+        && ops->getOperands()[count - 1].reg == X86_REG_RSP) {
+
+        return true;
+    }
+    for(size_t k = 0; k < assembly->getImplicitRegsWriteCount(); k++) {
+        if(assembly->getImplicitRegsWrite()[k] == X86_REG_RSP) return true;
+    }
+    return false;
+}
+
+/*  Whether the function may use arguments passed on the stack, i.e. access
+    memory above its return address. %rsp is followed from the entry in
+    layout order until the first jump or unknown change; a frame pointer
+    copied from %rsp while it was known is trusted for the whole function.
+    This catches the usual prologues, not every way of reaching the
+    caller's frame.
+*/
+bool usesStackArguments(Function *function) {
+    long depth = 0;     // bytes pushed or allocated since the entry
+    bool known = true;
+    long frame = -1;    // depth when %rbp was set from %rsp
+
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto semantic = instr->getSemantic();
+            if(semantic->isControlFlow()) {
+                // a call leaves %rsp as it was, a jump may not
+                auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic);
+                if(!dynamic_cast<IndirectCallInstruction *>(semantic)
+                    && !(cfi && cfi->getId() == X86_INS_CALL)) {
+
+                    known = false;
+                }
+                continue;
+            }
+            auto assembly = semantic->getAssembly();
+            if(!assembly) {
+                known = false;
+                continue;
+            }
+
+            auto ops = assembly->getAsmOperands();
+            for(size_t k = 0; k < ops->getOpCount(); k++) {
+                const auto &op = ops->getOperands()[k];
+                if(op.type != X86_OP_MEM) continue;
+                if(op.mem.base == X86_REG_RSP && known
+                    && op.mem.disp >= depth + 8) {
+
+                    return true;
+                }
+                if(op.mem.base == X86_REG_RBP && frame >= 0
+                    && op.mem.disp >= frame + 8) {
+
+                    return true;
+                }
+            }
+
+            if(!known) continue;
+            long change;
+            if(getStackChange(assembly, change)) {
+                depth += change;
+            }
+            else if(writesStackPointer(assembly)) {
+                known = false;
+            }
+            else if(assembly->getId() == X86_INS_MOV
+                && ops->getMode() == AssemblyOperands::MODE_REG_REG
+                && ops->getOperands()[0].reg == X86_REG_RSP
+                && ops->getOperands()[1].reg == X86_REG_RBP) {
+
+                frame = depth;
+            }
+        }
+    }
+    return false;
+}
+
+}  // anonymous namespace
+#endif
+
+void AFLForkServerPass::visit(Program *program) {
+#ifdef ARCH_X86_64
+    auto entryFunc = ChunkFind2(program).findFunction(
+        "egalito_forkserver_entry");
+    if(!entryFunc) {
+        throw "AFLForkServerPass: libcoverage.so has no fork server";
+    }
+
+    auto function = ChunkFind2(program).findFunction(
+        functionName.c_str(), program->getMain());
+    if(!function) {
+        LOG(0, "AFLForkServerPass: no function named " << functionName);
+        throw "AFLForkServerPass: fork server function not found";
+    }
+    if(iterations > 0x7fffffff) {
+        throw "AFLForkServerPass: too many persistent iterations";
+    }
+    if(iterations > 1 && usesStackArguments(function)) {
+        // the persistent loop re-enters the body from another frame
+        LOG(0, "AFLForkServerPass: " << function->getName()
+            << " takes arguments on the stack");
+        throw "AFLForkServerPass: persistent mode needs register arguments";
+    }
+
+    // The entry code finds the iteration count above its return address,
+    // and re-enters the function just past the call.
+    //     push $iterations
+    //     call egalito_forkserver_entry
+    auto pushInstr = X86Builder::push(static_cast<int32_t>(iterations));
+
+    auto call = new Instruction();
+    auto callSem = new ControlFlowInstruction(
+        X86_INS_CALL, call, "\xe8", "callq", 4);
+    callSem->setLink(new NormalLink(entryFunc, Link::SCOPE_EXTERNAL_JUMP));
+    call->setSemantic(callSem);
+
+    auto block = function->getChildren()->getIterable()->get(0);
+    {
+        ChunkMutator m(block, true);
+        m.prepend(call);
+        m.prepend(pushInstr);
+    }
+
+    LOG(1, "AFLForkServerPass: fork server at " << function->getName()
+        << ", " << iterations << " iteration(s) per fork");
+#else
+    LOG(0, "AFLForkServerPass: only supported on x86_64");
+#endif
+}
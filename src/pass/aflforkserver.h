@@ -0,0 +1,32 @@
+#ifndef EGALITO_PASS_AFL_FORK_SERVER_H
+#define EGALITO_PASS_AFL_FORK_SERVER_H
+
+#include <string>
+#include "chunkpass.h"
+
+/** Starts an AFL fork server when the named function is first entered,
+    so each run forks from a process that has already been loaded and
+    initialized instead of being exec'd from scratch. Uses
+    egalito_forkserver_entry from libcoverage.so.
+
+    With more than one iteration, each forked child runs the function body
+    that many times (AFL's persistent mode), stopping itself in between.
+    The function must then be safe to re-run with the same arguments. The
+    body is re-entered with the saved argument registers (including
+    xmm0-7) and its return value is kept from rax, rdx, xmm0 and xmm1, so
+    a function that takes arguments on the stack is refused. A long double
+    result (returned on the x87 stack) is not kept.
+*/
+class AFLForkServerPass : public ChunkPass {
+private:
+    std::string functionName;
+    unsigned long iterations;
+public:
+    AFLForkServerPass(const std::string &functionName = "main",
+        unsigned long iterations = 1)
+        : functionName(functionName), iterations(iterations) {}
+
+    virtual void visit(Program *program);
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <set>
+#include "alignloops.h"
+#include "promotejumps.h"
+#include "analysis/controlflow.h"
+#include "analysis/dominance.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+#include "transform/alignment.h"
+#include "log/log.h"
+
+void AlignLoopsPass::visit(Module *module) {
+    padded = 0;
+    recurse(module->getFunctionList());
+    LOG(1, "aligned loops in " << module->getName() << " with "
+        << padded << " bytes of padding");
+}
+
+void AlignLoopsPass::visit(Function *function) {
+#ifdef ARCH_X86_64
+    size_t alignment = policy->getLoopAlignment(function);
+    if(alignment <= 1) return;
+
+    auto headers = findLoopHeaders(function);
+    if(headers.empty()) return;
+
+    std::map<Block *, Block *> padding;
+    for(;;) {
+        pad(function, headers, alignment, padding);
+
+        size_t size = function->getSize();
+        PromoteJumpsPass promoteJumps;
+        function->accept(&promoteJumps);
+        if(function->getSize() == size) break;
+    }
+    if(padding.empty()) return;
+
+    policy->requireAlignment(function, alignment);
+    for(auto it : padding) padded += it.second->getSize();
+    LOG(10, "aligned " << padding.size() << " of " << headers.size()
+        << " loops in " << function->getName());
+#endif
+}
+
+std::vector<Block *> AlignLoopsPass::findLoopHeaders(Function *function) {
+    ControlFlowGraph cfg(function);
+    Dominance dominance(&cfg);
+
+    std::set<Block *> found;
+    for(size_t id = 1; id < cfg.getCount(); id++) {
+        auto node = cfg.get(id);
+        for(auto link : node->backwardLinks()) {
+            if(dominance.dominates(id, link->getTargetID())) {
+                found.insert(node->getBlock());
+                break;
+            }
+        }
+    }
+
+    // in layout order, since padding one header moves the ones after it
+    std::vector<Block *> headers;
+    for(auto block : CIter::children(function)) {
+        if(found.count(block) && block->getPreviousSibling()) {
+            headers.push_back(block);
+        }
+    }
+    return headers;
+}
+
+void AlignLoopsPass::pad(Function *function,
+    const std::vector<Block *> &headers, size_t alignment,
+    std::map<Block *, Block *> &padding) {
+
+    for(auto header : headers) {
+        auto it = padding.find(header);
+        Block *block = (it != padding.end() ? (*it).second : nullptr);
+        size_t current = block ? block->getSize() : 0;
+
+        address_t offset = header->getAddress() - function->getAddress()
+            - current;
+        size_t wanted = (alignment - offset % alignment) % alignment;
+        if(wanted > policy->getLoopMaxSkip()) wanted = 0;
+        if(wanted == current) continue;
+
+        if(block) {
+            ChunkMutator(function).remove(block);
+            padding.erase(it);
+        }
+        if(!wanted) continue;
+
+        // the NOPs get a block of their own right before the header, so no
+        // other block has anything after its terminator. They are only
+        // executed when falling into the loop.
+        block = new Block();
+        for(size_t left = wanted; left > 0; ) {
+            size_t size = std::min(left, AlignmentPolicy::getMaxNopSize());
+            auto semantic = new IsolatedInstruction();
+            semantic->setData(AlignmentPolicy::makeNop(size));
+            semantic->clearAssembly();
+
+            auto nop = new Instruction();
+            nop->setSemantic(semantic);
+            ChunkMutator(block).append(nop);
+            left -= size;
+        }
+        ChunkMutator(function).insertBefore(header, block);
+        padding[header] = block;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef EGALITO_PASS_ALIGN_LOOPS_H
+#define EGALITO_PASS_ALIGN_LOOPS_H
+
+#include <map>
+#include <vector>
+#include "chunkpass.h"
+
+class AlignmentPolicy;
+
+/** Inserts a block of NOPs before each loop header so that the header
+    starts at an alignment boundary relative to its function, then tells the
+    policy that the function itself must be aligned at least that much. A header is a
+    block that dominates one of its predecessors.
+
+    Padding can push short jumps out of range, so jumps are promoted and the
+    padding recomputed until nothing changes. Run this right before
+    addresses are assigned; only x86-64 is handled.
+*/
+class AlignLoopsPass : public ChunkPass {
+private:
+    AlignmentPolicy *policy;
+    size_t padded;
+public:
+    AlignLoopsPass(AlignmentPolicy *policy) : policy(policy), padded(0) {}
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+private:
+    std::vector<Block *> findLoopHeaders(Function *function);
+    void pad(Function *function, const std::vector<Block *> &headers,
+        size_t alignment, std::map<Block *, Block *> &padding);
+};
+
+#endif
@@ -16,6 +16,17 @@ protected:
             child->accept(this);
         }
     }
+    void recurse(FunctionList *root) {
+        if(!EgalitoProfiler::isEnabled(EgalitoProfiler::LEVEL_FUNCTION)) {
+            recurse<FunctionList>(root);
+            return;
+        }
+        for(auto child : root->getChildren()->genericIterable()) {
+            ProfileScope profile(child->getName(),
+                EgalitoProfiler::LEVEL_FUNCTION);
+            child->accept(this);
+        }
+    }
 public:
     virtual void visit(Program *program) { recurse(program); }
     virtual void visit(Module *module) { recurse(module); }
@@ -175,7 +175,7 @@ void EndbrEnforcePass::makeEnforcementCode(Instruction *point) {
     }
 
     // jmpq *%r11 / callq *%r11
-    static DisasmHandle handle(true);
+    thread_local DisasmHandle handle(true);
     AssemblyPtr newAssembly;
     InstructionSemantic *newSem = nullptr;
     if(dynamic_cast<IndirectJumpInstruction *>(semantic)) {
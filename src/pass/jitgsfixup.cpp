@@ -1,5 +1,8 @@
 #include <pthread.h>
+#include <sys/mman.h>
 #include <cstring>
+#include <set>
+#include <vector>
 #include <cassert>
 #include "jitgsfixup.h"
 #include "chunk/concrete.h"
@@ -13,6 +16,7 @@
 #include "operation/mutator.h"
 #include "cminus/print.h"
 #include "snippet/hook.h"
+#include "runtime/jitstats.h"
 #include "runtime/managegs.h"
 #include "transform/generator.h"
 #include "transform/sandbox.h"
@@ -21,7 +25,49 @@
 #include "util/timing.h"
 #include "log/log.h"
 
+extern ConductorSetup *egalito_conductor_setup;
 Chunk *egalito_gsCallback __attribute__((weak));
+bool egalito_jit_async_reset __attribute__((weak));
+
+size_t egalito_jit_fanout __attribute__((weak));
+size_t egalito_jit_epoch_group_size __attribute__((weak));
+size_t egalito_jit_reset_functions __attribute__((weak));
+JITBatchStatistics egalito_jit_batch_stats;
+
+// Generates up to budget callees of the entry at index, breadth first, that
+// still hold the pending (fixup) address. Returns how many were generated
+// and adds their code size to bytes.
+static size_t generateCallees(Generator &generator, GSTable *gsTable,
+    GSTableEntry::IndexType index, address_t pending, size_t budget,
+    size_t &bytes) {
+
+    auto array = static_cast<address_t *>(gsTable->getTableAddress());
+    std::vector<GSTableEntry::IndexType> queue(1, index);
+    size_t generated = 0;
+    for(size_t q = 0; q < queue.size() && generated < budget; q++) {
+        auto entry = gsTable->getAtIndex(queue[q]);
+        for(auto callee : entry->getCallees()) {
+            if(generated == budget) break;
+            if(array[callee] != pending) continue;  // already generated
+
+            auto target = gsTable->getAtIndex(callee)->getTarget();
+            if(auto f = dynamic_cast<Function *>(target)) {
+                generator.assignAndGenerate(f);
+            }
+            else if(auto t = dynamic_cast<PLTTrampoline *>(target)) {
+                generator.assignAndGenerate(t);
+            }
+            else continue;
+
+            ManageGS::setEntry(gsTable, callee, target->getAddress());
+            PositionManager::setAddress(target, 0);
+            queue.push_back(callee);
+            bytes += target->getSize();
+            generated++;
+        }
+    }
+    return generated;
+}
 
 extern "C"
 size_t egalito_jit_gs_fixup(size_t offset) {
@@ -30,26 +76,55 @@ size_t egalito_jit_gs_fixup(size_t offset) {
     //egalito_printf("index=%d\n", (int)index);
     //egalito_printf("(JIT-fixup index=%d ", (int)index);
 
-    auto target = ManageGS::resolve(gsTable, index);
+    // every entry not generated in this epoch holds the same fixup address
+    address_t pending = egalito_gsCallback->getAddress();
+
+    auto group = EgalitoTLS::getEpochGroup();
+    if(group) {
+        group->acquire();
+        // another member may have generated it while we were waiting
+        if(ManageGS::getEntry(offset) != pending) {
+            group->release();
+            return offset;
+        }
+    }
+
+    // in a shared epoch, no placeholder address may become visible
+    auto target = group ? gsTable->getAtIndex(index)->getTarget()
+        : ManageGS::resolve(gsTable, index);
     //egalito_printf("target=[%s])\n", target->getName().c_str());
+    __atomic_fetch_add(&egalito_jit_batch_stats.traps, 1, __ATOMIC_RELAXED);
 
     Function *targetFunction = dynamic_cast<Function *>(target);
     PLTTrampoline *targetTrampoline = dynamic_cast<PLTTrampoline *>(target);
 
     address_t address;
+    size_t bytes = 0;
     if(targetFunction || targetTrampoline) {
         auto sandbox = EgalitoTLS::getSandbox();
         sandbox->reopen();
         Generator generator(sandbox, true);
+        // functions whose loops AlignLoopsPass padded must stay aligned
+        generator.setAlignmentPolicy(
+            egalito_conductor_setup->getAlignmentPolicy());
         if(targetFunction) {
             generator.assignAndGenerate(targetFunction);
         }
         else {
             generator.assignAndGenerate(targetTrampoline);
         }
-        sandbox->finalize();
         address = target->getAddress();
         PositionManager::setAddress(target, 0);
+        bytes = target->getSize();
+
+        // generate likely callees now rather than trapping on each one
+        if(egalito_jit_fanout > 0) {
+            auto count = generateCallees(generator, gsTable, index, pending,
+                egalito_jit_fanout, bytes);
+            __atomic_fetch_add(&egalito_jit_batch_stats.batched, count,
+                __ATOMIC_RELAXED);
+        }
+        sandbox->finalize();
     }
     else {
         if(dynamic_cast<Instruction *>(target)) {
@@ -67,32 +142,254 @@ size_t egalito_jit_gs_fixup(size_t offset) {
 
     //egalito_printf("%lx\n", address);
     ManageGS::setEntry(gsTable, index, address);
+    if(group) group->release();
+    JITStatistics::recordFixup(index, bytes);
     return offset;
 }
 
-extern "C"
-void egalito_jit_gs_init(ShufflingSandbox *sandbox, GSTable *gsTable) {
+// Regenerates every entry before the JIT range into sandbox. The new
+// addresses are recorded in the calling thread's JIT address table.
+// Returns the size of the generated code.
+template <typename SandboxType>
+static size_t generateEpoch(SandboxType *sandbox, GSTable *gsTable) {
     sandbox->reopen();
     sandbox->recreate();
     Generator generator(sandbox, true);
+    generator.setAlignmentPolicy(
+        egalito_conductor_setup->getAlignmentPolicy());
+    size_t bytes = 0;
     for(auto gsEntry : CIter::children(gsTable)) {
         if(gsEntry->getIndex() == gsTable->getJITStartIndex()) break;
 
         auto target = gsEntry->getTarget();
         if(auto f = dynamic_cast<Function *>(target)) {
             generator.assignAndGenerate(f);
+            bytes += f->getSize();
         }
         else if(auto trampoline = dynamic_cast<PLTTrampoline *>(target)) {
             generator.assignAndGenerate(trampoline);
+            bytes += trampoline->getSize();
         }
     }
     sandbox->finalize();
+    return bytes;
+}
+
+static void publishEpoch(GSTable *gsTable) {
     ManageGS::resetEntries(gsTable, egalito_gsCallback);
     explicit_bzero(EgalitoTLS::getJITAddressTable(), JIT_TABLE_SIZE);
+}
+
+static size_t initEpoch(ShufflingSandbox *sandbox, GSTable *gsTable) {
+    auto bytes = generateEpoch(sandbox, gsTable);
+    publishEpoch(gsTable);
     sandbox->flip();
     sandbox->reopen();
     sandbox->recreate();
     sandbox->finalize();
+    return bytes;
+}
+
+extern "C"
+void egalito_jit_gs_init(ShufflingSandbox *sandbox, GSTable *gsTable) {
+    initEpoch(sandbox, gsTable);
+}
+
+/** State shared with a background shuffling thread. Each thread that
+    resets starts its own shuffler, which generates the next epoch into the
+    inactive half of that thread's sandbox, so a reset only has to publish
+    it. The shuffler is found through EgalitoTLS, so creating one never
+    races with another thread.
+*/
+struct JITShuffler {
+    enum State { STATE_IDLE, STATE_REQUESTED, STATE_READY };
+
+    ShufflingSandbox *sandbox;
+    GSTable *gsTable;
+    address_t *staging;     // JIT address table of the prepared epoch
+    size_t bytes;           // code size of the prepared epoch
+    State state;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+static void *shufflerMain(void *arg) {
+    auto shuffler = static_cast<JITShuffler *>(arg);
+    auto ownTable = EgalitoTLS::getJITAddressTable();
+    for(;;) {
+        pthread_mutex_lock(&shuffler->mutex);
+        while(shuffler->state != JITShuffler::STATE_REQUESTED) {
+            pthread_cond_wait(&shuffler->cond, &shuffler->mutex);
+        }
+        pthread_mutex_unlock(&shuffler->mutex);
+
+        // the generator records addresses in this thread's table
+        EgalitoTLS::setJITAddressTable(shuffler->staging);
+        auto bytes = generateEpoch(shuffler->sandbox->getInactive(),
+            shuffler->gsTable);
+        EgalitoTLS::setJITAddressTable(ownTable);
+
+        pthread_mutex_lock(&shuffler->mutex);
+        shuffler->bytes = bytes;
+        shuffler->state = JITShuffler::STATE_READY;
+        pthread_mutex_unlock(&shuffler->mutex);
+    }
+    return nullptr;
+}
+
+static void requestEpoch(JITShuffler *shuffler) {
+    pthread_mutex_lock(&shuffler->mutex);
+    shuffler->state = JITShuffler::STATE_REQUESTED;
+    pthread_cond_signal(&shuffler->cond);
+    pthread_mutex_unlock(&shuffler->mutex);
+}
+
+extern "C" int egalito_pthread_create(pthread_t *thread,
+    const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg);
+
+// start is when the reset began, or 0 if statistics are off.
+static void recordReset(uint64_t start, size_t bytes) {
+    if(start) JITStatistics::recordReset(JITStatistics::now() - start, bytes);
+}
+
+static void startShuffler(ShufflingSandbox *sandbox, GSTable *gsTable,
+    uint64_t start) {
+
+    // Lay out this epoch and all code JIT'd during it in the current half,
+    // leaving the other half free for the shuffler.
+    auto bytes = generateEpoch(sandbox, gsTable);
+    publishEpoch(gsTable);
+    auto inactive = sandbox->getInactive();
+    inactive->reopen();
+    inactive->recreate();
+    inactive->finalize();
+    recordReset(start, bytes);
+
+    auto shuffler = new JITShuffler();
+    shuffler->sandbox = sandbox;
+    shuffler->gsTable = gsTable;
+    shuffler->staging = static_cast<address_t *>(mmap(NULL, JIT_TABLE_SIZE,
+        PROT_READ|PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    shuffler->state = JITShuffler::STATE_REQUESTED;
+    pthread_mutex_init(&shuffler->mutex, nullptr);
+    pthread_cond_init(&shuffler->cond, nullptr);
+    EgalitoTLS::setJITShuffler(shuffler);
+
+    pthread_t thread;
+    egalito_pthread_create(&thread, nullptr, shufflerMain, shuffler);
+}
+
+static void resetAsync(ShufflingSandbox *sandbox, GSTable *gsTable,
+    uint64_t start) {
+
+    auto shuffler = EgalitoTLS::getJITShuffler();
+    if(!shuffler) {
+        startShuffler(sandbox, gsTable, start);
+        return;
+    }
+
+    pthread_mutex_lock(&shuffler->mutex);
+    bool ready = (shuffler->state == JITShuffler::STATE_READY);
+    pthread_mutex_unlock(&shuffler->mutex);
+
+    // keep the current layout until the next one is ready
+    if(!ready) return;
+
+    // new JIT'd code goes after the prepared epoch; the old half is free
+    sandbox->flip();
+    std::memcpy(EgalitoTLS::getJITAddressTable(), shuffler->staging,
+        gsTable->getJITStartIndex() * sizeof(address_t));
+    publishEpoch(gsTable);
+    recordReset(start, shuffler->bytes);
+
+    requestEpoch(shuffler);
+}
+
+// Unpublishes up to count JIT'd entries, round robin, so that each is
+// generated again (at a new address) the next time it is called. Only the
+// current half is touched: entries before the JIT range keep their epoch
+// layout. Code may still be running from an unpublished slot until the
+// next reset point, so slots are freed one reset point later.
+static size_t resetFunctions(ShufflingSandbox *sandbox, GSTable *gsTable,
+    size_t count) {
+
+    sandbox->freeRetired();
+
+    auto array = static_cast<address_t *>(gsTable->getTableAddress());
+    address_t pending = egalito_gsCallback->getAddress();
+    auto jitStart = gsTable->getJITStartIndex();
+    auto jitEnd = gsTable->getChildren()->getIterable()->getCount();
+
+    auto cursor = EgalitoTLS::getJITResetCursor();
+    size_t retired = 0;
+    for(size_t n = jitStart; n < jitEnd && retired < count; n++) {
+        if(cursor < jitStart || cursor >= jitEnd) cursor = jitStart;
+        auto index = cursor++;
+        if(array[index] == pending) continue;
+
+        auto target = gsTable->getAtIndex(index)->getTarget();
+        if(!dynamic_cast<Function *>(target)
+            && !dynamic_cast<PLTTrampoline *>(target)) continue;
+
+        sandbox->retire(Slot(array[index], target->getSize()));
+        ManageGS::setEntry(gsTable, index, pending);
+        retired++;
+    }
+    EgalitoTLS::setJITResetCursor(cursor);
+    return retired;
+}
+
+// How long a member waits at the group reset barrier before giving up.
+#define GROUP_RESET_SPINS   (1 << 16)
+
+// Members of an epoch group all run the shared epoch's code, so it may only
+// be regenerated while every member is stopped at a reset point. Each member
+// that reaches one while a reset is requested waits here; the last live
+// member to arrive regenerates the epoch and releases the rest. A member
+// that never arrives (blocked in a syscall, say) must not stall the others
+// for long, so waiting is bounded: on timeout the member leaves the barrier,
+// and the last one to leave withdraws the request until the next threshold.
+//
+// This weakens re-randomization: a group with any member that is blocked
+// for long (a server thread in epoll_wait, say) keeps its layout until
+// every member reaches a reset point close enough together. Timeouts and
+// dropped resets are counted in the JIT statistics file.
+static void resetGroup(JITEpochGroup *group, uint64_t start) {
+    group->acquireBarrier();
+    __atomic_store_n(&group->resetRequested, 1, __ATOMIC_RELAXED);
+    auto generation = group->generation;
+    group->arrived++;
+    if(group->arrived >= group->pruneExited()) {
+        auto bytes = initEpoch(group->sandbox, group->gsTable);
+        recordReset(start, bytes);
+        group->arrived = 0;
+        __atomic_store_n(&group->resetRequested, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&group->generation, generation + 1,
+            __ATOMIC_RELEASE);
+        group->releaseBarrier();
+        return;
+    }
+    group->releaseBarrier();
+
+    for(size_t spin = 0; spin < GROUP_RESET_SPINS; spin++) {
+        if(__atomic_load_n(&group->generation, __ATOMIC_ACQUIRE)
+            != generation) {
+
+            return;
+        }
+#ifdef ARCH_X86_64
+        __asm__ __volatile__ ("pause");
+#endif
+    }
+
+    bool dropped = false;
+    group->acquireBarrier();
+    if(group->generation == generation && --group->arrived == 0) {
+        __atomic_store_n(&group->resetRequested, 0, __ATOMIC_RELAXED);
+        dropped = true;
+    }
+    group->releaseBarrier();
+    JITStatistics::recordGroupResetTimeout(dropped);
 }
 
 extern "C"
@@ -105,19 +402,43 @@ void egalito_jit_gs_reset(void) {
     }
     t = new EgalitoTiming("from previous reset");
 #endif
+    // a member of a group also stops here when another member asked
+    auto group = EgalitoTLS::getEpochGroup();
+    bool requested = group
+        && __atomic_load_n(&group->resetRequested, __ATOMIC_RELAXED);
+
     auto counter = EgalitoTLS::getJITResetCounter();
     auto threshold = EgalitoTLS::getJITResetThreshold();
     counter++;
-    if(counter < threshold) {
+    if(counter < threshold && !requested) {
         EgalitoTLS::setJITResetCounter(counter);
         return;
     }
     EgalitoTLS::setJITResetCounter(0);
+
     //egalito_printf("resetting...\n");
+    uint64_t start = EgalitoTLS::getJITStatistics() ? JITStatistics::now() : 0;
+    if(group) {
+        resetGroup(group, start);
+        return;
+    }
+
     auto sandbox = EgalitoTLS::getSandbox();
     auto gsTable = EgalitoTLS::getGSTable();
 
-    egalito_jit_gs_init(sandbox, gsTable);
+    if(egalito_jit_reset_functions > 0) {
+        resetFunctions(sandbox, gsTable, egalito_jit_reset_functions);
+        recordReset(start, 0);
+        return;
+    }
+
+    if(egalito_jit_async_reset) {
+        resetAsync(sandbox, gsTable, start);
+        return;
+    }
+
+    auto bytes = initEpoch(sandbox, gsTable);
+    recordReset(start, bytes);
 }
 
 extern "C"
@@ -154,8 +475,34 @@ void JitGSFixup::visit(Program *program) {
     assert(callback);
     ::egalito_gsCallback = callback;
 
+    ::egalito_jit_epoch_group_size
+        = getFeatureValue("EGALITO_JIT_SHARED_EPOCH", 0);
+
     if(isFeatureEnabled("EGALITO_USE_SHUFFLING")) {
         addResetCalls();
+        ::egalito_jit_async_reset
+            = isFeatureEnabled("EGALITO_USE_ASYNC_SHUFFLING");
+        if(::egalito_jit_async_reset && ::egalito_jit_epoch_group_size > 1) {
+            LOG(0, "WARNING: shared JIT epochs are reset together,"
+                " ignoring EGALITO_USE_ASYNC_SHUFFLING");
+            ::egalito_jit_async_reset = false;
+        }
+
+        ::egalito_jit_reset_functions
+            = getFeatureValue("EGALITO_JIT_RESET_FUNCTIONS", 0);
+        if(::egalito_jit_reset_functions > 0
+            && (::egalito_jit_async_reset
+                || ::egalito_jit_epoch_group_size > 1)) {
+
+            LOG(0, "WARNING: EGALITO_JIT_RESET_FUNCTIONS needs a private,"
+                " synchronous epoch; ignoring it");
+            ::egalito_jit_reset_functions = 0;
+        }
+    }
+
+    ::egalito_jit_fanout = getFeatureValue("EGALITO_JIT_FANOUT", 0);
+    if(::egalito_jit_fanout > 0) {
+        addCallees();
     }
 
     auto hook = ChunkFind2(conductor).findFunctionInModule(
@@ -194,6 +541,40 @@ void JitGSFixup::addResetCalls() {
 #endif
 }
 
+void JitGSFixup::addCallees() {
+    // calls have already been rewritten to go through the GS table, so the
+    // direct call graph is read off the GSTableLinks
+    auto jitStart = gsTable->getJITStartIndex();
+    for(auto entry : CIter::children(gsTable)) {
+        if(entry->getIndex() < jitStart) continue;
+        auto function = dynamic_cast<Function *>(entry->getTarget());
+        if(!function) continue;
+
+        std::set<GSTableEntry::IndexType> seen;
+        for(auto block : CIter::children(function)) {
+            for(auto instr : CIter::children(block)) {
+                auto link = dynamic_cast<GSTableLink *>(
+                    instr->getSemantic()->getLink());
+                if(!link) continue;
+
+                auto callee = link->getEntry();
+                auto calleeIndex = callee->getIndex();
+                if(calleeIndex < jitStart || callee == entry) continue;
+                if(!dynamic_cast<Function *>(callee->getTarget())
+                    && !dynamic_cast<PLTTrampoline *>(callee->getTarget())) {
+
+                    continue;
+                }
+                if(seen.insert(calleeIndex).second) {
+                    entry->addCallee(calleeIndex);
+                }
+            }
+        }
+        LOG(10, "JIT batch: " << function->getName() << " has "
+            << seen.size() << " callees");
+    }
+}
+
 void JitGSFixup::addAfterSyscall(const char *name, Module *module,
     Chunk *target, bool firstOnly) {
 
@@ -7,6 +7,15 @@ class Conductor;
 class GSTable;
 class Module;
 
+/** Counters for lazy JIT generation: traps are GS table misses, batched are
+    callees generated ahead of time alongside a trapping function.
+*/
+struct JITBatchStatistics {
+    size_t traps;
+    size_t batched;
+};
+extern JITBatchStatistics egalito_jit_batch_stats;
+
 class JitGSFixup : public ChunkPass {
 private:
     Conductor *conductor;
@@ -18,6 +27,7 @@ public:
     virtual void visit(Program *program);
 private:
     void addResetCalls();
+    void addCallees();
     void addAfterFirstSyscall(const char *name, Module *module, Chunk *target);
     void addAfterEverySyscall(const char *name, Module *module, Chunk *target);
     void addAfterSyscall(const char *name, Module *module, Chunk *target,
@@ -92,6 +92,7 @@ void JitGSSetup::makeResolverGSEntries(Module *egalito) {
 
         "DualSandbox",
         "WatermarkAllocator",
+        "FreeListAllocator",
 
         //"EgalitoTLS",
 
@@ -123,7 +124,8 @@ void JitGSSetup::makeResolverGSEntries(Module *egalito) {
         "_ZNK22ChunkPositionDecoratorI9ChunkImplE11getPositionEv",
         "_ZNK9ChunkImpl10getAddressEv",
         //"_ZNK14DataOffsetLink16getTargetAddressEv",
-        "_ZN11DualSandboxI11SandboxImplI13MemoryBacking18WatermarkAllocatorIS1_EEE8allocateEm",
+        "_ZN11DualSandboxI11SandboxImplI17DualMappedBacking17FreeListAllocatorIS1_EEE8allocateEm",
+        "_ZN11DualSandboxI11SandboxImplI17DualMappedBacking17FreeListAllocatorIS1_EEE8allocateEmm",
         "_ZNK11GSTableLink16getTargetAddressEv",
         //"_ZNK11Instruction7getSizeEv",
         //"_ZN17LinkedInstruction6acceptEP18InstructionVisitor",
@@ -1,13 +1,13 @@
 #include "makecache.h"
 
 void MakeCachePass::visit(Function *function) {
-#ifdef ARCH_X86_64
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
     function->makeCache();
 #endif
 }
 
 void MakeCachePass::visit(PLTTrampoline *trampoline) {
-#ifdef ARCH_X86_64
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
     trampoline->makeCache();
 #endif
 }
@@ -125,11 +125,8 @@ bool NonReturnFunction::neverReturns(Function *function) {
                     }
                     //Dominance dom(cfg);
                     if(!dom) dom = new Dominance(cfg);
-                    auto pdom = dom->getPostDominators(0);
                     auto nid = cfg->getIDFor(block);
-                    if(std::find(pdom.begin(), pdom.end(), nid) == pdom.end()) {
-                        continue;
-                    }
+                    if(!dom->postDominates(nid, 0)) continue;
 
                     delete cfg;
                     delete dom;
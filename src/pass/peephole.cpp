@@ -0,0 +1,401 @@
+#include <capstone/x86.h>
+#include "peephole.h"
+#include "analysis/liveregister.h"
+#include "disasm/disassemble.h"
+#include "instr/concrete.h"
+#include "instr/register.h"
+#include "operation/mutator.h"
+#include "log/log.h"
+
+#ifdef ARCH_X86_64
+namespace {
+
+const int INVALID = X86Register::INVALID;
+const int FLAGS = X86Register::FLAGS;
+const int SP = X86Register::SP;
+
+int physical(int reg) {
+    if(reg == X86_REG_EFLAGS) return FLAGS;
+    if(reg == X86_REG_INVALID) return INVALID;
+    return X86Register::convertToPhysical(reg);
+}
+
+AssemblyPtr getAssembly(Instruction *instruction) {
+    auto semantic = instruction->getSemantic();
+    if(semantic->isControlFlow()) return AssemblyPtr();
+    return semantic->getAssembly();
+}
+
+bool isCall(InstructionSemantic *semantic) {
+    if(dynamic_cast<IndirectCallInstruction *>(semantic)) return true;
+    if(auto v = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        return v->getId() == X86_INS_CALL;
+    }
+    if(auto v = dynamic_cast<DataLinkedControlFlowInstruction *>(semantic)) {
+        return v->isCall();
+    }
+    return false;
+}
+
+// the whole 64-bit register in "push %r", FLAGS for pushf
+int getSaved(const AssemblyPtr &assembly, unsigned int pushId,
+    unsigned int pushfId) {
+
+    if(!assembly) return INVALID;
+    if(assembly->getId() == pushfId) return FLAGS;
+    if(assembly->getId() != pushId) return INVALID;
+
+    auto ops = assembly->getAsmOperands();
+    if(ops->getMode() != AssemblyOperands::MODE_REG) return INVALID;
+    int id = ops->getOperands()[0].reg;
+    int reg = physical(id);
+    if(!X86Register::isInteger(reg) || reg == SP) return INVALID;
+    if(X86Register::getWidth(reg, id) != 8) return INVALID;
+    return reg;
+}
+
+int getPushed(const AssemblyPtr &assembly)
+    { return getSaved(assembly, X86_INS_PUSH, X86_INS_PUSHFQ); }
+int getPopped(const AssemblyPtr &assembly)
+    { return getSaved(assembly, X86_INS_POP, X86_INS_POPFQ); }
+
+// lea n(%rsp),%rsp, add $n,%rsp or sub $n,%rsp
+bool getStackAdjust(const AssemblyPtr &assembly, long &amount,
+    bool &setsFlags) {
+
+    if(!assembly) return false;
+    auto ops = assembly->getAsmOperands();
+    if(ops->getOpCount() != 2) return false;
+
+    // AT&T operand order
+    const auto &source = ops->getOperands()[0];
+    const auto &dest = ops->getOperands()[1];
+    if(dest.type != X86_OP_REG || dest.reg != X86_REG_RSP) return false;
+
+    switch(assembly->getId()) {
+    case X86_INS_LEA:
+        if(source.type != X86_OP_MEM || source.mem.base != X86_REG_RSP
+            || source.mem.index != X86_REG_INVALID
+            || source.mem.segment != X86_REG_INVALID) {
+
+            return false;
+        }
+        amount = source.mem.disp;
+        setsFlags = false;
+        return true;
+    case X86_INS_ADD:
+    case X86_INS_SUB:
+        if(source.type != X86_OP_IMM) return false;
+        amount = (assembly->getId() == X86_INS_ADD)
+            ? source.imm : -source.imm;
+        setsFlags = true;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool reads(const AssemblyPtr &assembly, int reg, bool skipDest) {
+    auto ops = assembly->getAsmOperands();
+    size_t count = ops->getOpCount();
+    for(size_t k = 0; k < count; k++) {
+        const auto &op = ops->getOperands()[k];
+        if(op.type == X86_OP_REG) {
+            if(skipDest && k + 1 == count) continue;
+            if(physical(op.reg) == reg) return true;
+        }
+        else if(op.type == X86_OP_MEM) {
+            if(physical(op.mem.base) == reg
+                || physical(op.mem.index) == reg) {
+
+                return true;
+            }
+        }
+    }
+
+    for(size_t k = 0; k < assembly->getImplicitRegsReadCount(); k++) {
+        if(physical(assembly->getImplicitRegsRead()[k]) == reg) return true;
+    }
+    return false;
+}
+
+// popf also restores the direction, trap and alignment check flags, which
+// the live register analysis does not track
+bool changesSystemFlags(Instruction *instruction) {
+    auto semantic = instruction->getSemantic();
+    if(semantic->isControlFlow()) {
+        // the ABI has DF clear on entry and return
+        return !isCall(semantic);
+    }
+    auto assembly = semantic->getAssembly();
+    if(!assembly) return true;
+    switch(assembly->getId()) {
+    case X86_INS_STD:
+    case X86_INS_CLD:
+    case X86_INS_STAC:
+    case X86_INS_CLAC:
+    case X86_INS_POPF:
+    case X86_INS_POPFD:
+    case X86_INS_POPFQ:
+    case X86_INS_IRET:
+    case X86_INS_IRETD:
+    case X86_INS_IRETQ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool touchesStack(Instruction *instruction) {
+    auto assembly = getAssembly(instruction);
+    if(!assembly) return true;
+    if(reads(assembly, SP, false)) return true;
+    for(size_t k = 0; k < assembly->getImplicitRegsWriteCount(); k++) {
+        if(physical(assembly->getImplicitRegsWrite()[k]) == SP) return true;
+    }
+    return false;
+}
+
+// rough latency, only used to report what was saved
+long getCost(Instruction *instruction) {
+    auto assembly = getAssembly(instruction);
+    if(!assembly) return 1;
+    switch(assembly->getId()) {
+    case X86_INS_POPFQ:     return 20;  // microcoded
+    case X86_INS_PUSHFQ:    return 3;
+    default:                return 1;
+    }
+}
+
+}  // anonymous namespace
+#endif
+
+void PeepholePass::visit(Module *module) {
+    moduleRemoved = 0;
+    recurse(module->getFunctionList());
+    LOG(1, "peephole in " << module->getName() << ": removed "
+        << moduleRemoved << " instructions");
+}
+
+void PeepholePass::visit(Function *function) {
+#ifdef ARCH_X86_64
+    // Rewrites only make registers less live, so the analysis stays
+    // conservative while the function changes.
+    InstructionLiveRegister liveness(function);
+    this->liveness = &liveness;
+    recurse(function);
+    this->liveness = nullptr;
+#endif
+}
+
+void PeepholePass::visit(Block *block) {
+#ifdef ARCH_X86_64
+    std::vector<Instruction *> list;
+    do {
+        list.clear();
+        for(auto instruction : CIter::children(block)) {
+            list.push_back(instruction);
+        }
+    } while(rewrite(block, list));
+#endif
+}
+
+bool PeepholePass::rewrite(Block *block, std::vector<Instruction *> &list) {
+#ifdef ARCH_X86_64
+    // adjacent instructions
+    for(size_t i = 0; i + 1 < list.size(); i++) {
+        auto a = getAssembly(list[i]);
+        auto b = getAssembly(list[i + 1]);
+
+        // push %r; pop %r
+        int pushed = getPushed(a);
+        if(pushed != INVALID && getPopped(b) == pushed) {
+            if(removePair(block, list, i, i + 1)) return true;
+        }
+
+        // pop %r; push %r: the stack slot still holds the value
+        int popped = getPopped(a);
+        if(popped != INVALID && getPushed(b) == popped
+            && isDeadAfter(block, list, i + 1, popped)) {
+
+            if(removePair(block, list, i, i + 1)) return true;
+        }
+
+        long first, second;
+        bool firstFlags, secondFlags;
+        if(getStackAdjust(a, first, firstFlags)
+            && getStackAdjust(b, second, secondFlags)) {
+
+            if((firstFlags || secondFlags)
+                && !isDeadAfter(block, list, i + 1, FLAGS)) {
+
+                continue;
+            }
+            if(first + second == 0) {
+                if(removePair(block, list, i, i + 1)) return true;
+            }
+            else {
+                replaceWithStackAdjust(block, list[i], first + second);
+                remove(block, list[i + 1]);
+                return true;
+            }
+        }
+    }
+
+    // a save and its restore with other code in between
+    for(size_t i = 0; i + 1 < list.size(); i++) {
+        auto a = getAssembly(list[i]);
+        int pushed = getPushed(a);
+        long amount;
+        bool flags;
+        bool adjust = getStackAdjust(a, amount, flags) && amount < 0;
+        if(pushed == INVALID && !adjust) continue;
+
+        // the code in between must not notice the slot going away
+        size_t j = i + 1;
+        for( ; j < list.size(); j++) {
+            auto c = getAssembly(list[j]);
+            if(pushed != INVALID && getPopped(c) == pushed) break;
+
+            long back;
+            bool backFlags;
+            if(adjust && getStackAdjust(c, back, backFlags)
+                && back == -amount) {
+
+                flags = flags || backFlags;
+                break;
+            }
+            if(touchesStack(list[j])
+                || (pushed == FLAGS && changesSystemFlags(list[j]))) {
+
+                j = list.size();
+                break;
+            }
+        }
+        if(j < list.size()) {
+            bool dead = (pushed != INVALID)
+                ? isDeadAfter(block, list, j, pushed)
+                : (!flags || isDeadAfter(block, list, j, FLAGS));
+            if(dead && removePair(block, list, i, j)) return true;
+        }
+
+        if(pushed != FLAGS) continue;
+
+        // pushf ... popf around a call: keep the layout, not the flags
+        int depth = 0;
+        for(j = i + 1; j < list.size(); j++) {
+            auto semantic = list[j]->getSemantic();
+            if(semantic->isControlFlow()) {
+                if(isCall(semantic)) continue;
+                j = list.size();
+                break;
+            }
+            auto c = semantic->getAssembly();
+            if(!c) {
+                j = list.size();
+                break;
+            }
+
+            if(getPopped(c) == FLAGS && depth == 0) break;
+            if(changesSystemFlags(list[j])) {
+                j = list.size();
+                break;
+            }
+            auto id = c->getId();
+            if(id == X86_INS_PUSH || id == X86_INS_PUSHFQ) depth++;
+            else if(id == X86_INS_POP) {
+                if(--depth < 0) {
+                    j = list.size();
+                    break;
+                }
+            }
+        }
+        if(j < list.size() && isDeadAfter(block, list, j, FLAGS)) {
+            replaceWithStackAdjust(block, list[i], -8);
+            replaceWithStackAdjust(block, list[j], 8);
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+bool PeepholePass::isDeadAfter(Block *block,
+    const std::vector<Instruction *> &list, size_t index, int reg) const {
+
+#ifdef ARCH_X86_64
+    auto live = (index + 1 < list.size())
+        ? liveness->getLiveBefore(list[index + 1])
+        : liveness->getLiveOut(block);
+    return !live.get(reg);
+#else
+    return false;
+#endif
+}
+
+bool PeepholePass::removePair(Block *block, std::vector<Instruction *> &list,
+    size_t i, size_t j) {
+
+    // the first instruction may be the target of a jump
+    if(i == 0) return false;
+
+    LOG(10, "peephole: removing " << list[i]->getName() << " and "
+        << list[j]->getName());
+    remove(block, list[j]);
+    remove(block, list[i]);
+    return true;
+}
+
+void PeepholePass::remove(Block *block, Instruction *instruction) {
+#ifdef ARCH_X86_64
+    removed++;
+    moduleRemoved++;
+    bytesSaved += instruction->getSize();
+    cyclesSaved += getCost(instruction);
+#endif
+
+    ChunkMutator(block).remove(instruction);
+    delete instruction->getSemantic();
+    delete instruction;
+}
+
+void PeepholePass::replace(Block *block, Instruction *instruction,
+    const std::vector<unsigned char> &bytes) {
+
+    auto temporary = Disassemble::instruction(bytes);
+    auto oldSemantic = instruction->getSemantic();
+    auto newSemantic = temporary->getSemantic();
+    delete temporary;
+
+    long oldSize = instruction->getSize();
+#ifdef ARCH_X86_64
+    cyclesSaved += getCost(instruction);
+#endif
+    instruction->setSemantic(newSemantic);
+#ifdef ARCH_X86_64
+    cyclesSaved -= getCost(instruction);
+#endif
+    long newSize = instruction->getSize();
+    bytesSaved += oldSize - newSize;
+
+    ChunkMutator(block).modifiedChildSize(instruction, newSize - oldSize);
+    delete oldSemantic;
+}
+
+void PeepholePass::replaceWithStackAdjust(Block *block,
+    Instruction *instruction, long amount) {
+
+    std::vector<unsigned char> bytes;
+    if(amount >= -0x80 && amount < 0x80) {
+        // lea amount(%rsp), %rsp
+        bytes = {0x48, 0x8d, 0x64, 0x24, static_cast<unsigned char>(amount)};
+    }
+    else {
+        // lea amount(%rsp), %rsp, 32-bit displacement
+        bytes = {0x48, 0x8d, 0xa4, 0x24};
+        for(int k = 0; k < 4; k++) {
+            bytes.push_back(static_cast<unsigned char>(amount >> (8*k)));
+        }
+    }
+    replace(block, instruction, bytes);
+}
@@ -0,0 +1,63 @@
+#ifndef EGALITO_PASS_PEEPHOLE_H
+#define EGALITO_PASS_PEEPHOLE_H
+
+#include <string>
+#include <vector>
+#include "chunkpass.h"
+
+class InstructionLiveRegister;
+
+/** Cleans up the save/restore sequences that instrumentation passes wrap
+    around each site (ChunkAddInline, AFL coverage, shadow stacks, ...).
+    Within each block this
+      - drops push/pop and pushf/popf pairs whose value is dead after the
+        pop, as long as nothing between them uses the stack;
+      - drops a restore that is immediately saved again (pop %r; push %r);
+      - turns pushf/popf around a call into plain stack adjustments when
+        the flags are dead after the popf (popf is microcoded and slow);
+      - merges adjacent stack adjustments and drops balanced ones around
+        code that does not use the stack.
+
+    Whether a register or the flags are dead comes from
+    InstructionLiveRegister. popf also restores the direction, trap and
+    alignment check flags, which that analysis does not track, so pushf and
+    popf are kept if anything in between might change those. The first
+    instruction of a block may be a jump target, so it is rewritten in
+    place but never removed.
+
+    Run after all instrumentation passes and before PromoteJumpsPass. Only
+    x86-64 is handled.
+*/
+class PeepholePass : public ChunkPass {
+private:
+    InstructionLiveRegister *liveness;
+    size_t moduleRemoved;
+    size_t removed;
+    long bytesSaved;
+    long cyclesSaved;
+public:
+    PeepholePass() : liveness(nullptr), moduleRemoved(0), removed(0),
+        bytesSaved(0), cyclesSaved(0) {}
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+    virtual void visit(Block *block);
+
+    size_t getRemovedCount() const { return removed; }
+    long getBytesSaved() const { return bytesSaved; }
+    /** Rough estimate, summed once over every rewritten site. */
+    long getCyclesSaved() const { return cyclesSaved; }
+private:
+    bool rewrite(Block *block, std::vector<Instruction *> &list);
+    bool isDeadAfter(Block *block, const std::vector<Instruction *> &list,
+        size_t index, int reg) const;
+    bool removePair(Block *block, std::vector<Instruction *> &list,
+        size_t i, size_t j);
+    void remove(Block *block, Instruction *instruction);
+    void replace(Block *block, Instruction *instruction,
+        const std::vector<unsigned char> &bytes);
+    void replaceWithStackAdjust(Block *block, Instruction *instruction,
+        long amount);
+};
+
+#endif
@@ -14,9 +14,9 @@ public:
 
     template <typename NarrowType>
     static bool fitsIn(address_t address);
+    static std::string getWiderOpcode(unsigned int id);
 private:
     void promote(Instruction *instruction);
-    static std::string getWiderOpcode(unsigned int id);
 };
 
 template <typename NarrowType>
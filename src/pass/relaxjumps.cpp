@@ -0,0 +1,114 @@
+#include "relaxjumps.h"
+#include "promotejumps.h"
+#include "operation/mutator.h"
+#include "instr/concrete.h"
+#include "log/log.h"
+
+void RelaxJumpsPass::visit(Module *module) {
+    moduleSaved = 0;
+    recurse(module->getFunctionList());
+    LOG(1, "relaxed jumps in " << module->getName() << ": saved "
+        << moduleSaved << " bytes");
+    totalSaved += moduleSaved;
+}
+
+void RelaxJumpsPass::visit(Function *function) {
+#ifdef ARCH_X86_64
+    std::vector<Instruction *> jumps;
+    collectJumps(function, jumps);
+    if(jumps.empty()) return;
+
+    long before = function->getSize();
+    for(auto instruction : jumps) {
+        resize(instruction, true);
+    }
+
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(auto instruction : jumps) {
+            auto v = static_cast<ControlFlowInstruction *>(
+                instruction->getSemantic());
+            if(v->getDisplacementSize() != 1) continue;
+
+            address_t disp = v->calculateDisplacement();
+            if(!PromoteJumpsPass::fitsIn<signed char>(disp)) {
+                resize(instruction, false);
+                changed = true;
+            }
+        }
+    }
+
+    long saved = before - static_cast<long>(function->getSize());
+    LOG(10, "relaxed " << jumps.size() << " jumps in "
+        << function->getName() << ", saved " << saved << " bytes");
+    moduleSaved += saved;
+#endif
+}
+
+void RelaxJumpsPass::collectJumps(Function *function,
+    std::vector<Instruction *> &jumps) {
+
+#ifdef ARCH_X86_64
+    for(auto block : CIter::children(function)) {
+        for(auto instruction : CIter::children(block)) {
+            auto v = dynamic_cast<ControlFlowInstruction *>(
+                instruction->getSemantic());
+            if(!v || !v->getLink()) continue;
+
+            // targets outside the function may move independently
+            if(v->getLink()->isExternalJump()) continue;
+
+            // no calls; jrcxz and friends only have a short form
+            auto mnemonic = v->getMnemonic();
+            if(mnemonic.empty() || mnemonic[0] != 'j'
+                || mnemonic.find("cxz") != std::string::npos) {
+
+                continue;
+            }
+
+            // leave jumps with prefixes alone
+            auto wide = PromoteJumpsPass::getWiderOpcode(v->getId());
+            auto narrow = getShortOpcode(wide);
+            if(narrow.empty()) continue;
+            if(v->getOpcode() != (v->getDisplacementSize() == 1
+                ? narrow : wide)) {
+
+                continue;
+            }
+
+            jumps.push_back(instruction);
+        }
+    }
+#endif
+}
+
+void RelaxJumpsPass::resize(Instruction *instruction, bool toShort) {
+#ifdef ARCH_X86_64
+    auto v = static_cast<ControlFlowInstruction *>(instruction->getSemantic());
+    int size = toShort ? 1 : 4;
+    if(v->getDisplacementSize() == size) return;
+
+    auto wide = PromoteJumpsPass::getWiderOpcode(v->getId());
+    size_t oldSize = v->getSize();
+    v->setOpcode(toShort ? getShortOpcode(wide) : wide);
+    v->setDisplacementSize(size);
+
+    ChunkMutator(instruction->getParent())
+        .modifiedChildSize(instruction, v->getSize() - oldSize);
+#endif
+}
+
+std::string RelaxJumpsPass::getShortOpcode(const std::string &wide) {
+    std::string opcode;
+    if(wide.size() == 1 && static_cast<unsigned char>(wide[0]) == 0xe9) {
+        opcode += static_cast<char>(0xeb);
+    }
+    else if(wide.size() == 2 && static_cast<unsigned char>(wide[0]) == 0x0f
+        && (static_cast<unsigned char>(wide[1]) & 0xf0) == 0x80) {
+
+        // 0f 8x rel32 -> 7x rel8, same condition code
+        opcode += static_cast<char>(wide[1] - 0x10);
+    }
+    return opcode;
+}
@@ -0,0 +1,35 @@
+#ifndef EGALITO_PASS_RELAX_JUMPS_H
+#define EGALITO_PASS_RELAX_JUMPS_H
+
+#include <string>
+#include <vector>
+#include "chunkpass.h"
+
+/** Shrinks intra-function jumps to their shortest encoding. All candidate
+    jumps start short, then any that no longer reach are widened until
+    nothing changes. Jumps only ever grow in that loop, so it terminates,
+    and it finds the smallest sizes that all fit together.
+
+    Run after PromoteJumpsPass. Only x86-64 has variable-length branches;
+    on other architectures this pass does nothing.
+*/
+class RelaxJumpsPass : public ChunkPass {
+private:
+    long moduleSaved;
+    long totalSaved;
+public:
+    RelaxJumpsPass() : moduleSaved(0), totalSaved(0) {}
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+
+    long getBytesSaved() const { return totalSaved; }
+
+    /** Returns the rel8 form of a rel32 jmp/jcc opcode, or "" if none. */
+    static std::string getShortOpcode(const std::string &wide);
+private:
+    void collectJumps(Function *function, std::vector<Instruction *> &jumps);
+    void resize(Instruction *instruction, bool toShort);
+};
+
+#endif
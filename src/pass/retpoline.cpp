@@ -1,9 +1,9 @@
 #include <cassert>
 #include "retpoline.h"
 #include "chunk/dump.h"
+#include "instr/builder.h"
 #include "instr/concrete.h"
 #include "instr/register.h"
-#include "disasm/disassemble.h"
 #include "operation/mutator.h"
 #include "util/streamasstring.h"
 #include "log/log.h"
@@ -140,7 +140,7 @@ Function *RetpolinePass::makeOutlinedTrampoline(Module *module, Instruction *ins
         }
 
         {
-            auto pauseIns = Disassemble::instruction({0xf3, 0x90});
+            auto pauseIns = X86Builder::pause();
 
             auto jmpIns = new Instruction();
             auto jmpSem = new ControlFlowInstruction(
@@ -162,15 +162,10 @@ Function *RetpolinePass::makeOutlinedTrampoline(Module *module, Instruction *ins
             if(movInsList.empty()) {
                 LOG(1, "WARNING: couldn't rewrite " << instr->getName()
                     << " for retpoline! Using hlt instr");
-                movInsList.push_back(Disassemble::instruction({0xf4}));
+                movInsList.push_back(X86Builder::hlt());
             }
 
-            auto retIns = new Instruction();
-            auto retSem = new ReturnInstruction();
-            static DisasmHandle handle(true);
-            retSem->setAssembly(AssemblyPtr(DisassembleInstruction(handle)
-                .makeAssemblyPtr((std::vector<unsigned char>){0xc3})));
-            retIns->setSemantic(retSem);
+            auto retIns = X86Builder::ret();
 
             ChunkMutator m(block3);
             for(auto ins : movInsList) m.append(ins);
@@ -199,83 +194,25 @@ std::vector<Instruction *> RetpolinePass::makeMovInstruction(
 
 #ifdef ARCH_X86_64
     auto semantic = static_cast<IndirectControlFlowInstructionBase *>(instr->getSemantic());
-    auto cs_reg = semantic->getRegister();
-    assert(cs_reg != X86_REG_RIP);
-    auto reg = X86Register::convertToPhysical(cs_reg);
-    auto indexReg = X86Register::convertToPhysical(semantic->getIndexRegister());
-    auto scale = semantic->getScale();
-    int64_t displacement = semantic->getDisplacement();
+    auto reg = static_cast<x86_reg>(semantic->getRegister());
+    assert(reg != X86_REG_RIP);
 
     // movq EA, %r11
-    std::vector<unsigned char> bin2;
+    Instruction *ins1 = nullptr;
     if(semantic->hasMemoryOperand()) {
-        if(indexReg == X86Register::INVALID) {
-            // movq disp(%reg), %r11
-            bin2.resize(3);
-            unsigned char rex = 0x4c;
-            if(reg >= 8) rex |= 0b0001;
-            bin2[0] = rex;
-            bin2[1] = 0x8b;
-            if(reg >= 8) {
-                bin2[2] = 0x98 + reg - 8;
-                //bin2[2] = 0x80 | (reg - 8) << 3 | (reg - 8);
-                if(reg == 12) {
-                    bin2.push_back(0x24);
-                }
-            }
-            else {
-                bin2[2] = 0x98 + reg;
-                //bin2[2] = 0x80 | reg << 3 | reg;
-                if(reg == 4) {
-                    bin2.push_back(0x24);
-                }
-            }
-        }
-        else {
-            // movq disp(%reg, %index, scale), %r11
-            bin2.resize(4);
-            unsigned char rex = 0x4c;
-            if(reg >= 8) rex |= 0b0001;
-            if(indexReg >= 8) rex |= 0b0010;
-            bin2[0] = rex;
-            bin2[1] = 0x8b;
-            //unsigned char operand = 0x84;
-            //if(reg >= 8) operand |= (reg - 8) << 3;
-            //else         operand |= reg << 3;
-            unsigned char operand = 0x9c;
-            bin2[2] = operand;
-            // scale | index(3) | base(3)
-            size_t bits = 0;
-            while(scale /= 2) bits++;
-            unsigned char sib = bits << 6;
-            if(reg >= 8) sib |= (reg - 8);
-            else         sib |= reg;
-            if(indexReg > 8) sib |= (indexReg - 8) << 3;
-            else             sib |= indexReg << 3;
-            bin2[3] = sib;
-        }
-        for(int i = 0; i < 4; i++) {
-            bin2.push_back(displacement & 0xff);
-            displacement >>= 8;
-        }
+        // movq disp(%reg[, %index, scale]), %r11
+        X86Memory memory(reg,
+            static_cast<x86_reg>(semantic->getIndexRegister()),
+            semantic->getScale(), semantic->getDisplacement());
+        ins1 = X86Builder::mov(memory, X86_REG_R11);
     }
     else {
         // movq %reg, %r11
-        unsigned char rex = 0x49;
-        if(reg >= 8) rex |= 0b0100;
-        bin2.push_back(rex);
-        bin2.push_back(0x89);
-        unsigned char operand = 0xc3;
-        if(reg >= 8) operand |= (reg - 8) << 3;
-        else         operand |= reg << 3;
-        bin2.push_back(operand);
+        ins1 = X86Builder::mov(reg, X86_REG_R11);
     }
-    DisasmHandle handle(true);
-    auto ins1 = DisassembleInstruction(handle).instruction(bin2);
 
     // movq %r11, (%rsp)
-    std::vector<unsigned char> bin4{0x4c, 0x89, 0x1c, 0x24};
-    auto ins2 = DisassembleInstruction(handle).instruction(bin4);
+    auto ins2 = X86Builder::mov(X86_REG_R11, X86Memory(X86_REG_RSP));
     return {ins1, ins2};
 #else
     return {};
@@ -1,12 +1,13 @@
 #ifndef EGALITO_PASS_RUN_H
 #define EGALITO_PASS_RUN_H
 
-#include "util/timing.h"
+#include "util/profiler.h"
 
 #if 1  // enable pass profiling
     #define RUN_PASS(passConstructor, module) \
         { \
-            EgalitoTiming timing(#passConstructor); \
+            ProfileScope profile(#passConstructor, \
+                EgalitoProfiler::LEVEL_PASS); \
             auto pass = passConstructor; \
             module->accept(&pass); \
         }
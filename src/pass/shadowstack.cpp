@@ -1,7 +1,7 @@
 #include <vector>
 #include <cassert>
 #include "shadowstack.h"
-#include "disasm/disassemble.h"
+#include "instr/builder.h"
 #include "instr/register.h"
 #include "instr/concrete.h"
 #include "operation/mutator.h"
@@ -10,6 +10,8 @@
 #include "pass/switchcontext.h"
 #include "types.h"
 
+#include "log/log.h"
+
 void ShadowStackPass::visit(Program *program) {
     auto allocateFunc = ChunkFind2(program).findFunction(
         mode == MODE_GS ? "egalito_allocate_shadow_stack_gs"
@@ -44,11 +46,15 @@ void ShadowStackPass::visit(Program *program) {
     }
 
     recurse(program);
+
+    LOG(1, "ShadowStackPass: saved " << scratchState.getSavedCount()
+        << " registers, avoided " << scratchState.getAvoidedCount()
+        << " spills");
 }
 
 void ShadowStackPass::visit(Module *module) {
 #ifdef ARCH_X86_64
-    auto instr = Disassemble::instruction({0x0f, 0x0b});  // ud2
+    auto instr = X86Builder::ud2();
     auto block = new Block();
 
     auto symbol = new Symbol(0x0, 0, "egalito_shadowstack_violation",
@@ -150,41 +156,40 @@ void ShadowStackPass::pushToShadowStack(Function *function) {
 	}
 }
 
-#define FITS_IN_ONE_BYTE(x) ((x) < 0x80)  /* signed 1-byte operand */
-#define GET_BYTE(x, shift) static_cast<unsigned char>(((x) >> (shift*8)) & 0xff)
-#define GET_BYTES(x) GET_BYTE((x),0), GET_BYTE((x),1), GET_BYTE((x),2), GET_BYTE((x),3)
-
 void ShadowStackPass::pushToShadowStackConst(Function *function) {
-    ChunkAddInline ai({X86_REG_R11}, [] (unsigned int stackBytesAdded) {
+#ifdef ARCH_X86_64
+    ChunkAddInline ai(&scratchState, {X86_REG_R11, X86_REG_R10, X86_REG_RAX},
+        1, false,
+        [] (unsigned int stackBytesAdded, const std::vector<Register> &regs) {
+
+        auto reg = static_cast<x86_reg>(regs[0]);
         // 0:   41 53                   push   %r11
         // 2:   4c 8b 5c 24 08          mov    0x8(%rsp),%r11
         // 7:   4c 89 9c 24 00 00 50    mov    %r11,-0xb00000(%rsp)
         // e:   ff
         // f:   41 5b                   pop    %r11
 
-        Instruction *mov1Instr = nullptr;
-        if(FITS_IN_ONE_BYTE(stackBytesAdded)) {
-            mov1Instr = Disassemble::instruction({0x4c, 0x8b, 0x5c, 0x24, GET_BYTE(stackBytesAdded,0)});
-        } else {
-            //   5:    4c 8b 9c 24 88 00 00    mov    0x88(%rsp),%r11
-            //   c:    00 
-            mov1Instr = Disassemble::instruction({0x4c, 0x8b, 0x9c, 0x24, GET_BYTES(stackBytesAdded)});
-        }
-        Instruction *mov2Instr = nullptr;
-        {
-            unsigned int offset = -0xb00000 + stackBytesAdded;
-            mov2Instr = Disassemble::instruction({0x4c, 0x89, 0x9c, 0x24, GET_BYTES(offset)});
-        }
+        auto mov1Instr = X86Builder::mov(
+            X86Memory(X86_REG_RSP, stackBytesAdded), reg);
+        auto mov2Instr = X86Builder::mov(reg,
+            X86Memory(X86_REG_RSP, -0xb00000 + stackBytesAdded));
 
         return std::vector<Instruction *>{ mov1Instr, mov2Instr };
     });
 	auto block1 = function->getChildren()->getIterable()->get(0);
 	auto instr1 = block1->getChildren()->getIterable()->get(0);
     ai.insertBefore(instr1, false);
+#endif
 }
 
 void ShadowStackPass::pushToShadowStackGS(Function *function) {
-    ChunkAddInline ai({X86_REG_R10, X86_REG_R11}, [] (unsigned int stackBytesAdded) {
+#ifdef ARCH_X86_64
+    ChunkAddInline ai(&scratchState, {X86_REG_R11, X86_REG_R10, X86_REG_RAX},
+        2, false,
+        [] (unsigned int stackBytesAdded, const std::vector<Register> &regs) {
+
+        auto top = static_cast<x86_reg>(regs[0]);  // %r11 below
+        auto value = static_cast<x86_reg>(regs[1]);  // %r10 below
         /*  
            0:   65 4c 8b 1c 25 00 00    mov    %gs:0x0,%r11
            7:   00 00
@@ -194,30 +199,22 @@ void ShadowStackPass::pushToShadowStackGS(Function *function) {
           15:   65 4c 89 1c 25 00 00    mov    %r11,%gs:0x0
           1c:   00 00
         */
-        auto mov1Instr = Disassemble::instruction({0x65, 0x4c, 0x8b, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00});
-        auto leaInstr = Disassemble::instruction({0x4d, 0x8d, 0x5b, 0x08});
-        Instruction *mov2Instr = nullptr;
-        if(stackBytesAdded == 0) {
-            //   18:    4c 8b 14 24             mov    (%rsp),%r10
-            mov2Instr = Disassemble::instruction({0x4c, 0x8b, 0x14, 0x24});
-        }
-        else if(FITS_IN_ONE_BYTE(stackBytesAdded)) {
-            //   18:    4c 8b 54 24 08          mov    0x8(%rsp),%r10
-            mov2Instr = Disassemble::instruction({0x4c, 0x8b, 0x54, 0x24, GET_BYTE(stackBytesAdded,0)});
-        }
-        else {
-            //   1c:   4c 8b 94 24 88 00 00    mov    0x88(%rsp),%r10
-            //   23:   00 
-            mov2Instr = Disassemble::instruction({0x4c, 0x8b, 0x94, 0x24, GET_BYTES(stackBytesAdded)});
-        }
-        auto mov3Instr = Disassemble::instruction({0x65, 0x4d, 0x89, 0x13});
-        auto mov4Instr = Disassemble::instruction({0x65, 0x4c, 0x89, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00});
+        auto mov1Instr = X86Builder::mov(
+            X86Memory::absolute(0, X86_REG_GS), top);
+        auto leaInstr = X86Builder::lea(X86Memory(top, 8), top);
+        auto mov2Instr = X86Builder::mov(
+            X86Memory(X86_REG_RSP, stackBytesAdded), value);
+        auto mov3Instr = X86Builder::mov(value,
+            X86Memory(top).setSegment(X86_REG_GS));
+        auto mov4Instr = X86Builder::mov(top,
+            X86Memory::absolute(0, X86_REG_GS));
 
         return std::vector<Instruction *>{ mov1Instr, leaInstr, mov2Instr, mov3Instr, mov4Instr };
     });
 	auto block1 = function->getChildren()->getIterable()->get(0);
 	auto instr1 = block1->getChildren()->getIterable()->get(0);
     ai.insertBefore(instr1, false);
+#endif
 }
 
 void ShadowStackPass::popFromShadowStack(Instruction *instruction) {
@@ -230,7 +227,12 @@ void ShadowStackPass::popFromShadowStack(Instruction *instruction) {
 }
 
 void ShadowStackPass::popFromShadowStackConst(Instruction *instruction) {
-    ChunkAddInline ai({X86_REG_EFLAGS, X86_REG_R11}, [this] (unsigned int stackBytesAdded) {
+#ifdef ARCH_X86_64
+    ChunkAddInline ai(&scratchState, {X86_REG_R11, X86_REG_R10, X86_REG_RAX},
+        1, true,
+        [this] (unsigned int stackBytesAdded, const std::vector<Register> &regs) {
+
+        auto reg = static_cast<x86_reg>(regs[0]);
         /*
                                          pushfd
             0:   41 53                   push   %r11
@@ -241,20 +243,11 @@ void ShadowStackPass::popFromShadowStackConst(Instruction *instruction) {
            15:   41 5b                   pop    %r11
                                          popfd
         */
-        Instruction *movInstr = nullptr;
-        if(FITS_IN_ONE_BYTE(stackBytesAdded)) {
-            movInstr = Disassemble::instruction({0x4c, 0x8b, 0x5c, 0x24, GET_BYTE(stackBytesAdded,0)});
-        } else {
-            //   5:    4c 8b 9c 24 88 00 00    mov    0x90(%rsp),%r11
-            //   c:    00 
-            // (optional 0x80 for redzone), 0x8 for pushfd, 0x8 for push %r11
-            movInstr = Disassemble::instruction({0x4c, 0x8b, 0x9c, 0x24, GET_BYTES(stackBytesAdded)});
-        }
-        Instruction *cmpInstr = nullptr;
-        {
-            unsigned int offset = -0xb00000 + stackBytesAdded;
-            cmpInstr = Disassemble::instruction({0x4c, 0x39, 0x9c, 0x24, GET_BYTES(offset)});
-        }
+        // (optional 0x80 for redzone), 0x8 for pushfd, 0x8 for push %r11
+        auto movInstr = X86Builder::mov(
+            X86Memory(X86_REG_RSP, stackBytesAdded), reg);
+        auto cmpInstr = X86Builder::arithmetic(X86Builder::OP_CMP,
+            reg, X86Memory(X86_REG_RSP, -0xb00000 + stackBytesAdded));
 
         auto jne = new Instruction();
         auto jneSem = new ControlFlowInstruction(
@@ -264,10 +257,17 @@ void ShadowStackPass::popFromShadowStackConst(Instruction *instruction) {
         return std::vector<Instruction *>{ movInstr, cmpInstr, jne };
     });
     ai.insertBefore(instruction, true);
+#endif
 }
 
 void ShadowStackPass::popFromShadowStackGS(Instruction *instruction) {
-    ChunkAddInline ai({X86_REG_R10, X86_REG_R11}, [this] (unsigned int stackBytesAdded) {
+#ifdef ARCH_X86_64
+    ChunkAddInline ai(&scratchState, {X86_REG_R11, X86_REG_R10, X86_REG_RAX},
+        2, true,
+        [this] (unsigned int stackBytesAdded, const std::vector<Register> &regs) {
+
+        auto top = static_cast<x86_reg>(regs[0]);  // %r11 below
+        auto value = static_cast<x86_reg>(regs[1]);  // %r10 below
         /*
           1f:   65 4c 8b 1c 25 00 00    mov    %gs:0x0,%r11
           26:   00 00
@@ -278,25 +278,16 @@ void ShadowStackPass::popFromShadowStackGS(Instruction *instruction) {
           3a:   65 4c 89 1c 25 00 00    mov    %r11,%gs:0x0
           41:   00 00
         */
-        auto mov1Instr = Disassemble::instruction({0x65, 0x4c, 0x8b, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00});
-        Instruction *mov2Instr = nullptr;
-        if(stackBytesAdded == 0) {
-            //   18:    4c 8b 14 24             mov    (%rsp),%r10
-            mov2Instr = Disassemble::instruction({0x4c, 0x8b, 0x14, 0x24});
-        }
-        else if(FITS_IN_ONE_BYTE(stackBytesAdded)) {
-            //   18:    4c 8b 54 24 08          mov    0x8(%rsp),%r10
-            mov2Instr = Disassemble::instruction({0x4c, 0x8b, 0x54, 0x24, GET_BYTE(stackBytesAdded,0)});
-        }
-        else {
-            //   1c:   4c 8b 94 24 88 00 00    mov    0x88(%rsp),%r10
-            //   23:   00 
-            mov2Instr = Disassemble::instruction({0x4c, 0x8b, 0x94, 0x24, GET_BYTES(stackBytesAdded)});
-        }
-        auto cmpInstr = Disassemble::instruction({0x65, 0x4d, 0x39, 0x13});
+        auto mov1Instr = X86Builder::mov(
+            X86Memory::absolute(0, X86_REG_GS), top);
+        auto mov2Instr = X86Builder::mov(
+            X86Memory(X86_REG_RSP, stackBytesAdded), value);
+        auto cmpInstr = X86Builder::arithmetic(X86Builder::OP_CMP,
+            value, X86Memory(top).setSegment(X86_REG_GS));
         // jmp instr goes here
-        auto leaInstr = Disassemble::instruction({0x4d, 0x8d, 0x5b, 0xf8});
-        auto mov3Instr = Disassemble::instruction({0x65, 0x4c, 0x89, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00});
+        auto leaInstr = X86Builder::lea(X86Memory(top, -8), top);
+        auto mov3Instr = X86Builder::mov(top,
+            X86Memory::absolute(0, X86_REG_GS));
 
         auto jne = new Instruction();
         auto jneSem = new ControlFlowInstruction(
@@ -307,8 +298,5 @@ void ShadowStackPass::popFromShadowStackGS(Instruction *instruction) {
         return std::vector<Instruction *>{ mov1Instr, mov2Instr, cmpInstr, jne, leaInstr, mov3Instr };
     });
     ai.insertBefore(instruction, true);
+#endif
 }
-
-#undef FITS_IN_ONE_BYTE
-#undef GET_BYTE
-#undef GET_BYTES
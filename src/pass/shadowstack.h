@@ -2,6 +2,7 @@
 #define EGALITO_PASS_SHADOW_STACK_H
 
 #include "chunkpass.h"
+#include "operation/addinline.h"
 
 class ShadowStackPass : public ChunkPass {
 public:
@@ -13,6 +14,7 @@ private:
     Mode mode;
     Function *violationTarget;
     Function *entryPoint;
+    ChunkAddInline::ScratchState scratchState;
 public:
     ShadowStackPass(Mode mode = MODE_CONST) : mode(mode),
         violationTarget(nullptr), entryPoint(nullptr) {}
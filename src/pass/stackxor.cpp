@@ -1,6 +1,7 @@
 #include <sstream>
 #include "stackxor.h"
 #include "disasm/disassemble.h"
+#include "instr/builder.h"
 #include "operation/mutator.h"
 #include "instr/concrete.h"
 
@@ -60,11 +61,10 @@ void StackXOR::addInstructions(Block *block, Instruction *instruction,
 
     mutator.insertBefore(instruction, Reassemble::instructions(ss.str()), beforeJumpTo);
 #else
-    mutator.insertBefore(instruction, Disassemble::instruction(
-        {0x64, 0x4c, 0x8b, 0x1c, 0x25,
-            (unsigned char)xorOffset, 0x00, 0x00, 0x00}));
-    mutator.insertBefore(instruction, Disassemble::instruction(
-        {0x4c, 0x31, 0x1c, 0x24}));
+    mutator.insertBefore(instruction, X86Builder::mov(
+        X86Memory::absolute(xorOffset, X86_REG_FS), X86_REG_R11));
+    mutator.insertBefore(instruction, X86Builder::arithmetic(
+        X86Builder::OP_XOR, X86_REG_R11, X86Memory(X86_REG_RSP)));
 #endif
 
 #elif defined(ARCH_AARCH64) || defined(ARCH_ARM)
@@ -76,9 +76,15 @@ void StackXOR::addInstructions(Block *block, Instruction *instruction,
             shown as movn #0
      */
     ChunkMutator mutator(block);
+#ifdef ARCH_AARCH64
+    mutator.insertBefore(AARCH64Builder::movn(ARM64_REG_X16, 0), instruction);
+    mutator.insertBefore(AARCH64Builder::eor(
+        ARM64_REG_X30, ARM64_REG_X30, ARM64_REG_X16), instruction);
+#else
     mutator.insertBefore(Disassemble::instruction(
         {0x10, 0x00, 0x80, 0x92}), instruction);
     mutator.insertBefore(Disassemble::instruction(
         {0xde, 0x03, 0x10, 0xca}), instruction);
 #endif
+#endif
 }
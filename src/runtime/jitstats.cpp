@@ -0,0 +1,132 @@
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <cstring>
+#include <string>
+#include "jitstats.h"
+#include "chunk/concrete.h"
+#include "chunk/tls.h"
+
+#undef DEBUG_GROUP
+#define DEBUG_GROUP load
+#include "log/log.h"
+
+JITStatisticsHeader *egalito_jit_stats __attribute__((weak));
+
+bool JITStatistics::create(const char *path, GSTable *gsTable,
+    size_t sandboxSize) {
+
+    auto entryCount = gsTable->getChildren()->getIterable()->getCount();
+
+    std::string names;
+    for(auto entry : CIter::children(gsTable)) {
+        names += entry->getTarget()->getName();
+        names.push_back('\0');
+    }
+
+    size_t threadSize = sizeof(JITThreadStatistics)
+        + entryCount * sizeof(uint64_t);
+    size_t nameOffset = sizeof(JITStatisticsHeader)
+        + JIT_STATS_MAX_THREADS * threadSize;
+    size_t size = nameOffset + names.size();
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        LOG(0, "WARNING: can't create JIT statistics file " << path);
+        return false;
+    }
+    void *map = MAP_FAILED;
+    if(ftruncate(fd, size) == 0) {
+        map = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(map == MAP_FAILED) {
+        LOG(0, "WARNING: can't map JIT statistics file " << path);
+        return false;
+    }
+
+    auto header = static_cast<JITStatisticsHeader *>(map);
+    header->magic = JIT_STATS_MAGIC;
+    header->version = JIT_STATS_VERSION;
+    header->entryCount = entryCount;
+    header->maxThreads = JIT_STATS_MAX_THREADS;
+    header->threadCount = 0;
+    header->threadSize = threadSize;
+    header->nameOffset = nameOffset;
+    header->sandboxSize = sandboxSize;
+    header->epochThreads = 0;
+    header->epochGroups = 0;
+    header->epochGroupBytes = 0;
+    std::memcpy(static_cast<char *>(map) + nameOffset,
+        names.data(), names.size());
+
+    LOG(1, "JIT statistics for " << entryCount << " entries in " << path);
+    ::egalito_jit_stats = header;
+    return true;
+}
+
+JITThreadStatistics *JITStatistics::claimThread() {
+    auto header = egalito_jit_stats;
+    if(!header) return nullptr;
+
+    auto slot = __atomic_fetch_add(&header->threadCount, 1, __ATOMIC_RELAXED);
+    if(slot >= header->maxThreads) return nullptr;
+
+    auto base = reinterpret_cast<char *>(header + 1);
+    return reinterpret_cast<JITThreadStatistics *>(
+        base + slot * header->threadSize);
+}
+
+void JITStatistics::recordFixup(GSTableEntry::IndexType index, size_t bytes) {
+    auto stats = EgalitoTLS::getJITStatistics();
+    if(!stats) return;
+
+    stats->fixups++;
+    if(index < egalito_jit_stats->entryCount) {
+        stats->getEntryFixups()[index]++;
+    }
+    stats->generatedBytes += bytes;
+    stats->epochBytes += bytes;
+    if(stats->epochBytes > stats->peakEpochBytes) {
+        stats->peakEpochBytes = stats->epochBytes;
+    }
+}
+
+void JITStatistics::recordReset(uint64_t nanoseconds, size_t bytes) {
+    auto stats = EgalitoTLS::getJITStatistics();
+    if(!stats) return;
+
+    stats->resets++;
+    stats->resetNanoseconds += nanoseconds;
+    stats->generatedBytes += bytes;
+    stats->epochBytes = bytes;
+    if(stats->epochBytes > stats->peakEpochBytes) {
+        stats->peakEpochBytes = stats->epochBytes;
+    }
+}
+
+void JITStatistics::recordGroupResetTimeout(bool dropped) {
+    auto stats = EgalitoTLS::getJITStatistics();
+    if(!stats) return;
+
+    stats->groupResetTimeouts++;
+    if(dropped) stats->groupResetsDropped++;
+}
+
+void JITStatistics::recordEpochGroups(size_t threads, size_t groups,
+    size_t bytes) {
+
+    auto header = egalito_jit_stats;
+    if(!header) return;
+
+    __atomic_store_n(&header->epochThreads, threads, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->epochGroups, groups, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->epochGroupBytes, bytes, __ATOMIC_RELAXED);
+}
+
+uint64_t JITStatistics::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
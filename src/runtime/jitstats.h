@@ -0,0 +1,66 @@
+#ifndef EGALITO_RUNTIME_JIT_STATS_H
+#define EGALITO_RUNTIME_JIT_STATS_H
+
+#include <cstdint>
+#include "chunk/gstable.h"
+
+#define JIT_STATS_MAGIC         0x5354544954494c41ull   // "ALITJITS"
+#define JIT_STATS_VERSION       3
+#define JIT_STATS_MAX_THREADS   64
+
+/** Header of the JIT statistics file (EGALITO_JIT_STATS=path). The file
+    is mapped shared, so it can be read while the program runs and is
+    complete on disk when the program exits or dies.
+
+    Layout: this header, then maxThreads records of threadSize bytes, then
+    entryCount NUL-terminated GS entry names starting at nameOffset.
+*/
+struct JITStatisticsHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t maxThreads;
+    uint32_t threadCount;       // records claimed so far
+    uint64_t threadSize;
+    uint64_t nameOffset;
+    uint64_t sandboxSize;       // bytes in each sandbox half
+    uint64_t epochThreads;      // live threads in shared epoch groups
+    uint64_t epochGroups;
+    uint64_t epochGroupBytes;   // mapped for all groups together
+};
+
+/** Counters for one thread, followed by entryCount per-entry fixup counts.
+    Only the owning thread writes to its record.
+*/
+struct JITThreadStatistics {
+    uint64_t fixups;
+    uint64_t generatedBytes;    // by fixups and resets
+    uint64_t epochBytes;        // generated since the last reset
+    uint64_t peakEpochBytes;
+    uint64_t resets;
+    uint64_t resetNanoseconds;
+    uint64_t groupResetTimeouts;    // gave up waiting at the group barrier
+    uint64_t groupResetsDropped;    // withdrew a group reset nobody finished
+
+    uint64_t *getEntryFixups() { return reinterpret_cast<uint64_t *>(this + 1); }
+};
+
+class JITStatistics {
+public:
+    /** Creates the statistics file; called by the loader. */
+    static bool create(const char *path, GSTable *gsTable,
+        size_t sandboxSize);
+    /** Returns a fresh record for a new thread, or null if none is left. */
+    static JITThreadStatistics *claimThread();
+
+    static void recordFixup(GSTableEntry::IndexType index, size_t bytes);
+    static void recordReset(uint64_t nanoseconds, size_t bytes);
+    /** A member gave up on a group reset; dropped if it was the last. */
+    static void recordGroupResetTimeout(bool dropped);
+    /** Footprint of shared epochs (EGALITO_JIT_SHARED_EPOCH). */
+    static void recordEpochGroups(size_t threads, size_t groups,
+        size_t bytes);
+    static uint64_t now();
+};
+
+#endif
@@ -88,7 +88,8 @@ void ManageGS::setEntry(GSTable *gsTable, GSTableEntry::IndexType index,
 
     assert(index < JIT_TABLE_SIZE/sizeof(address_t));
     address_t *array = static_cast<address_t *>(gsTable->getTableAddress());
-    array[index] = value;
+    // the table may be shared: publish only after the code is written
+    __atomic_store_n(&array[index], value, __ATOMIC_RELEASE);
 }
 
 address_t ManageGS::getEntry(GSTableEntry::IndexType offset) {
@@ -5,31 +5,128 @@
 #include "conductor/setup.h"
 #include "conductor/conductor.h"
 #include "cminus/print.h"
+#include "runtime/jitstats.h"
 #include "runtime/managegs.h"
 
 extern ConductorSetup *egalito_conductor_setup;
+extern size_t egalito_jit_epoch_group_size;
 
 extern "C" void egalito_jit_gs_init(ShufflingSandbox *, GSTable *);
 
+// group that newly created threads join while it has room
+static JITEpochGroup *egalito_openEpochGroup;
+static int egalito_epochGroupLock;
+static size_t egalito_threadCount = 1;
+static size_t egalito_epochGroupCount = 1;
+static size_t egalito_epochGroupBytes;
+
+// each group maps a GS table, a JIT address table and two sandbox halves
+static size_t groupFootprint(ShufflingSandbox *sandbox) {
+    return 2*JIT_TABLE_SIZE + 2*sandbox->getBacking()->getSize();
+}
+
+// Start routine of a thread in an epoch group, so that it leaves the group
+// however it finishes (return, pthread_exit or cancellation).
+struct EpochGroupStart {
+    void *(*routine)(void *);
+    void *arg;
+    JITEpochGroup *group;
+    size_t slot;
+};
+
+static void leaveEpochGroup(void *arg) {
+    auto start = static_cast<EpochGroupStart *>(arg);
+    start->group->leave(start->slot);
+    auto threads = __atomic_sub_fetch(&egalito_threadCount, 1,
+        __ATOMIC_RELAXED);
+    JITStatistics::recordEpochGroups(threads,
+        __atomic_load_n(&egalito_epochGroupCount, __ATOMIC_RELAXED),
+        __atomic_load_n(&egalito_epochGroupBytes, __ATOMIC_RELAXED));
+    delete start;
+}
+
+static void *epochGroupThreadMain(void *arg) {
+    auto start = static_cast<EpochGroupStart *>(arg);
+    start->group->enter(start->slot);
+
+    void *result = nullptr;
+    pthread_cleanup_push(leaveEpochGroup, start);
+    result = start->routine(start->arg);
+    pthread_cleanup_pop(1);
+    return result;
+}
+
 extern "C"
 int egalito_pthread_create(pthread_t *thread, const pthread_attr_t *attr,
     void *(*start_routine)(void *), void *arg) {
 
-    auto gsTable = new GSTable(*EgalitoTLS::getGSTable());
-    ManageGS::allocateBuffer(gsTable);
-    auto sandbox = egalito_conductor_setup->makeShufflingSandbox();
+    GSTable *gsTable = nullptr;
+    ShufflingSandbox *sandbox = nullptr;
+    void *JIT_addressTable = nullptr;
+    JITEpochGroup *group = nullptr;
+    size_t slot = 0;
+
+    auto groupSize = egalito_jit_epoch_group_size;
+    if(groupSize > 1) {
+        while(__atomic_exchange_n(&egalito_epochGroupLock, 1,
+            __ATOMIC_ACQUIRE));
+
+        if(!egalito_openEpochGroup) {
+            // the first thread to spawn opens a group with its own epoch
+            egalito_openEpochGroup = new JITEpochGroup(
+                EgalitoTLS::getGSTable(), EgalitoTLS::getSandbox(),
+                EgalitoTLS::getJITAddressTable(), groupSize,
+                JITEpochGroup::currentThread());
+            EgalitoTLS::setEpochGroup(egalito_openEpochGroup);
+            egalito_epochGroupBytes = groupFootprint(EgalitoTLS::getSandbox());
+        }
+        slot = egalito_openEpochGroup->claimSlot();
+        if(slot < groupSize) {
+            group = egalito_openEpochGroup;
+            gsTable = group->gsTable;
+            sandbox = group->sandbox;
+            JIT_addressTable = group->JIT_addressTable;
+        }
+    }
+
+    if(!group) {
+        gsTable = new GSTable(*EgalitoTLS::getGSTable());
+        ManageGS::allocateBuffer(gsTable);
+        sandbox = egalito_conductor_setup->makeShufflingSandbox();
 
-    egalito_jit_gs_init(sandbox, gsTable);
+        egalito_jit_gs_init(sandbox, gsTable);
 
-    auto JIT_addressTable = mmap(NULL, JIT_TABLE_SIZE, PROT_READ|PROT_WRITE,
-        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        JIT_addressTable = mmap(NULL, JIT_TABLE_SIZE, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if(groupSize > 1) {
+            group = new JITEpochGroup(gsTable, sandbox, JIT_addressTable,
+                groupSize, JITEpochGroup::SLOT_STARTING);
+            slot = 0;
+            egalito_openEpochGroup = group;
+            egalito_epochGroupCount++;
+            egalito_epochGroupBytes += groupFootprint(sandbox);
+        }
+    }
+
+    if(groupSize > 1) {
+        auto threads = __atomic_add_fetch(&egalito_threadCount, 1,
+            __ATOMIC_RELAXED);
+        JITStatistics::recordEpochGroups(threads, egalito_epochGroupCount,
+            egalito_epochGroupBytes);
+        __atomic_store_n(&egalito_epochGroupLock, 0, __ATOMIC_RELEASE);
+
+        // the thread leaves its group when it finishes
+        arg = new EpochGroupStart{start_routine, arg, group, slot};
+        start_routine = epochGroupThreadMain;
+    }
 
     auto JIT_resetThreshold = EgalitoTLS::getJITResetThreshold();
 
     // will be consumed before the child is spawned
     volatile size_t barrier = 0;
     EgalitoTLS child(&barrier, gsTable, sandbox, JIT_addressTable,
-        JIT_resetThreshold);
+        JIT_resetThreshold, group, JITStatistics::claimThread());
 
     EgalitoTLS::setChild(&child);
 
@@ -39,6 +136,20 @@ int egalito_pthread_create(pthread_t *thread, const pthread_attr_t *attr,
 
     EgalitoTLS::setChild(nullptr);
 
+    if(status != 0) {
+        // the child never ran, so it will not leave its group either
+        if(group) {
+            group->releaseSlot(slot);
+            delete static_cast<EpochGroupStart *>(arg);
+            auto threads = __atomic_sub_fetch(&egalito_threadCount, 1,
+                __ATOMIC_RELAXED);
+            JITStatistics::recordEpochGroups(threads,
+                __atomic_load_n(&egalito_epochGroupCount, __ATOMIC_RELAXED),
+                __atomic_load_n(&egalito_epochGroupBytes, __ATOMIC_RELAXED));
+        }
+        return status;
+    }
+
     while(!barrier);    // careful: no memory fence here
 
     return status;
@@ -0,0 +1,164 @@
+#include <algorithm>  // for std::min, std::max
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "alignment.h"
+#include "chunk/function.h"
+#include "elf/symbol.h"
+#include "util/feature.h"
+#include "log/log.h"
+
+AlignmentPolicy::AlignmentPolicy(size_t functionAlign,
+    size_t hotFunctionAlign, size_t loopAlign, size_t loopMaxSkip)
+    : functionAlign(functionAlign), hotFunctionAlign(hotFunctionAlign),
+    loopAlign(loopAlign), hotThreshold(1) {
+
+    if(!loopMaxSkip) loopMaxSkip = loopAlign ? loopAlign - 1 : 0;
+    this->loopMaxSkip = std::min(loopMaxSkip, getMaxNopSize());
+}
+
+AlignmentPolicy *AlignmentPolicy::makeFromEnvironment() {
+    auto policy = new AlignmentPolicy(
+        getFeatureValue("EGALITO_ALIGN_FUNCTIONS", 0),
+        getFeatureValue("EGALITO_ALIGN_HOT_FUNCTIONS", 0),
+        getFeatureValue("EGALITO_ALIGN_LOOPS", 0),
+        getFeatureValue("EGALITO_ALIGN_LOOP_MAX_SKIP", 0));
+    policy->setHotThreshold(getFeatureValue("EGALITO_ALIGN_HOT_THRESHOLD", 1));
+
+    if(auto filename = getenv("EGALITO_ALIGN_PROFILE")) {
+        if(!policy->loadProfile(filename)) {
+            LOG(0, "WARNING: can't read alignment profile [" << filename
+                << "], ignoring");
+        }
+    }
+    return policy;
+}
+
+bool AlignmentPolicy::loadProfile(const char *filename) {
+    std::ifstream file(filename);
+    if(!file) return false;
+    loadProfile(file);
+    LOG(1, "loaded " << profile.size() << " function counts from "
+        << filename);
+    return true;
+}
+
+void AlignmentPolicy::loadProfile(std::istream &stream) {
+    // each line is "<count> [<function name>]"
+    std::string line;
+    while(std::getline(stream, line)) {
+        auto open = line.find('[');
+        auto close = line.rfind(']');
+        if(open == std::string::npos || close == std::string::npos
+            || close < open) {
+
+            continue;
+        }
+
+        unsigned long count = std::strtoul(line.c_str(), nullptr, 0);
+        profile[line.substr(open + 1, close - open - 1)] += count;
+    }
+}
+
+bool AlignmentPolicy::isHot(Function *function) const {
+    auto it = profile.find(function->getName());
+    return it != profile.end() && (*it).second >= hotThreshold;
+}
+
+size_t AlignmentPolicy::getFunctionAlignment(Function *function) const {
+    size_t alignment = 0;
+    if(functionAlign > 1) {
+        address_t original = function->getSymbol()
+            ? function->getSymbol()->getAddress() : function->getAddress();
+        alignment = getAddressAlignment(original, functionAlign);
+    }
+    if(hotFunctionAlign > 1 && isHot(function)) {
+        alignment = std::max(alignment, hotFunctionAlign);
+    }
+
+    auto it = required.find(function);
+    if(it != required.end()) {
+        alignment = std::max(alignment, (*it).second);
+    }
+    return alignment;
+}
+
+size_t AlignmentPolicy::getLoopAlignment(Function *function) const {
+    if(loopAlign <= 1 || !loopMaxSkip) return 0;
+    if(hasProfile() && !isHot(function)) return 0;
+    return loopAlign;
+}
+
+void AlignmentPolicy::requireAlignment(Function *function, size_t alignment) {
+    auto &value = required[function];
+    value = std::max(value, alignment);
+}
+
+size_t AlignmentPolicy::getMaxNopSize() {
+#if defined(ARCH_X86_64)
+    return 11;
+#elif defined(ARCH_AARCH64) || defined(ARCH_ARM) || defined(ARCH_RISCV)
+    return 4;
+#else
+    return 0;
+#endif
+}
+
+std::string AlignmentPolicy::makeNop(size_t size) {
+#if defined(ARCH_X86_64)
+    // the forms recommended by the Intel and AMD optimization manuals
+    static const char *const nops[] = {
+        "",
+        "\x90",
+        "\x66\x90",
+        "\x0f\x1f\x00",
+        "\x0f\x1f\x40\x00",
+        "\x0f\x1f\x44\x00\x00",
+        "\x66\x0f\x1f\x44\x00\x00",
+        "\x0f\x1f\x80\x00\x00\x00\x00",
+        "\x0f\x1f\x84\x00\x00\x00\x00\x00",
+        "\x66\x0f\x1f\x84\x00\x00\x00\x00\x00",
+        "\x66\x2e\x0f\x1f\x84\x00\x00\x00\x00\x00",
+        "\x66\x66\x2e\x0f\x1f\x84\x00\x00\x00\x00\x00",
+    };
+    if(size == 0 || size > getMaxNopSize()) return "";
+    return std::string(nops[size], size);
+#elif defined(ARCH_AARCH64)
+    return size == 4 ? std::string("\x1f\x20\x03\xd5", 4) : "";
+#elif defined(ARCH_ARM)
+    return size == 4 ? std::string("\x00\xf0\x20\xe3", 4) : "";
+#elif defined(ARCH_RISCV)
+    if(size == 4) return std::string("\x13\x00\x00\x00", 4);  // addi x0,x0,0
+    if(size == 2) return std::string("\x01\x00", 2);  // c.nop
+    return "";
+#else
+    return "";
+#endif
+}
+
+std::string AlignmentPolicy::makeNops(size_t size) {
+    std::string nops;
+    while(size > 0) {
+        auto nop = makeNop(std::min(size, getMaxNopSize()));
+        if(nop.empty()) nop = makeNop(2);
+        if(nop.empty() || nop.size() > size) {
+            nops.append(size, '\0');
+            break;
+        }
+        nops += nop;
+        size -= nop.size();
+    }
+    return nops;
+}
+
+void AlignmentPolicy::writeNops(char *output, size_t size) {
+    auto nops = makeNops(size);
+    std::memcpy(output, nops.data(), nops.size());
+}
+
+size_t AlignmentPolicy::getAddressAlignment(address_t address, size_t cap) {
+    // the largest power of two dividing address, at most cap
+    size_t alignment = 1;
+    while(alignment * 2 <= cap && !(address & alignment)) alignment <<= 1;
+    return alignment;
+}
@@ -0,0 +1,67 @@
+#ifndef EGALITO_TRANSFORM_ALIGNMENT_H
+#define EGALITO_TRANSFORM_ALIGNMENT_H
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include "types.h"
+
+class Function;
+
+/** Decides how generated code is aligned.
+
+    By default every function keeps the alignment its original ELF address
+    had, capped at functionAlign (0 disables function alignment). Functions
+    that a profile marks as hot are aligned to at least hotFunctionAlign.
+    Loop headers are aligned to loopAlign by AlignLoopsPass, but never
+    padded by more than loopMaxSkip bytes; once a profile is loaded only
+    hot functions get aligned loops.
+
+    Padding is filled with the longest NOPs the architecture has.
+*/
+class AlignmentPolicy {
+private:
+    size_t functionAlign;
+    size_t hotFunctionAlign;
+    size_t loopAlign;
+    size_t loopMaxSkip;
+    unsigned long hotThreshold;
+    std::map<std::string, unsigned long> profile;
+    std::map<Function *, size_t> required;
+public:
+    AlignmentPolicy(size_t functionAlign = 0, size_t hotFunctionAlign = 0,
+        size_t loopAlign = 0, size_t loopMaxSkip = 0);
+
+    /** Reads the EGALITO_ALIGN_* environment variables. */
+    static AlignmentPolicy *makeFromEnvironment();
+
+    /** Reads per-function counts as printed by etprofile. */
+    bool loadProfile(const char *filename);
+    void loadProfile(std::istream &stream);
+    void setHotThreshold(unsigned long threshold)
+        { hotThreshold = threshold; }
+    bool hasProfile() const { return !profile.empty(); }
+    bool isHot(Function *function) const;
+
+    size_t getFunctionAlignment(Function *function) const;
+    size_t getLoopAlignment(Function *function) const;
+    size_t getLoopMaxSkip() const { return loopMaxSkip; }
+    bool hasLoopAlignment() const { return loopAlign > 1; }
+
+    /** Function must start at a multiple of alignment, e.g. because
+        offsets inside it were padded relative to its start. */
+    void requireAlignment(Function *function, size_t alignment);
+
+    /** Longest single NOP instruction on this architecture. */
+    static size_t getMaxNopSize();
+    /** One NOP instruction of exactly size bytes, or "" if none exists. */
+    static std::string makeNop(size_t size);
+    /** Fills size bytes with as few NOPs as possible. Bytes that no NOP
+        can cover (e.g. 2 bytes on AArch64) are zero. */
+    static std::string makeNops(size_t size);
+    static void writeNops(char *output, size_t size);
+
+    static size_t getAddressAlignment(address_t address, size_t cap);
+};
+
+#endif
@@ -1,8 +1,8 @@
 #include <iostream>  // for std::cout.flush()
 #include <iomanip>
 #include <cstdio>  // for std::fflush
-#include <cstring>
 #include "generator.h"
+#include "alignment.h"
 #include "chunk/cache.h"
 #include "operation/mutator.h"
 #include "operation/find2.h"
@@ -44,10 +44,12 @@ void GeneratorHelper<ChunkType>::assignAddress(ChunkType *chunk, Slot slot) {
 template <>
 void GeneratorHelper<Function>::copyToSandbox(Function *function, Sandbox *sandbox) {
     if(sandbox->supportsDirectWrites()) {
-        char *output = reinterpret_cast<char *>(function->getAddress());
+        auto backing = static_cast<SandboxBackingImpl *>(sandbox->getBacking());
+        char *output = reinterpret_cast<char *>(
+            backing->getWritableAddress(function->getAddress()));
         if(auto cache = function->getCache()) {
             //LOG(0, "generating with Cache: " << function->getName());
-            cache->copyAndFix(output);
+            cache->copyAndFix(output, function->getAddress());
             return;
         }
         for(auto b : CIter::children(function)) {
@@ -80,10 +82,12 @@ void GeneratorHelper<Function>::copyToSandbox(Function *function, Sandbox *sandb
 template <>
 void GeneratorHelper<PLTTrampoline>::copyToSandbox(PLTTrampoline *trampoline, Sandbox *sandbox) {
     if(sandbox->supportsDirectWrites()) {
-        char *output = reinterpret_cast<char *>(trampoline->getAddress());
+        auto backing = static_cast<SandboxBackingImpl *>(sandbox->getBacking());
+        char *output = reinterpret_cast<char *>(
+            backing->getWritableAddress(trampoline->getAddress()));
         if(auto cache = trampoline->getCache()) {
             //LOG(0, "generating with Cache: " << function->getName());
-            cache->copyAndFix(output);
+            cache->copyAndFix(output, trampoline->getAddress());
             return;
         }
         trampoline->writeTo(output);
@@ -109,25 +113,18 @@ template <typename ChunkType>
 void GeneratorHelper<ChunkType>::addPaddingBytes(ChunkType *chunk, Sandbox *sandbox) {
     auto assignedSize = chunk->getAssignedPosition()->getAssignedSize();
     if(assignedSize > chunk->getSize()) {
-        // Add appropriate number of NOP bytes
+        // alignment padding, or rounding up by the allocator
         auto padding = assignedSize - chunk->getSize();
         if(sandbox->supportsDirectWrites()) {
-            char *output = reinterpret_cast<char *>(chunk->getAddress());
-#ifdef ARCH_X86_64
-            std::memset(output + chunk->getSize(), 0x90, padding);
-#else
-            // Should use platform-specific NOP here
-            std::memset(output + chunk->getSize(), 0x0, padding);
-#endif
+            auto backing = static_cast<SandboxBackingImpl *>(
+                sandbox->getBacking());
+            char *output = reinterpret_cast<char *>(
+                backing->getWritableAddress(chunk->getAddress()));
+            AlignmentPolicy::writeNops(output + chunk->getSize(), padding);
         }
         else {
             auto backing = static_cast<MemoryBufferBacking *>(sandbox->getBacking());
-#ifdef ARCH_X86_64
-            backing->getBuffer().append(padding, static_cast<char>(0x90));
-#else
-            // Should use platform-specific NOP here
-            backing->getBuffer().append(padding, static_cast<char>(0x0));
-#endif
+            backing->getBuffer() += AlignmentPolicy::makeNops(padding);
         }
     }
     else if(assignedSize < chunk->getSize()) {
@@ -184,11 +181,13 @@ std::vector<Function *> Generator::pickFunctionOrder(Module *module) {
 void Generator::assignAddresses(Module *module) {
     auto order = pickFunctionOrder(module);
     for(auto f : order) {
+        if(alignment) padToAlignment(alignment->getFunctionAlignment(f));
         auto slot = sandbox->allocate(f->getSize());
         LOG(2, "    alloc 0x" << std::hex << slot.getAddress()
             << " for [" << f->getName()
             << "] size " << std::dec << f->getSize());
         GeneratorHelper<Function>().assignAddress(f, slot);
+        lastSlot = f->getAssignedPosition();
     }
 
     if(module->getPLTList()) {
@@ -200,6 +199,7 @@ void Generator::assignAddresses(Module *module) {
                 << " for [" << plt->getName()
                 << "] size " << std::dec << plt->getSize());
             GeneratorHelper<PLTTrampoline>().assignAddress(plt, slot);
+            lastSlot = plt->getAssignedPosition();
         }
     }
 
@@ -207,6 +207,24 @@ void Generator::assignAddresses(Module *module) {
     module->accept(&clearSpatial);
 }
 
+void Generator::padToAlignment(size_t boundary) {
+    // the first chunk starts wherever the sandbox does
+    if(boundary <= 1 || !lastSlot) return;
+
+    auto last = lastSlot->getSlot();
+    address_t end = last.getAddress() + last.getSize();
+    size_t padding = (boundary - end % boundary) % boundary;
+    if(!padding) return;
+
+    // padding belongs to the previous chunk, which fills it with NOPs
+    auto slot = sandbox->allocate(padding);
+    if(slot.getAddress() != end) {
+        LOG(1, "    sandbox is not contiguous, can't align to " << boundary);
+        return;
+    }
+    lastSlot->set(Slot(last.getAddress(), last.getSize() + slot.getSize()));
+}
+
 void Generator::generateCode(Module *module) {
     LOG(1, "Copying code into sandbox");
     auto order = pickFunctionOrder(module);
@@ -241,7 +259,14 @@ void Generator::generateCodeForFunction(Function *function) {
 
 // These two functions are only used during JIT-Shuffling
 void Generator::pickFunctionAddressInSandbox(Function *function) {
-    auto slot = sandbox->allocate(function->getSize());
+    // there is no previous chunk to pad here, so the sandbox must align
+    size_t boundary = alignment ? alignment->getFunctionAlignment(function)
+        : 0;
+    auto slot = sandbox->allocate(function->getSize(), boundary);
+    if(boundary > 1 && slot.getAddress() % boundary) {
+        LOG(1, "    sandbox can't align [" << function->getName()
+            << "] to " << boundary);
+    }
     //ChunkMutator(function).setPosition(slot.getAddress());
     PositionManager::setAddress(function, slot.getAddress());
 }
@@ -5,14 +5,22 @@
 #include "sandbox.h"
 
 class PLTTrampoline;
+class SlotPosition;
+class AlignmentPolicy;
 
 class Generator {
 private:
     Sandbox *sandbox;
     bool useDisps;
+    AlignmentPolicy *alignment;
+    SlotPosition *lastSlot;  // most recently assigned, absorbs padding
 public:
     Generator(Sandbox *sandbox, bool useDisps = true)
-        : sandbox(sandbox), useDisps(useDisps) {}
+        : sandbox(sandbox), useDisps(useDisps), alignment(nullptr),
+        lastSlot(nullptr) {}
+
+    void setAlignmentPolicy(AlignmentPolicy *alignment)
+        { this->alignment = alignment; }
 
     void assignAddresses(Program *program);
     void generateCode(Program *program);
@@ -34,6 +42,7 @@ private:
     std::vector<Function *> pickFunctionOrder(Module *module);
     void pickFunctionAddressInSandbox(Function *function);
     void pickPLTAddressInSandbox(PLTTrampoline *trampoline);
+    void padToAlignment(size_t boundary);
 };
 
 #endif
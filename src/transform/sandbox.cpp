@@ -1,10 +1,21 @@
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <set>
+#include <pthread.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include "sandbox.h"
 #include "chunk/module.h"
 #include "config.h"
 
+#undef DEBUG_GROUP
+#define DEBUG_GROUP dassign
+#include "log/log.h"
+
 MemoryBacking::MemoryBacking(address_t address, size_t size)
     : SandboxBackingImpl(address, size) {
 
@@ -34,6 +45,174 @@ void MemoryBacking::recreate() {
     std::memset((void *)getBase(), 0, getSize());
 }
 
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+// every live DualMappedBacking, so that a forked child can find them
+static std::mutex dualMappedLock;
+static std::set<DualMappedBacking *> dualMappedBackings;
+
+static int createSandboxFile(size_t size) {
+    int fd = syscall(SYS_memfd_create, "egalito-sandbox", MFD_CLOEXEC);
+    if(fd < 0) return -1;
+    if(ftruncate(fd, size) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+DualMappedBacking::DualMappedBacking(address_t address, size_t size)
+    : SandboxBackingImpl(address, size), dirtyStart(0), dirtyEnd(0),
+    usedEnd(address) {
+
+    int fd = createSandboxFile(size);
+    if(fd < 0) throw std::bad_alloc();
+
+    void *executable = mmap((void *)address, size,
+        PROT_READ | PROT_EXEC, MAP_SHARED
+#ifdef ARCH_X86_64
+        | MAP_32BIT
+#endif
+        , fd, 0);
+    if(executable == MAP_FAILED) {
+        close(fd);
+        throw std::bad_alloc();
+    }
+    void *writable = mmap(nullptr, size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // the mappings keep the file alive
+    if(writable == MAP_FAILED) {
+        munmap(executable, size);
+        throw std::bad_alloc();
+    }
+
+    address_t base = reinterpret_cast<address_t>(executable);
+    if(base != address) {
+        munmap(executable, size);
+        munmap(writable, size);
+        throw "Sandbox: Overlapping with other regions?";
+    }
+    setBase(base);
+    setWriteOffset(reinterpret_cast<address_t>(writable) - base);
+    usedEnd = base;
+    registerForFork();
+}
+
+// copies share the mappings (SandboxImpl holds its backing by value)
+DualMappedBacking::DualMappedBacking(const DualMappedBacking &other)
+    : SandboxBackingImpl(other), dirtyStart(other.dirtyStart),
+    dirtyEnd(other.dirtyEnd), usedEnd(other.usedEnd) {
+
+    registerForFork();
+}
+
+DualMappedBacking::~DualMappedBacking() {
+    std::lock_guard<std::mutex> lock(dualMappedLock);
+    dualMappedBackings.erase(this);
+}
+
+void DualMappedBacking::registerForFork() {
+    static std::once_flag atfork;
+    std::call_once(atfork, [] () {
+        pthread_atfork(&lockForFork, &unlockForFork, &detachAfterFork);
+    });
+
+    std::lock_guard<std::mutex> lock(dualMappedLock);
+    dualMappedBackings.insert(this);
+}
+
+void DualMappedBacking::lockForFork() {
+    dualMappedLock.lock();
+}
+
+void DualMappedBacking::unlockForFork() {
+    dualMappedLock.unlock();
+}
+
+// Runs in the child with dualMappedLock still held from lockForFork().
+// Both views are MAP_SHARED, so without this the child and parent would
+// write new code over each other. The child's tables only point at code
+// finished before the fork; code the parent writes during the copy may or
+// may not be seen, and is never used by the child.
+void DualMappedBacking::detachAfterFork() {
+    std::map<address_t, std::vector<DualMappedBacking *>> byBase;
+    for(auto backing : dualMappedBackings) {
+        byBase[backing->getBase()].push_back(backing);
+    }
+
+    for(auto &it : byBase) {
+        auto &copies = it.second;
+        address_t used = it.first;
+        for(auto backing : copies) {
+            if(backing->usedEnd > used) used = backing->usedEnd;
+        }
+
+        auto first = copies.front();
+        first->copyIntoNewFile(used - it.first);
+        for(auto backing : copies) {
+            backing->setWriteOffset(
+                first->getWritableAddress(it.first) - it.first);
+        }
+    }
+
+    dualMappedLock.unlock();
+}
+
+void DualMappedBacking::copyIntoNewFile(size_t used) {
+    address_t base = getBase();
+    size_t size = getSize();
+
+    int fd = createSandboxFile(size);
+    void *writable = (fd < 0) ? MAP_FAILED
+        : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(writable == MAP_FAILED) {
+        LOG(0, "Sandbox: can't copy the sandbox in a forked child");
+        std::abort();
+    }
+    std::memcpy(writable, (void *)getWritableAddress(base), used);
+
+    void *executable = mmap((void *)base, size, PROT_READ | PROT_EXEC,
+        MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+    if(executable == MAP_FAILED) {
+        LOG(0, "Sandbox: can't remap the sandbox in a forked child");
+        std::abort();
+    }
+
+    munmap((void *)getWritableAddress(base), size);
+    setWriteOffset(reinterpret_cast<address_t>(writable) - base);
+}
+
+void DualMappedBacking::markDirty(address_t address, size_t size) {
+    if(dirtyStart == dirtyEnd) {
+        dirtyStart = address;
+        dirtyEnd = address + size;
+    }
+    else {
+        if(address < dirtyStart) dirtyStart = address;
+        if(address + size > dirtyEnd) dirtyEnd = address + size;
+    }
+    if(address + size > usedEnd) usedEnd = address + size;
+}
+
+void DualMappedBacking::finalize() {
+#ifndef ARCH_X86_64
+    // the instruction cache does not snoop writes through the other view
+    if(dirtyStart != dirtyEnd) {
+        __builtin___clear_cache(reinterpret_cast<char *>(dirtyStart),
+            reinterpret_cast<char *>(dirtyEnd));
+    }
+#endif
+    dirtyStart = dirtyEnd = 0;
+}
+
+void DualMappedBacking::recreate() {
+    std::memset((void *)getWritableAddress(getBase()), 0, getSize());
+    usedEnd = getBase();
+}
+
 MemoryBufferBacking::MemoryBufferBacking(address_t address, size_t size)
     : SandboxBackingImpl(address, size) {
 
@@ -1,6 +1,8 @@
 #ifndef EGALITO_TRANSFORM_SANDBOX_H
 #define EGALITO_TRANSFORM_SANDBOX_H
 
+#include <iterator>
+#include <map>
 #include <vector>
 #include <new>
 #include <string>
@@ -28,16 +30,23 @@ class SandboxBackingImpl : public SandboxBacking {
 private:
     address_t base;
     size_t size;
+    address_t writeOffset;
 public:
-    SandboxBackingImpl(address_t base, size_t size) : base(base), size(size) {}
+    SandboxBackingImpl(address_t base, size_t size)
+        : base(base), size(size), writeOffset(0) {}
 
     virtual address_t getBase() const { return base; }
     virtual std::string &getBuffer()
         { throw "SandboxBackingImplt::getBuffer() is unimplemented"; }
     virtual size_t getSize() const { return size; }
     virtual bool supportsDirectWrites() const = 0;
+
+    /** Where to write the bytes that will execute at address. */
+    address_t getWritableAddress(address_t address) const
+        { return address + writeOffset; }
 protected:
     void setBase(address_t base) { this->base = base; }
+    void setWriteOffset(address_t offset) { writeOffset = offset; }
 };
 
 // Mapped at final base address, can directly write to mem addresses.
@@ -53,6 +62,40 @@ public:
     virtual void recreate();
 };
 
+// The same memory file is mapped twice: read/execute at the final base
+// address, and read/write elsewhere. Code is written through the writable
+// view, so finalize() and reopen() never change page permissions.
+// A forked child gets its own copy of the file, so that neither process
+// writes code the other is running.
+class DualMappedBacking : public SandboxBackingImpl {
+private:
+    address_t dirtyStart, dirtyEnd;     // written since the last finalize()
+    address_t usedEnd;                  // written since the last recreate()
+public:
+    /** May throw std::bad_alloc. */
+    DualMappedBacking(address_t address, size_t size);
+    DualMappedBacking(const DualMappedBacking &other);
+    virtual ~DualMappedBacking();
+
+    virtual bool supportsDirectWrites() const { return true; }
+
+    /** Records that code will be written into [address, address + size),
+        so that finalize() only has to flush that range.
+    */
+    void markDirty(address_t address, size_t size);
+
+    virtual void finalize();
+    virtual bool reopen() { return true; }
+    virtual void recreate();
+private:
+    void registerForFork();
+    void copyIntoNewFile(size_t used);
+
+    static void lockForFork();
+    static void unlockForFork();
+    static void detachAfterFork();
+};
+
 // Not mapped at final address, please write into the buffer instead.
 class MemoryBufferBacking : public SandboxBackingImpl {
 private:
@@ -78,6 +121,8 @@ public:
 
     /** May throw std::bad_alloc. */
     Slot allocate(size_t request);
+    /** Only allocators with a free list reuse the space. */
+    void free(address_t) {}
 };
 
 template <typename Backing>
@@ -145,12 +190,234 @@ Slot AlignedWatermarkAllocator<Backing>::allocate(size_t request) {
     return Slot(region, request);
 }
 
+struct SandboxFragmentation {
+    size_t used;            // bytes in live slots
+    size_t free;            // bytes on the free list
+    size_t tail;            // bytes above the watermark
+    size_t largest;         // largest single allocation that would succeed
+    size_t freeBlocks;
+
+    /** 0 when all unused space is contiguous, approaching 1 as it splits. */
+    double getFragmentation() const
+        { return (free + tail) ? 1.0 - double(largest) / (free + tail) : 0; }
+};
+
+/** Allocator that can free individual slots, so single functions can be
+    re-JIT'd without resetting the whole sandbox. Requests are rounded up
+    to the size-class granularity. Freed slots are coalesced with their
+    neighbours and reused best-fit before the watermark is bumped.
+*/
+template <typename Backing>
+class FreeListAllocator : public SandboxAllocator<Backing> {
+public:
+    struct Move {
+        address_t from;
+        address_t to;
+        size_t size;
+    };
+private:
+    typedef std::map<address_t, size_t> BlockMap;
+    address_t base;
+    address_t watermark;
+    size_t granularity;
+    BlockMap live;
+    BlockMap freeByAddress;
+    std::multimap<size_t, address_t> freeBySize;
+public:
+    FreeListAllocator(Backing *backing, size_t granularity = 0x10)
+        : SandboxAllocator<Backing>(backing),
+        base(backing->getBase()), watermark(backing->getBase()),
+        granularity(granularity) {}
+
+    Slot allocate(size_t request);
+    /** Places the slot at a multiple of alignment; the space skipped to
+        get there goes on the free list. */
+    Slot allocate(size_t request, size_t alignment);
+    /** Frees the live slot starting at address. */
+    void free(address_t address);
+    address_t getCurrent() const { return watermark; }
+    void reset();
+
+    /** Slides live slots down towards the base, in address order, and
+        returns the moves made. Code is not touched: the caller must move
+        or regenerate each slot (relative references change).
+    */
+    std::vector<Move> compact();
+    SandboxFragmentation getFragmentation() const;
+private:
+    void addFree(address_t address, size_t size);
+    void removeFree(typename BlockMap::iterator it);
+};
+
+template <typename Backing>
+Slot FreeListAllocator<Backing>::allocate(size_t request) {
+    request = (request + granularity-1) / granularity * granularity;
+    if(request == 0) request = granularity;
+
+    auto fit = freeBySize.lower_bound(request);
+    if(fit != freeBySize.end()) {
+        auto address = fit->second;
+        auto size = fit->first;
+        removeFree(freeByAddress.find(address));
+        if(size > request) addFree(address + request, size - request);
+        live[address] = request;
+        return Slot(address, request);
+    }
+
+    size_t max = this->backing->getBase() + this->backing->getSize();
+    if(watermark + request > max) {
+        throw std::bad_alloc();
+    }
+
+    address_t region = watermark;
+    watermark += request;
+    live[region] = request;
+    return Slot(region, request);
+}
+
+template <typename Backing>
+Slot FreeListAllocator<Backing>::allocate(size_t request, size_t alignment) {
+    if(alignment <= granularity) return allocate(request);
+    request = (request + granularity-1) / granularity * granularity;
+    if(request == 0) request = granularity;
+
+    // the smallest free block that still fits once aligned
+    for(auto fit = freeBySize.lower_bound(request);
+        fit != freeBySize.end(); ++fit) {
+
+        auto address = fit->second;
+        auto size = fit->first;
+        address_t region = (address + alignment-1) / alignment * alignment;
+        if(region + request > address + size) continue;
+
+        removeFree(freeByAddress.find(address));
+        if(region > address) addFree(address, region - address);
+        if(address + size > region + request) {
+            addFree(region + request, address + size - (region + request));
+        }
+        live[region] = request;
+        return Slot(region, request);
+    }
+
+    size_t max = this->backing->getBase() + this->backing->getSize();
+    address_t region = (watermark + alignment-1) / alignment * alignment;
+    if(region + request > max) {
+        throw std::bad_alloc();
+    }
+
+    if(region > watermark) addFree(watermark, region - watermark);
+    watermark = region + request;
+    live[region] = request;
+    return Slot(region, request);
+}
+
+template <typename Backing>
+void FreeListAllocator<Backing>::free(address_t address) {
+    auto it = live.find(address);
+    if(it == live.end()) {
+        throw "FreeListAllocator: freeing a slot that is not allocated";
+    }
+    auto size = it->second;
+    live.erase(it);
+
+    // coalesce with the free neighbours on both sides
+    auto next = freeByAddress.lower_bound(address);
+    if(next != freeByAddress.begin()) {
+        auto prev = std::prev(next);
+        if(prev->first + prev->second == address) {
+            address = prev->first;
+            size += prev->second;
+            removeFree(prev);
+        }
+    }
+    if(next != freeByAddress.end() && address + size == next->first) {
+        size += next->second;
+        removeFree(next);
+    }
+
+    if(address + size == watermark) {
+        watermark = address;
+    }
+    else {
+        addFree(address, size);
+    }
+}
+
+template <typename Backing>
+void FreeListAllocator<Backing>::reset() {
+    watermark = base;
+    live.clear();
+    freeByAddress.clear();
+    freeBySize.clear();
+}
+
+template <typename Backing>
+std::vector<typename FreeListAllocator<Backing>::Move>
+    FreeListAllocator<Backing>::compact() {
+
+    std::vector<Move> moves;
+    BlockMap moved;
+    address_t cursor = base;
+    for(const auto &block : live) {
+        if(block.first != cursor) {
+            moves.push_back(Move{block.first, cursor, block.second});
+        }
+        moved[cursor] = block.second;
+        cursor += block.second;
+    }
+    live.swap(moved);
+    freeByAddress.clear();
+    freeBySize.clear();
+    watermark = cursor;
+    return moves;
+}
+
+template <typename Backing>
+SandboxFragmentation FreeListAllocator<Backing>::getFragmentation() const {
+    SandboxFragmentation stats = {};
+    for(const auto &block : live) stats.used += block.second;
+    for(const auto &block : freeByAddress) stats.free += block.second;
+    stats.freeBlocks = freeByAddress.size();
+    stats.tail = this->backing->getBase() + this->backing->getSize()
+        - watermark;
+    stats.largest = stats.tail;
+    if(!freeBySize.empty() && freeBySize.rbegin()->first > stats.largest) {
+        stats.largest = freeBySize.rbegin()->first;
+    }
+    return stats;
+}
+
+template <typename Backing>
+void FreeListAllocator<Backing>::addFree(address_t address, size_t size) {
+    freeByAddress[address] = size;
+    freeBySize.insert(std::make_pair(size, address));
+}
+
+template <typename Backing>
+void FreeListAllocator<Backing>::removeFree(typename BlockMap::iterator it) {
+    auto range = freeBySize.equal_range(it->second);
+    for(auto s = range.first; s != range.second; ++s) {
+        if(s->second == it->first) {
+            freeBySize.erase(s);
+            break;
+        }
+    }
+    freeByAddress.erase(it);
+}
+
 class Sandbox {
 public:
     virtual ~Sandbox() {}
 
     /** May throw std::bad_alloc. */
     virtual Slot allocate(size_t request) = 0;
+    /** As above, starting at a multiple of alignment if the allocator can
+        skip space to get there. Others ignore alignment; see
+        Generator::padToAlignment() for contiguous sandboxes.
+    */
+    virtual Slot allocate(size_t request, size_t alignment) = 0;
+    /** Returns a slot to the allocator, if it can reuse the space. */
+    virtual void free(const Slot &slot) = 0;
     virtual void finalize() = 0;
     virtual bool reopen() = 0;
 
@@ -169,8 +436,9 @@ public:
     SandboxImpl(const Backing &backing)
         : backing(backing), alloc(Allocator(&this->backing)) {}
 
-    virtual Slot allocate(size_t request)
-        { return alloc.allocate(request); }
+    virtual Slot allocate(size_t request);
+    virtual Slot allocate(size_t request, size_t alignment);
+    virtual void free(const Slot &slot) { alloc.free(slot.getAddress()); }
     virtual void finalize() { backing.finalize(); }
     virtual bool reopen() { return backing.reopen(); }
 
@@ -181,38 +449,105 @@ public:
 
 private:
     void recreate(id<MemoryBacking>);
+    void recreate(id<DualMappedBacking>);
+    template <typename T>
+    Slot allocateAligned(id<T>, size_t request, size_t)
+        { return alloc.allocate(request); }
+    Slot allocateAligned(id<FreeListAllocator<Backing>>, size_t request,
+        size_t alignment) { return alloc.allocate(request, alignment); }
+    template <typename T>
+    void markAllocated(id<T>, const Slot &) {}
+    void markAllocated(id<DualMappedBacking>, const Slot &slot)
+        { backing.markDirty(slot.getAddress(), slot.getSize()); }
 };
 
+template <typename Backing, typename Allocator>
+Slot SandboxImpl<Backing, Allocator>::allocate(size_t request) {
+    auto slot = alloc.allocate(request);
+    markAllocated(id<Backing>(), slot);
+    return slot;
+}
+
+template <typename Backing, typename Allocator>
+Slot SandboxImpl<Backing, Allocator>::allocate(size_t request,
+    size_t alignment) {
+
+    auto slot = allocateAligned(id<Allocator>(), request, alignment);
+    markAllocated(id<Backing>(), slot);
+    return slot;
+}
+
 template <typename Backing, typename Allocator>
 void SandboxImpl<Backing, Allocator>::recreate(id<MemoryBacking>) {
     backing.recreate(/*alloc.getCurrent()*/);
     alloc.reset();
 }
 
+template <typename Backing, typename Allocator>
+void SandboxImpl<Backing, Allocator>::recreate(id<DualMappedBacking>) {
+    backing.recreate();
+    alloc.reset();
+}
+
 template <typename SandboxImplType>
 class DualSandbox : public Sandbox {
 private:
     SandboxImplType *sandbox[2];
     size_t i;
+    std::vector<Slot> retired;  // freed by the next freeRetired()
 
 public:
     DualSandbox(SandboxImplType *one, SandboxImplType *other)
         : sandbox{one, other}, i(0) {}
     void flip() { i^= 1; }
+    /** The half that is not receiving new code. */
+    SandboxImplType *getInactive() const { return sandbox[i ^ 1]; }
     //Sandbox *get() const { return sandbox[i]; }
 
     virtual Slot allocate(size_t request)
         { return sandbox[i]->allocate(request); }
+    virtual Slot allocate(size_t request, size_t alignment)
+        { return sandbox[i]->allocate(request, alignment); }
+    virtual void free(const Slot &slot)
+        { sandbox[contains(slot.getAddress()) ? i : i^1]->free(slot); }
     virtual void finalize() { sandbox[i]->finalize(); }
     virtual bool reopen() { return sandbox[i]->reopen(); }
-    void recreate() const { sandbox[i]->recreate(); }
+    void recreate();
     virtual SandboxBacking *getBacking() { return sandbox[i]->getBacking(); }
     virtual bool supportsDirectWrites() const
         { return sandbox[i]->supportsDirectWrites(); }
+
+    /** Defers freeing a slot whose code may still be running (returned
+        to, say) until the next call to freeRetired().
+    */
+    void retire(const Slot &slot) { retired.push_back(slot); }
+    void freeRetired();
+private:
+    bool contains(address_t address) {
+        auto backing = sandbox[i]->getBacking();
+        return address - backing->getBase() < backing->getSize();
+    }
 };
 
+template <typename SandboxImplType>
+void DualSandbox<SandboxImplType>::recreate() {
+    // slots in the current half are gone already
+    std::vector<Slot> kept;
+    for(const auto &slot : retired) {
+        if(!contains(slot.getAddress())) kept.push_back(slot);
+    }
+    retired.swap(kept);
+    sandbox[i]->recreate();
+}
+
+template <typename SandboxImplType>
+void DualSandbox<SandboxImplType>::freeRetired() {
+    for(const auto &slot : retired) free(slot);
+    retired.clear();
+}
+
 using ShufflingSandbox = DualSandbox<
-    SandboxImpl<MemoryBacking, WatermarkAllocator<MemoryBacking>>>;
+    SandboxImpl<DualMappedBacking, FreeListAllocator<DualMappedBacking>>>;
 
 /*class SandboxBuilder {
 public:
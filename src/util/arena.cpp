@@ -0,0 +1,19 @@
+#include <algorithm>
+#include "arena.h"
+
+void *Arena::allocate(size_t size, size_t align) {
+    size_t offset = (used + align - 1) & ~(align - 1);
+    if(blocks.empty() || offset + size > blockSize) {
+        // oversized requests get a block of their own
+        blocks.push_back(new char[std::max(size, blockSize)]);
+        offset = 0;
+    }
+    used = offset + size;
+    return blocks.back() + offset;
+}
+
+void Arena::clear() {
+    for(auto block : blocks) delete [] block;
+    blocks.clear();
+    used = 0;
+}
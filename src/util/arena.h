@@ -0,0 +1,30 @@
+#ifndef EGALITO_UTIL_ARENA_H
+#define EGALITO_UTIL_ARENA_H
+
+#include <vector>
+#include <cstddef>
+
+/** Bump allocator that hands out memory from large blocks. Allocations
+    cannot be freed individually; all memory is released together by clear()
+    or the destructor. Destructors of objects placed here are not run.
+*/
+class Arena {
+private:
+    size_t blockSize;
+    std::vector<char *> blocks;
+    size_t used;    // bytes used in blocks.back()
+public:
+    Arena(size_t blockSize = 64 * 1024)
+        : blockSize(blockSize), used(0) {}
+    ~Arena() { clear(); }
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+    void clear();
+
+    size_t getBlockCount() const { return blocks.size(); }
+private:
+    Arena(const Arena &);
+    Arena &operator = (const Arena &);
+};
+
+#endif
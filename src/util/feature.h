@@ -7,4 +7,10 @@ static inline bool isFeatureEnabled(const char *name) {
     return variable && strtol(variable, nullptr, 0) != 0;
 }
 
+static inline long getFeatureValue(const char *name, long defaultValue) {
+    const char *variable = getenv(name);
+
+    return variable ? strtol(variable, nullptr, 0) : defaultValue;
+}
+
 #endif
@@ -0,0 +1,135 @@
+#include <thread>
+#include <cstdlib>  // for getenv
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <exception>
+#include <vector>
+#include "parallel.h"
+
+void parallelFor(size_t count, size_t threads,
+    const std::function<void (size_t)> &task) {
+
+    if(threads > count) threads = count;
+    if(threads <= 1) {
+        for(size_t i = 0; i < count; i ++) task(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&] () {
+        for(;;) {
+            size_t i = next++;
+            if(i >= count) break;
+            try {
+                task(i);
+            }
+            catch(...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!error) error = std::current_exception();
+                next = count;  // hand out no more work
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(size_t t = 1; t < threads; t ++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for(auto &thread : pool) {
+        thread.join();
+    }
+
+    if(error) std::rethrow_exception(error);
+}
+
+void parallelGraph(size_t count, const std::vector<std::vector<size_t>> &after,
+    size_t threads, const std::function<void (size_t)> &task) {
+
+    for(size_t i = 0; i < count; i ++) {
+        for(auto d : after[i]) {
+            if(d >= i) throw "parallelGraph: dependency is not an earlier task";
+        }
+    }
+
+    if(threads > count) threads = count;
+    if(threads <= 1) {
+        for(size_t i = 0; i < count; i ++) task(i);
+        return;
+    }
+
+    std::vector<size_t> waiting(count);
+    std::vector<std::vector<size_t>> unblocks(count);
+    std::set<size_t> ready;
+    for(size_t i = 0; i < count; i ++) {
+        waiting[i] = after[i].size();
+        for(auto d : after[i]) unblocks[d].push_back(i);
+        if(!waiting[i]) ready.insert(i);
+    }
+
+    size_t done = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable changed;
+    auto worker = [&] () {
+        std::unique_lock<std::mutex> lock(mutex);
+        for(;;) {
+            changed.wait(lock, [&] () {
+                return error || done == count || !ready.empty();
+            });
+            if(error || done == count) break;
+
+            size_t i = *ready.begin();
+            ready.erase(ready.begin());
+            lock.unlock();
+            try {
+                task(i);
+            }
+            catch(...) {
+                lock.lock();
+                if(!error) error = std::current_exception();
+                changed.notify_all();
+                continue;
+            }
+            lock.lock();
+
+            done ++;
+            for(auto next : unblocks[i]) {
+                if(--waiting[next] == 0) ready.insert(next);
+            }
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(size_t t = 1; t < threads; t ++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for(auto &thread : pool) {
+        thread.join();
+    }
+
+    if(error) std::rethrow_exception(error);
+}
+
+size_t getHardwareThreads() {
+    auto count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+size_t getThreadsFromEnvironment(const char *variable) {
+    const char *value = getenv(variable);
+    if(!value || !*value) return 1;
+    if(std::strcmp(value, "auto") == 0) return getHardwareThreads();
+
+    char *end = nullptr;
+    size_t count = std::strtoul(value, &end, 10);
+    if(*end) return 1;
+    return count ? count : getHardwareThreads();
+}
@@ -0,0 +1,34 @@
+#ifndef EGALITO_UTIL_PARALLEL_H
+#define EGALITO_UTIL_PARALLEL_H
+
+#include <functional>
+#include <vector>
+#include <cstddef>
+
+/** Runs task(0) .. task(count - 1) on up to the given number of threads
+    (including the calling thread) and waits for all of them. The first
+    exception thrown by a task is rethrown in the caller after every worker
+    has stopped. With threads <= 1, tasks run in order on the caller.
+*/
+void parallelFor(size_t count, size_t threads,
+    const std::function<void (size_t)> &task);
+
+/** Runs task(0) .. task(count - 1), starting each one only after the
+    tasks listed in after[i] have finished. Dependencies must have smaller
+    indices than the task that names them, so index order is always a valid
+    serial order, and it is the one used with threads <= 1. Ready tasks are
+    started lowest index first. Exceptions are handled as in parallelFor().
+*/
+void parallelGraph(size_t count, const std::vector<std::vector<size_t>> &after,
+    size_t threads, const std::function<void (size_t)> &task);
+
+/** Number of hardware threads available, at least 1. */
+size_t getHardwareThreads();
+
+/** Thread count from an environment variable such as
+    EGALITO_PARALLEL_PARSE: N means N threads, and 0 or "auto" means one per
+    hardware thread. Unset or unparsable values give 1 (serial).
+*/
+size_t getThreadsFromEnvironment(const char *variable);
+
+#endif
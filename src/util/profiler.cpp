@@ -0,0 +1,309 @@
+#include <algorithm>  // for std::sort
+#include <atomic>
+#include <chrono>
+#include <cstdio>  // for std::snprintf
+#include <cstdlib>  // for getenv, std::atexit
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <malloc.h>  // for mallinfo
+#include <sys/resource.h>  // for getrusage
+#include <time.h>  // for clock_gettime
+#include <unistd.h>  // for getpid
+#include "profiler.h"
+
+#undef DEBUG_GROUP
+#define DEBUG_GROUP dtiming
+#include "log/log.h"
+
+#include "cminus/print.h"
+
+extern bool egalito_init_done;
+
+EgalitoProfiler::Level EgalitoProfiler::maxLevel = EgalitoProfiler::LEVEL_NONE;
+
+static unsigned getThreadNumber() {
+    static std::atomic<unsigned> nextThread(1);
+    static thread_local unsigned thread = nextThread++;
+    return thread;
+}
+
+static void finishAtExit() {
+    EgalitoProfiler::getInstance()->finish();
+}
+
+bool EgalitoProfiler::parseEnvVar(const char *var) {
+    const char *env = getenv(var);
+    if(!env) return true;
+    return configure(env);
+}
+
+bool EgalitoProfiler::configure(const std::string &settings) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    maxLevel = LEVEL_NONE;
+    traceFile.clear();
+    summaryFile.clear();
+    printSummary = true;
+    if(settings.empty()) return false;
+
+    bool valid = true;
+    std::istringstream ss(settings);
+    std::string setting;
+    while(std::getline(ss, setting, ':')) {
+        if(!applySetting(setting)) {
+            LOG(0, "Unknown profile setting \"" << setting << '"');
+            valid = false;
+        }
+    }
+    if(maxLevel == LEVEL_NONE) maxLevel = LEVEL_PASS;
+    keepEvents = !traceFile.empty();
+    finished = false;
+
+    static bool registered = false;
+    if(!registered) {
+        std::atexit(finishAtExit);
+        registered = true;
+    }
+    return valid;
+}
+
+bool EgalitoProfiler::applySetting(const std::string &setting) {
+    if(setting == "pass") maxLevel = std::max(maxLevel, LEVEL_PASS);
+    else if(setting == "module") maxLevel = std::max(maxLevel, LEVEL_MODULE);
+    else if(setting == "function") {
+        maxLevel = std::max(maxLevel, LEVEL_FUNCTION);
+    }
+    else if(setting == "summary") printSummary = true;
+    else if(setting == "!summary") printSummary = false;
+    else if(setting.compare(0, 6, "trace=") == 0) {
+        traceFile = setting.substr(6);
+    }
+    else if(setting.compare(0, 8, "summary=") == 0) {
+        summaryFile = setting.substr(8);
+        printSummary = true;
+    }
+    else if(!setting.empty()) return false;
+    return true;
+}
+
+void EgalitoProfiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    eventList.clear();
+    totalMap.clear();
+    finished = false;
+}
+
+void EgalitoProfiler::record(const std::string &name, Level level,
+    long startUS, const Sample &sample) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(keepEvents) {
+        eventList.push_back({name, level, getThreadNumber(), startUS,
+            sample});
+    }
+
+    auto &total = totalMap[std::make_pair(level, name)];
+    total.count++;
+    total.sample.wallUS += sample.wallUS;
+    total.sample.cpuUS += sample.cpuUS;
+    total.sample.heapBytes += sample.heapBytes;
+    total.sample.peakRSSKB += sample.peakRSSKB;
+}
+
+EgalitoProfiler::Sample EgalitoProfiler::getTotal(Level level,
+    const std::string &prefix, unsigned long *count) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Sample sum = {};
+    if(count) *count = 0;
+    for(const auto &row : totalMap) {
+        if(row.first.first != level) continue;
+        if(row.first.second.compare(0, prefix.size(), prefix) != 0) continue;
+
+        const auto &total = row.second;
+        sum.wallUS += total.sample.wallUS;
+        sum.cpuUS += total.sample.cpuUS;
+        sum.heapBytes += total.sample.heapBytes;
+        sum.peakRSSKB += total.sample.peakRSSKB;
+        if(count) *count += total.count;
+    }
+    return sum;
+}
+
+void EgalitoProfiler::finish() {
+    if(maxLevel == LEVEL_NONE || finished) return;
+    finished = true;
+
+    if(!traceFile.empty()) {
+        std::ofstream file(traceFile.c_str());
+        if(file) {
+            writeTrace(file);
+        }
+        else {
+            LOG(0, "Can't write profile trace \"" << traceFile << '"');
+        }
+    }
+
+    if(printSummary) {
+        if(summaryFile.empty()) {
+            writeSummary(std::cerr);
+        }
+        else {
+            std::ofstream file(summaryFile.c_str());
+            if(file) writeSummary(file);
+        }
+    }
+}
+
+static void writeJSONString(std::ostream &stream, const std::string &s) {
+    stream << '"';
+    for(char c : s) {
+        if(c == '"' || c == '\\') stream << '\\' << c;
+        else if(static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof buffer, "\\u%04x", c);
+            stream << buffer;
+        }
+        else stream << c;
+    }
+    stream << '"';
+}
+
+void EgalitoProfiler::writeTrace(std::ostream &stream) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // complete ("X") events; see the Trace Event Format document
+    auto pid = getpid();
+    stream << "{\"traceEvents\":[";
+    for(size_t i = 0; i < eventList.size(); i++) {
+        const auto &event = eventList[i];
+        stream << (i ? ",\n" : "\n") << "{\"name\":";
+        writeJSONString(stream, event.name);
+        stream << ",\"cat\":\"" << getLevelName(event.level) << '"'
+            << ",\"ph\":\"X\",\"ts\":" << event.startUS
+            << ",\"dur\":" << event.sample.wallUS
+            << ",\"pid\":" << pid << ",\"tid\":" << event.thread
+            << ",\"args\":{\"cpu_us\":" << event.sample.cpuUS
+            << ",\"heap_bytes\":" << event.sample.heapBytes
+            << ",\"peak_rss_kb\":" << event.sample.peakRSSKB << "}}";
+    }
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void EgalitoProfiler::writeSummary(std::ostream &stream, size_t maxRows) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    typedef std::pair<const std::pair<Level, std::string>, Total> Row;
+    std::vector<const Row *> rows;
+    for(const auto &row : totalMap) rows.push_back(&row);
+    std::sort(rows.begin(), rows.end(), [] (const Row *a, const Row *b) {
+        return a->second.sample.wallUS > b->second.sample.wallUS;
+    });
+
+    char buffer[128];
+    std::snprintf(buffer, sizeof buffer, "%-9s %8s %11s %11s %11s %11s  %s",
+        "scope", "count", "wall ms", "cpu ms", "heap KB", "peak RSS KB",
+        "name");
+    stream << "profile summary:\n" << buffer << '\n';
+
+    for(size_t i = 0; i < rows.size() && i < maxRows; i++) {
+        const auto &total = rows[i]->second;
+        std::snprintf(buffer, sizeof buffer,
+            "%-9s %8lu %11.3f %11.3f %11ld %11ld  ",
+            getLevelName(rows[i]->first.first), total.count,
+            total.sample.wallUS / 1e3, total.sample.cpuUS / 1e3,
+            total.sample.heapBytes / 1024, total.sample.peakRSSKB);
+        stream << buffer << rows[i]->first.second << '\n';
+    }
+    if(rows.size() > maxRows) {
+        stream << "(" << (rows.size() - maxRows) << " more)\n";
+    }
+}
+
+long EgalitoProfiler::getWallTime() {
+    static auto origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin).count();
+}
+
+void EgalitoProfiler::takeSample(Sample &sample) {
+    sample.wallUS = getWallTime();
+
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    sample.cpuUS = cpu.tv_sec * 1000000L + cpu.tv_nsec / 1000;
+
+#if defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+#else
+    struct mallinfo info = mallinfo();
+#endif
+    sample.heapBytes = static_cast<long>(info.uordblks)
+        + static_cast<long>(info.hblkhd);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    sample.peakRSSKB = usage.ru_maxrss;
+}
+
+const char *EgalitoProfiler::getLevelName(Level level) {
+    switch(level) {
+    case LEVEL_PASS:        return "pass";
+    case LEVEL_MODULE:      return "module";
+    case LEVEL_FUNCTION:    return "function";
+    default:                return "none";
+    }
+}
+
+ProfileScope::ProfileScope(const char *name, EgalitoProfiler::Level level)
+    : name(name), level(level) {
+
+    begin();
+}
+
+ProfileScope::ProfileScope(const std::string &name,
+    EgalitoProfiler::Level level) : name(nullptr), level(level) {
+
+    begin();
+    if(active) nameString = name;
+}
+
+void ProfileScope::begin() {
+    active = EgalitoProfiler::isEnabled(level);
+    IF_LOG(1) if(level == EgalitoProfiler::LEVEL_PASS) active = true;
+
+    if(active) {
+        EgalitoProfiler::takeSample(start);
+        startUS = start.wallUS;
+    }
+}
+
+ProfileScope::~ProfileScope() {
+    if(!active) return;
+
+    EgalitoProfiler::Sample end;
+    EgalitoProfiler::takeSample(end);
+    EgalitoProfiler::Sample delta = {
+        end.wallUS - start.wallUS,
+        end.cpuUS - start.cpuUS,
+        end.heapBytes - start.heapBytes,
+        end.peakRSSKB - start.peakRSSKB
+    };
+    const char *label = name ? name : nameString.c_str();
+
+    if(EgalitoProfiler::isEnabled(level)) {
+        EgalitoProfiler::getInstance()->record(label, level, startUS, delta);
+    }
+
+    if(level == EgalitoProfiler::LEVEL_PASS) {
+        if(!egalito_init_done) {
+            CLOG(1, "TIMING: %8.6fs for \"%s\"", delta.wallUS / 1e6, label);
+        }
+        else {
+            IF_LOG(1) egalito_printf("timing: %d ms %d us for \"%s\"\n",
+                (int)(delta.wallUS / 1000), (int)(delta.wallUS % 1000), label);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef EGALITO_UTIL_PROFILER_H
+#define EGALITO_UTIL_PROFILER_H
+
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Records nested pass, module and function scopes.
+
+    Configured like EGALITO_DEBUG, from a colon-separated list in the
+    EGALITO_PROFILE environment variable:
+        pass, module, function  deepest kind of scope to record
+        trace=<file>            write Chrome trace-event JSON on exit
+        summary=<file>          write the summary table to a file
+        !summary                no summary (the default is stderr)
+    For example, EGALITO_PROFILE=module:trace=/tmp/egalito.json. A
+    non-empty variable without a level records passes.
+
+    Every scope records wall time, CPU time of its thread, the change in
+    heap bytes in use and the change in peak RSS. The heap and RSS are
+    process-wide, so they overlap when scopes run in parallel.
+*/
+class EgalitoProfiler {
+public:
+    enum Level {
+        LEVEL_NONE,
+        LEVEL_PASS,
+        LEVEL_MODULE,
+        LEVEL_FUNCTION
+    };
+
+    struct Sample {
+        long wallUS;
+        long cpuUS;
+        long heapBytes;
+        long peakRSSKB;
+    };
+private:
+    struct Event {
+        std::string name;
+        Level level;
+        unsigned thread;
+        long startUS;
+        Sample sample;
+    };
+    struct Total {
+        unsigned long count;
+        Sample sample;
+    };
+private:
+    static Level maxLevel;
+    std::mutex mutex;
+    bool keepEvents;
+    bool finished;
+    std::string traceFile;
+    std::string summaryFile;
+    bool printSummary;
+    std::vector<Event> eventList;
+    std::map<std::pair<Level, std::string>, Total> totalMap;
+public:
+    static EgalitoProfiler *getInstance() {
+        static EgalitoProfiler instance;
+        return &instance;
+    }
+
+    static bool isEnabled(Level level) { return level <= maxLevel; }
+
+    /** Returns false if the variable is set but malformed. */
+    bool parseEnvVar(const char *var = "EGALITO_PROFILE");
+    bool configure(const std::string &settings);
+    void reset();
+
+    void record(const std::string &name, Level level, long startUS,
+        const Sample &sample);
+    /** Sums every scope of the given level whose name starts with prefix. */
+    Sample getTotal(Level level, const std::string &prefix,
+        unsigned long *count = nullptr);
+
+    /** Writes the trace and summary. Only the first call does anything. */
+    void finish();
+    void writeTrace(std::ostream &stream);
+    void writeSummary(std::ostream &stream, size_t maxRows = 100);
+
+    static long getWallTime();
+    static void takeSample(Sample &sample);
+    static const char *getLevelName(Level level);
+private:
+    EgalitoProfiler() : keepEvents(false), finished(false),
+        printSummary(true) {}
+    bool applySetting(const std::string &setting);
+};
+
+/** Times everything until the end of the enclosing block. Scopes below
+    the configured level cost one comparison. Pass scopes also print the
+    old "TIMING:" line when the dtiming log group is enabled.
+*/
+class ProfileScope {
+private:
+    const char *name;
+    std::string nameString;
+    EgalitoProfiler::Level level;
+    bool active;
+    long startUS;
+    EgalitoProfiler::Sample start;
+public:
+    ProfileScope(const char *name, EgalitoProfiler::Level level);
+    ProfileScope(const std::string &name, EgalitoProfiler::Level level);
+    ~ProfileScope();
+private:
+    void begin();
+};
+
+#endif
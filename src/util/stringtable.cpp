@@ -0,0 +1,136 @@
+#include <cstring>
+#include "stringtable.h"
+
+const StringTable::ID StringTable::NONE;
+
+// which chunk holds id, and where: chunk k starts at (2^k - 1) << FIRST
+static inline size_t chunkOf(uint32_t id, size_t firstBits) {
+    uint32_t scaled = (id >> firstBits) + 1;
+    return 31 - __builtin_clz(scaled);
+}
+
+StringTable::Index::Index(size_t size) : mask(size - 1),
+    slot(new std::atomic<uint64_t>[size]) {
+
+    for(size_t i = 0; i < size; i++) {
+        slot[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+StringTable::StringTable() : index(new Index(1 << FIRST_CHUNK_BITS)),
+    count(0) {
+
+    for(auto &c : chunk) c.store(nullptr, std::memory_order_relaxed);
+}
+
+StringTable::~StringTable() {
+    for(auto &c : chunk) delete[] c.load();
+    delete index.load();
+    for(auto in : retired) delete in;
+}
+
+StringTable &StringTable::getInstance() {
+    static StringTable instance;
+    return instance;
+}
+
+uint64_t StringTable::hash(const char *str, size_t length) {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for(size_t i = 0; i < length; i++) {
+        h ^= static_cast<unsigned char>(str[i]);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+const StringTable::Key &StringTable::getKey(ID id) const {
+    size_t k = chunkOf(id, FIRST_CHUNK_BITS);
+    size_t start = ((size_t(1) << k) - 1) << FIRST_CHUNK_BITS;
+    return chunk[k].load(std::memory_order_acquire)[id - start];
+}
+
+StringTable::ID StringTable::find(const Index *in, uint64_t h,
+    const char *str, size_t length) const {
+
+    const uint64_t tag = h & ~0xffffffffull;
+    for(size_t i = h & in->mask; ; i = (i + 1) & in->mask) {
+        uint64_t value = in->slot[i].load(std::memory_order_acquire);
+        if(!value) return NONE;
+        if((value & ~0xffffffffull) != tag) continue;
+
+        ID id = static_cast<ID>(value) - 1;
+        const auto &key = getKey(id);
+        if(key.length == length && std::memcmp(key.str, str, length) == 0) {
+            return id;
+        }
+    }
+}
+
+void StringTable::insert(Index *in, uint64_t h, ID id) {
+    size_t i = h & in->mask;
+    while(in->slot[i].load(std::memory_order_relaxed)) {
+        i = (i + 1) & in->mask;
+    }
+    in->slot[i].store((h & ~0xffffffffull) | (uint64_t(id) + 1),
+        std::memory_order_release);
+}
+
+StringTable::ID StringTable::intern(const char *str, size_t length) {
+    const uint64_t h = hash(str, length);
+    ID id = find(index.load(std::memory_order_acquire), h, str, length);
+    if(id != NONE) return id;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Index *in = index.load(std::memory_order_relaxed);
+    id = find(in, h, str, length);  // another thread may have added it
+    if(id != NONE) return id;
+
+    id = count.load(std::memory_order_relaxed);
+    if(id == NONE - 1) throw "StringTable: too many strings";
+
+    auto copy = static_cast<char *>(arena.allocate(length + 1, 1));
+    std::memcpy(copy, str, length);
+    copy[length] = 0;
+
+    size_t k = chunkOf(id, FIRST_CHUNK_BITS);
+    size_t start = ((size_t(1) << k) - 1) << FIRST_CHUNK_BITS;
+    Key *keys = chunk[k].load(std::memory_order_relaxed);
+    if(!keys) {
+        keys = new Key[size_t(1) << (k + FIRST_CHUNK_BITS)];
+        chunk[k].store(keys, std::memory_order_release);
+    }
+    keys[id - start] = Key{copy, length};
+
+    // keep the index at most half full; readers of the old one still
+    // see every string that was there before this call
+    if(2 * (size_t(id) + 1) > in->mask + 1) {
+        auto bigger = new Index(2 * (in->mask + 1));
+        for(ID other = 0; other < id; other++) {
+            const auto &key = getKey(other);
+            insert(bigger, hash(key.str, key.length), other);
+        }
+        insert(bigger, h, id);
+        index.store(bigger, std::memory_order_release);
+        retired.push_back(in);
+    }
+    else {
+        insert(in, h, id);
+    }
+
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+StringTable::ID StringTable::intern(const char *str) {
+    return intern(str, std::strlen(str));
+}
+
+StringTable::ID StringTable::lookup(const char *str, size_t length) const {
+    return find(index.load(std::memory_order_acquire),
+        hash(str, length), str, length);
+}
+
+StringTable::ID StringTable::lookup(const char *str) const {
+    return lookup(str, std::strlen(str));
+}
@@ -0,0 +1,79 @@
+#ifndef EGALITO_UTIL_STRING_TABLE_H
+#define EGALITO_UTIL_STRING_TABLE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include "arena.h"
+
+/** Process-wide table of interned names. Each distinct string is copied
+    once and identified by a small integer ID, so that name-keyed maps can
+    hash and compare integers. lookup() never allocates: a string that was
+    never interned cannot be the name of anything, and yields NONE.
+
+    The table only ever grows, so lookup() and get() take no lock: entries
+    live in chunks that never move once published, and the hash index is
+    replaced by a larger copy instead of being resized in place. Only
+    adding a new string locks, since modules may be parsed concurrently.
+*/
+class StringTable {
+public:
+    typedef uint32_t ID;
+    static const ID NONE = ~0u;
+private:
+    struct Key {
+        const char *str;
+        size_t length;
+    };
+    /** Open-addressed index. Each slot holds the high half of the hash
+        and ID + 1, or 0 if empty.
+    */
+    struct Index {
+        size_t mask;
+        std::atomic<uint64_t> *slot;
+        Index(size_t size);
+        ~Index() { delete[] slot; }
+    };
+    enum {
+        FIRST_CHUNK_BITS = 10,      // chunk k holds 1024 << k entries
+        MAX_CHUNKS = 33 - FIRST_CHUNK_BITS
+    };
+
+    Arena arena;                    // string storage, never freed
+    std::atomic<Key *> chunk[MAX_CHUNKS];
+    std::atomic<Index *> index;
+    std::vector<Index *> retired;   // older indices readers may still use
+    std::atomic<ID> count;
+    std::mutex mutex;               // held while adding
+public:
+    static StringTable &getInstance();
+
+    ID intern(const char *str, size_t length);
+    ID intern(const char *str);
+    ID intern(const std::string &str)
+        { return intern(str.c_str(), str.length()); }
+
+    ID lookup(const char *str, size_t length) const;
+    ID lookup(const char *str) const;
+    ID lookup(const std::string &str) const
+        { return lookup(str.c_str(), str.length()); }
+
+    /** Returns the NUL-terminated string for id; valid forever. */
+    const char *get(ID id) const { return getKey(id).str; }
+    size_t getCount() const { return count.load(std::memory_order_acquire); }
+private:
+    StringTable();
+    ~StringTable();
+    StringTable(const StringTable &);
+    StringTable &operator = (const StringTable &);
+
+    static uint64_t hash(const char *str, size_t length);
+    const Key &getKey(ID id) const;
+    ID find(const Index *in, uint64_t h, const char *str,
+        size_t length) const;
+    static void insert(Index *in, uint64_t h, ID id);
+};
+
+#endif
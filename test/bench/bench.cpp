@@ -0,0 +1,231 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>  // for std::remove
+#include <cstdlib>  // for std::strtoul
+#include <cstring>  // for std::strcmp
+#include <sys/stat.h>
+#include <unistd.h>  // for getpid
+#include "conductor/interface.h"
+#include "chunk/concrete.h"
+#include "chunk/serializer.h"
+#include "elf/elfspace.h"
+#include "elf/elfmap.h"
+#include "analysis/controlflow.h"
+#include "analysis/usedef.h"
+#include "analysis/walker.h"
+#include "util/profiler.h"
+
+/* Measures the throughput of each phase of egalito on a corpus of ELF
+    files, and writes one JSON object of metrics per input. Metrics ending
+    in _per_sec are compared against a baseline by compare.py.
+*/
+
+typedef std::map<std::string, double> Metrics;
+
+class Stopwatch {
+private:
+    std::chrono::steady_clock::time_point start;
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+    double getSeconds() const {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+static double getFileSize(const std::string &filename) {
+    struct stat st;
+    if(stat(filename.c_str(), &st) != 0) return 0;
+    return st.st_size;
+}
+
+static void setRate(Metrics &metrics, const std::string &name,
+    double amount, double seconds) {
+
+    // keep the best of several repetitions
+    double rate = seconds > 0 ? amount / seconds : 0;
+    auto it = metrics.find(name);
+    if(it == metrics.end() || (*it).second < rate) metrics[name] = rate;
+}
+
+static void resetProfiler() {
+    // EgalitoInterface may have reconfigured it from EGALITO_PROFILE
+    EgalitoProfiler::getInstance()->configure("pass:!summary");
+    EgalitoProfiler::getInstance()->reset();
+}
+
+static void benchAnalysis(const std::string &filename,
+    const std::string &scratch, Metrics &metrics) {
+
+    EgalitoInterface egalito(false, true);
+    resetProfiler();
+    egalito.initializeParsing();
+
+    Stopwatch parseTime;
+    auto module = egalito.parse(filename);
+    double parseSeconds = parseTime.getSeconds();
+
+    double functions = module->getFunctionList()
+        ->getChildren()->genericGetSize();
+    metrics["functions"] = functions;
+    setRate(metrics, "functions_per_sec", functions, parseSeconds);
+    setRate(metrics, "input_bytes_per_sec", getFileSize(filename),
+        parseSeconds);
+
+    // all of the jump table passes run as part of parsing
+    auto jumpTableTime = EgalitoProfiler::getInstance()->getTotal(
+        EgalitoProfiler::LEVEL_PASS, "JumpTable");
+    double jumpTables = module->getJumpTableList()
+        ? module->getJumpTableList()->getChildren()->genericGetSize() : 0;
+    metrics["jump_tables"] = jumpTables;
+    setRate(metrics, "jump_tables_per_sec", jumpTables,
+        jumpTableTime.wallUS / 1e6);
+
+    Stopwatch useDefTime;
+    double states = 0;
+    for(auto function : CIter::functions(module)) {
+        ControlFlowGraph cfg(function);
+        UDConfiguration config(&cfg);
+        UDRegMemWorkingSet working(function, &cfg);
+        UseDef usedef(&config, &working);
+
+        SccOrder order(&cfg);
+        order.genFull(0);
+        usedef.analyze(order.get());
+        states += working.getStateList().size();
+    }
+    metrics["usedef_states"] = states;
+    setRate(metrics, "usedef_states_per_sec", states,
+        useDefTime.getSeconds());
+
+    Stopwatch writeTime;
+    ChunkSerializer().serialize(module, scratch);
+    double writeSeconds = writeTime.getSeconds();
+    double archiveMB = getFileSize(scratch) / 1e6;
+    setRate(metrics, "archive_write_mb_per_sec", archiveMB, writeSeconds);
+
+    Stopwatch readTime;
+    ChunkSerializer().deserialize(scratch);
+    setRate(metrics, "archive_read_mb_per_sec", archiveMB,
+        readTime.getSeconds());
+    std::remove(scratch.c_str());
+}
+
+static void benchGenerate(const std::string &filename,
+    const std::string &scratch, bool isUnion, Metrics &metrics) {
+
+    EgalitoInterface egalito(false, true);
+    resetProfiler();
+    egalito.initializeParsing();
+    egalito.parse(filename, isUnion);
+
+    Stopwatch generateTime;
+    egalito.generate(scratch, isUnion);
+    double seconds = generateTime.getSeconds();
+
+    setRate(metrics, isUnion ? "uniongen_bytes_per_sec"
+        : "mirrorgen_bytes_per_sec", getFileSize(scratch), seconds);
+    std::remove(scratch.c_str());
+}
+
+static bool isExecutable(const std::string &filename) {
+    ElfMap elf(filename.c_str());
+    return elf.isExecutable() && elf.isDynamic();
+}
+
+static std::string getBaseName(const std::string &filename) {
+    auto slash = filename.rfind('/');
+    return slash == std::string::npos ? filename : filename.substr(slash + 1);
+}
+
+static void writeJSON(std::ostream &stream,
+    const std::vector<std::pair<std::string, Metrics>> &results) {
+
+    stream << "{\n";
+    for(size_t i = 0; i < results.size(); i++) {
+        stream << "    \"" << results[i].first << "\": {";
+        bool first = true;
+        for(const auto &metric : results[i].second) {
+            stream << (first ? "\n" : ",\n") << "        \""
+                << metric.first << "\": " << metric.second;
+            first = false;
+        }
+        stream << "\n    }" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    stream << "}\n";
+}
+
+static void printUsage(const char *program) {
+    std::cerr << "Usage: " << program
+        << " [-o results.json] [-r repeat] [-t tmpdir] elf-file...\n"
+        "    Measures parse, analysis, archive and generation throughput.\n"
+        "    Files that do not exist are skipped.\n";
+}
+
+int main(int argc, char *argv[]) {
+    std::string output;
+    std::string tmpdir = "/tmp";
+    unsigned long repeat = 1;
+    std::vector<std::string> files;
+
+    for(int i = 1; i < argc; i++) {
+        if(!std::strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+        else if(!std::strcmp(argv[i], "-t") && i + 1 < argc) tmpdir = argv[++i];
+        else if(!std::strcmp(argv[i], "-r") && i + 1 < argc) {
+            repeat = std::strtoul(argv[++i], nullptr, 0);
+        }
+        else if(argv[i][0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        }
+        else files.push_back(argv[i]);
+    }
+    if(files.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::ostringstream scratchName;
+    scratchName << tmpdir << "/egalito-bench-" << getpid();
+    std::string scratch = scratchName.str();
+
+    std::vector<std::pair<std::string, Metrics>> results;
+    for(const auto &filename : files) {
+        if(getFileSize(filename) == 0 || !ElfMap::isElf(filename.c_str())) {
+            std::cerr << "skipping [" << filename << "]\n";
+            continue;
+        }
+
+        std::cerr << "benchmarking [" << filename << "]\n";
+        Metrics metrics;
+        try {
+            bool executable = isExecutable(filename);
+            for(unsigned long r = 0; r < repeat; r++) {
+                benchAnalysis(filename, scratch, metrics);
+                benchGenerate(filename, scratch, false, metrics);
+                if(executable) {
+                    benchGenerate(filename, scratch, true, metrics);
+                }
+            }
+        }
+        catch(const char *message) {
+            std::cerr << "    exception: " << message << "\n";
+            metrics["failed"] = 1;
+        }
+        results.push_back(std::make_pair(getBaseName(filename), metrics));
+    }
+
+    if(output.empty()) {
+        writeJSON(std::cout, results);
+    }
+    else {
+        std::ofstream file(output.c_str());
+        writeJSON(file, results);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Compares benchmark results written by bench against a baseline. Every
+# *_per_sec metric must be within the tolerance of its baseline value.
+# usage: compare.py [-t tolerance] baseline.json results.json
+
+import json
+import os
+import sys
+
+tolerance = 0.2
+args = sys.argv[1:]
+if len(args) >= 2 and args[0] == '-t':
+    tolerance = float(args[1])
+    args = args[2:]
+if len(args) != 2:
+    sys.exit('usage: compare.py [-t tolerance] baseline.json results.json')
+
+if not os.path.exists(args[0]):
+    print('no baseline [%s], run "make baseline" to record one' % args[0])
+    sys.exit(0)
+
+baseline = json.load(open(args[0]))
+results = json.load(open(args[1]))
+
+failures = 0
+print('%-16s %-28s %14s %14s %8s' % ('input', 'metric', 'baseline',
+    'current', 'change'))
+for name in sorted(baseline):
+    current = results.get(name)
+    if current is None:
+        print('%-16s missing from results' % name)
+        failures += 1
+        continue
+    if current.get('failed'):
+        print('%-16s failed' % name)
+        failures += 1
+        continue
+
+    for metric in sorted(baseline[name]):
+        if not metric.endswith('_per_sec'):
+            continue
+        old = baseline[name][metric]
+        new = current.get(metric, 0)
+        change = (new - old) / old if old else 0
+        flag = ''
+        if change < -tolerance:
+            flag = '  REGRESSION'
+            failures += 1
+        print('%-16s %-28s %14.1f %14.1f %+7.1f%%%s' % (name, metric, old,
+            new, change * 100, flag))
+
+if failures:
+    sys.exit('%d regression(s) beyond %d%%' % (failures, tolerance * 100))
+print('no regressions beyond %d%%' % (tolerance * 100))
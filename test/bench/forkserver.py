@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+# Measures fuzzing throughput (execs/sec) of etcoverage outputs, playing
+# the part of afl-fuzz: it owns the coverage map, writes the test case to
+# a file passed as the last argument, and drives the target either by
+# exec'ing it for every run or through the fork server protocol. Each
+# program is transformed with plain etcoverage, with --fork-server, and
+# with --persistent=N.
+# usage: forkserver.py [-d seconds] [-p N] [-o results.json] [--app dir]
+#                      [--function name] program...
+
+import argparse
+import ctypes
+import json
+import os
+import select
+import signal
+import struct
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+APP = os.path.join(HERE, '..', '..', 'app')
+
+FORKSRV_FD = 198
+MAP_SIZE = 0x10000
+IPC_PRIVATE = 0
+IPC_CREAT = 0o1000
+IPC_RMID = 0
+
+class Map:
+    """A SysV shared memory segment, as afl-fuzz would create."""
+    def __init__(self):
+        self.libc = ctypes.CDLL(None, use_errno=True)
+        self.libc.shmat.restype = ctypes.c_void_p
+        self.id = self.libc.shmget(IPC_PRIVATE, MAP_SIZE, IPC_CREAT | 0o600)
+        if self.id < 0:
+            raise OSError(ctypes.get_errno(), 'shmget')
+        self.address = self.libc.shmat(self.id, None, 0)
+
+    def clear(self):
+        ctypes.memset(self.address, 0, MAP_SIZE)
+
+    def count(self):
+        data = ctypes.string_at(self.address, MAP_SIZE)
+        return MAP_SIZE - data.count(0)
+
+    def close(self):
+        self.libc.shmdt(ctypes.c_void_p(self.address))
+        self.libc.shmctl(self.id, IPC_RMID, None)
+
+def transform(app, flags, program, output):
+    command = [os.path.join(app, 'etcoverage')] + flags + [program, output]
+    result = subprocess.run(command, stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL)
+    return result.returncode == 0 and os.path.exists(output)
+
+def run_exec(path, testcase, env, shm, duration):
+    """The old way: one fork and exec per run."""
+    execs = 0
+    edges = 0
+    start = time.perf_counter()
+    while time.perf_counter() - start < duration:
+        shm.clear()
+        result = subprocess.run([path, testcase], env=env,
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        if result.returncode != 0:
+            return None
+        execs += 1
+        edges = max(edges, shm.count())
+    return execs / (time.perf_counter() - start), edges
+
+def run_forkserver(path, testcase, env, shm, duration, timeout=1.0):
+    control_read, control_write = os.pipe()
+    status_read, status_write = os.pipe()
+
+    # the target finds its ends of the pipes at fixed descriptors
+    os.dup2(control_read, FORKSRV_FD)
+    os.dup2(status_write, FORKSRV_FD + 1)
+    process = subprocess.Popen([path, testcase], env=env,
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+        pass_fds=(FORKSRV_FD, FORKSRV_FD + 1))
+    for fd in (control_read, status_write, FORKSRV_FD, FORKSRV_FD + 1):
+        os.close(fd)
+
+    def read_word():
+        ready, _, _ = select.select([status_read], [], [], timeout)
+        if not ready:
+            return None
+        data = os.read(status_read, 4)
+        return struct.unpack('<i', data)[0] if len(data) == 4 else None
+
+    try:
+        if read_word() is None:
+            return None  # no hello, the fork server never started
+        execs = 0
+        edges = 0
+        killed = 0
+        start = time.perf_counter()
+        while time.perf_counter() - start < duration:
+            shm.clear()
+            os.write(control_write, struct.pack('<i', killed))
+            killed = 0
+            child = read_word()
+            if child is None or child <= 0:
+                return None
+            status = read_word()
+            if status is None:
+                os.kill(child, signal.SIGKILL)
+                killed = 1
+                status = read_word()
+                if status is None:
+                    return None
+            if os.WIFSIGNALED(status) or (os.WIFEXITED(status)
+                    and os.WEXITSTATUS(status) != 0):
+                return None
+            execs += 1
+            edges = max(edges, shm.count())
+        return execs / (time.perf_counter() - start), edges
+    finally:
+        os.close(control_write)
+        os.close(status_read)
+        process.kill()
+        process.wait()
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-d', '--duration', type=float, default=5.0,
+        help='seconds to fuzz each variant')
+    parser.add_argument('-p', '--persistent', type=int, default=1000,
+        help='iterations per fork in persistent mode')
+    parser.add_argument('-o', '--output')
+    parser.add_argument('-t', '--tmpdir', default='/tmp/egalito-forkserver')
+    parser.add_argument('--app', default=APP,
+        help='directory containing etcoverage and libcoverage.so')
+    parser.add_argument('--function', default='main',
+        help='function to start the fork server in')
+    parser.add_argument('programs', nargs='+')
+    args = parser.parse_args()
+
+    os.makedirs(args.tmpdir, exist_ok=True)
+    testcase = os.path.join(args.tmpdir, 'input')
+    with open(testcase, 'wb') as f:
+        f.write(b'egalito\n')
+
+    variants = [
+        ('exec', [], run_exec),
+        ('forkserver', ['--fork-server=' + args.function], run_forkserver),
+        ('persistent', ['--fork-server=' + args.function,
+            '--persistent=%d' % args.persistent], run_forkserver),
+    ]
+
+    shm = Map()
+    env = dict(os.environ, __AFL_SHM_ID=str(shm.id))
+    results = {}
+    try:
+        for program in args.programs:
+            name = os.path.basename(program)
+            entry = results.setdefault(name, {})
+            for label, flags, runner in variants:
+                output = os.path.join(args.tmpdir, '%s-%s' % (name, label))
+                print('transforming %s: %s' % (name, label), file=sys.stderr)
+                if not transform(args.app, flags, program, output):
+                    entry[label] = {'failed': 'transform'}
+                    continue
+                sample = runner(output, testcase, env, shm, args.duration)
+                if sample is None:
+                    entry[label] = {'failed': 'run'}
+                    continue
+                entry[label] = {'execs_per_sec': sample[0],
+                    'map_bytes': sample[1]}
+
+            print('\n%s (%.1f s per variant, %d iterations per fork)'
+                % (name, args.duration, args.persistent))
+            print('%-12s %14s %10s %10s' % ('variant', 'execs/sec',
+                'speedup', 'map'))
+            base = entry.get('exec', {}).get('execs_per_sec')
+            for label, _, _ in variants:
+                row = entry[label]
+                if 'failed' in row:
+                    print('%-12s failed (%s)' % (label, row['failed']))
+                    continue
+                speedup = ('%9.2fx' % (row['execs_per_sec'] / base)) \
+                    if base else '         -'
+                print('%-12s %14.1f %s %10d' % (label, row['execs_per_sec'],
+                    speedup, row['map_bytes']))
+    finally:
+        shm.close()
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent=4, sort_keys=True)
+
+if __name__ == '__main__':
+    main()
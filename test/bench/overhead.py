@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+# Measures the runtime cost of each etharden/etcoverage mode. Every test
+# program is transformed in mirror (-m) and union form, then all variants
+# are run round-robin. Reports slowdown against the original program,
+# executable code size against the untransformed (--nop) output of the
+# same form, and peak RSS, each with a 95% confidence interval.
+# usage: overhead.py [-n runs] [-s scale] [-o results.json] [--app dir]
+#                    [--modes m1,m2...] program...
+
+import argparse
+import json
+import math
+import os
+import struct
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+APP = os.path.join(HERE, '..', '..', 'app')
+
+# name -> (tool, flags, supports mirror form)
+MODES = [
+    ('nop',          'etharden',   ['--nop'],          True),
+    ('retpolines',   'etharden',   ['--retpolines'],   True),
+    ('cfi',          'etharden',   ['--cfi'],          True),
+    ('ss-xor',       'etharden',   ['--ss-xor'],       True),
+    ('ss-gs',        'etharden',   ['--ss-gs'],        True),
+    ('ss-const',     'etharden',   ['--ss-const'],     True),
+    ('cet-gs',       'etharden',   ['--cet-gs'],       True),
+    ('cet-const',    'etharden',   ['--cet-const'],    True),
+    ('permute-data', 'etharden',   ['--permute-data'], True),
+    ('profile',      'etharden',   ['--profile'],      True),
+    ('coverage',     'etcoverage', [],                 False),
+]
+
+# two-sided 95% Student's t quantiles by degrees of freedom
+T95 = [0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+    2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+    2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+    2.042]
+
+def t95(df):
+    return T95[df] if df < len(T95) else 1.960
+
+def summarize(samples):
+    """Mean and half-width of the 95% confidence interval."""
+    n = len(samples)
+    mean = sum(samples) / n
+    if n < 2:
+        return mean, float('nan')
+    var = sum((x - mean) ** 2 for x in samples) / (n - 1)
+    return mean, t95(n - 1) * math.sqrt(var / n)
+
+def ratio(a, b):
+    """Ratio of two means a/b with a first-order (delta method) interval."""
+    (ma, ha), (mb, hb) = a, b
+    r = ma / mb
+    return r, r * math.sqrt((ha / ma) ** 2 + (hb / mb) ** 2)
+
+def code_size(filename):
+    """Bytes in executable PT_LOAD segments of an ELF64 file."""
+    if not os.path.exists(filename):
+        return 0
+    with open(filename, 'rb') as f:
+        data = f.read()
+    if data[:4] != b'\x7fELF' or data[4] != 2:
+        return 0
+    phoff, = struct.unpack_from('<Q', data, 0x20)
+    phentsize, phnum = struct.unpack_from('<HH', data, 0x36)
+    total = 0
+    for i in range(phnum):
+        p_type, p_flags = struct.unpack_from('<II', data, phoff + i * phentsize)
+        p_filesz, = struct.unpack_from('<Q', data, phoff + i * phentsize + 0x20)
+        if p_type == 1 and p_flags & 1:  # PT_LOAD, PF_X
+            total += p_filesz
+    return total
+
+def transform(app, tool, flags, mirror, program, output):
+    command = [os.path.join(app, tool)] + flags
+    if mirror:
+        command.append('-m')
+    command += [program, output]
+    result = subprocess.run(command, stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL)
+    return result.returncode == 0 and os.path.exists(output)
+
+def run_once(command):
+    """Returns (seconds, peak RSS in KiB, stdout) or None on failure."""
+    start = time.perf_counter()
+    try:
+        process = subprocess.Popen(command, stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL)
+    except OSError:
+        return None
+    output = process.stdout.read()
+    _, status, usage = os.wait4(process.pid, 0)
+    elapsed = time.perf_counter() - start
+    if status != 0:
+        return None
+    return elapsed, usage.ru_maxrss, output
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-n', '--runs', type=int, default=10)
+    parser.add_argument('-s', '--scale', default='10',
+        help='argument passed to each program')
+    parser.add_argument('-o', '--output')
+    parser.add_argument('-t', '--tmpdir', default='/tmp/egalito-overhead')
+    parser.add_argument('--app', default=APP,
+        help='directory containing etharden and etcoverage')
+    parser.add_argument('--modes',
+        help='comma-separated subset of: '
+            + ','.join(m[0] for m in MODES))
+    parser.add_argument('programs', nargs='+')
+    args = parser.parse_args()
+
+    modes = MODES
+    if args.modes:
+        wanted = args.modes.split(',')
+        modes = [m for m in MODES if m[0] in wanted or m[0] == 'nop']
+    os.makedirs(args.tmpdir, exist_ok=True)
+
+    results = {}
+    for program in args.programs:
+        name = os.path.basename(program)
+        variants = [('original', None, program)]
+        for mode, tool, flags, hasMirror in modes:
+            for mirror in ([True, False] if hasMirror else [False]):
+                form = 'mirror' if mirror else 'union'
+                output = os.path.join(args.tmpdir,
+                    '%s-%s-%s' % (name, mode, form))
+                print('transforming %s: %s (%s)' % (name, mode, form),
+                    file=sys.stderr)
+                if transform(args.app, tool, flags, mirror, program, output):
+                    variants.append(('%s/%s' % (mode, form), form, output))
+                else:
+                    results.setdefault(name, {})['%s/%s' % (mode, form)] \
+                        = {'failed': 'transform'}
+
+        # one warm-up run, then round-robin so drift affects all equally
+        times = {v[0]: [] for v in variants}
+        rss = {v[0]: [] for v in variants}
+        expected = None
+        failed = set()
+        for run in range(args.runs + 1):
+            for label, form, path in variants:
+                if label in failed:
+                    continue
+                sample = run_once([path, args.scale])
+                if sample is None:
+                    failed.add(label)
+                    continue
+                if label == 'original':
+                    expected = sample[2]
+                elif sample[2] != expected:
+                    failed.add(label)
+                    continue
+                if run > 0:
+                    times[label].append(sample[0])
+                    rss[label].append(sample[1])
+
+        if not times['original']:
+            print('%s does not run, skipping' % program, file=sys.stderr)
+            continue
+        base = summarize(times['original'])
+        baseRSS = summarize(rss['original'])
+        entry = results.setdefault(name, {})
+        entry['original'] = {
+            'seconds': base,
+            'rss_kb': baseRSS,
+            'code_bytes': code_size(program),
+        }
+        for label, form, path in variants[1:]:
+            if label in failed or not times[label]:
+                entry[label] = {'failed': 'run'}
+                continue
+            nopSize = code_size(os.path.join(args.tmpdir,
+                '%s-nop-%s' % (name, form)))
+            size = code_size(path)
+            entry[label] = {
+                'seconds': summarize(times[label]),
+                'slowdown': ratio(summarize(times[label]), base),
+                'rss_kb': summarize(rss[label]),
+                'rss_growth': ratio(summarize(rss[label]), baseRSS),
+                'code_bytes': size,
+                'code_growth': size / nopSize if nopSize else None,
+            }
+
+        print('\n%s (%d runs, scale %s)' % (name, args.runs, args.scale))
+        print('%-24s %18s %18s %10s' % ('variant', 'slowdown',
+            'RSS growth', 'code'))
+        for label in sorted(entry):
+            row = entry[label]
+            if 'failed' in row:
+                print('%-24s failed (%s)' % (label, row['failed']))
+            elif label != 'original':
+                code = ('%9.3fx' % row['code_growth']) \
+                    if row['code_growth'] else '         -'
+                print('%-24s %8.3fx +- %5.3f %8.3fx +- %5.3f %s' % (label,
+                    row['slowdown'][0], row['slowdown'][1],
+                    row['rss_growth'][0], row['rss_growth'][1], code))
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent=4, sort_keys=True)
+
+if __name__ == '__main__':
+    main()
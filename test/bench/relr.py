@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+# Measures what DT_RELR packing saves in etelf mirror outputs. Each
+# program is transformed twice, with EGALITO_RELR=0 and EGALITO_RELR=1,
+# and for each output reports the file size, the sizes of .rela.dyn and
+# .relr.dyn, and startup cost: ld.so relocation time from
+# LD_DEBUG=statistics and the wall time of a whole run, as medians. Both
+# outputs must print the same thing as the original program.
+# usage: relr.py [-n runs] [-o results.json] [--app dir] program...
+
+import argparse
+import json
+import os
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+APP = os.path.join(HERE, '..', '..', 'app')
+
+VARIANTS = [('rela', '0'), ('relr', '1')]
+
+RELOCATION_TIME = re.compile(r'time needed for relocation: (\d+) cycles')
+
+def transform(app, relr, program, output):
+    command = [os.path.join(app, 'etelf'), '-m', program, output]
+    env = dict(os.environ, EGALITO_RELR=relr)
+    try:
+        result = subprocess.run(command, env=env,
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    except OSError:
+        return False
+    return result.returncode == 0 and os.path.exists(output)
+
+def section_sizes(path):
+    result = subprocess.run(['readelf', '-SW', path], stdout=subprocess.PIPE,
+        stderr=subprocess.DEVNULL, universal_newlines=True)
+    sizes = {}
+    for line in result.stdout.splitlines():
+        match = re.search(r'\]\s+(\S+)\s+\S+\s+[0-9a-f]+\s+[0-9a-f]+\s+'
+            r'([0-9a-f]+)', line)
+        if match:
+            sizes[match.group(1)] = int(match.group(2), 16)
+    return sizes
+
+def run(path, env):
+    start = time.perf_counter()
+    result = subprocess.run([path], env=env, stdin=subprocess.DEVNULL,
+        stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+        universal_newlines=True)
+    return time.perf_counter() - start, result
+
+def measure(path, runs):
+    cycles = []
+    seconds = []
+    output = None
+    stats_env = dict(os.environ, LD_DEBUG='statistics')
+    for _ in range(runs):
+        elapsed, result = run(path, dict(os.environ))
+        if result.returncode != 0:
+            return None
+        seconds.append(elapsed)
+        output = result.stdout
+
+        _, result = run(path, stats_env)
+        match = RELOCATION_TIME.search(result.stderr)
+        if not match:
+            return None
+        cycles.append(int(match.group(1)))
+    return statistics.median(cycles), statistics.median(seconds), output
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-n', '--runs', type=int, default=20)
+    parser.add_argument('-o', '--output')
+    parser.add_argument('-t', '--tmpdir', default='/tmp/egalito-relr')
+    parser.add_argument('--app', default=APP,
+        help='directory containing etelf')
+    parser.add_argument('programs', nargs='+')
+    args = parser.parse_args()
+
+    os.makedirs(args.tmpdir, exist_ok=True)
+    results = {}
+    status = 0
+    for program in args.programs:
+        name = os.path.basename(program)
+        entry = results.setdefault(name, {})
+        _, expected = run(program, dict(os.environ))
+
+        for label, relr in VARIANTS:
+            path = os.path.join(args.tmpdir, '%s-%s' % (name, label))
+            print('transforming %s: %s' % (name, label), file=sys.stderr)
+            if not transform(args.app, relr, program, path):
+                entry[label] = {'failed': 'transform'}
+                continue
+            sample = measure(path, args.runs)
+            if sample is None:
+                entry[label] = {'failed': 'run'}
+                continue
+            if sample[2] != expected.stdout:
+                entry[label] = {'failed': 'output differs'}
+                continue
+            sizes = section_sizes(path)
+            entry[label] = {'file_bytes': os.path.getsize(path),
+                'rela_dyn_bytes': sizes.get('.rela.dyn', 0),
+                'relr_dyn_bytes': sizes.get('.relr.dyn', 0),
+                'relocation_cycles': sample[0], 'seconds': sample[1]}
+
+        print('\n%s (%d runs, median)' % (name, args.runs))
+        print('%-6s %12s %10s %10s %18s %10s' % ('form', 'file bytes',
+            '.rela.dyn', '.relr.dyn', 'relocation cycles', 'ms'))
+        for label, _ in VARIANTS:
+            row = entry[label]
+            if 'failed' in row:
+                print('%-6s failed (%s)' % (label, row['failed']))
+                status = 1
+                continue
+            print('%-6s %12d %10d %10d %18d %10.2f' % (label,
+                row['file_bytes'], row['rela_dyn_bytes'],
+                row['relr_dyn_bytes'], row['relocation_cycles'],
+                row['seconds'] * 1000))
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent=4, sort_keys=True)
+    sys.exit(status)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,55 @@
+/* Preloaded by symlookup.py. Before main() runs, times dlsym() through
+   the global scope for every name in $SYMLOOKUP_NAMES (one per line).
+   The main program is searched first, so its .gnu.hash is consulted for
+   every lookup: hits for names it defines, and bloom filter or chain
+   misses for names defined by the libraries after it. Appends
+   "found lookups nanoseconds" to $SYMLOOKUP_OUTPUT.
+*/
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void __attribute__((constructor)) symlookup(void) {
+    const char *namesFile = getenv("SYMLOOKUP_NAMES");
+    const char *outputFile = getenv("SYMLOOKUP_OUTPUT");
+    const char *roundsString = getenv("SYMLOOKUP_ROUNDS");
+    if(!namesFile || !outputFile) return;
+    long rounds = roundsString ? atol(roundsString) : 100;
+
+    FILE *file = fopen(namesFile, "r");
+    if(!file) return;
+    size_t count = 0, capacity = 1024;
+    char **names = malloc(capacity * sizeof(*names));
+    char line[4096];
+    while(fgets(line, sizeof line, file)) {
+        line[strcspn(line, "\n")] = 0;
+        if(!*line) continue;
+        if(count == capacity) {
+            capacity *= 2;
+            names = realloc(names, capacity * sizeof(*names));
+        }
+        names[count++] = strdup(line);
+    }
+    fclose(file);
+
+    struct timespec start, end;
+    size_t found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(long r = 0; r < rounds; r++) {
+        for(size_t i = 0; i < count; i++) {
+            if(dlsym(RTLD_DEFAULT, names[i])) found++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    FILE *output = fopen(outputFile, "a");
+    if(output) {
+        fprintf(output, "%zu %zu %lld\n", found, count * rounds,
+            (end.tv_sec - start.tv_sec) * 1000000000LL
+                + (end.tv_nsec - start.tv_nsec));
+        fclose(output);
+    }
+}
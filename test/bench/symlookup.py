@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+# Measures how quickly ld.so resolves symbols against etelf outputs. Each
+# program is run as is, and after transformation in mirror (-m) and union
+# form. Two numbers are reported per variant:
+#  - relocation time from LD_DEBUG=statistics with LD_BIND_NOW=1; every
+#    symbol a library imports is looked up in the main program first.
+#  - dlsym() time through the global scope, from symlookup.so preloaded
+#    into the program, for the names the program and its libraries define.
+# usage: symlookup.py [-n runs] [-r rounds] [-o results.json] [--app dir]
+#                     [--preload symlookup.so] program...
+
+import argparse
+import json
+import os
+import re
+import statistics
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+APP = os.path.join(HERE, '..', '..', 'app')
+
+VARIANTS = [
+    ('original', None),
+    ('mirror', ['-m']),
+    ('union', []),
+]
+
+RELOCATION_TIME = re.compile(r'time needed for relocation: (\d+) cycles')
+
+def transform(app, flags, program, output):
+    command = [os.path.join(app, 'etelf')] + flags + [program, output]
+    try:
+        result = subprocess.run(command, stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL)
+    except OSError:
+        return False
+    return result.returncode == 0 and os.path.exists(output)
+
+def defined_symbols(path):
+    result = subprocess.run(['nm', '-D', '--defined-only', path],
+        stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+        universal_newlines=True)
+    names = []
+    for line in result.stdout.splitlines():
+        fields = line.split()
+        if len(fields) == 3:
+            names.append(fields[2].split('@')[0])
+    return names
+
+def libraries(path):
+    result = subprocess.run(['ldd', path], stdout=subprocess.PIPE,
+        stderr=subprocess.DEVNULL, universal_newlines=True)
+    found = []
+    for line in result.stdout.splitlines():
+        match = re.search(r'=> (/\S+)', line)
+        if match:
+            found.append(match.group(1))
+    return found
+
+def relocation_cycles(path, runs):
+    env = dict(os.environ, LD_DEBUG='statistics', LD_BIND_NOW='1')
+    samples = []
+    for _ in range(runs):
+        result = subprocess.run([path], env=env, stdin=subprocess.DEVNULL,
+            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+            universal_newlines=True)
+        match = RELOCATION_TIME.search(result.stderr)
+        if result.returncode != 0 or not match:
+            return None
+        samples.append(int(match.group(1)))
+    return statistics.median(samples)
+
+def lookup_time(path, preload, names_file, rounds, runs, output):
+    env = dict(os.environ, LD_PRELOAD=preload, SYMLOOKUP_NAMES=names_file,
+        SYMLOOKUP_OUTPUT=output, SYMLOOKUP_ROUNDS=str(rounds))
+    if os.path.exists(output):
+        os.unlink(output)
+    for _ in range(runs):
+        result = subprocess.run([path], env=env, stdin=subprocess.DEVNULL,
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        if result.returncode != 0:
+            return None
+    samples = []
+    with open(output) as f:
+        for line in f:
+            found, lookups, ns = map(int, line.split())
+            samples.append((ns / lookups, found // rounds))
+    if len(samples) != runs:
+        return None
+    return statistics.median(s[0] for s in samples), samples[0][1]
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-n', '--runs', type=int, default=10)
+    parser.add_argument('-r', '--rounds', type=int, default=100,
+        help='dlsym() passes over the names per run')
+    parser.add_argument('-o', '--output')
+    parser.add_argument('-t', '--tmpdir', default='/tmp/egalito-symlookup')
+    parser.add_argument('--app', default=APP,
+        help='directory containing etelf')
+    parser.add_argument('--preload',
+        default=os.path.join(HERE, 'symlookup.so'))
+    parser.add_argument('programs', nargs='+')
+    args = parser.parse_args()
+
+    os.makedirs(args.tmpdir, exist_ok=True)
+    preload = os.path.abspath(args.preload)
+    results = {}
+    for program in args.programs:
+        name = os.path.basename(program)
+        entry = results.setdefault(name, {})
+
+        names = defined_symbols(program)
+        for library in libraries(program):
+            names += defined_symbols(library)
+        names_file = os.path.join(args.tmpdir, name + '.names')
+        with open(names_file, 'w') as f:
+            f.write('\n'.join(sorted(set(names))) + '\n')
+
+        for label, flags in VARIANTS:
+            path = program
+            if flags is not None:
+                path = os.path.join(args.tmpdir, '%s-%s' % (name, label))
+                print('transforming %s: %s' % (name, label), file=sys.stderr)
+                if not transform(args.app, flags, program, path):
+                    entry[label] = {'failed': 'transform'}
+                    continue
+
+            cycles = relocation_cycles(path, args.runs)
+            lookup = lookup_time(path, preload, names_file, args.rounds,
+                args.runs, os.path.join(args.tmpdir, 'lookup.out'))
+            if cycles is None or lookup is None:
+                entry[label] = {'failed': 'run'}
+                continue
+            entry[label] = {'relocation_cycles': cycles,
+                'ns_per_lookup': lookup[0], 'found': lookup[1],
+                'names': len(set(names))}
+
+        print('\n%s (%d runs, median)' % (name, args.runs))
+        print('%-10s %18s %14s %14s' % ('variant', 'relocation cycles',
+            'ns/dlsym', 'found'))
+        for label, _ in VARIANTS:
+            row = entry[label]
+            if 'failed' in row:
+                print('%-10s failed (%s)' % (label, row['failed']))
+                continue
+            print('%-10s %18d %14.1f %8d/%d' % (label,
+                row['relocation_cycles'], row['ns_per_lookup'],
+                row['found'], row['names']))
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent=4, sort_keys=True)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* CPU-bound workload for the overhead benchmarks: many direct calls and
+   returns (shadow stacks, CET), indirect calls (CFI, retpolines) and
+   tight loops. Prints a checksum so transformed outputs can be checked.
+*/
+
+static int __attribute__((noinline)) fib(int n) {
+	return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+static int compare(const void *a, const void *b) {
+	unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+	return (x > y) - (x < y);
+}
+
+static unsigned long sort(unsigned seed, size_t count) {
+	unsigned *data = malloc(count * sizeof *data);
+	for(size_t i = 0; i < count; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 8;
+	}
+	qsort(data, count, sizeof *data, compare);
+
+	unsigned long sum = 0;
+	for(size_t i = 0; i < count; i += 97) sum += data[i];
+	free(data);
+	return sum;
+}
+
+static unsigned long sieve(size_t limit) {
+	char *composite = calloc(limit, 1);
+	unsigned long count = 0;
+	for(size_t i = 2; i < limit; i++) {
+		if(composite[i]) continue;
+		count++;
+		for(size_t j = i * i; j < limit; j += i) composite[j] = 1;
+	}
+	free(composite);
+	return count;
+}
+
+int main(int argc, char **argv) {
+	int scale = argc > 1 ? atoi(argv[1]) : 1;
+	unsigned long checksum = 0;
+
+	for(int i = 0; i < scale; i++) {
+		checksum += fib(27);
+		checksum += sort(i, 200000);
+		checksum += sieve(2000000);
+	}
+	printf("%lu\n", checksum);
+	return 0;
+}
@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Syscall-heavy workload for the overhead benchmarks: short system calls
+   and small reads and writes, so that the cost of entering and leaving
+   libc dominates. Prints a checksum so transformed outputs can be checked.
+*/
+
+int main(int argc, char **argv) {
+	int scale = argc > 1 ? atoi(argv[1]) : 1;
+	unsigned long checksum = 0;
+	char buffer[64];
+
+	int null = open("/dev/null", O_WRONLY);
+	int zero = open("/dev/zero", O_RDONLY);
+	if(null < 0 || zero < 0) return 1;
+
+	for(int i = 0; i < scale * 100000; i++) {
+		checksum += (getppid() != 0);
+		checksum += write(null, "x", 1);
+		checksum += read(zero, buffer, sizeof buffer);
+
+		if(i % 100 == 0) {
+			int fd = open("/proc/self/stat", O_RDONLY);
+			if(fd >= 0) {
+				checksum += (read(fd, buffer, sizeof buffer) > 0);
+				close(fd);
+			}
+		}
+	}
+	close(null);
+	close(zero);
+	printf("%lu\n", checksum);
+	return 0;
+}
@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+# Prints the file written by EGALITO_JIT_STATS=<file>; see runtime/jitstats.h.
+# usage: jit-stats.py <file> [top-N]
+
+import struct
+import sys
+
+MAGIC = 0x5354544954494c41
+HEADER = struct.Struct('<QIIIIQQQQQQ')
+THREAD = struct.Struct('<8Q')
+
+data = open(sys.argv[1], 'rb').read()
+top = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+
+(magic, version, entryCount, maxThreads, threadCount,
+    threadSize, nameOffset, sandboxSize, epochThreads, epochGroups,
+    epochGroupBytes) = HEADER.unpack_from(data, 0)
+if magic != MAGIC or version != 3:
+    sys.exit('not a JIT statistics file (version 3)')
+
+names = data[nameOffset:].split(b'\0')[:entryCount]
+totals = [0] * entryCount
+
+print('sandbox half: %d KiB' % (sandboxSize // 1024))
+if epochGroups:
+    print('shared epochs: %d threads in %d groups, %d KiB per thread'
+        ' (%d KiB total)' % (epochThreads, epochGroups,
+        epochGroupBytes // max(epochThreads, 1) // 1024,
+        epochGroupBytes // 1024))
+print('thread fixups generated-KiB peak-epoch-KiB resets reset-ms'
+    ' group-timeouts group-dropped')
+for t in range(min(threadCount, maxThreads)):
+    base = HEADER.size + t * threadSize
+    (fixups, generated, epoch, peak, resets, resetNs, timeouts, dropped) \
+        = THREAD.unpack_from(data, base)
+    print('%6d %6d %13d %14d %6d %8.3f %14d %13d' % (t, fixups,
+        generated // 1024, peak // 1024, resets, resetNs / 1e6,
+        timeouts, dropped))
+    counts = struct.unpack_from('<%dQ' % entryCount, data, base + THREAD.size)
+    totals = [a + b for a, b in zip(totals, counts)]
+
+print('')
+print('fixups entry')
+ranked = sorted(range(entryCount), key=lambda i: -totals[i])
+for i in ranked[:top]:
+    if totals[i] == 0:
+        break
+    print('%6d gs@[%d] %s' % (totals[i], i, names[i].decode()))
@@ -0,0 +1,49 @@
+#!/bin/bash
+# Compares request latency of JIT-shuffling with synchronous resets against
+# resets that publish an epoch prepared by the background shuffler, and
+# against resets that only re-JIT a few functions at a time.
+
+filename=${1:-index.html}
+source ../binary/target/nginx/wrkparam.sh
+
+command -v wrk > /dev/null 2>&1 || { echo >&2 "needs wrk -- skipping"; exit 0; }
+
+mkdir -p tmp
+ln -sf ../../src/libegalito.so
+
+pidfile=../binary/target/nginx/nginx/logs/nginx.pid
+
+run() {
+    mode=$1
+    shift
+    rm -f $pidfile
+
+    env LANG=C EGALITO_DEBLOAT=1 EGALITO_USE_GS=1 EGALITO_USE_SHUFFLING=1 "$@" \
+    ../../src/loader ../binary/target/nginx/nginx/sbin/nginx -c ../conf/nginx.conf >tmp/nginx-jitshuffle-$mode.out 2>& 1 &
+
+    count=50
+    while [ ! -f $pidfile ]; do
+      sleep 1;
+      count=$((count-1))
+      if [[ "$count" -eq 0 ]]; then
+        echo "test failed";
+        exit 1;
+      fi
+    done
+
+    wrk $wrkparam --latency http://localhost:8000/$filename > tmp/nginx-jitshuffle-$mode-wrk.out
+
+    kill -QUIT $( cat $pidfile )
+    kill -KILL $( cat $pidfile )
+    killall loader
+    rm -f $pidfile
+
+    echo "$mode: $(grep -E '^ +99%' tmp/nginx-jitshuffle-$mode-wrk.out)"
+}
+
+run sync
+run async EGALITO_USE_ASYNC_SHUFFLING=1
+run incremental EGALITO_JIT_RESET_FUNCTIONS=16
+
+rm libegalito.so
+echo "test passed"
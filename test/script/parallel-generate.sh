@@ -0,0 +1,25 @@
+#!/bin/bash
+# Mirror and union outputs must be byte-identical whether the ELF
+# generation pipeline runs serially or on several threads.
+mkdir -p tmp
+
+status=0
+for form in -m -u; do
+    for threads in 1 4; do
+        LD_LIBRARY_PATH=../../src EGALITO_DEBUG=/dev/null \
+            EGALITO_PARALLEL_GENERATE=$threads ../../app/etelf $form \
+            ../binary/build/hello tmp/parallel-generate$form-$threads \
+            >/dev/null 2>&1
+    done
+    if ! cmp -s tmp/parallel-generate$form-1 tmp/parallel-generate$form-4; then
+        echo "output differs with parallel generation ($form)"
+        status=1
+    fi
+done
+
+if [ $status = 0 ]; then
+    echo "test passed"
+else
+    echo "test failed!"
+    exit 1
+fi
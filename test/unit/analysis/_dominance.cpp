@@ -0,0 +1,70 @@
+#include <algorithm>
+#include "framework/include.h"
+#include "elf/elfmap.h"
+#include "elf/elfspace.h"
+#include "analysis/controlflow.h"
+#include "analysis/dominance.h"
+#include "conductor/conductor.h"
+#include "log/registry.h"
+
+TEST_CASE("dominator tree", "[analysis][fast][.]") {
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    ElfMap elf(TESTDIR "cfg");
+
+    Conductor conductor;
+    conductor.parseExecutable(&elf);
+
+    auto module = conductor.getMainSpace()->getModule();
+    auto f = CIter::named(module->getFunctionList())->find("main");
+
+    REQUIRE(f != nullptr);
+    ControlFlowGraph cfg(f);
+    Dominance dom(&cfg);
+
+    // 0->1->2->3<->4->5
+    // |  |
+    // |  v
+    // +->6
+
+    SECTION("dominates") {
+        for(size_t i = 0; i < cfg.getCount(); i++) {
+            CHECK(dom.dominates(0, i));
+            CHECK(dom.dominates(i, i));
+        }
+        CHECK(dom.dominates(1, 2));
+        CHECK(dom.dominates(1, 5));
+        CHECK(dom.dominates(3, 4));
+        CHECK(!dom.dominates(4, 3));
+        CHECK(!dom.dominates(1, 6));
+        CHECK(dom.getImmediateDominator(6) == 0);
+        CHECK(dom.getImmediateDominator(0) == -1);
+    }
+
+    SECTION("dominator list agrees with queries") {
+        for(size_t i = 0; i < cfg.getCount(); i++) {
+            auto doms = dom.getDominators(i);
+            REQUIRE(!doms.empty());
+            CHECK(doms.front() == static_cast<int>(i));
+            CHECK(doms.back() == 0);
+            for(auto d : doms) {
+                CHECK(dom.dominates(d, i));
+            }
+        }
+    }
+
+    SECTION("frontier") {
+        // 6 is the join point of both branches out of 0 and 1
+        auto df = dom.getDominanceFrontier(1);
+        CHECK(std::find(df.begin(), df.end(), 6) != df.end());
+        CHECK(dom.getDominanceFrontier(0).empty());
+    }
+
+    SECTION("post-dominators") {
+        auto pdoms = dom.getPostDominators(0);
+        for(auto p : pdoms) {
+            CHECK(dom.postDominates(p, 0));
+        }
+        CHECK(!dom.postDominates(1, 0));
+    }
+}
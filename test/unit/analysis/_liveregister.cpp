@@ -0,0 +1,138 @@
+#include "framework/include.h"
+#include "analysis/liveregister.h"
+#include "chunk/concrete.h"
+#include "instr/builder.h"
+#include "instr/concrete.h"
+#include "operation/addinline.h"
+#include "operation/mutator.h"
+
+#ifdef ARCH_X86_64
+/*  mov (%rdi), %r10
+    add $1, %r10
+    mov %r10, %rdi
+    callq external
+    mov %rax, %r11
+    retq
+*/
+static Function *makeFunction(std::vector<Instruction *> &instrs) {
+    auto external = new Function(0x2000);
+    external->setPosition(new AbsolutePosition(0x2000));
+
+    auto call = new Instruction();
+    auto callSem = new ControlFlowInstruction(
+        X86_INS_CALL, call, "\xe8", "callq", 4);
+    callSem->setLink(new NormalLink(external, Link::SCOPE_EXTERNAL_JUMP));
+    call->setSemantic(callSem);
+
+    instrs = {
+        X86Builder::mov(X86Memory(X86_REG_RDI), X86_REG_R10),
+        X86Builder::arithmetic(X86Builder::OP_ADD, 1, X86_REG_R10),
+        X86Builder::mov(X86_REG_R10, X86_REG_RDI),
+        call,
+        X86Builder::mov(X86_REG_RAX, X86_REG_R11),
+        X86Builder::ret()
+    };
+
+    auto function = new Function(0x1000);
+    function->setPosition(new AbsolutePosition(0x1000));
+    auto block = new Block();
+    ChunkMutator(function).append(block);
+    ChunkMutator mutator(block);
+    for(auto instr : instrs) mutator.append(instr);
+    return function;
+}
+#endif
+
+TEST_CASE("live registers before each instruction", "[analysis][fast]") {
+#ifdef ARCH_X86_64
+    std::vector<Instruction *> instrs;
+    auto function = makeFunction(instrs);
+    InstructionLiveRegister liveness(function);
+
+    auto live = [&] (size_t index, int reg) {
+        return liveness.getLiveBefore(instrs[index]).get(reg);
+    };
+
+    // defined before being read
+    CHECK(!live(0, X86Register::R10));
+    CHECK(!live(3, X86Register::R11));
+    CHECK(!live(0, X86Register::FLAGS));
+    CHECK(!live(2, X86Register::R7));
+
+    // arguments and static chain are read by the call
+    CHECK(live(0, X86Register::R7));
+    CHECK(live(1, X86Register::R10));
+    CHECK(live(3, X86Register::R6));
+    CHECK(live(3, X86Register::R10));
+    CHECK(live(4, X86Register::R0));
+
+    // return value and callee-saved registers at the return
+    CHECK(live(5, X86Register::R0));
+    CHECK(live(5, X86Register::R3));
+    CHECK(live(0, X86Register::R12));
+    CHECK(!live(5, X86Register::R11));
+    CHECK(!live(5, X86Register::FLAGS));
+
+    // instructions the analysis has not seen keep everything live
+    auto other = X86Builder::nop();
+    CHECK(liveness.getLiveBefore(other).get(X86Register::R11));
+    delete other;
+#endif
+}
+
+TEST_CASE("inline code uses dead scratch registers", "[analysis][fast]") {
+#ifdef ARCH_X86_64
+    std::vector<Instruction *> instrs;
+    auto function = makeFunction(instrs);
+    auto block = function->getChildren()->getIterable()->get(0);
+    ChunkAddInline::ScratchState state;
+
+    auto insert = [&] (Instruction *point, ChunkAddInline::RegList scratch,
+        ChunkAddInline::RegList &chosen) {
+
+        size_t before = block->getChildren()->getIterable()->getCount();
+        ChunkAddInline ai(&state, scratch, 1, true,
+            [&chosen] (unsigned int stackBytesAdded,
+                const ChunkAddInline::RegList &regs) {
+
+            chosen = regs;
+            return ChunkAddInline::InstrList{X86Builder::mov(
+                0, static_cast<x86_reg>(regs[0]))};
+        });
+        ai.insertBefore(point, false);
+        return block->getChildren()->getIterable()->getCount() - before;
+    };
+
+    ChunkAddInline::RegList chosen;
+    CHECK(insert(instrs[0], {X86_REG_R10, X86_REG_R11}, chosen) == 1);
+    CHECK(chosen == ChunkAddInline::RegList{X86_REG_R10});
+
+    CHECK(insert(instrs[3], {X86_REG_R10, X86_REG_R11}, chosen) == 1);
+    CHECK(chosen == ChunkAddInline::RegList{X86_REG_R11});
+    CHECK(state.getSavedCount() == 0);
+    CHECK(state.getAvoidedCount() == 4);
+
+    // nothing dead: skip the red zone, push, code, pop, restore
+    CHECK(insert(instrs[2], {X86_REG_R10}, chosen) == 5);
+    CHECK(chosen == ChunkAddInline::RegList{X86_REG_R10});
+    CHECK(state.getSavedCount() == 1);
+    CHECK(state.getAvoidedCount() == 5);
+#endif
+}
+
+TEST_CASE("functions outside the ABI keep every register live",
+    "[analysis][fast]") {
+#ifdef ARCH_X86_64
+    std::vector<Instruction *> instrs;
+    auto function = makeFunction(instrs);
+    function->setName("_dl_tlsdesc_dynamic");
+    InstructionLiveRegister liveness(function);
+
+    for(auto instr : instrs) {
+        auto live = liveness.getLiveBefore(instr);
+        CHECK(live.get(X86Register::R10));
+        CHECK(live.get(X86Register::R11));
+        CHECK(live.get(X86Register::FLAGS));
+    }
+#endif
+}
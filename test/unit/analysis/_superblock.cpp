@@ -0,0 +1,165 @@
+#include <set>
+#include <utility>
+#include "framework/include.h"
+#include "elf/elfmap.h"
+#include "elf/elfspace.h"
+#include "analysis/controlflow.h"
+#include "analysis/dominance.h"
+#include "analysis/superblock.h"
+#include "conductor/conductor.h"
+#include "chunk/concrete.h"
+#include "instr/builder.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+#include "log/registry.h"
+
+/*  With a probe at the head of each superblock, an edge into a head is told
+    apart by the superblock it comes from, and an edge to any other node is
+    implied by the probe of the superblock both are in, or by the source
+    having no other successor.
+*/
+static void checkEdgesRecoverable(ControlFlowGraph &cfg,
+    SuperblockAnalysis &superblocks) {
+
+    std::set<std::pair<int, int>> probePairs;
+    for(size_t id = 0; id < cfg.getCount(); id++) {
+        size_t successors = 0;
+        for(auto link : cfg.get(id)->forwardLinks()) {
+            (void)link;
+            successors++;
+        }
+
+        for(auto link : cfg.get(id)->forwardLinks()) {
+            auto target = link->getTargetID();
+            INFO("edge " << id << " -> " << target);
+            if(superblocks.isHead(target)) {
+                CHECK(probePairs.insert(std::make_pair(
+                    superblocks.getHead(id), target)).second);
+            }
+            else {
+                CHECK((superblocks.getHead(target) == superblocks.getHead(id)
+                    || successors == 1));
+            }
+        }
+    }
+}
+
+#ifdef ARCH_X86_64
+/*  Builds a function with one block per entry of jumps. A block whose
+    entry is -1 ends in a nop and falls through, -2 ends in a ret, and any
+    other value ends in a jne to that block.
+*/
+static Function *makeFunction(const std::vector<int> &jumps) {
+    auto function = new Function(0x1000);
+    function->setPosition(new AbsolutePosition(0x1000));
+
+    std::vector<Instruction *> firsts, lasts;
+    for(auto jump : jumps) {
+        auto block = new Block();
+        ChunkMutator(function).append(block);
+        ChunkMutator mutator(block);
+
+        auto first = X86Builder::nop();
+        mutator.append(first);
+        firsts.push_back(first);
+
+        Instruction *last;
+        if(jump == -2) last = X86Builder::ret();
+        else if(jump == -1) last = X86Builder::nop();
+        else {
+            last = new Instruction();
+            last->setSemantic(new ControlFlowInstruction(
+                X86_INS_JNE, last, "\x0f\x85", "jne", 4));
+        }
+        mutator.append(last);
+        lasts.push_back(last);
+    }
+
+    for(size_t i = 0; i < jumps.size(); i++) {
+        if(jumps[i] < 0) continue;
+        auto semantic = static_cast<ControlFlowInstruction *>(
+            lasts[i]->getSemantic());
+        semantic->setLink(new NormalLink(firsts[jumps[i]],
+            Link::SCOPE_INTERNAL_JUMP));
+    }
+    return function;
+}
+#endif
+
+TEST_CASE("superblocks", "[analysis][fast][.]") {
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    ElfMap elf(TESTDIR "cfg");
+
+    Conductor conductor;
+    conductor.parseExecutable(&elf);
+
+    auto module = conductor.getMainSpace()->getModule();
+    auto f = CIter::named(module->getFunctionList())->find("main");
+
+    REQUIRE(f != nullptr);
+    ControlFlowGraph cfg(f);
+    Dominance dom(&cfg);
+
+    // 0->1->2->3<->4->5
+    // |  |
+    // |  v
+    // +->6
+
+    SECTION("blocks that always run together share a head") {
+        SuperblockAnalysis superblocks(&cfg, &dom);
+        CHECK(superblocks.isHead(0));
+        CHECK(superblocks.isHead(1));
+        CHECK(superblocks.isHead(2));
+        CHECK(superblocks.isHead(6));
+
+        // the loop header starts a superblock, which stops at the loop
+        CHECK(superblocks.isHead(3));
+        CHECK(superblocks.getHead(4) == 3);
+        CHECK(superblocks.isHead(5));
+        checkEdgesRecoverable(cfg, superblocks);
+    }
+
+    SECTION("every node heads its own superblock without merging") {
+        SuperblockAnalysis superblocks(&cfg, &dom, false);
+        for(size_t i = 0; i < cfg.getCount(); i++) {
+            CHECK(superblocks.isHead(i));
+        }
+    }
+}
+
+TEST_CASE("superblocks stop at cycles", "[analysis][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    SECTION("a loop after straight-line code") {
+        // 0->1->2->3<->4->5
+        // |  |
+        // +--+->6
+        auto function = makeFunction({6, 6, -1, -1, 3, -2, -2});
+        ControlFlowGraph cfg(function);
+        Dominance dom(&cfg);
+        SuperblockAnalysis superblocks(&cfg, &dom);
+
+        CHECK(superblocks.isHead(2));
+        CHECK(superblocks.isHead(3));
+        CHECK(superblocks.getHead(4) == 3);
+        CHECK(superblocks.isHead(5));
+        checkEdgesRecoverable(cfg, superblocks);
+    }
+
+    SECTION("nested loops") {
+        // 0->1->2->3->4->5, 3->2 and 4->1
+        auto function = makeFunction({-1, -1, -1, 2, 1, -2});
+        ControlFlowGraph cfg(function);
+        Dominance dom(&cfg);
+        SuperblockAnalysis superblocks(&cfg, &dom);
+
+        CHECK(superblocks.isHead(0));
+        CHECK(superblocks.isHead(1));
+        CHECK(superblocks.isHead(2));
+        CHECK(superblocks.getHead(3) == 2);
+        CHECK(superblocks.isHead(4));
+        CHECK(superblocks.isHead(5));
+        checkEdgesRecoverable(cfg, superblocks);
+    }
+#endif
+}
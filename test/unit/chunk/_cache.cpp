@@ -0,0 +1,144 @@
+#include <string>
+#include <vector>
+#include "framework/include.h"
+#include "chunk/cache.h"
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "instr/builder.h"
+#include "instr/concrete.h"
+#include "instr/writer.h"
+#include "operation/mutator.h"
+
+static Function *makeFunction(address_t address,
+    const std::vector<Instruction *> &instrs) {
+
+    auto function = new Function(address);
+    function->setPosition(new AbsolutePosition(address));
+    auto block = new Block();
+    ChunkMutator(function).append(block);
+    ChunkMutator mutator(block);
+    for(auto instr : instrs) mutator.append(instr);
+    return function;
+}
+
+// what the writer produces for function at its current address
+static std::string emit(Function *function) {
+    std::string data;
+    InstrWriterCppString writer(data);
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            instr->getSemantic()->accept(&writer);
+        }
+    }
+    return data;
+}
+
+// what the cache produces at the function's current address
+static std::string copyAndFix(ChunkCache &cache, Function *function) {
+    std::string data(cache.getSize(), '\0');
+    cache.copyAndFix(&data[0], function->getAddress());
+    return data;
+}
+
+#ifdef ARCH_X86_64
+static Instruction *makeBranch(unsigned int id, const char *opcode,
+    const char *mnemonic, Link *link) {
+
+    auto instr = new Instruction();
+    auto semantic = new ControlFlowInstruction(id, instr, opcode, mnemonic, 4);
+    semantic->setLink(link);
+    instr->setSemantic(semantic);
+    return instr;
+}
+#endif
+
+#ifdef ARCH_AARCH64
+static Instruction *makeLinked(uint32_t bits, Link *link,
+    bool controlFlow = false) {
+
+    std::vector<unsigned char> bytes(4);
+    for(int i = 0; i < 4; i++) bytes[i] = (bits >> (8 * i)) & 0xff;
+    auto instr = Disassemble::instruction(bytes);
+    auto assembly = instr->getSemantic()->getAssembly();
+
+    auto semantic = controlFlow ? new ControlFlowInstruction(instr)
+        : new LinkedInstruction(instr);
+    semantic->setAssembly(assembly);
+    semantic->setLink(link);
+    instr->setSemantic(semantic);
+    return instr;
+}
+#endif
+
+TEST_CASE("ChunkCache matches the writer at a new address",
+    "[chunk][fast]") {
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
+    auto callee = new Function(0x20000);
+    callee->setPosition(new AbsolutePosition(0x20000));
+    const address_t data = 0x500000;
+
+#ifdef ARCH_X86_64
+    auto end = X86Builder::ret();
+    auto function = makeFunction(0x10000, {
+        // fixed rel32 and fixed absolute
+        X86Builder::lea(X86Memory::ripRelative(
+            new UnresolvedRelativeLink(data)), X86_REG_RAX),
+        X86Builder::mov(X86Memory::ripRelative(
+            new UnresolvedLink(data)), X86_REG_RCX),
+        // internal, relative and absolute
+        X86Builder::lea(X86Memory::ripRelative(
+            new NormalLink(end, Link::SCOPE_INTERNAL_DATA)), X86_REG_RDX),
+        X86Builder::mov(X86Memory::ripRelative(
+            new AbsoluteNormalLink(end, Link::SCOPE_INTERNAL_DATA)),
+            X86_REG_RSI),
+        makeBranch(X86_INS_JMP, "\xe9", "jmp",
+            new NormalLink(end, Link::SCOPE_INTERNAL_JUMP)),
+        // targets that move
+        makeBranch(X86_INS_CALL, "\xe8", "callq",
+            new NormalLink(callee, Link::SCOPE_EXTERNAL_JUMP)),
+        X86Builder::lea(X86Memory::ripRelative(
+            new NormalLink(callee, Link::SCOPE_EXTERNAL_DATA)), X86_REG_RDI),
+        end
+    });
+#else
+    auto end = AARCH64Builder::nop();
+    auto function = makeFunction(0x10000, {
+        // fixed: adrp and add to data
+        makeLinked(0x90000000, new UnresolvedRelativeLink(data)),
+        makeLinked(0x91000000, new UnresolvedLink(data)),
+        // internal: adr, and b
+        makeLinked(0x10000000,
+            new NormalLink(end, Link::SCOPE_INTERNAL_DATA)),
+        makeLinked(0x14000000,
+            new NormalLink(end, Link::SCOPE_INTERNAL_JUMP), true),
+        // targets that move: bl, and adrp and add
+        makeLinked(0x94000000,
+            new NormalLink(callee, Link::SCOPE_EXTERNAL_JUMP), true),
+        makeLinked(0x90000000,
+            new NormalLink(callee, Link::SCOPE_EXTERNAL_DATA)),
+        makeLinked(0x91000000,
+            new AbsoluteNormalLink(callee, Link::SCOPE_EXTERNAL_DATA)),
+        end
+    });
+#endif
+
+    ChunkCache cache(function);
+    REQUIRE(cache.getSize() == function->getSize());
+    CHECK(copyAndFix(cache, function) == emit(function));
+
+    // the function moves by more than the adrp page size
+    ChunkMutator(function).setPosition(0x345000);
+    REQUIRE(end->getAddress() == 0x345000 + function->getSize()
+        - end->getSize());
+    CHECK(copyAndFix(cache, function) == emit(function));
+
+    // and its callee moves independently
+    ChunkMutator(callee).setPosition(0x7654000);
+    CHECK(copyAndFix(cache, function) == emit(function));
+    ChunkMutator(function).setPosition(0x10008);
+    CHECK(copyAndFix(cache, function) == emit(function));
+
+    // internal PC-relative fields are never patched
+    CHECK(cache.getFixupCount() == 5);
+#endif
+}
@@ -0,0 +1,20 @@
+#include "framework/include.h"
+#include "chunk/tls.h"
+
+TEST_CASE("epoch group slots can be given back", "[chunk][fast]") {
+    JITEpochGroup group(nullptr, nullptr, nullptr, 2,
+        JITEpochGroup::currentThread());
+    CHECK(group.members == 1);
+
+    auto slot = group.claimSlot();
+    CHECK(slot == 1);
+    CHECK(group.members == 2);
+    CHECK(group.claimSlot() == 2);      // full
+
+    // as when pthread_create fails
+    group.releaseSlot(slot);
+    CHECK(group.members == 1);
+    CHECK(group.slot[slot] == JITEpochGroup::SLOT_FREE);
+    CHECK(group.claimSlot() == slot);
+    CHECK(group.members == 2);
+}
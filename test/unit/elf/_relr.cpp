@@ -0,0 +1,34 @@
+#include <vector>
+#include "framework/include.h"
+#include "elf/relr.h"
+
+TEST_CASE("RELR encoding uses addresses and bitmaps", "[elf][fast]") {
+    // two neighbours and one 31 words later fit in the first bitmap
+    std::vector<address_t> addresses = {0x1000, 0x1008, 0x1010, 0x1100,
+        0x2000};
+    std::vector<RelrTable::WordType> expected = {0x1000, 0x100000007, 0x2000};
+    CHECK(RelrTable::encode(addresses) == expected);
+    CHECK(RelrTable::decode(expected.data(), expected.size()) == addresses);
+
+    // 63 words past the first bitmap starts a second one
+    addresses = {0x1000, 0x1008, 0x1200};
+    expected = {0x1000, 0x3, 0x3};
+    CHECK(RelrTable::encode(addresses) == expected);
+    CHECK(RelrTable::decode(expected.data(), expected.size()) == addresses);
+
+    CHECK(RelrTable::encode({}).empty());
+}
+
+TEST_CASE("RELR encoding round trip", "[elf][fast]") {
+    std::vector<address_t> addresses;
+    address_t address = 0x200000;
+    for(size_t i = 0; i < 5000; i ++) {
+        // runs of pointers, with occasional large gaps
+        address += 8 * ((i * 7919) % 13 == 0 ? 97 : 1 + (i * 31) % 3);
+        addresses.push_back(address);
+    }
+
+    auto words = RelrTable::encode(addresses);
+    CHECK(words.size() < addresses.size() / 4);
+    CHECK(RelrTable::decode(words.data(), words.size()) == addresses);
+}
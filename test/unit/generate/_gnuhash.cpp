@@ -0,0 +1,58 @@
+#include <set>
+#include <string>
+#include "framework/include.h"
+#include "generate/gnuhash.h"
+
+TEST_CASE("GNU hash function matches ld.so", "[generate][fast]") {
+    CHECK(GnuHashTable::hash("") == 5381);
+    CHECK(GnuHashTable::hash("printf") == 0x156b2bb8);
+}
+
+TEST_CASE("GNU hash table finds every symbol", "[generate][fast]") {
+    for(size_t count : {0, 1, 3, 4, 100, 5000}) {
+        const size_t offset = 7;  // null and undefined symbols come first
+        GnuHashTable table(offset);
+        for(size_t i = 0; i < count; i ++) {
+            table.add("symbol" + std::to_string(i));
+        }
+        table.build();
+
+        auto &bloom = table.getBloomList();
+        CHECK(bloom.size() > 0);
+        CHECK((bloom.size() & (bloom.size() - 1)) == 0);
+        CHECK(table.getChainList().size() == count);
+
+        auto &order = table.getOrder();
+        REQUIRE(order.size() == count);
+        for(size_t i = 0; i < count; i ++) {
+            auto name = "symbol" + std::to_string(order[i]);
+            CHECK(table.find(name) == offset + i);
+        }
+
+        // each bucket's symbols are contiguous, in bucket order
+        auto &buckets = table.getBucketList();
+        std::set<size_t> seen;
+        size_t previous = 0;
+        for(auto index : order) {
+            auto h = GnuHashTable::hash(
+                ("symbol" + std::to_string(index)).c_str());
+            auto bucket = h % buckets.size();
+            CHECK(bucket >= previous);
+            if(bucket != previous) CHECK(seen.count(bucket) == 0);
+            seen.insert(bucket);
+            previous = bucket;
+        }
+
+        // most misses are rejected by the bloom filter alone
+        size_t passed = 0;
+        for(size_t i = 0; i < 1000; i ++) {
+            auto name = "missing" + std::to_string(i);
+            CHECK(table.find(name) == 0);
+            auto h = GnuHashTable::hash(name.c_str());
+            auto word = bloom[(h / 64) % bloom.size()];
+            auto bit2 = (h >> table.getBloomShift()) % 64;
+            if((word >> (h % 64)) & (word >> bit2) & 1) passed ++;
+        }
+        CHECK(passed < 250);
+    }
+}
@@ -0,0 +1,220 @@
+#include <cstring>
+#include <set>
+#include "framework/include.h"
+#include "disasm/disassemble.h"
+#include "instr/builder.h"
+#include "instr/concrete.h"
+
+static std::set<uint8_t> makeSet(const uint8_t *regs, size_t count) {
+    return std::set<uint8_t>(regs, regs + count);
+}
+
+/* Decodes the builder's bytes with Capstone and compares the metadata. */
+static void checkAgainstCapstone(Instruction *built) {
+    auto assembly = built->getSemantic()->getAssembly();
+    REQUIRE(assembly);
+    INFO("built " << assembly->getMnemonic() << " " << assembly->getOpStr());
+
+    std::vector<unsigned char> bytes(assembly->getBytes(),
+        assembly->getBytes() + assembly->getSize());
+    auto decoded = Disassemble::instruction(bytes, true, 0);
+    auto expected = decoded->getSemantic()->getAssembly();
+    REQUIRE(expected);
+    INFO("capstone " << expected->getMnemonic() << " "
+        << expected->getOpStr());
+
+    CHECK(built->getSize() == decoded->getSize());
+    CHECK(assembly->getId() == expected->getId());
+    CHECK(assembly->getMnemonic() == expected->getMnemonic());
+    CHECK(makeSet(assembly->getImplicitRegsRead(),
+            assembly->getImplicitRegsReadCount())
+        == makeSet(expected->getImplicitRegsRead(),
+            expected->getImplicitRegsReadCount()));
+    CHECK(makeSet(assembly->getImplicitRegsWrite(),
+            assembly->getImplicitRegsWriteCount())
+        == makeSet(expected->getImplicitRegsWrite(),
+            expected->getImplicitRegsWriteCount()));
+
+    auto ops = assembly->getAsmOperands();
+    auto expectedOps = expected->getAsmOperands();
+    REQUIRE(ops->getOpCount() == expectedOps->getOpCount());
+    CHECK(ops->getMode() == expectedOps->getMode());
+    for(size_t i = 0; i < ops->getOpCount(); i++) {
+        auto op = &ops->getOperands()[i];
+        auto expectedOp = &expectedOps->getOperands()[i];
+        INFO("operand " << i);
+        REQUIRE(op->type == expectedOp->type);
+#ifdef ARCH_X86_64
+        switch(op->type) {
+        case X86_OP_REG:
+            CHECK(op->reg == expectedOp->reg);
+            CHECK(op->size == expectedOp->size);
+            break;
+        case X86_OP_IMM:
+            CHECK(op->imm == expectedOp->imm);
+            break;
+        case X86_OP_MEM:
+            CHECK(op->mem.segment == expectedOp->mem.segment);
+            CHECK(op->mem.base == expectedOp->mem.base);
+            CHECK(op->mem.index == expectedOp->mem.index);
+            CHECK(op->mem.scale == expectedOp->mem.scale);
+            CHECK(op->mem.disp == expectedOp->mem.disp);
+            CHECK(op->size == expectedOp->size);
+            break;
+        default:
+            break;
+        }
+#elif defined(ARCH_AARCH64)
+        switch(op->type) {
+        case ARM64_OP_REG:
+            CHECK(op->reg == expectedOp->reg);
+            break;
+        case ARM64_OP_IMM:
+            CHECK(op->imm == expectedOp->imm);
+            break;
+        case ARM64_OP_MEM:
+            CHECK(op->mem.base == expectedOp->mem.base);
+            CHECK(op->mem.index == expectedOp->mem.index);
+            CHECK(op->mem.disp == expectedOp->mem.disp);
+            break;
+        default:
+            break;
+        }
+#endif
+    }
+}
+
+#ifdef ARCH_X86_64
+static void checkBytes(Instruction *built, std::vector<uint8_t> bytes) {
+    auto assembly = built->getSemantic()->getAssembly();
+    REQUIRE(assembly->getSize() == bytes.size());
+    CHECK(std::memcmp(assembly->getBytes(), bytes.data(), bytes.size()) == 0);
+}
+
+TEST_CASE("x86 builder encodings match Capstone", "[instr][fast][x86_64]") {
+    std::vector<Instruction *> list = {
+        X86Builder::mov(X86_REG_RAX, X86_REG_R11),
+        X86Builder::mov(X86_REG_R13, X86_REG_RBX),
+        X86Builder::mov(X86Memory(X86_REG_RSP), X86_REG_R10),
+        X86Builder::mov(X86Memory(X86_REG_RSP, 8), X86_REG_R11),
+        X86Builder::mov(X86Memory(X86_REG_RSP, 0x88), X86_REG_R10),
+        X86Builder::mov(X86Memory(X86_REG_RBP), X86_REG_RAX),
+        X86Builder::mov(X86Memory(X86_REG_R13, -8), X86_REG_RAX),
+        X86Builder::mov(X86Memory(X86_REG_R12, X86_REG_R9, 8, 0x10),
+            X86_REG_R11),
+        X86Builder::mov(X86Memory(X86_REG_RAX, X86_REG_RCX, 1), X86_REG_RDX),
+        X86Builder::mov(X86Memory::absolute(0, X86_REG_GS), X86_REG_R11),
+        X86Builder::mov(X86Memory::absolute(0x28, X86_REG_FS), X86_REG_R11),
+        X86Builder::mov(X86_REG_R11, X86Memory(X86_REG_RSP, -0xb00000)),
+        X86Builder::mov(X86_REG_R10,
+            X86Memory(X86_REG_R11).setSegment(X86_REG_GS)),
+        X86Builder::mov(0x1234, X86_REG_R10),
+        X86Builder::mov(-1, X86_REG_RAX),
+        X86Builder::lea(X86Memory(X86_REG_RSP, -0x80), X86_REG_RSP),
+        X86Builder::lea(X86Memory(X86_REG_RSP, 0x80), X86_REG_RSP),
+        X86Builder::lea(X86Memory(X86_REG_R11, -8), X86_REG_R11),
+        X86Builder::push(X86_REG_RAX),
+        X86Builder::push(X86_REG_R15),
+        X86Builder::pop(X86_REG_RDI),
+        X86Builder::pop(X86_REG_R10),
+        X86Builder::push(1),
+        X86Builder::push(0x10000),
+        X86Builder::push(X86_REG_EFLAGS),
+        X86Builder::pop(X86_REG_EFLAGS),
+        X86Builder::arithmetic(X86Builder::OP_XOR, 0x11111111, X86_REG_R10),
+        X86Builder::arithmetic(X86Builder::OP_AND, 0xffff, X86_REG_R10),
+        X86Builder::arithmetic(X86Builder::OP_ADD, 8, X86_REG_RSP),
+        X86Builder::arithmetic(X86Builder::OP_SUB, -1, X86_REG_RCX),
+        X86Builder::arithmetic(X86Builder::OP_CMP, 0x7f,
+            X86Memory(X86_REG_RSP, 8)),
+        X86Builder::arithmetic(X86Builder::OP_OR, X86_REG_RAX, X86_REG_R9),
+        X86Builder::arithmetic(X86Builder::OP_XOR, X86_REG_R11,
+            X86Memory(X86_REG_RSP)),
+        X86Builder::arithmetic(X86Builder::OP_CMP, X86_REG_R10,
+            X86Memory(X86_REG_R11).setSegment(X86_REG_GS)),
+        X86Builder::arithmetic(X86Builder::OP_SUB, X86Memory(X86_REG_RDI, 4),
+            X86_REG_RAX),
+        X86Builder::shr(1, X86_REG_R10),
+        X86Builder::shr(4, X86_REG_RAX),
+        X86Builder::incb(X86Memory(X86_REG_R10, 0x50000000)),
+        X86Builder::incb(X86Memory(X86_REG_RAX)),
+        X86Builder::nop(),
+        X86Builder::pause(),
+        X86Builder::hlt(),
+        X86Builder::ud2(),
+        X86Builder::ret(),
+    };
+    for(auto instr : list) checkAgainstCapstone(instr);
+}
+
+TEST_CASE("x86 builder keeps the existing encodings", "[instr][fast][x86_64]") {
+    checkBytes(X86Builder::mov(X86Memory::absolute(0, X86_REG_GS),
+        X86_REG_R11), {0x65, 0x4c, 0x8b, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00});
+    checkBytes(X86Builder::lea(X86Memory(X86_REG_R11, 8), X86_REG_R11),
+        {0x4d, 0x8d, 0x5b, 0x08});
+    checkBytes(X86Builder::mov(X86Memory(X86_REG_RSP), X86_REG_R10),
+        {0x4c, 0x8b, 0x14, 0x24});
+    checkBytes(X86Builder::mov(X86_REG_R10,
+        X86Memory(X86_REG_R11).setSegment(X86_REG_GS)),
+        {0x65, 0x4d, 0x89, 0x13});
+    checkBytes(X86Builder::arithmetic(X86Builder::OP_CMP, X86_REG_R11,
+        X86Memory(X86_REG_RSP, -0xb00000)),
+        {0x4c, 0x39, 0x9c, 0x24, 0x00, 0x00, 0x50, 0xff});
+    checkBytes(X86Builder::lea(X86Memory(X86_REG_RSP, 0x80), X86_REG_RSP),
+        {0x48, 0x8d, 0xa4, 0x24, 0x80, 0x00, 0x00, 0x00});
+    checkBytes(X86Builder::incb(X86Memory(X86_REG_R10, 0x50000000)),
+        {0x41, 0xfe, 0x82, 0x00, 0x00, 0x00, 0x50});
+    checkBytes(X86Builder::shr(1, X86_REG_R10), {0x49, 0xd1, 0xea});
+    checkBytes(X86Builder::push(X86_REG_R11), {0x41, 0x53});
+    checkBytes(X86Builder::pop(X86_REG_EFLAGS), {0x9d});
+    checkBytes(X86Builder::push(-1), {0x6a, 0xff});
+}
+
+TEST_CASE("x86 builder links RIP-relative operands", "[instr][fast][x86_64]") {
+    auto load = X86Builder::mov(X86Memory::ripRelative(
+        new UnresolvedRelativeLink(0x1000)), X86_REG_R10);
+    auto store = X86Builder::mov(X86_REG_R10, X86Memory::ripRelative(
+        new UnresolvedRelativeLink(0x1000)));
+    auto xorIns = X86Builder::arithmetic(X86Builder::OP_XOR,
+        X86Memory::ripRelative(new UnresolvedRelativeLink(0x1000)),
+        X86_REG_R10);
+
+    for(auto instr : {load, store, xorIns}) {
+        checkAgainstCapstone(instr);
+
+        auto linked = dynamic_cast<LinkedInstruction *>(instr->getSemantic());
+        REQUIRE(linked != nullptr);
+        CHECK(linked->getLink() != nullptr);
+        CHECK(linked->getDispSize() == 4);
+        CHECK(linked->getDispOffset() == 3);
+    }
+    CHECK(static_cast<LinkedInstruction *>(load->getSemantic())
+        ->getIndex() == 0);
+    CHECK(static_cast<LinkedInstruction *>(store->getSemantic())
+        ->getIndex() == 1);
+    CHECK(dynamic_cast<ReturnInstruction *>(
+        X86Builder::ret()->getSemantic()) != nullptr);
+}
+#endif
+
+#ifdef ARCH_AARCH64
+TEST_CASE("AArch64 builder encodings match Capstone", "[instr][fast][aarch64]") {
+    std::vector<Instruction *> list = {
+        AARCH64Builder::nop(),
+        AARCH64Builder::mov(ARM64_REG_X0, 5),
+        AARCH64Builder::mov(ARM64_REG_X16, 0xffff),
+        AARCH64Builder::movn(ARM64_REG_X16, 0),
+        AARCH64Builder::eor(ARM64_REG_X30, ARM64_REG_X30, ARM64_REG_X16),
+        AARCH64Builder::add(ARM64_REG_X0, ARM64_REG_X1, 16),
+        AARCH64Builder::sub(ARM64_REG_SP, ARM64_REG_SP, 32),
+        AARCH64Builder::ldr(ARM64_REG_X0, ARM64_REG_SP, 8),
+        AARCH64Builder::ldr(ARM64_REG_X2, ARM64_REG_X3, 0),
+        AARCH64Builder::str(ARM64_REG_X30, ARM64_REG_SP, 0x7ff8),
+    };
+    for(auto instr : list) checkAgainstCapstone(instr);
+
+    auto bytes = AARCH64Builder::movn(ARM64_REG_X16, 0)
+        ->getSemantic()->getAssembly()->getBytes();
+    CHECK(std::memcmp(bytes, "\x10\x00\x80\x92", 4) == 0);
+}
+#endif
@@ -0,0 +1,143 @@
+#include <string>
+#include <vector>
+#include "framework/include.h"
+#include "pass/peephole.h"
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+#ifdef ARCH_X86_64
+static const std::string NOP        = "\x90";
+static const std::string PUSH_RDI   = "\x57";
+static const std::string POP_RDI    = "\x5f";
+static const std::string PUSH_RBX   = "\x53";
+static const std::string POP_RBX    = "\x5b";
+static const std::string PUSHF      = "\x9c";
+static const std::string POPF       = "\x9d";
+static const std::string STD        = "\xfd";
+static const std::string MOV_1_EAX  = std::string("\xb8\x01\x00\x00\x00", 5);
+static const std::string SETE_AL    = "\x0f\x94\xc0";
+static const std::string SUB_8_RSP  = "\x48\x83\xec\x08";
+static const std::string ADD_8_RSP  = "\x48\x83\xc4\x08";
+static const std::string LEA_M8_RSP = "\x48\x8d\x64\x24\xf8";
+static const std::string LEA_8_RSP  = "\x48\x8d\x64\x24\x08";
+static const std::string LEA_M16_RSP = "\x48\x8d\x64\x24\xf0";
+static const std::string RET        = "\xc3";
+static const std::string CALL       = "call";
+
+/*  Builds a one-block function from the given instructions, runs the pass
+    over it and returns what is left. The block starts with a nop, since
+    the first instruction of a block is never removed.
+*/
+static std::vector<std::string> optimize(
+    const std::vector<std::string> &code) {
+
+    auto external = new Function(0x2000);
+    external->setPosition(new AbsolutePosition(0x2000));
+
+    auto function = new Function(0x1000);
+    function->setPosition(new AbsolutePosition(0x1000));
+    auto block = new Block();
+    ChunkMutator(function).append(block);
+
+    std::vector<std::string> all = {NOP};
+    all.insert(all.end(), code.begin(), code.end());
+    for(const auto &bytes : all) {
+        Instruction *instr;
+        if(bytes == CALL) {
+            instr = new Instruction();
+            auto semantic = new ControlFlowInstruction(
+                X86_INS_CALL, instr, "\xe8", "callq", 4);
+            semantic->setLink(
+                new NormalLink(external, Link::SCOPE_EXTERNAL_JUMP));
+            instr->setSemantic(semantic);
+        }
+        else {
+            instr = Disassemble::instruction(
+                std::vector<unsigned char>(bytes.begin(), bytes.end()));
+        }
+        ChunkMutator(block).append(instr);
+    }
+
+    PeepholePass peephole;
+    function->accept(&peephole);
+
+    std::vector<std::string> result;
+    for(auto instr : CIter::children(block)) {
+        auto semantic = instr->getSemantic();
+        result.push_back(dynamic_cast<ControlFlowInstruction *>(semantic)
+            ? CALL : semantic->getData());
+    }
+    result.erase(result.begin());
+    return result;
+}
+#endif
+
+TEST_CASE("peephole drops a save of a dead register", "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    // rdi is not preserved across the return
+    CHECK(optimize({PUSH_RDI, MOV_1_EAX, POP_RDI, RET})
+        == (std::vector<std::string>{MOV_1_EAX, RET}));
+    CHECK(optimize({PUSH_RDI, POP_RDI, RET})
+        == (std::vector<std::string>{RET}));
+
+    // rbx is callee-saved, so it is live at the return
+    CHECK(optimize({PUSH_RBX, MOV_1_EAX, POP_RBX, RET})
+        == (std::vector<std::string>{PUSH_RBX, MOV_1_EAX, POP_RBX, RET}));
+#endif
+}
+
+TEST_CASE("peephole drops a restore that is saved again",
+    "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    CHECK(optimize({POP_RDI, PUSH_RDI, RET})
+        == (std::vector<std::string>{RET}));
+    CHECK(optimize({POP_RBX, PUSH_RBX, RET})
+        == (std::vector<std::string>{POP_RBX, PUSH_RBX, RET}));
+#endif
+}
+
+TEST_CASE("peephole drops pushf and popf when the flags are dead",
+    "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    CHECK(optimize({PUSHF, MOV_1_EAX, POPF, RET})
+        == (std::vector<std::string>{MOV_1_EAX, RET}));
+
+    // sete reads the restored flags
+    CHECK(optimize({PUSHF, MOV_1_EAX, POPF, SETE_AL, RET})
+        == (std::vector<std::string>{PUSHF, MOV_1_EAX, POPF, SETE_AL, RET}));
+
+    // popf would have restored the direction flag
+    CHECK(optimize({PUSHF, STD, POPF, RET})
+        == (std::vector<std::string>{PUSHF, STD, POPF, RET}));
+#endif
+}
+
+TEST_CASE("peephole replaces pushf and popf around a call",
+    "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    CHECK(optimize({PUSHF, CALL, POPF, RET})
+        == (std::vector<std::string>{LEA_M8_RSP, CALL, LEA_8_RSP, RET}));
+
+    CHECK(optimize({PUSHF, CALL, POPF, SETE_AL, RET})
+        == (std::vector<std::string>{PUSHF, CALL, POPF, SETE_AL, RET}));
+    CHECK(optimize({PUSHF, CALL, STD, POPF, RET})
+        == (std::vector<std::string>{PUSHF, CALL, STD, POPF, RET}));
+#endif
+}
+
+TEST_CASE("peephole merges stack adjustments", "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    CHECK(optimize({LEA_M8_RSP, LEA_M8_RSP, RET})
+        == (std::vector<std::string>{LEA_M16_RSP, RET}));
+    CHECK(optimize({SUB_8_RSP, ADD_8_RSP, RET})
+        == (std::vector<std::string>{RET}));
+    CHECK(optimize({SUB_8_RSP, MOV_1_EAX, ADD_8_RSP, RET})
+        == (std::vector<std::string>{MOV_1_EAX, RET}));
+
+    // add sets the flags that sete reads
+    CHECK(optimize({SUB_8_RSP, ADD_8_RSP, SETE_AL, RET})
+        == (std::vector<std::string>{SUB_8_RSP, ADD_8_RSP, SETE_AL, RET}));
+#endif
+}
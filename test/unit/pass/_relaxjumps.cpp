@@ -0,0 +1,115 @@
+#include "framework/include.h"
+#include "pass/relaxjumps.h"
+#include "chunk/concrete.h"
+#include "instr/builder.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+TEST_CASE("short forms of rel32 jump opcodes", "[pass][fast][x86_64]") {
+    CHECK(RelaxJumpsPass::getShortOpcode("\xe9") == "\xeb");          // jmp
+    CHECK(RelaxJumpsPass::getShortOpcode("\x0f\x84") == "\x74");      // je
+    CHECK(RelaxJumpsPass::getShortOpcode("\x0f\x85") == "\x75");      // jne
+    CHECK(RelaxJumpsPass::getShortOpcode("\x0f\x8f") == "\x7f");      // jg
+
+    CHECK(RelaxJumpsPass::getShortOpcode("\xe8").empty());            // call
+    CHECK(RelaxJumpsPass::getShortOpcode("\x0f\x05").empty());        // syscall
+    CHECK(RelaxJumpsPass::getShortOpcode("").empty());
+}
+
+#ifdef ARCH_X86_64
+static Instruction *makeJump(unsigned int id, const char *opcode,
+    const char *mnemonic) {
+
+    auto instr = new Instruction();
+    auto semantic = new ControlFlowInstruction(id, instr, opcode, mnemonic, 4);
+    instr->setSemantic(semantic);
+    return instr;
+}
+
+static void link(Instruction *jump, Instruction *target) {
+    auto v = static_cast<ControlFlowInstruction *>(jump->getSemantic());
+    v->setLink(new NormalLink(target, Link::SCOPE_INTERNAL_JUMP));
+}
+
+static Block *appendBlock(Function *function,
+    const std::vector<Instruction *> &instrs) {
+
+    auto block = new Block();
+    ChunkMutator(function).append(block);
+    ChunkMutator mutator(block);
+    for(auto instr : instrs) mutator.append(instr);
+    return block;
+}
+
+static std::vector<Instruction *> makeNops(size_t count) {
+    std::vector<Instruction *> nops;
+    for(size_t i = 0; i < count; i ++) nops.push_back(X86Builder::nop());
+    return nops;
+}
+#endif
+
+TEST_CASE("widening one jump can push another out of rel8 range",
+    "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    /*  0x1000  je   t1         short: reaches t1 only while jmp is short
+                jmp  t2         short: never reaches t2
+                124 x nop
+        t1:     nop
+                20 x nop
+        t2:     nop
+                jmp  t1         short both ways
+    */
+    auto je = makeJump(X86_INS_JE, "\x0f\x84", "je");
+    auto jmp = makeJump(X86_INS_JMP, "\xe9", "jmp");
+    auto back = makeJump(X86_INS_JMP, "\xe9", "jmp");
+    auto t1 = X86Builder::nop();
+    auto t2 = X86Builder::nop();
+
+    auto function = new Function(0x1000);
+    function->setPosition(new AbsolutePosition(0x1000));
+    appendBlock(function, {je});
+    appendBlock(function, {jmp});
+    appendBlock(function, makeNops(124));
+    auto t1Block = makeNops(20);
+    t1Block.insert(t1Block.begin(), t1);
+    appendBlock(function, t1Block);
+    appendBlock(function, {t2, back});
+    link(je, t1);
+    link(jmp, t2);
+    link(back, t1);
+
+    auto wideSize = function->getSize();
+    CHECK(wideSize == 6 + 5 + 124 + 1 + 20 + 1 + 5);
+
+    RelaxJumpsPass relax;
+    function->accept(&relax);
+
+    auto sizeOf = [] (Instruction *instr) {
+        return static_cast<ControlFlowInstruction *>(instr->getSemantic())
+            ->getDisplacementSize();
+    };
+    auto displacement = [] (Instruction *instr) {
+        return static_cast<long>(static_cast<ControlFlowInstruction *>(
+            instr->getSemantic())->calculateDisplacement());
+    };
+
+    // jmp t2 is 145 bytes away, so it is widened; that moves t1 to 129
+    // bytes past the end of je, so je is widened too
+    CHECK(sizeOf(je) == 4);
+    CHECK(sizeOf(jmp) == 4);
+    CHECK(sizeOf(back) == 1);
+    CHECK(je->getSemantic()->getSize() == 6);
+    CHECK(jmp->getSemantic()->getSize() == 5);
+    CHECK(back->getSemantic()->getSize() == 2);
+
+    // every jump still lands on its target
+    CHECK(je->getAddress() == 0x1000);
+    CHECK(jmp->getAddress() == 0x1006);
+    CHECK(t1->getAddress() == 0x1006 + 5 + 124);
+    CHECK(t2->getAddress() == t1->getAddress() + 1 + 20);
+    CHECK(displacement(je) == 129);
+    CHECK(displacement(jmp) == 145);
+    CHECK(displacement(back) == -24);
+    CHECK(function->getSize() == wideSize - 3);
+#endif
+}
@@ -0,0 +1,47 @@
+#include <sstream>
+#include "framework/include.h"
+#include "transform/alignment.h"
+
+TEST_CASE("NOP padding has the requested size", "[transform][fast]") {
+    for(size_t size = 0; size < 100; size++) {
+        CHECK(AlignmentPolicy::makeNops(size).size() == size);
+    }
+
+#ifdef ARCH_X86_64
+    CHECK(AlignmentPolicy::makeNop(1) == "\x90");
+    CHECK(AlignmentPolicy::makeNop(3) == std::string("\x0f\x1f\x00", 3));
+    CHECK(AlignmentPolicy::makeNop(AlignmentPolicy::getMaxNopSize() + 1)
+        .empty());
+
+    // as few instructions as possible, the longest first
+    auto nops = AlignmentPolicy::makeNops(14);
+    CHECK(nops.substr(0, 11) == AlignmentPolicy::makeNop(11));
+    CHECK(nops.substr(11) == AlignmentPolicy::makeNop(3));
+#elif defined(ARCH_AARCH64)
+    CHECK(AlignmentPolicy::makeNops(8)
+        == std::string("\x1f\x20\x03\xd5\x1f\x20\x03\xd5", 8));
+    CHECK(AlignmentPolicy::makeNop(2).empty());
+#endif
+}
+
+TEST_CASE("Alignment kept from original addresses", "[transform][fast]") {
+    CHECK(AlignmentPolicy::getAddressAlignment(0x401000, 16) == 16);
+    CHECK(AlignmentPolicy::getAddressAlignment(0x401008, 16) == 8);
+    CHECK(AlignmentPolicy::getAddressAlignment(0x401001, 16) == 1);
+    CHECK(AlignmentPolicy::getAddressAlignment(0x401040, 64) == 64);
+    CHECK(AlignmentPolicy::getAddressAlignment(0x401040, 48) == 32);
+    CHECK(AlignmentPolicy::getAddressAlignment(0, 32) == 32);
+}
+
+TEST_CASE("Alignment policy loop settings", "[transform][fast]") {
+    AlignmentPolicy none;
+    CHECK(!none.hasLoopAlignment());
+
+    AlignmentPolicy loops(16, 64, 32, 100);
+    CHECK(loops.hasLoopAlignment());
+    CHECK(loops.getLoopMaxSkip() <= AlignmentPolicy::getMaxNopSize());
+
+    std::istringstream stream("  120 [main]\n    0 [cold]\nnot a count\n");
+    loops.loadProfile(stream);
+    CHECK(loops.hasProfile());
+}
@@ -0,0 +1,296 @@
+#include <algorithm>  // for std::sort
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "framework/include.h"
+#include "transform/sandbox.h"
+
+// the allocator only needs the address range; nothing is mapped
+class RangeBacking {
+private:
+    address_t base;
+    size_t size;
+public:
+    RangeBacking(address_t base, size_t size) : base(base), size(size) {}
+    address_t getBase() const { return base; }
+    size_t getSize() const { return size; }
+};
+
+TEST_CASE("Free-list allocator reuses and coalesces freed slots",
+    "[transform][fast]") {
+
+    RangeBacking backing(0x1000, 0x1000);
+    FreeListAllocator<RangeBacking> alloc(&backing);
+
+    auto a = alloc.allocate(0x20);
+    auto b = alloc.allocate(0x18);  // rounded up to 0x20
+    auto c = alloc.allocate(0x40);
+    auto d = alloc.allocate(0x10);
+    CHECK(b.getSize() == 0x20);
+    CHECK(c.getAddress() == 0x1040);
+
+    alloc.free(a.getAddress());
+    alloc.free(c.getAddress());
+    CHECK(alloc.getFragmentation().freeBlocks == 2);
+
+    // b is between two free blocks, so all three merge
+    alloc.free(b.getAddress());
+    auto stats = alloc.getFragmentation();
+    CHECK(stats.freeBlocks == 1);
+    CHECK(stats.free == 0x80);
+    CHECK(stats.used == 0x10);
+
+    auto e = alloc.allocate(0x30);
+    CHECK(e.getAddress() == 0x1000);
+
+    // freeing the last slot retracts the watermark over the hole before it
+    alloc.free(d.getAddress());
+    CHECK(alloc.getCurrent() == 0x1030);
+    CHECK(alloc.getFragmentation().freeBlocks == 0);
+    alloc.free(e.getAddress());
+    CHECK(alloc.getCurrent() == 0x1000);
+    CHECK(alloc.getFragmentation().freeBlocks == 0);
+}
+
+TEST_CASE("Free-list allocator picks the best fit", "[transform][fast]") {
+    RangeBacking backing(0, 0x1000);
+    FreeListAllocator<RangeBacking> alloc(&backing);
+
+    std::vector<Slot> slots;
+    for(size_t size : {0x40, 0x10, 0x20, 0x10, 0x10}) {
+        slots.push_back(alloc.allocate(size));
+    }
+    alloc.free(slots[0].getAddress());  // 0x40 hole
+    alloc.free(slots[2].getAddress());  // 0x20 hole
+
+    CHECK(alloc.allocate(0x20).getAddress() == slots[2].getAddress());
+    CHECK(alloc.allocate(0x30).getAddress() == slots[0].getAddress());
+    CHECK(alloc.allocate(0x10).getAddress() == 0x30);
+}
+
+TEST_CASE("Free-list allocator throws when full", "[transform][fast]") {
+    RangeBacking backing(0, 0x100);
+    FreeListAllocator<RangeBacking> alloc(&backing);
+
+    auto a = alloc.allocate(0x80);
+    alloc.allocate(0x80);
+    CHECK_THROWS(alloc.allocate(0x10));
+
+    alloc.free(a.getAddress());
+    CHECK(alloc.getFragmentation().largest == 0x80);
+    CHECK_THROWS(alloc.allocate(0x90));
+    CHECK_NOTHROW(alloc.allocate(0x80));
+}
+
+TEST_CASE("Free-list allocator aligns slots", "[transform][fast]") {
+    RangeBacking backing(0x1000, 0x1000);
+    FreeListAllocator<RangeBacking> alloc(&backing);
+
+    alloc.allocate(0x10);
+    auto a = alloc.allocate(0x30, 0x40);
+    CHECK(a.getAddress() == 0x1040);
+    CHECK(alloc.getCurrent() == 0x1070);
+
+    // the space skipped is reused, by requests that need no alignment
+    CHECK(alloc.getFragmentation().free == 0x30);
+    CHECK(alloc.allocate(0x20).getAddress() == 0x1010);
+
+    // a free block is split on both sides of the aligned slot
+    alloc.allocate(0x10, 0x10);
+    auto b = alloc.allocate(0x100);
+    alloc.allocate(0x10);
+    alloc.free(b.getAddress());
+    auto c = alloc.allocate(0x40, 0x80);
+    CHECK(c.getAddress() == 0x1080);
+    CHECK(alloc.getFragmentation().freeBlocks == 2);
+
+    // freeing gives back the block it was carved from
+    alloc.free(c.getAddress());
+    auto stats = alloc.getFragmentation();
+    CHECK(stats.freeBlocks == 1);
+    CHECK(stats.free == 0x100);
+}
+
+TEST_CASE("Free-list allocator compaction", "[transform][fast]") {
+    RangeBacking backing(0x1000, 0x1000);
+    FreeListAllocator<RangeBacking> alloc(&backing);
+
+    std::vector<Slot> slots;
+    for(int i = 0; i < 8; i++) slots.push_back(alloc.allocate(0x10 * (i+1)));
+    for(int i = 0; i < 8; i += 2) alloc.free(slots[i].getAddress());
+
+    auto before = alloc.getFragmentation();
+    CHECK(before.getFragmentation() > 0);
+
+    auto moves = alloc.compact();
+    REQUIRE(moves.size() == 4);
+    address_t cursor = 0x1000;
+    for(auto move : moves) {
+        CHECK(move.to == cursor);
+        CHECK(move.to < move.from);
+        cursor += move.size;
+    }
+    CHECK(alloc.getCurrent() == cursor);
+
+    auto after = alloc.getFragmentation();
+    CHECK(after.used == before.used);
+    CHECK(after.freeBlocks == 0);
+    CHECK(after.getFragmentation() == 0);
+
+    // moved slots are freed by their new address
+    CHECK_NOTHROW(alloc.free(moves.back().to));
+    CHECK_THROWS(alloc.free(moves.back().from));
+}
+
+TEST_CASE("Free-list allocator stress", "[transform][fast]") {
+    const address_t base = 0x10000;
+    const size_t size = 0x10000;
+    RangeBacking backing(base, size);
+    FreeListAllocator<RangeBacking> alloc(&backing);
+
+    std::srand(1);
+    std::vector<Slot> live;
+    for(int round = 0; round < 20000; round++) {
+        if(live.empty() || std::rand() % 3) {
+            try {
+                size_t alignment = (std::rand() % 4) ? 0 : 0x40;
+                live.push_back(alloc.allocate(1 + std::rand() % 0x200,
+                    alignment));
+                if(alignment) CHECK(live.back().getAddress() % alignment == 0);
+            }
+            catch(const std::bad_alloc &) {}
+        }
+        else {
+            auto i = std::rand() % live.size();
+            alloc.free(live[i].getAddress());
+            live[i] = live.back();
+            live.pop_back();
+        }
+        if(round % 5000 == 4999) {
+            for(auto move : alloc.compact()) {
+                for(auto &slot : live) {
+                    if(slot.getAddress() == move.from) {
+                        slot = Slot(move.to, move.size);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // live slots never overlap and stay inside the backing
+    std::sort(live.begin(), live.end(), [](const Slot &a, const Slot &b)
+        { return a.getAddress() < b.getAddress(); });
+    size_t used = 0;
+    for(size_t i = 0; i < live.size(); i++) {
+        CHECK(live[i].getAddress() >= base);
+        CHECK(live[i].getAddress() + live[i].getSize() <= base + size);
+        if(i + 1 < live.size()) {
+            CHECK(live[i].getAddress() + live[i].getSize()
+                <= live[i+1].getAddress());
+        }
+        used += live[i].getSize();
+    }
+
+    auto stats = alloc.getFragmentation();
+    CHECK(stats.used == used);
+    CHECK(stats.used + stats.free + stats.tail == size);
+
+    for(auto slot : live) alloc.free(slot.getAddress());
+    CHECK(alloc.getCurrent() == base);
+    CHECK(alloc.getFragmentation().freeBlocks == 0);
+}
+
+typedef SandboxImpl<DualMappedBacking, WatermarkAllocator<DualMappedBacking>>
+    DualMappedSandbox;
+
+// writes a function that returns value, and returns its address
+static int (*writeReturn(DualMappedSandbox *sandbox, int value))() {
+#ifdef ARCH_X86_64
+    char code[] = {'\xb8', 0, 0, 0, 0, '\xc3'};     // mov $value, %eax; ret
+    std::memcpy(code + 1, &value, sizeof(value));
+#elif defined(ARCH_AARCH64)
+    unsigned int code[] = {
+        0x52800000u | (static_cast<unsigned int>(value) << 5),  // mov w0
+        0xd65f03c0u                                             // ret
+    };
+#endif
+    auto backing = static_cast<DualMappedBacking *>(sandbox->getBacking());
+    auto slot = sandbox->allocate(sizeof(code));
+    std::memcpy(reinterpret_cast<void *>(
+        backing->getWritableAddress(slot.getAddress())), code, sizeof(code));
+    sandbox->finalize();
+    return reinterpret_cast<int (*)()>(slot.getAddress());
+}
+
+TEST_CASE("forked processes JIT into their own sandbox copies",
+    "[transform][fast]") {
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
+    auto sandbox = new DualMappedSandbox(
+        DualMappedBacking(0x70000000, 0x10000));
+    auto function = writeReturn(sandbox, 1);
+    REQUIRE(function() == 1);
+
+    int toParent[2], toChild[2];
+    REQUIRE(pipe(toParent) == 0);
+    REQUIRE(pipe(toChild) == 0);
+    char c = 0;
+
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if(pid == 0) {
+        // the child sees the code from before the fork, then writes its own
+        int status = (function() == 1) ? 0 : 1;
+        sandbox->recreate();
+        if(writeReturn(sandbox, 2) != function) status |= 2;
+        if(write(toParent[1], &c, 1) != 1) status |= 4;
+        if(read(toChild[0], &c, 1) != 1) status |= 4;
+        if(function() != 2) status |= 8;
+        _exit(status);
+    }
+
+    REQUIRE(read(toParent[0], &c, 1) == 1);
+    CHECK(function() == 1);
+    sandbox->recreate();
+    CHECK(writeReturn(sandbox, 3) == function);
+    CHECK(function() == 3);
+    REQUIRE(write(toChild[1], &c, 1) == 1);
+
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+    CHECK(function() == 3);
+
+    for(int fd : {toParent[0], toParent[1], toChild[0], toChild[1]}) {
+        close(fd);
+    }
+#endif
+}
+
+TEST_CASE("retired slots are freed one reset point later",
+    "[transform][fast]") {
+
+    typedef SandboxImpl<DualMappedBacking,
+        FreeListAllocator<DualMappedBacking>> FreeListSandbox;
+    auto one = new FreeListSandbox(DualMappedBacking(0x71000000, 0x10000));
+    auto other = new FreeListSandbox(DualMappedBacking(0x72000000, 0x10000));
+    DualSandbox<FreeListSandbox> sandbox(one, other);
+
+    auto a = sandbox.allocate(0x40);
+    sandbox.allocate(0x40);
+    sandbox.retire(a);
+    CHECK(sandbox.allocate(0x40).getAddress() != a.getAddress());
+
+    sandbox.freeRetired();
+    CHECK(sandbox.allocate(0x40).getAddress() == a.getAddress());
+
+    // recreating the half drops slots retired from it
+    auto b = sandbox.allocate(0x20);
+    sandbox.retire(b);
+    sandbox.recreate();
+    CHECK_NOTHROW(sandbox.freeRetired());
+    CHECK(sandbox.allocate(0x20).getAddress() == 0x71000000);
+}
@@ -0,0 +1,50 @@
+#include <atomic>
+#include <vector>
+#include "framework/include.h"
+#include "util/parallel.h"
+
+TEST_CASE("parallel graph respects dependencies", "[util][fast]") {
+    // a chain 0 -> 2 -> 4 -> ..., each odd task depending on the one before
+    const size_t count = 64;
+    std::vector<std::vector<size_t>> after(count);
+    for(size_t i = 2; i < count; i ++) {
+        after[i].push_back(i - 2);
+        if(i % 2) after[i].push_back(i - 1);
+    }
+
+    for(size_t threads : {1, 4}) {
+        std::atomic<size_t> clock(0);
+        std::vector<size_t> finished(count);
+        parallelGraph(count, after, threads, [&] (size_t i) {
+            for(auto d : after[i]) CHECK(finished[d] != 0);
+            finished[i] = ++clock;
+        });
+        for(size_t i = 0; i < count; i ++) {
+            CHECK(finished[i] != 0);
+            for(auto d : after[i]) CHECK(finished[d] < finished[i]);
+        }
+        if(threads == 1) {
+            for(size_t i = 0; i < count; i ++) CHECK(finished[i] == i + 1);
+        }
+    }
+}
+
+TEST_CASE("parallel graph stops at the first error", "[util][fast]") {
+    std::vector<std::vector<size_t>> after = {{}, {0}, {1}, {}};
+    std::atomic<int> ran(0);
+    bool caught = false;
+    try {
+        parallelGraph(after.size(), after, 4, [&] (size_t i) {
+            ran ++;
+            if(i == 1) throw "failed";
+        });
+    }
+    catch(const char *message) {
+        caught = true;
+    }
+    CHECK(caught);
+    CHECK(ran <= 3);  // task 2 never starts
+
+    std::vector<std::vector<size_t>> backwards = {{1}, {}};
+    CHECK_THROWS(parallelGraph(2, backwards, 1, [] (size_t) {}));
+}
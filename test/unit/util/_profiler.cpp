@@ -0,0 +1,66 @@
+#include <sstream>
+#include "framework/include.h"
+#include "util/profiler.h"
+
+TEST_CASE("Profiler settings select the deepest scope", "[util][fast]") {
+    auto profiler = EgalitoProfiler::getInstance();
+
+    CHECK(profiler->configure("module:!summary"));
+    CHECK(EgalitoProfiler::isEnabled(EgalitoProfiler::LEVEL_PASS));
+    CHECK(EgalitoProfiler::isEnabled(EgalitoProfiler::LEVEL_MODULE));
+    CHECK(!EgalitoProfiler::isEnabled(EgalitoProfiler::LEVEL_FUNCTION));
+
+    CHECK(profiler->configure("trace=/dev/null:!summary"));
+    CHECK(EgalitoProfiler::isEnabled(EgalitoProfiler::LEVEL_PASS));
+    CHECK(!EgalitoProfiler::isEnabled(EgalitoProfiler::LEVEL_MODULE));
+
+    CHECK(!profiler->configure("pass:bogus:!summary"));
+    CHECK(!profiler->configure(""));
+    CHECK(!EgalitoProfiler::isEnabled(EgalitoProfiler::LEVEL_PASS));
+}
+
+TEST_CASE("Profiler aggregates nested scopes", "[util][fast]") {
+    auto profiler = EgalitoProfiler::getInstance();
+    REQUIRE(profiler->configure("function:trace=/dev/null:!summary"));
+    profiler->reset();
+
+    for(int i = 0; i < 3; i++) {
+        ProfileScope pass("TestPass()", EgalitoProfiler::LEVEL_PASS);
+        ProfileScope function(std::string("test_\"function\""),
+            EgalitoProfiler::LEVEL_FUNCTION);
+    }
+
+    std::ostringstream summary;
+    profiler->writeSummary(summary);
+    CHECK(summary.str().find("TestPass()") != std::string::npos);
+    CHECK(summary.str().find("       3 ") != std::string::npos);
+
+    unsigned long count;
+    auto total = profiler->getTotal(EgalitoProfiler::LEVEL_PASS, "Test",
+        &count);
+    CHECK(count == 3);
+    CHECK(total.wallUS >= 0);
+    profiler->getTotal(EgalitoProfiler::LEVEL_PASS, "Other", &count);
+    CHECK(count == 0);
+
+    std::ostringstream trace;
+    profiler->writeTrace(trace);
+    auto json = trace.str();
+    CHECK(json.compare(0, 15, "{\"traceEvents\":") == 0);
+    CHECK(json.find("\"name\":\"test_\\\"function\\\"\"") != std::string::npos);
+    CHECK(json.find("\"cat\":\"function\"") != std::string::npos);
+    CHECK(json.find("\"ph\":\"X\"") != std::string::npos);
+
+    // scopes below the configured level are not recorded
+    profiler->configure("pass:!summary");
+    profiler->reset();
+    {
+        ProfileScope module("module", EgalitoProfiler::LEVEL_MODULE);
+    }
+    std::ostringstream empty;
+    profiler->writeSummary(empty);
+    CHECK(empty.str().find("module") == std::string::npos);
+
+    profiler->configure("");
+    profiler->reset();
+}
@@ -0,0 +1,60 @@
+#include <cstring>
+#include <string>
+#include <vector>
+#include "framework/include.h"
+#include "util/stringtable.h"
+#include "util/parallel.h"
+
+TEST_CASE("String table interns equal strings once", "[util][fast]") {
+    auto &table = StringTable::getInstance();
+
+    auto a = table.intern("_test_interned_name");
+    auto b = table.intern(std::string("_test_interned_name"));
+    auto c = table.intern("_test_interned_name2");
+
+    CHECK(a == b);
+    CHECK(a != c);
+    CHECK(std::strcmp(table.get(a), "_test_interned_name") == 0);
+    CHECK(std::strcmp(table.get(c), "_test_interned_name2") == 0);
+}
+
+TEST_CASE("String table lookup does not intern", "[util][fast]") {
+    auto &table = StringTable::getInstance();
+
+    auto count = table.getCount();
+    CHECK(table.lookup("_test_never_interned") == StringTable::NONE);
+    CHECK(table.getCount() == count);
+
+    auto id = table.intern("_test_looked_up");
+    CHECK(table.lookup("_test_looked_up") == id);
+    CHECK(table.lookup(std::string("_test_looked_up")) == id);
+    CHECK(table.lookup("_test_looked_up", 5) != id);
+}
+
+TEST_CASE("String table interns concurrently", "[util][fast]") {
+    auto &table = StringTable::getInstance();
+
+    // enough names to grow the index and the entry chunks several times,
+    // with every thread interning and reading the same ones
+    const size_t names = 20000, threads = 4;
+    std::vector<std::vector<StringTable::ID>> ids(threads,
+        std::vector<StringTable::ID>(names));
+    std::vector<size_t> mismatches(threads);
+    parallelFor(threads, threads, [&] (size_t t) {
+        for(size_t i = 0; i < names; i++) {
+            size_t n = (t % 2 ? names - 1 - i : i);
+            auto name = "_test_concurrent_" + std::to_string(n);
+            auto id = table.intern(name);
+            ids[t][n] = id;
+            if(table.lookup(name) != id || name != table.get(id)) {
+                mismatches[t]++;
+            }
+        }
+    });
+
+    for(size_t t = 0; t < threads; t++) {
+        CHECK(mismatches[t] == 0);
+        CHECK(ids[t] == ids[0]);
+    }
+    CHECK(table.lookup("_test_concurrent_19999") == ids[0][names - 1]);
+}